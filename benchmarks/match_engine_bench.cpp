@@ -0,0 +1,465 @@
+// standalone micro-benchmarks for the native matching core, built without
+// pybind11 or python (make bench-native).
+//
+// each workload is generated up front as a list of ops in ticks/lots, with
+// an untimed prefill to build the starting book. ops are then replayed on
+// a fresh engine per backend twice: once with a clock read around every op
+// for the latency percentiles and allocation count, once without for
+// throughput. the generators track the book exactly, so every cancel hits
+// a resting order and every sweep empties the levels it targets.
+//
+// usage: match_engine_bench [--ops N] [--backend map|ladder|both]
+//                           [--only NAME] [--seed S]
+//                           [--flow FILE --tick T --lot L]
+//
+// --flow replays a recorded order flow: raw OP_DTYPE rows as written by
+// numpy's tofile(), e.g. from scripts/export_order_flow.py.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "match_engine.hpp"
+
+namespace {
+
+// every global allocation while counting is on is one tick here; the
+// engine's pool and index grow geometrically, so steady state should be
+// close to zero per op
+bool g_count_allocs = false;
+uint64_t g_allocs = 0;
+
+// every form of new below lands here, and every delete in std::free, so
+// each pair stays matched whichever one the compiler picks
+void* counted_alloc(size_t size, size_t align) {
+    if (g_count_allocs) ++g_allocs;
+    size = size ? size : 1;
+    if (align <= alignof(std::max_align_t)) return std::malloc(size);
+    // aligned_alloc wants a size that is a multiple of the alignment
+    return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+void* counted_new(size_t size, size_t align = alignof(std::max_align_t)) {
+    if (void* p = counted_alloc(size, align)) return p;
+    throw std::bad_alloc();
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return counted_new(size); }
+void* operator new[](size_t size) { return counted_new(size); }
+void* operator new(size_t size, std::align_val_t align) {
+    return counted_new(size, static_cast<size_t>(align));
+}
+void* operator new[](size_t size, std::align_val_t align) {
+    return counted_new(size, static_cast<size_t>(align));
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, alignof(std::max_align_t));
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, alignof(std::max_align_t));
+}
+void* operator new(size_t size, std::align_val_t align,
+                   const std::nothrow_t&) noexcept {
+    return counted_alloc(size, static_cast<size_t>(align));
+}
+void* operator new[](size_t size, std::align_val_t align,
+                     const std::nothrow_t&) noexcept {
+    return counted_alloc(size, static_cast<size_t>(align));
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Kind : uint8_t { INSERT, CANCEL, AMEND, SWEEP };
+constexpr const char* kKindNames[] = {"insert", "cancel", "amend", "sweep"};
+constexpr size_t kKinds = 4;
+
+struct Op {
+    Kind kind;
+    Side side;
+    OrderId id;
+    int64_t price;
+    int64_t size;
+};
+
+struct Workload {
+    std::string name;
+    std::vector<Op> prefill;
+    std::vector<Op> ops;
+};
+
+// mirror of match_engine.cpp's BatchOp, the OP_DTYPE row layout
+struct FlowRow {
+    uint8_t op;
+    uint8_t side;
+    double price;
+    double size;
+    int64_t timestamp;
+    uint64_t order_id;
+};
+static_assert(sizeof(FlowRow) == 40, "FlowRow must match OP_DTYPE");
+
+constexpr int64_t kMid = 1000000;
+
+Op insert(OrderId id, Side side, int64_t price, int64_t size) {
+    return Op{Kind::INSERT, side, id, price, size};
+}
+
+Op cancel(OrderId id) { return Op{Kind::CANCEL, Side::BUY, id, 0, 0}; }
+
+// ids of resting orders with O(1) random removal
+class LiveSet {
+public:
+    void add(OrderId id) { ids_.push_back(id); }
+    bool empty() const { return ids_.empty(); }
+    size_t size() const { return ids_.size(); }
+
+    OrderId take(std::mt19937_64& rng) {
+        size_t i = std::uniform_int_distribution<size_t>(0, ids_.size() - 1)(rng);
+        OrderId id = ids_[i];
+        ids_[i] = ids_.back();
+        ids_.pop_back();
+        return id;
+    }
+
+private:
+    std::vector<OrderId> ids_;
+};
+
+// a passive order 1..depth ticks behind the mid, never crossing
+Op passive(OrderId id, std::mt19937_64& rng, int64_t depth) {
+    Side side = rng() & 1 ? Side::BUY : Side::SELL;
+    int64_t offset = std::uniform_int_distribution<int64_t>(1, depth)(rng);
+    int64_t size = std::uniform_int_distribution<int64_t>(1, 10)(rng);
+    return insert(id, side, side == Side::BUY ? kMid - offset : kMid + offset, size);
+}
+
+// mostly new passive orders, some cancels, a book that keeps growing
+Workload add_heavy(size_t n, std::mt19937_64& rng) {
+    Workload w{"add_heavy", {}, {}};
+    LiveSet live;
+    OrderId next = 1;
+    for (int i = 0; i < 10000; ++i) {
+        w.prefill.push_back(passive(next, rng, 50));
+        live.add(next++);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (rng() % 10 == 0 && !live.empty()) {
+            w.ops.push_back(cancel(live.take(rng)));
+        } else {
+            w.ops.push_back(passive(next, rng, 50));
+            live.add(next++);
+        }
+    }
+    return w;
+}
+
+// a deep resting book being pulled, refilled a quarter of the time
+Workload cancel_heavy(size_t n, std::mt19937_64& rng) {
+    Workload w{"cancel_heavy", {}, {}};
+    LiveSet live;
+    OrderId next = 1;
+    for (int i = 0; i < 200000; ++i) {
+        w.prefill.push_back(passive(next, rng, 500));
+        live.add(next++);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (rng() % 4 != 0 && !live.empty()) {
+            w.ops.push_back(cancel(live.take(rng)));
+        } else {
+            w.ops.push_back(passive(next, rng, 500));
+            live.add(next++);
+        }
+    }
+    return w;
+}
+
+// aggressive orders that take out 50 levels of 20 orders each, then the
+// levels are refilled; alternates sides
+Workload sweep(size_t n, std::mt19937_64&) {
+    constexpr int64_t kLevels = 200, kSwept = 50, kPerLevel = 20, kSize = 5;
+    Workload w{"sweep", {}, {}};
+    OrderId next = 1;
+    auto fill_levels = [&](std::vector<Op>& out, Side side, int64_t levels) {
+        for (int64_t l = 0; l < levels; ++l) {
+            int64_t price = side == Side::BUY ? kMid - 1 - l : kMid + 1 + l;
+            for (int64_t k = 0; k < kPerLevel; ++k) {
+                out.push_back(insert(next++, side, price, kSize));
+            }
+        }
+    };
+    fill_levels(w.prefill, Side::BUY, kLevels);
+    fill_levels(w.prefill, Side::SELL, kLevels);
+    bool buy = true;
+    while (w.ops.size() < n) {
+        // exactly the resting size of the swept levels, so nothing rests
+        Side taker = buy ? Side::BUY : Side::SELL;
+        int64_t limit = buy ? kMid + kSwept : kMid - kSwept;
+        w.ops.push_back(Op{Kind::SWEEP, taker, next++, limit,
+                           kSwept * kPerLevel * kSize});
+        fill_levels(w.ops, buy ? Side::SELL : Side::BUY, kSwept);
+        buy = !buy;
+    }
+    w.ops.resize(n);
+    return w;
+}
+
+// one price with 100k orders queued: cancels from anywhere in the queue,
+// joins at the back and fills from the front
+Workload deep_queue(size_t n, std::mt19937_64& rng) {
+    constexpr int64_t kPrice = kMid - 1;
+    Workload w{"deep_queue", {}, {}};
+    std::vector<OrderId> queue;  // fifo order, dead ids skipped
+    std::vector<bool> dead;
+    size_t head = 0, alive = 0;
+    OrderId next = 1;
+    auto join = [&](std::vector<Op>& out) {
+        out.push_back(insert(next, Side::BUY, kPrice, 1));
+        queue.push_back(next++);
+        dead.push_back(false);
+        ++alive;
+    };
+    for (int i = 0; i < 100000; ++i) join(w.prefill);
+    for (size_t i = 0; i < n; ++i) {
+        // joins balance cancels plus fills, so the queue stays ~100k deep
+        uint64_t pick = rng() % 4;
+        if (pick < 2 || alive < 1000) {
+            join(w.ops);
+        } else if (pick == 2) {
+            size_t j;
+            do {
+                j = std::uniform_int_distribution<size_t>(head, queue.size() - 1)(rng);
+            } while (dead[j]);
+            dead[j] = true;
+            --alive;
+            w.ops.push_back(cancel(queue[j]));
+        } else {
+            while (dead[head]) ++head;
+            dead[head++] = true;
+            --alive;
+            w.ops.push_back(Op{Kind::SWEEP, Side::SELL, next++, kPrice, 1});
+        }
+    }
+    return w;
+}
+
+Workload recorded(const std::string& path, double tick, double lot) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open flow file " + path);
+    Instrument instrument(tick, lot);
+    Workload w{"recorded", {}, {}};
+    FlowRow row;
+    while (in.read(reinterpret_cast<char*>(&row), sizeof(row))) {
+        Side side = row.side == 0 ? Side::BUY : Side::SELL;
+        switch (row.op) {
+        case 0:
+            w.ops.push_back(insert(row.order_id, side, instrument.to_ticks(row.price),
+                                   instrument.to_lots(row.size)));
+            break;
+        case 1:
+            w.ops.push_back(cancel(row.order_id));
+            break;
+        case 2:
+            w.ops.push_back(
+                Op{Kind::AMEND, side, row.order_id, 0, instrument.to_lots(row.size)});
+            break;
+        default:
+            throw std::runtime_error("Unknown op type in flow file");
+        }
+    }
+    return w;
+}
+
+template <class Engine>
+void apply(Engine& engine, const Op& op, int64_t timestamp) {
+    switch (op.kind) {
+    case Kind::INSERT:
+    case Kind::SWEEP:
+        engine.insert(op.id, op.side, op.price, op.size, timestamp);
+        break;
+    case Kind::CANCEL:
+        engine.cancel(op.id);
+        break;
+    case Kind::AMEND:
+        engine.amend(op.id, op.size);
+        break;
+    }
+}
+
+template <class Engine>
+void prefill(Engine& engine, const Workload& w) {
+    engine.reserve(w.prefill.size() + w.ops.size());
+    int64_t t = 0;
+    for (const Op& op : w.prefill) apply(engine, op, t++);
+}
+
+int64_t percentile(const std::vector<int64_t>& sorted, double q) {
+    size_t i = static_cast<size_t>(q * static_cast<double>(sorted.size()));
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+template <class Engine>
+void run(const char* backend, const Workload& w) {
+    if (w.ops.empty()) return;
+    std::vector<int64_t> latency(w.ops.size());
+    uint64_t allocs = 0;
+    {
+        Engine engine;
+        prefill(engine, w);
+        int64_t t = static_cast<int64_t>(w.prefill.size());
+        g_allocs = 0;
+        g_count_allocs = true;
+        for (size_t i = 0; i < w.ops.size(); ++i) {
+            auto start = Clock::now();
+            apply(engine, w.ops[i], t++);
+            latency[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             Clock::now() - start)
+                             .count();
+        }
+        g_count_allocs = false;
+        allocs = g_allocs;
+    }
+
+    double seconds;
+    {
+        Engine engine;
+        prefill(engine, w);
+        int64_t t = static_cast<int64_t>(w.prefill.size());
+        auto start = Clock::now();
+        for (const Op& op : w.ops) apply(engine, op, t++);
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    std::printf("%-13s %-7s %-7s %10zu %9.2f %8s %8s %8s %9s %10.3f\n", w.name.c_str(),
+                backend, "all", w.ops.size(), w.ops.size() / seconds / 1e6, "", "", "",
+                "", static_cast<double>(allocs) / w.ops.size());
+    for (size_t k = 0; k < kKinds; ++k) {
+        std::vector<int64_t> sorted;
+        for (size_t i = 0; i < w.ops.size(); ++i) {
+            if (static_cast<size_t>(w.ops[i].kind) == k) sorted.push_back(latency[i]);
+        }
+        if (sorted.empty()) continue;
+        std::sort(sorted.begin(), sorted.end());
+        std::printf("%-13s %-7s %-7s %10zu %9s %8lld %8lld %8lld %9lld\n",
+                    w.name.c_str(), backend, kKindNames[k], sorted.size(), "",
+                    static_cast<long long>(percentile(sorted, 0.50)),
+                    static_cast<long long>(percentile(sorted, 0.99)),
+                    static_cast<long long>(percentile(sorted, 0.999)),
+                    static_cast<long long>(sorted.back()));
+    }
+}
+
+int64_t clock_overhead_ns() {
+    constexpr int kReads = 100000;
+    std::vector<int64_t> samples(kReads);
+    for (int i = 0; i < kReads; ++i) {
+        auto start = Clock::now();
+        samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         Clock::now() - start)
+                         .count();
+    }
+    std::sort(samples.begin(), samples.end());
+    return percentile(samples, 0.50);
+}
+
+[[noreturn]] void usage() {
+    std::fprintf(stderr,
+                 "usage: match_engine_bench [--ops N] [--backend map|ladder|both]\n"
+                 "                          [--only NAME] [--seed S]\n"
+                 "                          [--flow FILE --tick T --lot L]\n");
+    std::exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t n = 1000000;
+    std::string backend = "both", only, flow;
+    uint64_t seed = 42;
+    double tick = 0.01, lot = 0.00001;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) usage();
+        const char* value = argv[++i];
+        if (arg == "--ops") {
+            n = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--backend") {
+            backend = value;
+        } else if (arg == "--only") {
+            only = value;
+        } else if (arg == "--seed") {
+            seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--flow") {
+            flow = value;
+        } else if (arg == "--tick") {
+            tick = std::strtod(value, nullptr);
+        } else if (arg == "--lot") {
+            lot = std::strtod(value, nullptr);
+        } else {
+            usage();
+        }
+    }
+    if (backend != "map" && backend != "ladder" && backend != "both") usage();
+
+    std::mt19937_64 rng(seed);
+    std::vector<Workload> workloads;
+    try {
+        if (!flow.empty()) {
+            workloads.push_back(recorded(flow, tick, lot));
+        } else {
+            workloads.push_back(add_heavy(n, rng));
+            workloads.push_back(cancel_heavy(n, rng));
+            workloads.push_back(sweep(n, rng));
+            workloads.push_back(deep_queue(n, rng));
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    std::printf("clock read overhead ~%lld ns, included in latencies\n\n",
+                static_cast<long long>(clock_overhead_ns()));
+    std::printf("%-13s %-7s %-7s %10s %9s %8s %8s %8s %9s %10s\n", "workload",
+                "backend", "op", "count", "Mops/s", "p50 ns", "p99 ns", "p999 ns",
+                "max ns", "allocs/op");
+    for (const Workload& w : workloads) {
+        if (!only.empty() && w.name != only) continue;
+        try {
+            if (backend != "ladder") run<MapMatchEngine>("map", w);
+            if (backend != "map") run<LadderMatchEngine>("ladder", w);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s: %s\n", w.name.c_str(), e.what());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,536 @@
+"""
+end-to-end replay benchmark for the market data pipeline
+
+a fixed parquet corpus, as written by the recorder, is replayed through each
+stage on its own so every stage gets a clean ns/msg:
+
+    parquet_decode   pq.read_table, to_pandas and iterrows, the simulator's
+                     parquet path
+    simulator        Simulator._process_message over those rows (incremental
+                     book, NaiveMaker strategy)
+    matching         MatchEngine.apply_depth_update plus replacing one quote
+                     per side one tick behind the market
+    features         FillProbabilityModel.feature_matrix (spread, volumes and
+                     imbalances) and the rolling volatility on the top levels
+    quote            EVMaker.quote_prices on the same book states
+    features_native  MatchEngine.update_features into a FeaturePipeline
+    quote_native     NativeEVMaker.quote_prices
+
+messages/sec is for the python reference path, the first five stages one
+after another. peak RSS is the process high-water mark. each run is
+appended to a jsonl results file with the commit it ran on and compared
+with the last run on the same corpus, so a regression shows up as a
+per-stage percentage.
+
+record a real corpus with the recorder, e.g.
+    PYTHONPATH=src python -m data_feed.recorder --timeout 600 \
+        --fast-decode --output-path data/bench
+or generate a deterministic synthetic BTCUSDT one with --generate N.
+
+usage: PYTHONPATH=src python benchmarks/pipeline_bench.py [--corpus FILE]
+       [--generate N] [--messages N] [--repeat R] [--only STAGE,...]
+       [--results FILE] [--no-save] [--fail-over PCT]
+"""
+
+import argparse
+import contextlib
+import datetime
+import hashlib
+import json
+import logging
+import os
+import platform
+import random
+import resource
+import subprocess
+import sys
+import tempfile
+import time
+from decimal import Decimal
+from pathlib import Path
+from typing import Any, Callable, Dict, List, Optional, Sequence, Tuple
+
+import pyarrow.parquet as pq
+
+from backtest.simulator import Simulator
+from data_feed.parquet_writer import ParquetWriter, decode_levels, schema_units
+from features.volatility import VolatilityCalculator
+from match_engine import FeaturePipeline, MatchEngine, Side
+from models.fill_prob import FillProbabilityModel
+from models.size_calculator import SizeConfig
+from strategy.ev_maker import EVConfig, EVMaker, NativeEVMaker
+from strategy.naive_maker import NaiveMaker, NaiveMakerConfig
+
+ROOT = Path(__file__).resolve().parent.parent
+DEFAULT_CORPUS = ROOT / "data" / "bench" / "btcusdt_20240610.parquet"
+DEFAULT_RESULTS = ROOT / "benchmarks" / "results" / "pipeline.jsonl"
+
+# generated corpus: binance btcusdt's grid, one message every 100ms from
+# midnight utc so a day holds it without rotating files
+CORPUS_TICK = "0.01"
+CORPUS_LOT = "0.00001"
+CORPUS_START = 1717977600000  # 2024-06-10 00:00:00 utc
+CORPUS_INTERVAL_MS = 100
+CORPUS_DEPTH = 20
+
+# levels the features and quotes see, as the live engine passes them
+FEATURE_DEPTH = 5
+
+# the python reference path, summed for the end-to-end throughput
+PIPELINE = ("parquet_decode", "simulator", "matching", "features", "quote")
+STAGES = PIPELINE + ("features_native", "quote_native")
+
+# (E, U, u, bids, asks) with decimal string levels
+Message = Tuple[int, int, int, List[List[str]], List[List[str]]]
+# (bids, asks, best bid, best ask, mid) after a message, top levels only
+BookState = Tuple[List[List[str]], List[List[str]], Decimal, Decimal, Decimal]
+
+
+def generate_corpus(path: Path, messages: int, seed: int = 7) -> None:
+    """write a deterministic synthetic depth diff stream as a parquet file
+
+    the book is tracked exactly so every diff is consistent: the top moves
+    by a tick at a time, levels near it change size or empty, and each side
+    keeps CORPUS_DEPTH levels
+
+    args:
+        path: parquet file to write
+        messages: number of depth updates, the first is the starting book
+        seed: random seed, the same seed gives the same file
+    """
+    rng = random.Random(seed)
+    mid = 6_000_000  # 60000.00 in ticks
+    bids = {mid - 1 - i: rng.randint(1, 200_000) for i in range(CORPUS_DEPTH)}
+    asks = {mid + i: rng.randint(1, 200_000) for i in range(CORPUS_DEPTH)}
+
+    def price(ticks: int) -> str:
+        return f"{ticks // 100}.{ticks % 100:02d}"
+
+    def qty(lots: int) -> str:
+        return f"{lots // 100_000}.{lots % 100_000:05d}"
+
+    with tempfile.TemporaryDirectory(dir=path.parent) as tmp:
+        writer = ParquetWriter(
+            symbol="btcusdt",
+            base_path=tmp,
+            schema_version=2,
+            tick_size=CORPUS_TICK,
+            lot_size=CORPUS_LOT,
+        )
+        update_id = 1
+        changes: Dict[str, Dict[int, int]] = {"b": dict(bids), "a": dict(asks)}
+        for i in range(messages):
+            if i > 0:
+                changes = {"b": {}, "a": {}}
+                before = {"b": set(bids), "a": set(asks)}
+                for _ in range(rng.randint(1, 6)):
+                    key = rng.choice("ba")
+                    _change_level(rng, key, bids, asks, changes[key])
+                # a level added and emptied within one message is never sent
+                for key in "ba":
+                    for level in [p for p, q in changes[key].items() if q == 0]:
+                        if level not in before[key]:
+                            del changes[key][level]
+            first_id = update_id
+            update_id += rng.randint(0, 3)
+            writer.write(
+                {
+                    "e": "depthUpdate",
+                    "E": CORPUS_START + i * CORPUS_INTERVAL_MS,
+                    "s": "BTCUSDT",
+                    "U": first_id,
+                    "u": update_id,
+                    "b": [
+                        [price(p), qty(q)]
+                        for p, q in sorted(changes["b"].items(), reverse=True)
+                    ],
+                    "a": [[price(p), qty(q)] for p, q in sorted(changes["a"].items())],
+                }
+            )
+            update_id += 1
+        writer.close()
+        (written,) = Path(tmp).glob("*.parquet")
+        os.replace(written, path)
+
+
+def _change_level(
+    rng: random.Random,
+    key: str,
+    bids: Dict[int, int],
+    asks: Dict[int, int],
+    changes: Dict[int, int],
+) -> None:
+    """apply one random change to a side of the book and record it"""
+    levels, sign = (bids, 1) if key == "b" else (asks, -1)
+    best = max(bids) if key == "b" else min(asks)
+    other = min(asks) if key == "b" else max(bids)
+    roll = rng.random()
+    if roll < 0.1 and (best + sign - other) * sign < 0:
+        # improve the top by a tick without crossing
+        price = best + sign
+        size = rng.randint(1, 200_000)
+    elif roll < 0.2 and len(levels) > CORPUS_DEPTH // 2:
+        price, size = best, 0
+    else:
+        ranked = sorted(levels, reverse=key == "b")
+        price = ranked[rng.randrange(len(ranked))]
+        size = 0 if rng.random() < 0.15 else rng.randint(1, 200_000)
+    if size == 0:
+        del levels[price]
+    else:
+        levels[price] = size
+    changes[price] = size
+    # refill behind the worst level so the side keeps its depth
+    while len(levels) < CORPUS_DEPTH:
+        worst = min(levels) if key == "b" else max(levels)
+        price = worst - sign
+        levels[price] = changes[price] = rng.randint(1, 200_000)
+
+
+def _ns() -> int:
+    return time.perf_counter_ns()
+
+
+def bench_parquet_decode(path: Path, limit: Optional[int]) -> Tuple[int, List, Any]:
+    """time the simulator's parquet path from file to rows
+
+    returns:
+        (elapsed ns, rows, tick/lot units of the file)
+    """
+    start = _ns()
+    table = pq.read_table(path)
+    if limit is not None:
+        table = table.slice(0, limit)
+    rows = [row for _, row in table.to_pandas().iterrows()]
+    return _ns() - start, rows, schema_units(table.schema)
+
+
+def bench_simulator(path: Path, rows: Sequence, units: Any) -> int:
+    """time Simulator._process_message over decoded rows"""
+    strategy = NaiveMaker(NaiveMakerConfig())
+    simulator = Simulator(
+        symbol="btcusdt",
+        data_path=str(path.parent),
+        strategy=strategy.quote_prices,
+        incremental=True,
+    )
+    simulator._level_units = units
+    start = _ns()
+    for row in rows:
+        simulator._process_message(row)
+    return _ns() - start
+
+
+def bench_matching(messages: Sequence[Message], tick: float, lot: float) -> int:
+    """time depth updates and quote replaces on the native engine"""
+    engine = MatchEngine(tick, lot)
+    engine.reset_market(messages[0][1] - 1)
+    size = round(0.001 / lot)
+    ids = {Side.BUY: 0, Side.SELL: 0}
+    next_id = 1
+    start = _ns()
+    for event_time, first_id, final_id, bids, asks in messages:
+        engine.apply_depth_update(first_id, final_id, bids, asks)
+        best_bid, best_ask = engine.market_best_bid, engine.market_best_ask
+        if not best_bid or not best_ask:
+            continue
+        for side, price in (
+            (Side.BUY, round(best_bid / tick) - 1),
+            (Side.SELL, round(best_ask / tick) + 1),
+        ):
+            if ids[side]:
+                engine.submit_replace(ids[side], next_id, price, size, event_time)
+            else:
+                engine.submit(next_id, side, price, size, event_time)
+            ids[side] = next_id
+            next_id += 1
+    return _ns() - start
+
+
+def bench_features_native(messages: Sequence[Message], tick: float, lot: float) -> int:
+    """time update_features alone, the diffs are applied outside the timer"""
+    engine = MatchEngine(tick, lot)
+    engine.reset_market(messages[0][1] - 1)
+    features = FeaturePipeline()
+    elapsed = 0
+    for _, first_id, final_id, bids, asks in messages:
+        engine.apply_depth_update(first_id, final_id, bids, asks)
+        start = _ns()
+        engine.update_features(features)
+        elapsed += _ns() - start
+    return elapsed
+
+
+def book_states(
+    messages: Sequence[Message], tick: float, lot: float
+) -> List[BookState]:
+    """top of book after every message, as strings and decimals"""
+    engine = MatchEngine(tick, lot)
+    engine.reset_market(messages[0][1] - 1)
+    states = []
+    for _, first_id, final_id, bids, asks in messages:
+        engine.apply_depth_update(first_id, final_id, bids, asks)
+        top_bids, top_asks = engine.market_snapshot(FEATURE_DEPTH)
+        if not top_bids or not top_asks:
+            continue
+        best_bid = Decimal(repr(top_bids[0][0]))
+        best_ask = Decimal(repr(top_asks[0][0]))
+        states.append(
+            (
+                [[repr(p), repr(q)] for p, q in top_bids],
+                [[repr(p), repr(q)] for p, q in top_asks],
+                best_bid,
+                best_ask,
+                (best_bid + best_ask) / 2,
+            )
+        )
+    return states
+
+
+def bench_features(states: Sequence[BookState]) -> int:
+    """time the python book features and volatility per book state"""
+    fill_model = FillProbabilityModel(
+        model_path=tempfile.gettempdir() + "/pipeline_bench_fill_prob.joblib"
+    )
+    volatility = VolatilityCalculator()
+    size = Decimal("0.001")
+    sides = ["buy", "sell"]
+    start = _ns()
+    for bids, asks, best_bid, best_ask, mid in states:
+        fill_model.feature_matrix(bids, asks, [best_bid, best_ask], size, sides)
+        volatility.update(mid)
+    return _ns() - start
+
+
+def bench_quote(states: Sequence[BookState], maker: Any) -> int:
+    """time quote_prices per book state, its debug output discarded"""
+    volatility = Decimal("0.01")
+    probability = Decimal("0.5")
+    with open(os.devnull, "w") as devnull, contextlib.redirect_stdout(devnull):
+        start = _ns()
+        for bids, asks, best_bid, best_ask, mid in states:
+            maker.quote_prices(
+                mid_price=mid,
+                volatility=volatility,
+                bid_probability=probability,
+                ask_probability=probability,
+                best_bid=best_bid,
+                best_ask=best_ask,
+                bids=bids,
+                asks=asks,
+            )
+        return _ns() - start
+
+
+def run_stages(
+    path: Path, stages: Sequence[str], limit: Optional[int], repeat: int
+) -> Tuple[int, Dict[str, float]]:
+    """run the selected stages, keeping each one's best of repeat runs
+
+    returns:
+        (messages in the corpus, stage -> ns per message)
+    """
+    results: Dict[str, float] = {}
+
+    def best(name: str, count: int, run: Callable[[], int]) -> None:
+        if name in stages and count:
+            results[name] = min(run() for _ in range(repeat)) / count
+
+    # the decode stage also produces every later stage's input
+    elapsed, rows, units = bench_parquet_decode(path, limit)
+    if "parquet_decode" in stages:
+        runs = [elapsed] + [
+            bench_parquet_decode(path, limit)[0] for _ in range(repeat - 1)
+        ]
+        results["parquet_decode"] = min(runs) / len(rows)
+
+    tick, lot = (float(u) for u in units) if units else (1e-8, 1e-8)
+    messages: List[Message] = [
+        (
+            int(row["event_time"]),
+            int(row["first_update_id"]),
+            int(row["final_update_id"]),
+            decode_levels(row["bids"], units),
+            decode_levels(row["asks"], units),
+        )
+        for row in rows
+    ]
+    best("simulator", len(rows), lambda: bench_simulator(path, rows, units))
+    best("matching", len(messages), lambda: bench_matching(messages, tick, lot))
+    best(
+        "features_native",
+        len(messages),
+        lambda: bench_features_native(messages, tick, lot),
+    )
+
+    states = book_states(messages, tick, lot)
+    best("features", len(states), lambda: bench_features(states))
+    best(
+        "quote",
+        len(states),
+        lambda: bench_quote(states, EVMaker(EVConfig(), SizeConfig())),
+    )
+    best(
+        "quote_native",
+        len(states),
+        lambda: bench_quote(states, NativeEVMaker(EVConfig(), SizeConfig(), tick, lot)),
+    )
+    return len(rows), results
+
+
+def peak_rss_mb() -> float:
+    """process high-water mark, ru_maxrss is KiB on linux and bytes on macos"""
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return peak / (1 << 20) if sys.platform == "darwin" else peak / (1 << 10)
+
+
+def _git(*args: str) -> str:
+    try:
+        return subprocess.run(
+            ["git", *args], cwd=ROOT, capture_output=True, text=True, check=True
+        ).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return ""
+
+
+def file_digest(path: Path) -> str:
+    """sha256 of the corpus, so results are only compared on the same data"""
+    digest = hashlib.sha256()
+    with open(path, "rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            digest.update(block)
+    return digest.hexdigest()
+
+
+def previous_result(
+    results_path: Path, corpus_digest: str, messages: int
+) -> Optional[Dict[str, Any]]:
+    """last stored run on the same corpus and message count"""
+    if not results_path.exists():
+        return None
+    previous = None
+    with open(results_path) as f:
+        for line in f:
+            record = json.loads(line)
+            if (
+                record.get("corpus_sha256") == corpus_digest
+                and record.get("messages") == messages
+            ):
+                previous = record
+    return previous
+
+
+def report(
+    record: Dict[str, Any], previous: Optional[Dict[str, Any]]
+) -> List[Tuple[str, float]]:
+    """print the run, with deltas against previous when there is one
+
+    returns:
+        (stage, fractional change) for every stage slower than previous
+    """
+    old = previous["stages"] if previous else {}
+    if previous:
+        print(f"compared with {previous['commit'] or 'unknown'} ({previous['time']})")
+    print(f"{'stage':<16} {'ns/msg':>12} {'msgs/sec':>12} {'change':>9}")
+    changes = []
+    for name, ns in record["stages"].items():
+        line = f"{name:<16} {ns:>12.0f} {1e9 / ns:>12.0f}"
+        if name in old:
+            change = ns / old[name] - 1
+            line += f" {change:>+8.1%}"
+            changes.append((name, change))
+        print(line)
+    if record["pipeline_ns_per_msg"]:
+        print(
+            f"pipeline: {record['messages_per_sec']:.0f} msgs/sec "
+            f"({record['pipeline_ns_per_msg']:.0f} ns/msg over {len(PIPELINE)} "
+            f"stages), peak RSS {record['peak_rss_mb']:.1f} MiB"
+        )
+    return [(name, change) for name, change in changes if change > 0]
+
+
+def main() -> None:
+    """parse arguments, run the stages and store the results"""
+    parser = argparse.ArgumentParser(description="Pipeline replay benchmark")
+    parser.add_argument("--corpus", type=Path, default=DEFAULT_CORPUS)
+    parser.add_argument(
+        "--generate",
+        type=int,
+        metavar="N",
+        help="write a synthetic corpus of N messages to --corpus first",
+    )
+    parser.add_argument("--seed", type=int, default=7)
+    parser.add_argument("--messages", type=int, help="replay only the first N messages")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument(
+        "--only", type=str, help=f"comma separated subset of {','.join(STAGES)}"
+    )
+    parser.add_argument("--results", type=Path, default=DEFAULT_RESULTS)
+    parser.add_argument("--no-save", action="store_true")
+    parser.add_argument(
+        "--fail-over",
+        type=float,
+        metavar="PCT",
+        help="exit 1 if a stage is more than PCT percent slower than last time",
+    )
+    args = parser.parse_args()
+
+    stages = STAGES if args.only is None else tuple(args.only.split(","))
+    unknown = set(stages) - set(STAGES)
+    if unknown:
+        parser.error(f"unknown stages: {','.join(sorted(unknown))}")
+    if args.repeat < 1:
+        parser.error("--repeat must be at least 1")
+
+    if args.generate:
+        args.corpus.parent.mkdir(parents=True, exist_ok=True)
+        generate_corpus(args.corpus, args.generate, args.seed)
+    if not args.corpus.exists():
+        parser.error(f"no corpus at {args.corpus}, record one or use --generate N")
+
+    # the simulator logs per message otherwise
+    logging.disable(logging.WARNING)
+    messages, ns_per_msg = run_stages(args.corpus, stages, args.messages, args.repeat)
+
+    pipeline_ns = (
+        sum(ns_per_msg[name] for name in PIPELINE)
+        if all(name in ns_per_msg for name in PIPELINE)
+        else None
+    )
+    digest = file_digest(args.corpus)
+    record = {
+        "commit": _git("rev-parse", "--short", "HEAD"),
+        "dirty": bool(_git("status", "--porcelain", "--untracked-files=no")),
+        "time": datetime.datetime.now(datetime.timezone.utc).isoformat(
+            timespec="seconds"
+        ),
+        "corpus": args.corpus.name,
+        "corpus_sha256": digest,
+        "messages": messages,
+        "python": platform.python_version(),
+        "backend": MatchEngine.__name__,
+        "stages": {name: ns_per_msg[name] for name in STAGES if name in ns_per_msg},
+        "pipeline_ns_per_msg": pipeline_ns,
+        "messages_per_sec": 1e9 / pipeline_ns if pipeline_ns else None,
+        "peak_rss_mb": peak_rss_mb(),
+    }
+
+    print(f"{args.corpus.name}: {messages} messages, best of {args.repeat}")
+    slower = report(record, previous_result(args.results, digest, messages))
+    if not args.no_save:
+        args.results.parent.mkdir(parents=True, exist_ok=True)
+        with open(args.results, "a") as f:
+            f.write(json.dumps(record) + "\n")
+    if args.fail_over is not None:
+        regressions = [
+            f"{name} {change:+.1%}"
+            for name, change in slower
+            if change * 100 > args.fail_over
+        ]
+        if regressions:
+            print(f"regressions over {args.fail_over}%: {', '.join(regressions)}")
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
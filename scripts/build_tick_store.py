@@ -0,0 +1,34 @@
+"""
+build memory-mapped tick store files from recorded parquet files, with book
+checkpoints every 10000 messages for replays that start mid-day
+
+usage: PYTHONPATH=src python scripts/build_tick_store.py <output_dir> <parquet>...
+"""
+
+import datetime
+import sys
+from pathlib import Path
+
+from storage.tick_store import convert_parquet, write_checkpoints
+
+
+def main() -> None:
+    """convert every parquet file given on the command line"""
+    if len(sys.argv) < 3:
+        print(__doc__.strip().splitlines()[-1])
+        sys.exit(1)
+
+    output_dir = sys.argv[1]
+    for parquet_path in sys.argv[2:]:
+        # files are named {symbol}_{YYYYMMDD}.parquet by ParquetWriter
+        symbol, day = Path(parquet_path).stem.rsplit("_", 1)
+        count = convert_parquet(parquet_path, output_dir, symbol)
+        checkpoints = 0
+        if count:
+            date = datetime.datetime.strptime(day, "%Y%m%d").date()
+            checkpoints = write_checkpoints(output_dir, symbol, date)
+        print(f"{parquet_path}: {count} messages, {checkpoints} checkpoints")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,99 @@
+"""
+turn a recorded tick store day into an order flow for the native benchmark
+
+every level quantity increase becomes a new order at that price and every
+decrease pulls from the newest orders at the level: whole orders are
+cancelled, the last one is amended down. the rows are OP_DTYPE and written
+raw, the --flow input of benchmarks/match_engine_bench.
+
+usage: python scripts/export_order_flow.py <dir> <symbol> <date> <output> [messages]
+"""
+
+import datetime
+import sys
+from collections import defaultdict
+from typing import Dict, List, Tuple
+
+import numpy as np
+
+from match_engine import OP_DTYPE, OpType
+from storage.tick_store import TickStoreReader
+
+BUY, SELL = 0, 1
+
+
+def order_flow(reader: TickStoreReader, max_messages: int = 0) -> np.ndarray:
+    """build OP_DTYPE rows from the store's depth diffs
+
+    args:
+        reader: tick store day to convert
+        max_messages: stop after this many messages, 0 for all
+
+    returns:
+        OP_DTYPE rows with prices and sizes in exchange units
+    """
+    tick = float(reader.tick_size)
+    lot = float(reader.lot_size)
+    insert, cancel, amend = int(OpType.INSERT), int(OpType.CANCEL), int(OpType.AMEND)
+    rows: List[Tuple[int, int, float, float, int, int]] = []
+    # (side, price ticks) -> [order_id, lots] oldest first, and their total
+    levels: Dict[Tuple[int, int], List[List[int]]] = defaultdict(list)
+    totals: Dict[Tuple[int, int], int] = defaultdict(int)
+    next_id = 1
+
+    count = len(reader) if max_messages <= 0 else min(max_messages, len(reader))
+    for position in range(count):
+        event_time, _, _, bids, asks = reader.message(position)
+        for side, side_levels in ((BUY, bids), (SELL, asks)):
+            for price, qty in side_levels.tolist():
+                key = (side, price)
+                orders = levels[key]
+                delta = qty - totals[key]
+                totals[key] = qty
+                if delta > 0:
+                    rows.append(
+                        (insert, side, price * tick, delta * lot, event_time, next_id)
+                    )
+                    orders.append([next_id, delta])
+                    next_id += 1
+                while delta < 0 and orders:
+                    order_id, size = orders[-1]
+                    if size <= -delta:
+                        rows.append((cancel, side, 0.0, 0.0, event_time, order_id))
+                        orders.pop()
+                        delta += size
+                    else:
+                        remaining = size + delta
+                        orders[-1][1] = remaining
+                        rows.append(
+                            (amend, side, 0.0, remaining * lot, event_time, order_id)
+                        )
+                        delta = 0
+                if not orders:
+                    del levels[key]
+                    del totals[key]
+
+    return np.array(rows, dtype=OP_DTYPE)
+
+
+def main() -> None:
+    """export one day given on the command line"""
+    if len(sys.argv) not in (5, 6):
+        print(__doc__.strip().splitlines()[-1])
+        sys.exit(1)
+
+    base_path, symbol, date, output = sys.argv[1:5]
+    max_messages = int(sys.argv[5]) if len(sys.argv) == 6 else 0
+    reader = TickStoreReader.open(
+        base_path, symbol, datetime.date.fromisoformat(date)
+    )
+    rows = order_flow(reader, max_messages)
+    rows.tofile(output)
+    print(
+        f"{output}: {len(rows)} ops, run with "
+        f"--flow {output} --tick {reader.tick_size} --lot {reader.lot_size}"
+    )
+
+
+if __name__ == "__main__":
+    main()
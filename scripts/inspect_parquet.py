@@ -1,11 +1,26 @@
 import sys
 import pandas as pd
+import pyarrow.parquet as pq
 
-# usage: python scripts/inspect_parquet.py <parquet_file>
+from data_feed.parquet_writer import decode_levels, schema_units
+
+# usage: PYTHONPATH=src python scripts/inspect_parquet.py <parquet_file>
 if len(sys.argv) < 2:
-    print('usage: python scripts/inspect_parquet.py <parquet_file>')
+    print('usage: PYTHONPATH=src python scripts/inspect_parquet.py <parquet_file>')
     sys.exit(1)
 
 file = sys.argv[1]
-df = pd.read_parquet(file)
-print(df.head(10)) 
\ No newline at end of file
+units = schema_units(pq.read_schema(file))
+if units is None:
+    print('schema version 1 (string levels)')
+else:
+    print(f'schema version 2 (tick_size={units[0]}, lot_size={units[1]})')
+
+df = pd.read_parquet(file).head(10)
+# show both versions as "price,qty" strings
+for side in ('bids', 'asks'):
+    df[side] = [
+        [','.join(level) for level in decode_levels(levels, units)]
+        for levels in df[side]
+    ]
+print(df)
@@ -47,15 +47,52 @@ if sys.platform == "darwin":
         extra_compile_args += [f"-isysroot{sdk_path}"]
         print(f"Using SDK path: {sdk_path}")
 
+# book backend behind match_engine.MatchEngine: "map" (std::map levels) or
+# "ladder" (flat tick-indexed arrays). both stay importable as
+# MapMatchEngine / LadderMatchEngine for side-by-side benchmarks.
+book_backend = os.environ.get("MATCH_ENGINE_BACKEND", "map").lower()
+if book_backend not in ("map", "ladder"):
+    raise ValueError(f"unknown MATCH_ENGINE_BACKEND: {book_backend}")
+define_macros = [("MATCH_ENGINE_LADDER", "1")] if book_backend == "ladder" else []
+
 ext_modules = [
     Extension(
         "match_engine",
-        ["src/lob/match_engine.cpp"],
+        [
+            "src/lob/match_engine.cpp",
+            "src/lob/depth_replay.cpp",
+            "src/lob/quote_engine.cpp",
+            "src/lob/feature_pipeline.cpp",
+            "src/lob/shm_ring.cpp",
+            "src/lob/shard_runtime.cpp",
+            "src/lob/queue_fill.cpp",
+            "src/lob/depth_decode.cpp",
+        ],
+        depends=[
+            "src/lob/arrow_c.hpp",
+            "src/lob/depth_book.hpp",
+            "src/lob/depth_decode.hpp",
+            "src/lob/depth_replay.hpp",
+            "src/lob/feature_pipeline.hpp",
+            "src/lob/latency_histogram.hpp",
+            "src/lob/logistic.hpp",
+            "src/lob/match_engine.hpp",
+            "src/lob/order_index.hpp",
+            "src/lob/order_pool.hpp",
+            "src/lob/order_type.hpp",
+            "src/lob/price_ladder.hpp",
+            "src/lob/queue_fill.hpp",
+            "src/lob/quote_engine.hpp",
+            "src/lob/shard_runtime.hpp",
+            "src/lob/shm_ring.hpp",
+            "src/lob/side.hpp",
+        ],
         include_dirs=[
             get_pybind_include(),
             get_pybind_include(user=True),
         ],
         language="c++",
+        define_macros=define_macros,
         extra_compile_args=extra_compile_args,
     ),
 ]
@@ -0,0 +1,103 @@
+"""
+event-time clock and latency model for backtests
+
+this module provides:
+1. LatencyModel, the feed and order-entry delays a replay applies
+2. EventQueue, strategy actions ordered by the event time they reach the book
+
+the clock only ever moves to recorded depth event times (E) or to the due
+times of queued actions, never to wall-clock time, so a replay with latency
+is as reproducible as one without and runs as fast as it can be computed
+"""
+
+import heapq
+import itertools
+from dataclasses import dataclass
+from typing import Callable, List, Optional, Tuple
+
+# action(now) runs with the clock at its due time
+Action = Callable[[int], None]
+
+
+@dataclass(frozen=True)
+class LatencyModel:
+    """fixed delays in event-time units, milliseconds for binance E
+
+    Attributes:
+        feed: from a depth event to the strategy seeing it
+        order: from the strategy's decision to the order reaching the book
+    """
+
+    feed: int = 0
+    order: int = 0
+
+    def __post_init__(self) -> None:
+        if self.feed < 0 or self.order < 0:
+            raise ValueError("latencies cannot be negative")
+
+    def arrival(self, event_time: int) -> int:
+        """when an action taken on event_time's book reaches the exchange
+
+        the strategy decides on the book as published at event_time, which
+        it only sees feed later, and its order travels order more
+
+        Args:
+            event_time: event time of the depth message acted on
+
+        Returns:
+            event time the action takes effect at
+        """
+        return event_time + self.feed + self.order
+
+
+class EventQueue:
+    """pending actions ordered by due time
+
+    actions due at the same time run in the order they were scheduled, so
+    the replay never depends on how the heap breaks ties
+    """
+
+    def __init__(self) -> None:
+        self._heap: List[Tuple[int, int, Action]] = []
+        self._sequence = itertools.count()
+
+    def __len__(self) -> int:
+        return len(self._heap)
+
+    def push(self, due: int, action: Action) -> None:
+        """schedule action to run once the clock reaches due
+
+        Args:
+            due: event time to run at
+            action: called with due as the current time
+        """
+        heapq.heappush(self._heap, (due, next(self._sequence), action))
+
+    def next_due(self) -> Optional[int]:
+        """due time of the earliest action, None if nothing is pending"""
+        return self._heap[0][0] if self._heap else None
+
+    def run_until(self, now: int, inclusive: bool = True) -> int:
+        """run every action due by now, earliest first
+
+        an action may schedule more; those run too if they are due by now
+
+        Args:
+            now: current event time
+            inclusive: also run actions due exactly at now
+
+        Returns:
+            number of actions run
+        """
+        count = 0
+        while self._heap:
+            due = self._heap[0][0]
+            if due > now or (due == now and not inclusive):
+                break
+            _, _, action = heapq.heappop(self._heap)
+            action(due)
+            count += 1
+        return count
+
+    def clear(self) -> None:
+        self._heap.clear()
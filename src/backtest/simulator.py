@@ -9,24 +9,41 @@ this module provides the Simulator class which:
 """
 
 import datetime
+import itertools
 import logging
 from dataclasses import dataclass
-from decimal import Decimal
+from decimal import ROUND_CEILING, ROUND_FLOOR, Decimal
+from functools import partial
 from pathlib import Path
-from typing import Callable, Dict, List, Optional, Tuple
+from typing import Any, Callable, Dict, List, Optional, Tuple
 
 import pandas as pd
+import pyarrow.compute as pc
 import pyarrow.parquet as pq
 from pyarrow import Table
 
+from backtest.latency import EventQueue, LatencyModel
+from data_feed.parquet_writer import decode_levels, schema_units
 from data_feed.schemas import DepthUpdate
 from lob.order_book import Order, OrderBook
+from storage.tick_store import TickStoreReader
 
 logging.basicConfig(
     level=logging.INFO, format="%(asctime)s - %(name)s - %(levelname)s - %(message)s"
 )
 logger = logging.getLogger(__name__)
 
+# columns the native replay reads, the rest are never decoded
+_NATIVE_COLUMNS = (
+    "event_time",
+    "first_update_id",
+    "final_update_id",
+    "bids",
+    "asks",
+)
+# rows per record batch streamed into the native replay
+_NATIVE_BATCH_SIZE = 65536
+
 
 @dataclass
 class Fill:
@@ -47,18 +64,6 @@ class Fill:
     order_id: str
 
 
-def _convert_string_to_list(lst: List[str]) -> List[List[str]]:
-    """convert list of strings back to nested list
-
-    Args:
-        lst: list of "price,quantity" strings
-
-    Returns:
-        list of [price, quantity] pairs
-    """
-    return [s.split(",") for s in lst]
-
-
 class Simulator:
     """replays market data into order book for backtesting
 
@@ -87,6 +92,14 @@ class Simulator:
         data_path: str,
         strategy: Callable,
         spread: Decimal = Decimal("0.001"),
+        native: bool = False,
+        sample_every: int = 1,
+        tick_size: float = 1e-8,
+        lot_size: float = 1e-8,
+        incremental: bool = False,
+        tick_store_path: Optional[str] = None,
+        queue_fills: bool = False,
+        latency: Optional[LatencyModel] = None,
     ) -> None:
         """initialize simulator
 
@@ -95,7 +108,26 @@ class Simulator:
             data_path: path to parquet files
             strategy: strategy function to use for quoting
             spread: fixed spread for naive maker
+            native: replay depth in the C++ extension instead of pandas rows
+            sample_every: with native replay, run the strategy on every n-th
+                message only; the native book still applies every message
+            tick_size: price grid used by the native book
+            lot_size: quantity grid used by the native book
+            incremental: treat messages as binance depth diffs applied to a
+                persistent book (qty 0 deletes a level) instead of full
+                snapshots, validating the U/u update-id sequence
+            tick_store_path: replay from memory-mapped tick store files in
+                this directory instead of parquet
+            queue_fills: rest one quote per side in a native QueueFillModel,
+                where it keeps its place in line until the strategy moves it
+                and fills passively as the size shown ahead of it trades
+                away, instead of only filling when a quote crosses the book
+            latency: feed and order-entry delays; quotes then wait in an
+                event queue and reach the book latency.arrival(E) after the
+                message they were made on, None acts on it immediately
         """
+        if sample_every < 1:
+            raise ValueError("sample_every must be at least 1")
         self.symbol = symbol.lower()
         self.data_path = Path(data_path)
         self.strategy = strategy
@@ -107,6 +139,32 @@ class Simulator:
         self.position: Decimal = Decimal("0")
         self.pnl: Decimal = Decimal("0")
         self.volatility: Decimal = Decimal("0.01")  # 1% default volatility
+        self.native = native
+        self.sample_every = sample_every
+        self.tick_size = tick_size
+        self.lot_size = lot_size
+        self.incremental = incremental
+        self.tick_store_path = tick_store_path
+        self.last_update_id: Optional[int] = None
+        self.sequence_gaps = 0
+        self.stale_updates = 0
+        self._native_replay = None
+        # tick/lot grid of the file being replayed, None for string levels
+        self._level_units: Optional[Tuple[Decimal, Decimal]] = None
+        self.queue_fills = queue_fills
+        self.latency = latency
+        self.events = EventQueue()
+        # event time of the message or action being simulated
+        self.clock = 0
+        self._queue = None
+        self._queue_sides: Dict[str, object] = {}
+        # side -> (queue order id, price, size) of the quote resting there
+        self._resting: Dict[str, Optional[Tuple[int, Decimal, Decimal]]] = {
+            "buy": None,
+            "sell": None,
+        }
+        # numbers each placement, since latency can deliver two at one time
+        self._order_seq = itertools.count(1)
 
     def _get_file_path(self, date: datetime.date) -> Path:
         """get parquet file path for date
@@ -152,11 +210,133 @@ class Simulator:
             "s": message.get("symbol"),
             "U": message.get("first_update_id"),
             "u": message.get("final_update_id"),
-            "b": _convert_string_to_list(message.get("bids", [])),
-            "a": _convert_string_to_list(message.get("asks", [])),
+            "b": decode_levels(message.get("bids", []), self._level_units),
+            "a": decode_levels(message.get("asks", []), self._level_units),
         }
         depth_update = DepthUpdate(**mapped)
+        self._apply_depth(
+            depth_update.E,
+            depth_update.U,
+            depth_update.u,
+            [(Decimal(price), Decimal(qty)) for price, qty in depth_update.b],
+            [(Decimal(price), Decimal(qty)) for price, qty in depth_update.a],
+        )
+
+    def _apply_depth(
+        self,
+        event_time: int,
+        first_update_id: int,
+        final_update_id: int,
+        bids: List[Tuple[Decimal, Decimal]],
+        asks: List[Tuple[Decimal, Decimal]],
+    ) -> None:
+        """apply one decoded depth message and run the strategy
+
+        Args:
+            event_time: event time of the message
+            first_update_id: first update id (U)
+            final_update_id: final update id (u)
+            bids: (price, quantity) pairs for the bid side
+            asks: (price, quantity) pairs for the ask side
+        """
+        if self.latency is not None:
+            # actions due before this message meet the book it replaces
+            self._run_events(event_time, inclusive=False)
+        self.clock = event_time
+
+        if self.incremental:
+            if not self._check_sequence(first_update_id, final_update_id):
+                return
+            self._apply_market_diff(self.order_book.bids, bids, "buy", event_time)
+            self._apply_market_diff(self.order_book.asks, asks, "sell", event_time)
+        else:
+            self._rebuild_market_levels(bids, asks, event_time)
 
+        if self.queue_fills:
+            self._advance_queue(bids, asks, event_time)
+        if self.latency is not None:
+            self._run_events(event_time)
+
+        # Run strategy
+        self._run_strategy(event_time)
+
+    def _check_sequence(self, first_update_id: int, final_update_id: int) -> bool:
+        """validate a diff's update ids against the last applied one
+
+        a recording has no snapshot to resync from, so a gap is logged and
+        counted and the diff is applied anyway
+
+        Args:
+            first_update_id: first update id in the diff (U)
+            final_update_id: final update id in the diff (u)
+
+        Returns:
+            False if every change in the diff is already applied
+        """
+        if self.last_update_id is not None:
+            if final_update_id <= self.last_update_id:
+                self.stale_updates += 1
+                return False
+            if first_update_id > self.last_update_id + 1:
+                self.sequence_gaps += 1
+                logger.warning(
+                    f"depth sequence gap: expected {self.last_update_id + 1}, "
+                    f"got {first_update_id}"
+                )
+        self.last_update_id = final_update_id
+        return True
+
+    def _apply_market_diff(
+        self,
+        levels: Dict[Decimal, List[Order]],
+        changes: List[Tuple[Decimal, Decimal]],
+        side: str,
+        timestamp: int,
+    ) -> None:
+        """apply changed market levels to one side, keeping strategy orders
+
+        only the listed prices are touched, so the cost follows the size of
+        the diff rather than the depth of the book
+
+        Args:
+            levels: bids or asks of the order book
+            changes: (price, quantity) pairs, quantity 0 removes the level
+            side: buy or sell
+            timestamp: event time of the update
+        """
+        for price, qty in changes:
+            ours = [
+                order
+                for order in levels.get(price, [])
+                if not order.order_id.startswith("mkt_")
+            ]
+            if qty > 0:
+                market = Order(
+                    order_id=f"mkt_{price}_{qty}",
+                    side=side,
+                    price=price,
+                    size=qty,
+                    timestamp=timestamp,
+                )
+                levels[price] = [market] + ours
+            elif ours:
+                levels[price] = ours
+            else:
+                levels.pop(price, None)
+
+    def _rebuild_market_levels(
+        self,
+        bids: List[Tuple[Decimal, Decimal]],
+        asks: List[Tuple[Decimal, Decimal]],
+        timestamp: int,
+    ) -> None:
+        """replace market levels in the order book, keeping strategy orders
+
+        Args:
+            bids: (price, quantity) pairs for the bid side
+            asks: (price, quantity) pairs for the ask side
+            timestamp: event time of the update
+        """
         # Store our quotes before clearing
         our_quotes = []
         for price, orders in self.order_book.bids.items():
@@ -172,28 +352,24 @@ class Simulator:
         self.order_book.bids.clear()
         self.order_book.asks.clear()
 
-        for price, qty in depth_update.b:
-            price_dec = Decimal(price)
-            qty_dec = Decimal(qty)
-            self.order_book.bids[price_dec] = [
+        for price, qty in bids:
+            self.order_book.bids[price] = [
                 Order(
                     order_id=f"mkt_{price}_{qty}",  # prefix with mkt_ to distinguish
                     side="buy",
-                    price=price_dec,
-                    size=qty_dec,
-                    timestamp=depth_update.E,
+                    price=price,
+                    size=qty,
+                    timestamp=timestamp,
                 )
             ]
-        for price, qty in depth_update.a:
-            price_dec = Decimal(price)
-            qty_dec = Decimal(qty)
-            self.order_book.asks[price_dec] = [
+        for price, qty in asks:
+            self.order_book.asks[price] = [
                 Order(
                     order_id=f"mkt_{price}_{qty}",  # prefix with mkt_ to distinguish
                     side="sell",
-                    price=price_dec,
-                    size=qty_dec,
-                    timestamp=depth_update.E,
+                    price=price,
+                    size=qty,
+                    timestamp=timestamp,
                 )
             ]
 
@@ -208,8 +384,180 @@ class Simulator:
                     self.order_book.asks[order.price] = []
                 self.order_book.asks[order.price].append(order)
 
-        # Run strategy
-        self._run_strategy(depth_update.E)
+    def _on_native_sample(
+        self,
+        event_time: int,
+        bids: List[Tuple[float, float]],
+        asks: List[Tuple[float, float]],
+    ) -> None:
+        """handle a sampled book from the native replay
+
+        Args:
+            event_time: event time of the sampled message
+            bids: (price, quantity) pairs from the native book, best first
+            asks: (price, quantity) pairs from the native book, best first
+        """
+        if self.queue_fills:
+            # the native replay moved the queue on every message since the
+            # last sample
+            self._take_queue_fills()
+        if self.latency is not None:
+            # actions due before this sample meet the previous sampled book,
+            # the nearest the python side has to the book they were due at
+            self._run_events(event_time, inclusive=False)
+        self.clock = event_time
+
+        # repr gives the shortest decimal that round-trips, which is the
+        # exchange string for any price/qty on the tick grid
+        self._rebuild_market_levels(
+            [(Decimal(repr(price)), Decimal(repr(qty))) for price, qty in bids],
+            [(Decimal(repr(price)), Decimal(repr(qty))) for price, qty in asks],
+            event_time,
+        )
+        if self.latency is not None:
+            self._run_events(event_time)
+        self._run_strategy(event_time)
+
+    def _run_events(self, now: int, inclusive: bool = True) -> None:
+        """run queued strategy actions due by now, each at its due time
+
+        Args:
+            now: event time of the current message
+            inclusive: also run actions due exactly at now
+        """
+        self.events.run_until(now, inclusive)
+        self.clock = now
+
+    def _queue_model(self):
+        """the QueueFillModel behind queue_fills, on the native book's grid"""
+        if self._queue is None:
+            from match_engine import QueueFillModel, Side
+
+            self._queue = QueueFillModel(self.tick_size, self.lot_size)
+            self._queue_sides = {"buy": Side.BUY, "sell": Side.SELL}
+        return self._queue
+
+    def _advance_queue(
+        self,
+        bids: List[Tuple[Decimal, Decimal]],
+        asks: List[Tuple[Decimal, Decimal]],
+        timestamp: int,
+    ) -> None:
+        """move resting quotes along their queues by one message's levels
+
+        a diff only changes the levels it lists, so in incremental mode a
+        quote's level is looked at only when the message touched it. a full
+        message replaced the book, so a level inside its range that it left
+        out is gone and one past its worst price is out of view. either way
+        the size shown is read off the book the message left, as are the
+        best prices: the other side's touch at or through a quote's price
+        means the market traded through it
+
+        Args:
+            bids: (price, quantity) pairs for the bid side
+            asks: (price, quantity) pairs for the ask side
+            timestamp: event time of the update
+        """
+        queue = self._queue_model()
+        for side, changes, levels in (
+            ("buy", bids, self.order_book.bids),
+            ("sell", asks, self.order_book.asks),
+        ):
+            resting = self._resting[side]
+            if resting is None:
+                continue
+            price = resting[1]
+            if self.incremental:
+                changed = any(level == price for level, _ in changes)
+            elif side == "buy":
+                changed = bool(levels) and price >= min(levels)
+            else:
+                changed = bool(levels) and price <= max(levels)
+            if changed:
+                # only market orders sit in the book in this mode
+                shown = levels[price][0].size if price in levels else Decimal("0")
+                queue.on_level(
+                    self._queue_sides[side], float(price), float(shown), timestamp
+                )
+        best_bid = self.order_book.get_best_bid() or 0
+        best_ask = self.order_book.get_best_ask() or 0
+        queue.on_best(float(best_bid), float(best_ask), timestamp)
+        self._take_queue_fills()
+
+    def _take_queue_fills(self) -> None:
+        """book the queue model's passive fills and forget filled quotes"""
+        buy = self._queue_sides["buy"]
+        tick = Decimal(repr(self.tick_size))
+        lot = Decimal(repr(self.lot_size))
+        for _, side, price, size, timestamp in self._queue.take_fills():
+            # back to whole ticks/lots first: unlike recorded levels, a
+            # computed partial size need not repr() as its short decimal
+            self._simulate_fill(
+                timestamp=timestamp,
+                side="buy" if side == buy else "sell",
+                price=round(price / self.tick_size) * tick,
+                size=round(size / self.lot_size) * lot,
+            )
+        for side, resting in self._resting.items():
+            if resting is not None and resting[0] not in self._queue:
+                self._resting[side] = None
+
+    def _work_quotes(self, timestamp: int, bid_quote, ask_quote) -> None:
+        """cross or rest each quote in the queue model
+
+        quotes are rounded onto the grid away from the other side. one that
+        is unchanged keeps its place in line, one that moved is cancelled
+        and joins the back of its new level, and one that crosses takes the
+        touch instead of resting
+
+        Args:
+            timestamp: event time the quotes reach the book
+            bid_quote: strategy quote for the bid
+            ask_quote: strategy quote for the ask
+        """
+        best_bid = self.order_book.get_best_bid()
+        best_ask = self.order_book.get_best_ask()
+        if not best_bid or not best_ask:
+            return
+        queue = self._queue_model()
+        tick = Decimal(repr(self.tick_size))
+        lot = Decimal(repr(self.lot_size))
+        for side, quote, rounding in (
+            ("buy", bid_quote, ROUND_FLOOR),
+            ("sell", ask_quote, ROUND_CEILING),
+        ):
+            price = (quote.price / tick).to_integral_value(rounding) * tick
+            size = (quote.size / lot).to_integral_value(ROUND_FLOOR) * lot
+            resting = self._resting[side]
+            if resting is not None:
+                if resting[1:] == (price, size):
+                    continue
+                queue.cancel(resting[0])
+                self._resting[side] = None
+            if size <= 0:
+                continue
+
+            if side == "buy":
+                levels, opposite = self.order_book.bids, self.order_book.asks
+                touch, crosses = best_ask, price >= best_ask
+            else:
+                levels, opposite = self.order_book.asks, self.order_book.bids
+                touch, crosses = best_bid, price <= best_bid
+            if crosses:
+                self._simulate_fill(
+                    timestamp=timestamp,
+                    side=side,
+                    price=touch,
+                    size=min(opposite[touch][0].size, size),
+                )
+                continue
+
+            # only market orders sit in the book in this mode
+            shown = levels[price][0].size if price in levels else Decimal("0")
+            order_id = queue.place(
+                self._queue_sides[side], float(price), float(size), float(shown)
+            )
+            self._resting[side] = (order_id, price, size)
 
     def _run_strategy(self, timestamp: int) -> None:
         """run strategy and simulate fills"""
@@ -241,19 +589,41 @@ class Simulator:
 
         # Unpack quotes
         bid_quote, ask_quote = quotes
+        if self.latency is None:
+            self._place_quotes(timestamp, bid_quote, ask_quote)
+        else:
+            self.events.push(
+                self.latency.arrival(timestamp),
+                partial(self._place_quotes, bid_quote=bid_quote, ask_quote=ask_quote),
+            )
+
+    def _place_quotes(self, timestamp: int, bid_quote, ask_quote) -> None:
+        """put the strategy's quotes on the book and simulate fills
+
+        Args:
+            timestamp: event time the quotes reach the book
+            bid_quote: strategy quote for the bid
+            ask_quote: strategy quote for the ask
+        """
+        self.clock = timestamp
+        if self.queue_fills:
+            self._work_quotes(timestamp, bid_quote, ask_quote)
+            return
+
         bid_price, bid_size = bid_quote.price, bid_quote.size
         ask_price, ask_size = ask_quote.price, ask_quote.size
 
         # Place strategy orders
+        seq = next(self._order_seq)
         bid_order = Order(
-            order_id=f"strat_bid_{timestamp}",
+            order_id=f"strat_bid_{timestamp}_{seq}",
             side="buy",
             price=bid_price,
             size=bid_size,
             timestamp=timestamp,
         )
         ask_order = Order(
-            order_id=f"strat_ask_{timestamp}",
+            order_id=f"strat_ask_{timestamp}_{seq}",
             side="sell",
             price=ask_price,
             size=ask_size,
@@ -330,22 +700,170 @@ class Simulator:
         else:
             self.pnl = self.pnl - fill_value
 
-    def replay_date(self, date: datetime.date) -> None:
+    def replay_date(
+        self, date: datetime.date, start_time: Optional[int] = None
+    ) -> None:
         """replay messages for a single date
 
         Args:
             date: date to replay
+            start_time: skip messages with an earlier event time; the tick
+                store seeks straight to it, parquet sources still decode
+                and drop the earlier rows
 
         Raises:
             FileNotFoundError: if parquet file doesn't exist
         """
+        if self.tick_store_path is not None:
+            self._replay_tick_store(date, start_time)
+            return
+
         file_path = self._get_file_path(date)
+        if self.native:
+            self._replay_file_native(file_path, start_time)
+            return
+
         table = self._read_parquet_file(file_path)
+        self._level_units = schema_units(table.schema)
+        if start_time is not None:
+            table = table.filter(pc.greater_equal(table["event_time"], start_time))
         df = table.to_pandas()
 
         for _, row in df.iterrows():
             self._process_message(row)
 
+    def _replay_tick_store(
+        self, date: datetime.date, start_time: Optional[int] = None
+    ) -> None:
+        """replay a day from memory-mapped tick store files
+
+        Args:
+            date: date to replay
+            start_time: first event time to replay, None for the whole day
+
+        Raises:
+            FileNotFoundError: if the day's tick store files don't exist
+        """
+        reader = TickStoreReader.open(self.tick_store_path, self.symbol, date)
+        self.replay_messages(reader, start_time)
+
+    def replay_messages(
+        self, reader: TickStoreReader, start_time: Optional[int] = None
+    ) -> None:
+        """replay already decoded messages from a tick store reader
+
+        an incremental replay that starts mid-day first rebuilds the book
+        from the reader's latest checkpoint before start_time, see
+        _warm_start()
+
+        Args:
+            reader: mapped or in-memory tick store, see load_parquet()
+            start_time: first event time to replay, None for all of them
+        """
+        tick_size, lot_size = reader.tick_size, reader.lot_size
+
+        def levels(records) -> List[Tuple[Decimal, Decimal]]:
+            return [
+                (Decimal(price) * tick_size, Decimal(qty) * lot_size)
+                for price, qty in records.tolist()
+            ]
+
+        if self.incremental and start_time is not None:
+            self._warm_start(reader, reader.seek(start_time), levels)
+
+        for event_time, first_id, final_id, bids, asks in reader.iter_messages(
+            start_time
+        ):
+            self._apply_depth(
+                event_time, first_id, final_id, levels(bids), levels(asks)
+            )
+
+    def _warm_start(
+        self,
+        reader: TickStoreReader,
+        start: int,
+        levels: Callable[[Any], List[Tuple[Decimal, Decimal]]],
+    ) -> None:
+        """bring the market book to where a replay from message 0 has it
+
+        loads the latest checkpoint at or before message start and applies
+        the diffs between it and start without running the strategy, so the
+        cost is at most one checkpoint interval. a reader without such a
+        checkpoint leaves the book as it is
+
+        Args:
+            reader: tick store being replayed
+            start: position of the first message to replay
+            levels: converts LEVEL_DTYPE records to (price, quantity) pairs
+        """
+        checkpoint = reader.checkpoint(start)
+        if checkpoint is None:
+            return
+        position, last_update_id, bids, asks = checkpoint
+        event_time = int(reader.index[position]["event_time"])
+        self._rebuild_market_levels(levels(bids), levels(asks), event_time)
+        self.last_update_id = last_update_id
+        for position in range(position, start):
+            event_time, first_id, final_id, bids, asks = reader.message(position)
+            if self._check_sequence(first_id, final_id):
+                book = self.order_book
+                self._apply_market_diff(book.bids, levels(bids), "buy", event_time)
+                self._apply_market_diff(book.asks, levels(asks), "sell", event_time)
+
+    def _replay_file_native(
+        self, file_path: Path, start_time: Optional[int] = None
+    ) -> None:
+        """replay a parquet file through the native depth replay
+
+        record batches are streamed from the file and handed to C++ through
+        the arrow c data interface, so level strings are parsed without
+        building python objects and only sampled books cross back
+
+        Args:
+            file_path: path to parquet file
+            start_time: skip rows with an earlier event time
+
+        Raises:
+            FileNotFoundError: if file doesn't exist
+        """
+        if not file_path.exists():
+            raise FileNotFoundError(f"parquet file not found: {file_path}")
+
+        if self._native_replay is None:
+            from match_engine import DepthReplay
+
+            self._native_replay = DepthReplay(
+                self.tick_size, self.lot_size, incremental=self.incremental
+            )
+            if self.queue_fills:
+                self._native_replay.set_queue_model(self._queue_model())
+
+        parquet_file = pq.ParquetFile(file_path)
+        # integer levels are rescaled from the file's grid to the replay's
+        units = schema_units(parquet_file.schema_arrow)
+        tick_size, lot_size = (float(u) for u in units) if units else (0.0, 0.0)
+        columns = [
+            name for name in _NATIVE_COLUMNS if name in parquet_file.schema_arrow.names
+        ]
+        for batch in parquet_file.iter_batches(
+            batch_size=_NATIVE_BATCH_SIZE, columns=columns
+        ):
+            if start_time is not None:
+                batch = batch.filter(pc.greater_equal(batch["event_time"], start_time))
+            self._native_replay.replay(
+                batch,
+                self._on_native_sample,
+                sample_every=self.sample_every,
+                tick_size=tick_size,
+                lot_size=lot_size,
+            )
+        if self.queue_fills:
+            # fills after the last sampled message
+            self._take_queue_fills()
+        self.last_update_id = self._native_replay.last_update_id or None
+        self.sequence_gaps = self._native_replay.gaps
+        self.stale_updates = self._native_replay.stale
+
     def replay_date_range(
         self, start_date: datetime.date, end_date: datetime.date
     ) -> None:
@@ -0,0 +1,230 @@
+"""
+parameter sweep module for evaluating strategy configs over the same data
+
+this module provides the SweepRunner class which:
+1. decodes each day once into flat tick store arrays (or maps tick store files)
+2. forks a process pool that inherits those arrays read-only, so workers
+   share the decoded pages instead of re-reading parquet per config
+3. runs one Simulator per configuration, handing configs to whichever
+   worker is idle so uneven runs don't stall the pool
+4. collects every get_pnl_summary() into one table
+"""
+
+import datetime
+import logging
+import multiprocessing
+import os
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import dataclass, fields, replace
+from decimal import Decimal
+from pathlib import Path
+from typing import Any, Callable, Dict, Iterable, List, Optional, Sequence
+
+import pandas as pd
+
+from backtest.simulator import Simulator
+from models.inventory_skew import InventorySkewConfig
+from models.size_calculator import SizeConfig
+from storage.tick_store import TickStoreReader, load_parquet
+from strategy.ev_maker import EVConfig, EVMaker, default_inventory_config
+
+logger = logging.getLogger(__name__)
+
+# builds the strategy callable for one configuration
+StrategyFactory = Callable[[Dict[str, Any]], Callable]
+
+_EV_FIELDS = ("min_spread", "max_spread", "num_points")
+_INVENTORY_FIELDS = tuple(
+    f.name for f in fields(InventorySkewConfig) if f.name != "float_tolerance"
+)
+
+
+def ev_maker_strategy(params: Dict[str, Any]) -> Callable:
+    """build an EVMaker from flat sweep parameters
+
+    Args:
+        params: any of min_spread, max_spread, num_points and the
+            InventorySkewConfig fields; missing ones keep their defaults
+
+    Returns:
+        the maker's quote_prices
+
+    Raises:
+        ValueError: if a parameter is not an EVConfig or InventorySkewConfig field
+    """
+    unknown = set(params) - set(_EV_FIELDS) - set(_INVENTORY_FIELDS)
+    if unknown:
+        raise ValueError(f"unknown sweep parameters: {sorted(unknown)}")
+    inventory = replace(
+        default_inventory_config(),
+        **{name: float(params[name]) for name in _INVENTORY_FIELDS if name in params},
+    )
+    config = EVConfig(inventory_config=inventory)
+    for name in ("min_spread", "max_spread"):
+        if name in params:
+            setattr(config, name, Decimal(str(params[name])))
+    if "num_points" in params:
+        config.num_points = int(params["num_points"])
+    return EVMaker(config, SizeConfig()).quote_prices
+
+
+@dataclass
+class _SweepState:
+    """what every worker needs, inherited at fork"""
+
+    symbol: str
+    data_path: str
+    strategy_factory: StrategyFactory
+    spread: Decimal
+    incremental: bool
+    days: List[TickStoreReader]
+
+
+# set in each worker by the pool initializer; with fork it is the parent's
+# object, so the decoded arrays are shared copy-on-write and never pickled
+_STATE: Optional[_SweepState] = None
+
+
+def _init_worker(state: _SweepState) -> None:
+    global _STATE
+    _STATE = state
+
+
+def _run_config(state: _SweepState, params: Dict[str, Any]) -> Dict[str, float]:
+    """replay every loaded day for one configuration"""
+    simulator = Simulator(
+        symbol=state.symbol,
+        data_path=state.data_path,
+        strategy=state.strategy_factory(params),
+        spread=state.spread,
+        incremental=state.incremental,
+    )
+    for reader in state.days:
+        simulator.replay_messages(reader)
+    return simulator.get_pnl_summary()
+
+
+def _run_in_worker(params: Dict[str, Any]) -> Dict[str, float]:
+    return _run_config(_STATE, params)
+
+
+class SweepRunner:
+    """evaluates many strategy configurations over the same days
+
+    Attributes:
+        symbol: trading pair symbol
+        data_path: path to parquet files
+        strategy_factory: builds a strategy callable from one config's params
+        tick_store_path: read days from tick store files here instead of parquet
+        spread: fixed spread passed to each Simulator
+        incremental: replay messages as depth diffs, see Simulator
+        workers: worker processes, 1 runs configs in this process
+        days: decoded days, in load order
+    """
+
+    def __init__(
+        self,
+        symbol: str,
+        data_path: str,
+        strategy_factory: StrategyFactory = ev_maker_strategy,
+        tick_store_path: Optional[str] = None,
+        spread: Decimal = Decimal("0.001"),
+        incremental: bool = False,
+        workers: Optional[int] = None,
+    ) -> None:
+        """initialize runner
+
+        Args:
+            symbol: trading pair symbol
+            data_path: path to parquet files
+            strategy_factory: builds a strategy callable from one config's
+                params; must be picklable where fork is unavailable
+            tick_store_path: read days from tick store files here instead of
+                decoding parquet
+            spread: fixed spread passed to each Simulator
+            incremental: replay messages as depth diffs, see Simulator
+            workers: worker processes, defaults to the cpu count
+
+        Raises:
+            ValueError: if workers is less than 1
+        """
+        if workers is None:
+            workers = os.cpu_count() or 1
+        if workers < 1:
+            raise ValueError("workers must be at least 1")
+        self.symbol = symbol.lower()
+        self.data_path = Path(data_path)
+        self.strategy_factory = strategy_factory
+        self.tick_store_path = tick_store_path
+        self.spread = spread
+        self.incremental = incremental
+        self.workers = workers
+        self.days: List[TickStoreReader] = []
+
+    def load(self, dates: Iterable[datetime.date]) -> int:
+        """decode days once for every later run
+
+        Args:
+            dates: days to load, replayed in this order
+
+        Returns:
+            number of messages loaded
+
+        Raises:
+            FileNotFoundError: if a day's files don't exist
+        """
+        for date in dates:
+            if self.tick_store_path is not None:
+                reader = TickStoreReader.open(self.tick_store_path, self.symbol, date)
+            else:
+                file_path = self.data_path / (
+                    f"{self.symbol}_{date.strftime('%Y%m%d')}.parquet"
+                )
+                reader = load_parquet(file_path)
+            self.days.append(reader)
+        return sum(len(reader) for reader in self.days)
+
+    def run(self, configs: Sequence[Dict[str, Any]]) -> pd.DataFrame:
+        """evaluate every configuration over the loaded days
+
+        Args:
+            configs: one dict of strategy parameters per run
+
+        Returns:
+            DataFrame with one row per config, in config order: the
+            parameters followed by the get_pnl_summary() columns
+        """
+        state = _SweepState(
+            symbol=self.symbol,
+            data_path=str(self.data_path),
+            strategy_factory=self.strategy_factory,
+            spread=self.spread,
+            incremental=self.incremental,
+            days=self.days,
+        )
+        workers = min(self.workers, len(configs))
+        if workers <= 1:
+            summaries = [_run_config(state, params) for params in configs]
+        else:
+            # one task per config rather than fixed chunks: a worker that
+            # finishes early takes the next config
+            with ProcessPoolExecutor(
+                max_workers=workers,
+                mp_context=self._context(),
+                initializer=_init_worker,
+                initargs=(state,),
+            ) as pool:
+                futures = [pool.submit(_run_in_worker, params) for params in configs]
+                summaries = [future.result() for future in futures]
+        logger.info(f"sweep finished {len(configs)} configs on {workers} workers")
+        return pd.DataFrame(
+            [{**params, **summary} for params, summary in zip(configs, summaries)]
+        )
+
+    @staticmethod
+    def _context() -> multiprocessing.context.BaseContext:
+        # fork shares the decoded days; elsewhere they are pickled once per
+        # worker, not per config
+        if "fork" in multiprocessing.get_all_start_methods():
+            return multiprocessing.get_context("fork")
+        return multiprocessing.get_context()
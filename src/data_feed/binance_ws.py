@@ -12,7 +12,7 @@ import asyncio
 import json
 import logging
 import os
-from typing import Any, Dict, Optional
+from typing import Any, Dict, Optional, Tuple, Union
 
 import websockets.client
 from websockets.exceptions import (
@@ -202,6 +202,61 @@ class BinanceWebSocket:
             logger.error(f"Error receiving message: {e}")
             return None
 
+    async def receive_depth(
+        self, decoder: Any
+    ) -> Optional[Tuple[Union[str, bytes], Any]]:
+        """Receive the next depth update, decoded natively onto a grid
+
+        Unlike receive(), depth frames never go through json.loads; only
+        the rare frame that is not a depth update does, for ping handling.
+
+        Args:
+            decoder: DepthDecoder for the grid the levels should be on
+
+        Returns:
+            (raw frame, FixedDepthUpdate) if valid
+            None if connection closed
+
+        Raises:
+            Exception: For unexpected errors
+        """
+        if not self.ws:
+            return None
+
+        try:
+            while self._running:
+                message = await self.ws.recv()
+
+                if not message:
+                    continue
+
+                try:
+                    update = decoder.decode(message)
+                except ValueError as e:
+                    logger.warning(f"Received invalid depth message: {e}")
+                    continue
+
+                if update is None:
+                    data = json.loads(message)
+                    if "ping" in data:
+                        await self.ws.pong(data["ping"])
+                    else:
+                        logger.warning(f"Received invalid message format: {data}")
+                    continue
+
+                self.message_count += 1
+                return message, update
+
+        except ConnectionClosedOK:
+            logger.info("WebSocket connection closed normally")
+            return None
+        except ConnectionClosed as e:
+            logger.error(f"WebSocket connection closed unexpectedly: {e}")
+            return None
+        except Exception as e:
+            logger.error(f"Error receiving message: {e}")
+            return None
+
     async def subscribe(self) -> None:
         """subscribe to depth stream"""
         subscribe_message = {
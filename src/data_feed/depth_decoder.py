@@ -0,0 +1,103 @@
+"""
+native decoding of depth stream frames onto a tick/lot grid
+
+This module provides the fast path from websocket text to integer levels:
+1. DepthDecoder parses a raw depth frame once, in native code, without
+   building a json tree, a dict or a Decimal per level
+2. FixedDepthUpdate carries the result, DepthUpdate's fields with the
+   levels as LEVEL_DTYPE records (price ticks, qty lots)
+
+the grid defaults to the tick store's and the ring's 1e-8, so a decoded
+update goes to write_levels()/publish_levels() as it is. to_message() gives
+back decimal strings for the consumers that still need them.
+"""
+
+from decimal import Decimal
+from typing import Any, Dict, List, NamedTuple, Optional, Union
+
+import numpy as np
+
+from match_engine import DepthDecoder as NativeDepthDecoder
+
+DEFAULT_GRID = "0.00000001"
+
+
+class FixedDepthUpdate(NamedTuple):
+    """Depth update with integer levels, fields named as in DepthUpdate"""
+
+    e: str
+    E: int
+    s: str
+    U: int
+    u: int
+    b: np.ndarray
+    a: np.ndarray
+
+
+class DepthDecoder:
+    """Parses raw depth frames into FixedDepthUpdate
+
+    Attributes:
+        tick_size: Price grid of decoded levels
+        lot_size: Quantity grid of decoded levels
+    """
+
+    def __init__(
+        self,
+        tick_size: Union[str, Decimal] = DEFAULT_GRID,
+        lot_size: Union[str, Decimal] = DEFAULT_GRID,
+    ) -> None:
+        """Initialize decoder
+
+        Args:
+            tick_size: Price grid of decoded levels
+            lot_size: Quantity grid of decoded levels
+        """
+        self.tick_size = Decimal(str(tick_size))
+        self.lot_size = Decimal(str(lot_size))
+        # plain notation, str() would give "1E-8"
+        self._decoder = NativeDepthDecoder(
+            format(self.tick_size, "f"), format(self.lot_size, "f")
+        )
+
+    def decode(self, text: Union[str, bytes]) -> Optional[FixedDepthUpdate]:
+        """Parse one websocket frame
+
+        Args:
+            text: Raw frame as received
+
+        Returns:
+            Decoded update, or None for a frame that is not a depth update
+
+        Raises:
+            ValueError: If the frame is malformed or a level is off the grid
+        """
+        decoded = self._decoder.decode(text)
+        if decoded is None:
+            return None
+        return FixedDepthUpdate(*decoded)
+
+    def _levels(self, levels: np.ndarray) -> List[List[str]]:
+        return [
+            [str(price * self.tick_size), str(qty * self.lot_size)]
+            for price, qty in levels.tolist()
+        ]
+
+    def to_message(self, update: FixedDepthUpdate) -> Dict[str, Any]:
+        """Convert an update back to DepthUpdate fields with string levels
+
+        Args:
+            update: Update decoded on this decoder's grid
+
+        Returns:
+            Message as asdict(DepthUpdate) would give it
+        """
+        return {
+            "e": update.e,
+            "E": update.E,
+            "s": update.s,
+            "U": update.U,
+            "u": update.u,
+            "b": self._levels(update.b),
+            "a": self._levels(update.a),
+        }
@@ -6,13 +6,24 @@ This module provides the ParquetWriter class which:
 2. Efficiently appends messages using PyArrow
 3. Handles file rotation at UTC midnight
 4. Ensures proper schema conversion
+5. Optionally hands finished record batches to a background thread, so
+   compression and disk writes never run on the caller's event loop
+
+Two schema versions exist. Version 1 stores levels as "price,qty" strings.
+Version 2 stores them as list<struct<price, qty>> of int64 ticks/lots, with
+the tick/lot grid and version in the file metadata. Readers use
+schema_units/decode_levels to handle both.
 """
 
 import datetime
 import logging
 import os
+import queue
+import threading
+import time
+from decimal import Decimal
 from pathlib import Path
-from typing import Any, Dict, List, Optional
+from typing import Any, Dict, List, Optional, Sequence, Tuple, Union
 
 import pyarrow as pa
 import pyarrow.parquet as pq
@@ -24,6 +35,34 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
+# file metadata keys, files without them are schema version 1
+SCHEMA_VERSION_KEY = b"market_maker.schema_version"
+TICK_SIZE_KEY = b"market_maker.tick_size"
+LOT_SIZE_KEY = b"market_maker.lot_size"
+
+SCHEMA_VERSIONS = (1, 2)
+
+# version 2 level column: integer ticks/lots, best level first
+LEVEL_TYPE = pa.list_(pa.struct([("price", pa.int64()), ("qty", pa.int64())]))
+
+# row group size when none is given: version 1 keeps one row group per
+# message as before, version 2 batches messages into larger groups
+_DEFAULT_ROW_GROUP_SIZE = {1: 1, 2: 4096}
+
+# batches queued for the background thread before write() has to wait
+_DEFAULT_MAX_PENDING = 8
+
+# run-length friendly ids and times, and the nested level columns
+_DELTA_COLUMNS = (
+    "event_time",
+    "first_update_id",
+    "final_update_id",
+    "bids.list.element.price",
+    "bids.list.element.qty",
+    "asks.list.element.price",
+    "asks.list.element.qty",
+)
+
 
 def _convert_list_to_string(lst: List[List[str]]) -> List[str]:
     """Convert nested list to list of strings for better Parquet storage
@@ -49,6 +88,83 @@ def _convert_string_to_list(lst: List[str]) -> List[List[str]]:
     return [s.split(",") for s in lst]
 
 
+def to_units(value: str, unit: Decimal) -> int:
+    """Convert an exchange decimal string to a whole number of grid units
+
+    Args:
+        value: Decimal string such as "50000.01"
+        unit: Tick or lot size
+
+    Returns:
+        Value in units of the grid
+
+    Raises:
+        ValueError: If value is not a multiple of unit
+    """
+    units = Decimal(value) / unit
+    if units != units.to_integral_value():
+        raise ValueError(f"{value} is not a multiple of {unit}")
+    return int(units)
+
+
+def _convert_list_to_levels(
+    lst: List[List[str]], tick_size: Decimal, lot_size: Decimal
+) -> List[Dict[str, int]]:
+    """Convert nested list to version 2 integer levels
+
+    Args:
+        lst: List of [price, quantity] pairs
+        tick_size: Price grid
+        lot_size: Quantity grid
+
+    Returns:
+        List of {"price": ticks, "qty": lots} structs
+    """
+    return [
+        {"price": to_units(price, tick_size), "qty": to_units(qty, lot_size)}
+        for price, qty in lst
+    ]
+
+
+def schema_units(schema: pa.Schema) -> Optional[Tuple[Decimal, Decimal]]:
+    """Get the tick/lot grid of a version 2 file
+
+    Args:
+        schema: Arrow schema read from a Parquet file
+
+    Returns:
+        (tick_size, lot_size) for version 2 files, None for version 1
+    """
+    metadata = schema.metadata or {}
+    if int(metadata.get(SCHEMA_VERSION_KEY, b"1")) < 2:
+        return None
+    return (
+        Decimal(metadata[TICK_SIZE_KEY].decode()),
+        Decimal(metadata[LOT_SIZE_KEY].decode()),
+    )
+
+
+def decode_levels(
+    levels: Sequence[Any], units: Optional[Tuple[Decimal, Decimal]]
+) -> List[List[str]]:
+    """Decode a stored bids/asks cell of either schema version
+
+    Args:
+        levels: "price,qty" strings (version 1) or price/qty structs (version 2)
+        units: (tick_size, lot_size) from schema_units, None for version 1
+
+    Returns:
+        List of [price, quantity] decimal strings
+    """
+    if units is None:
+        return _convert_string_to_list(levels)
+    tick_size, lot_size = units
+    return [
+        [str(level["price"] * tick_size), str(level["qty"] * lot_size)]
+        for level in levels
+    ]
+
+
 class ParquetWriter:
     """Writes market data to daily Parquet files
 
@@ -65,20 +181,89 @@ class ParquetWriter:
         current_date: Date of current file
         writer: PyArrow writer instance
         schema: PyArrow schema for data
+        schema_version: 1 for string levels, 2 for integer tick/lot levels
+        tick_size: Price grid for version 2 levels
+        lot_size: Quantity grid for version 2 levels
+        row_group_size: Messages buffered per Parquet row group
+        compression: Parquet codec, "zstd" unless set otherwise
+        background: Whether batches are written by a background thread
+        flush_interval: Seconds a partial batch may wait before it is flushed
     """
 
-    def __init__(self, symbol: str = "btcusdt", base_path: str = "data/raw") -> None:
+    def __init__(
+        self,
+        symbol: str = "btcusdt",
+        base_path: str = "data/raw",
+        schema_version: int = 1,
+        tick_size: Union[str, Decimal] = "0.00000001",
+        lot_size: Union[str, Decimal] = "0.00000001",
+        row_group_size: Optional[int] = None,
+        compression: str = "zstd",
+        background: bool = False,
+        max_pending: int = _DEFAULT_MAX_PENDING,
+        flush_interval: Optional[float] = None,
+    ) -> None:
         """Initialize writer
 
         Args:
             symbol: Trading pair symbol
             base_path: Base directory for Parquet files
+            schema_version: 1 for string levels, 2 for integer tick/lot levels
+            tick_size: Price grid for version 2 levels
+            lot_size: Quantity grid for version 2 levels
+            row_group_size: Messages per row group, buffered until full and
+                flushed on rotation/close; defaults to 1 for version 1 and
+                4096 for version 2
+            compression: Parquet codec for every column, zstd by default
+                since it packs repetitive level data much tighter than
+                snappy
+            background: Hand each finished batch to a writer thread so
+                write() only converts and buffers; Parquet encoding,
+                compression and disk writes happen off the caller's thread
+            max_pending: Batches the background thread may have queued.
+                write() blocks once they are all taken, which bounds memory
+                and shows up as backpressure in stats()
+            flush_interval: Flush a partial batch on the first write at
+                least this many seconds after its first message, None to
+                wait until it is full
+
+        Raises:
+            ValueError: If the schema version, row group size or queue
+                bound is invalid
         """
+        if schema_version not in SCHEMA_VERSIONS:
+            raise ValueError(f"unknown schema version: {schema_version}")
+        if row_group_size is None:
+            row_group_size = _DEFAULT_ROW_GROUP_SIZE[schema_version]
+        if row_group_size < 1:
+            raise ValueError("row_group_size must be at least 1")
+        if max_pending < 1:
+            raise ValueError("max_pending must be at least 1")
+
         self.symbol = symbol.lower()
         self.base_path = Path(base_path)
         self.current_file: Optional[str] = None
         self.current_date: Optional[datetime.date] = None
         self.writer: Optional[pq.ParquetWriter] = None
+        self.schema_version = schema_version
+        self.tick_size = Decimal(str(tick_size))
+        self.lot_size = Decimal(str(lot_size))
+        self.row_group_size = row_group_size
+        self.compression = compression
+        self.background = background
+        self.flush_interval = flush_interval
+
+        if schema_version == 1:
+            # Store levels as list of "price,quantity" strings
+            level_type = pa.list_(pa.string())
+            metadata = None
+        else:
+            level_type = LEVEL_TYPE
+            metadata = {
+                SCHEMA_VERSION_KEY: str(schema_version).encode(),
+                TICK_SIZE_KEY: str(self.tick_size).encode(),
+                LOT_SIZE_KEY: str(self.lot_size).encode(),
+            }
 
         # Create schema for Parquet files
         self.schema = pa.schema(
@@ -88,17 +273,37 @@ class ParquetWriter:
                 ("symbol", pa.string()),
                 ("first_update_id", pa.int64()),
                 ("final_update_id", pa.int64()),
-                (
-                    "bids",
-                    pa.list_(pa.string()),
-                ),  # Store as list of "price,quantity" strings
-                (
-                    "asks",
-                    pa.list_(pa.string()),
-                ),  # Store as list of "price,quantity" strings
-            ]
+                ("bids", level_type),
+                ("asks", level_type),
+            ],
+            metadata=metadata,
         )
 
+        # messages are buffered column by column and become one record
+        # batch per row group
+        self._columns: Dict[str, List[Any]] = {name: [] for name in self.schema.names}
+        self._buffered = 0
+        self._batch_started = 0.0
+
+        # flush and backpressure counters, see stats()
+        self._stats_lock = threading.Lock()
+        self._stats = {
+            "batches_written": 0,
+            "rows_written": 0,
+            "last_flush_seconds": 0.0,
+            "max_flush_seconds": 0.0,
+            "total_flush_seconds": 0.0,
+            "backpressure_waits": 0,
+            "backpressure_seconds": 0.0,
+        }
+
+        # the background thread owns its pq.ParquetWriter; batches reach it
+        # tagged with their file, so rotation stays decided here
+        self.max_pending = max_pending
+        self._queue: Optional[queue.Queue] = None
+        self._worker: Optional[threading.Thread] = None
+        self._worker_error: Optional[BaseException] = None
+
         # Ensure base directory exists
         os.makedirs(self.base_path, exist_ok=True)
 
@@ -128,7 +333,12 @@ class ParquetWriter:
 
         if message_date != self.current_date:
             # Close current file if open
-            if self.writer is not None:
+            if self.background:
+                self._flush()
+                if self._worker is not None:
+                    self._submit(self.current_file, None)
+            elif self.writer is not None:
+                self._flush()
                 self.writer.close()
                 self.writer = None
 
@@ -136,15 +346,167 @@ class ParquetWriter:
             self.current_date = message_date
             self.current_file = self._get_file_path(message_date)
 
-            # Create new writer
-            current_file_str = str(self.current_file)
-            schema = self.schema
-            compression = "snappy"
-            self.writer = pq.ParquetWriter(  # noqa: E501
-                current_file_str, schema=schema, compression=compression
-            )
+            # the background thread opens the file with its first batch
+            if not self.background:
+                self.writer = self._open_file(self.current_file)
             logger.info(f"Rotated to new Parquet file: {self.current_file}")
 
+    def _open_file(self, path: Path) -> pq.ParquetWriter:
+        """Create a Parquet writer for one day's file
+
+        Args:
+            path: File to write
+
+        Returns:
+            PyArrow writer with the schema, codec and encodings
+        """
+        return pq.ParquetWriter(
+            str(path),
+            schema=self.schema,
+            compression=self.compression,
+            **self._encoding_options(),
+        )
+
+    def _encoding_options(self) -> Dict[str, Any]:
+        """Get column encodings for the schema version
+
+        Returns:
+            Extra keyword arguments for pq.ParquetWriter
+        """
+        if self.schema_version == 1:
+            return {}
+        # symbol and event type repeat on every row; ids, times and sorted
+        # price ladders are close to their neighbours, so delta-pack them
+        return {
+            "use_dictionary": ["event_type", "symbol"],
+            "column_encoding": {
+                column: "DELTA_BINARY_PACKED" for column in _DELTA_COLUMNS
+            },
+            "use_compliant_nested_type": True,
+        }
+
+    def _take_batch(self) -> pa.RecordBatch:
+        """Build a record batch from the buffered columns and reset them
+
+        Returns:
+            Buffered messages as one record batch
+        """
+        batch = pa.RecordBatch.from_pydict(self._columns, schema=self.schema)
+        for column in self._columns.values():
+            column.clear()
+        self._buffered = 0
+        return batch
+
+    def _flush(self) -> None:
+        """Write buffered messages to the current file as one row group"""
+        if not self._buffered or self.current_file is None:
+            return
+        batch = self._take_batch()
+        if self.background:
+            self._submit(self.current_file, batch)
+            return
+        start = time.perf_counter()
+        self.writer.write_batch(batch, row_group_size=self.row_group_size)
+        self._record_flush(time.perf_counter() - start, batch.num_rows)
+
+    def _record_flush(self, seconds: float, rows: int) -> None:
+        with self._stats_lock:
+            stats = self._stats
+            stats["batches_written"] += 1
+            stats["rows_written"] += rows
+            stats["last_flush_seconds"] = seconds
+            stats["max_flush_seconds"] = max(stats["max_flush_seconds"], seconds)
+            stats["total_flush_seconds"] += seconds
+
+    def _submit(self, path: Path, batch: Optional[pa.RecordBatch]) -> None:
+        """Queue a batch for the background thread, None closes path
+
+        Blocks while max_pending batches are already queued
+
+        Args:
+            path: File the batch belongs to
+            batch: Messages to write, None to close the file
+
+        Raises:
+            RuntimeError: If the background thread failed to write
+        """
+        self._raise_worker_error()
+        if self._worker is None:
+            # started with the first batch, and again after a close()
+            self._queue = queue.Queue(maxsize=self.max_pending)
+            self._worker = threading.Thread(
+                target=self._run_worker,
+                args=(self._queue,),
+                name=f"parquet-{self.symbol}",
+                daemon=True,
+            )
+            self._worker.start()
+        try:
+            self._queue.put_nowait((path, batch))
+            return
+        except queue.Full:
+            pass
+        with self._stats_lock:
+            self._stats["backpressure_waits"] += 1
+        start = time.perf_counter()
+        self._queue.put((path, batch))
+        waited = time.perf_counter() - start
+        with self._stats_lock:
+            self._stats["backpressure_seconds"] += waited
+
+    def _raise_worker_error(self) -> None:
+        if self._worker_error is not None:
+            error, self._worker_error = self._worker_error, None
+            raise RuntimeError(f"background Parquet write failed: {error}") from error
+
+    def _run_worker(self, batches: queue.Queue) -> None:
+        """Write queued batches until the None sentinel from close()"""
+        writers: Dict[Path, pq.ParquetWriter] = {}
+        while True:
+            item = batches.get()
+            try:
+                if item is None:
+                    break
+                path, batch = item
+                if batch is None:
+                    writer = writers.pop(path, None)
+                    if writer is not None:
+                        writer.close()
+                    continue
+                start = time.perf_counter()
+                writer = writers.get(path)
+                if writer is None:
+                    writer = writers[path] = self._open_file(path)
+                writer.write_batch(batch, row_group_size=self.row_group_size)
+                self._record_flush(time.perf_counter() - start, batch.num_rows)
+            except Exception as e:
+                # keep draining so close() never waits on a full queue; the
+                # caller sees the error on its next write or close
+                logger.error(f"Error writing Parquet batch: {e}")
+                self._worker_error = e
+            finally:
+                batches.task_done()
+        for writer in writers.values():
+            try:
+                writer.close()
+            except Exception as e:
+                logger.error(f"Error closing Parquet file: {e}")
+                self._worker_error = e
+
+    def stats(self) -> Dict[str, float]:
+        """Get flush latency and backpressure counters
+
+        Returns:
+            Batches and rows written, last/max/total seconds spent writing
+            a batch, how often and how long write() waited on a full
+            background queue, and the batches queued right now
+        """
+        with self._stats_lock:
+            stats = dict(self._stats)
+        stats["pending_batches"] = self._queue.qsize() if self._queue else 0
+        stats["max_pending"] = self.max_pending
+        return stats
+
     def write(self, message: Dict[str, Any]) -> None:
         """Write message to Parquet file
 
@@ -161,39 +523,112 @@ class ParquetWriter:
             # Rotate file if needed
             self._rotate_if_needed(depth_update.E)
 
-            # Convert nested lists to strings for better storage
-            bids_str = _convert_list_to_string(depth_update.b)
-            asks_str = _convert_list_to_string(depth_update.a)
-
-            # Convert to Arrow table
-            table = pa.Table.from_pydict(
-                {
-                    "event_type": [depth_update.e],
-                    "event_time": [depth_update.E],
-                    "symbol": [depth_update.s],
-                    "first_update_id": [depth_update.U],
-                    "final_update_id": [depth_update.u],
-                    "bids": [bids_str],
-                    "asks": [asks_str],
-                },
-                schema=self.schema,
+            if self.schema_version == 1:
+                # Convert nested lists to strings for better storage
+                bids = _convert_list_to_string(depth_update.b)
+                asks = _convert_list_to_string(depth_update.a)
+            else:
+                bids = _convert_list_to_levels(
+                    depth_update.b, self.tick_size, self.lot_size
+                )
+                asks = _convert_list_to_levels(
+                    depth_update.a, self.tick_size, self.lot_size
+                )
+
+            self._append(
+                (
+                    depth_update.e,
+                    depth_update.E,
+                    depth_update.s,
+                    depth_update.U,
+                    depth_update.u,
+                    bids,
+                    asks,
+                )
             )
 
-            # Write to file
-            self.writer.write_table(table)
+        except Exception as e:
+            logger.error(f"Error writing message to Parquet: {e}")
+            raise
+
+    def write_levels(self, update: Any) -> None:
+        """Write a depth update already decoded onto the file grid
+
+        Args:
+            update: FixedDepthUpdate with LEVEL_DTYPE levels on this
+                writer's tick/lot grid
 
+        Raises:
+            ValueError: If the writer stores version 1 string levels
+        """
+        if self.schema_version == 1:
+            raise ValueError("Version 1 files store string levels, use write()")
+        try:
+            self._rotate_if_needed(update.E)
+            self._append(
+                (
+                    update.e,
+                    update.E,
+                    update.s,
+                    update.U,
+                    update.u,
+                    [{"price": p, "qty": q} for p, q in update.b.tolist()],
+                    [{"price": p, "qty": q} for p, q in update.a.tolist()],
+                )
+            )
         except Exception as e:
             logger.error(f"Error writing message to Parquet: {e}")
             raise
 
+    def _append(self, row: Tuple[Any, ...]) -> None:
+        """Buffer one row, flushing once a full row group is ready"""
+        for column, value in zip(self._columns.values(), row):
+            column.append(value)
+        now = time.monotonic()
+        if self._buffered == 0:
+            self._batch_started = now
+        self._buffered += 1
+        if self._buffered >= self.row_group_size or (
+            self.flush_interval is not None
+            and now - self._batch_started >= self.flush_interval
+        ):
+            self._flush()
+
     def close(self) -> None:
-        """Close current Parquet file"""
+        """Close current Parquet file
+
+        With a background writer this waits for every queued batch to be
+        written and stops the thread
+
+        Raises:
+            RuntimeError: If the background thread failed to write
+        """
+        if self.background:
+            try:
+                self._flush()
+            except Exception as e:
+                logger.error(f"Error closing Parquet writer: {e}")
+            if self._worker is not None:
+                self._queue.put(None)
+                self._worker.join()
+                self._worker = None
+            for column in self._columns.values():
+                column.clear()
+            self._buffered = 0
+            self.current_file = None
+            self.current_date = None
+            self._raise_worker_error()
+            return
         if self.writer is not None:
             try:
+                self._flush()
                 self.writer.close()
             except Exception as e:
                 logger.error(f"Error closing Parquet writer: {e}")
             finally:
+                for column in self._columns.values():
+                    column.clear()
+                self._buffered = 0
                 self.writer = None
                 self.current_file = None
                 self.current_date = None
@@ -5,21 +5,35 @@ This module provides the MessageRecorder class which:
 1. Connects to a Binance WebSocket stream for market data
 2. Validates incoming messages using schemas
 3. Writes valid messages to Redis stream and Parquet files
+4. Optionally publishes them to a shared memory ring for same-host readers
+
+Redis writes are one XADD per message by default. With redis_batch_size
+above 1 they are grouped into pipelines of up to that many entries, sent
+once full or redis_batch_interval seconds after the first one was queued,
+and the stream is trimmed approximately (MAXLEN ~) so Redis can drop whole
+nodes instead of exact entries.
+
+With fast_decode each frame is parsed once, natively, onto the 1e-8 grid
+the Parquet (version 2), tick store and ring writers share, and every
+writer takes those integer levels without a Decimal per level. A json
+stream entry is then the raw frame itself.
 """
 
 import asyncio
-import json
 import logging
 import time
 from dataclasses import asdict
-from typing import Any, Dict, Optional
+from typing import Any, Dict, List, Optional, Union
 
 import redis.asyncio as redis
 from websockets.exceptions import ConnectionClosedOK
 
+from storage.tick_store import TickStoreWriter
+
 from .binance_ws import BinanceWebSocket
 from .parquet_writer import ParquetWriter
 from .schemas import DepthUpdate
+from .stream_codec import JSON_FIELD, PAYLOAD_FORMATS, encode_fields
 
 logging.basicConfig(
     level=logging.INFO,
@@ -27,6 +41,18 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
+# messages per parquet row group, and the most seconds one may stay buffered
+PARQUET_ROW_GROUP_SIZE = 1024
+PARQUET_FLUSH_INTERVAL = 1.0
+
+# seconds between parquet writer stats log lines
+STATS_LOG_INTERVAL = 60.0
+
+# entries kept on the redis stream
+REDIS_MAXLEN = 100000
+# most seconds a queued entry waits for its pipeline to fill
+REDIS_BATCH_INTERVAL = 0.005
+
 
 class MessageRecorder:
     """Records WebSocket messages to Redis stream and Parquet files
@@ -44,6 +70,12 @@ class MessageRecorder:
         ws_client: WebSocket client for market data
         stream_key: Redis stream key for storing messages
         parquet_writer: Writer for Parquet files
+        tick_store: Optional writer for memory-mapped tick store files
+        depth_ring: Optional shared memory ring publisher
+        payload_format: Stream entry encoding, "json" or "binary"
+        redis_batch_size: Most entries per Redis pipeline, 1 for no batching
+        redis_batch_interval: Most seconds an entry waits for its pipeline
+        decoder: Native depth decoder when fast_decode is on, otherwise None
         _running: Internal flag for controlling the recording loop
         _cleanup_done: Internal flag for preventing double cleanup
         timeout: Optional timeout in seconds
@@ -55,6 +87,12 @@ class MessageRecorder:
         symbol: str = "btcusdt",
         timeout: Optional[int] = None,
         output_path: str = "data/raw",
+        tick_store_path: Optional[str] = None,
+        shm_ring: Optional[str] = None,
+        payload_format: str = "json",
+        redis_batch_size: int = 1,
+        redis_batch_interval: float = REDIS_BATCH_INTERVAL,
+        fast_decode: bool = False,
     ) -> None:
         """Initialize recorder
 
@@ -63,16 +101,71 @@ class MessageRecorder:
             symbol: Trading pair symbol to record
             timeout: Optional timeout in seconds
             output_path: Path to write Parquet files
+            tick_store_path: Path to also write tick store files, None to skip
+            shm_ring: Shared memory segment to also publish to, None to skip
+            payload_format: Stream entry encoding, "json" or "binary"
+            redis_batch_size: Most entries per Redis pipeline, 1 writes each
+                message with its own XADD
+            redis_batch_interval: Most seconds an entry waits for its
+                pipeline to fill
+            fast_decode: Decode frames natively into integer levels and
+                write Parquet version 2 files
+
+        Raises:
+            ValueError: If the payload format or batch settings are invalid
         """
+        if payload_format not in PAYLOAD_FORMATS:
+            raise ValueError(f"Unknown payload format: {payload_format}")
+        if redis_batch_size < 1:
+            raise ValueError("redis_batch_size must be at least 1")
+        if redis_batch_interval <= 0:
+            raise ValueError("redis_batch_interval must be positive")
         self.redis_client = redis.from_url(redis_url)
         self.symbol = symbol.lower()
         self.ws_client = BinanceWebSocket(symbol=self.symbol)
         self.stream_key = f"stream:lob:{self.symbol}"
-        self.parquet_writer = ParquetWriter(symbol=self.symbol, base_path=output_path)
+        # parquet encoding and zstd compression run on the writer's own
+        # thread, so a row group flush never holds up the next receive
+        self.parquet_writer = ParquetWriter(
+            symbol=self.symbol,
+            base_path=output_path,
+            row_group_size=PARQUET_ROW_GROUP_SIZE,
+            schema_version=2 if fast_decode else 1,
+            compression="zstd",
+            background=True,
+            flush_interval=PARQUET_FLUSH_INTERVAL,
+        )
+        self.tick_store: Optional[TickStoreWriter] = None
+        if tick_store_path is not None:
+            self.tick_store = TickStoreWriter(
+                symbol=self.symbol, base_path=tick_store_path
+            )
+        self.depth_ring = None
+        if shm_ring is not None:
+            # the ring is native, only load it when asked for
+            from .shm_ring import DepthRingWriter
+
+            self.depth_ring = DepthRingWriter(shm_ring)
+        self.decoder = None
+        if fast_decode:
+            # native like the ring; every writer here is on the default grid
+            from .depth_decoder import DepthDecoder
+
+            self.decoder = DepthDecoder(
+                self.parquet_writer.tick_size, self.parquet_writer.lot_size
+            )
+        self.payload_format = payload_format
+        self.redis_batch_size = redis_batch_size
+        self.redis_batch_interval = redis_batch_interval
+        self._redis_pending: List[Dict[str, Any]] = []
+        self._redis_flush_task: Optional[asyncio.Task] = None
+        # pipelines go out one at a time so entries keep their order
+        self._redis_lock = asyncio.Lock()
         self._running = False
         self._cleanup_done = False
         self.timeout = timeout
         self._start_time = None
+        self._last_stats_log = time.monotonic()
 
     async def start(self) -> None:
         """Start recording messages from WebSocket to Redis and Parquet
@@ -103,6 +196,16 @@ class MessageRecorder:
                     break
 
                 try:
+                    if self.decoder is not None:
+                        received = await self.ws_client.receive_depth(self.decoder)
+                        if not received:
+                            continue
+                        try:
+                            await self._record_decoded(*received)
+                        except Exception as e:
+                            logger.error(f"Error processing message: {e}")
+                        continue
+
                     message = await self.ws_client.receive()
 
                     if not message:
@@ -135,7 +238,7 @@ class MessageRecorder:
         1. Stops the recording loop
         2. Unsubscribes from WebSocket
         3. Closes WebSocket connection
-        4. Closes Redis connection
+        4. Sends queued Redis entries and closes Redis connection
         5. Closes Parquet writer
         """
         if self._cleanup_done:
@@ -151,6 +254,13 @@ class MessageRecorder:
                 logger.error(f"Error disconnecting from WebSocket: {e}")
 
         if self.redis_client:
+            if self._redis_flush_task is not None:
+                self._redis_flush_task.cancel()
+                self._redis_flush_task = None
+            try:
+                await self._flush_redis()
+            except Exception as e:
+                logger.error(f"Error flushing Redis pipeline: {e}")
             try:
                 await self.redis_client.aclose()
             except Exception as e:
@@ -159,9 +269,19 @@ class MessageRecorder:
         if self.parquet_writer:
             try:
                 self.parquet_writer.close()
+                self._log_writer_stats()
             except Exception as e:
                 logger.error(f"Error closing Parquet writer: {e}")
 
+        if self.tick_store:
+            try:
+                self.tick_store.close()
+            except Exception as e:
+                logger.error(f"Error closing tick store: {e}")
+
+        if self.depth_ring:
+            self.depth_ring.close()
+
         self._cleanup_done = True
         logger.info("Stopped recording messages")
 
@@ -175,24 +295,143 @@ class MessageRecorder:
             Exception: If error writing message
         """
         try:
+            # same-host readers first, they are the latency sensitive ones.
+            # an update the ring can't carry still goes to redis.
+            if self.depth_ring:
+                try:
+                    self.depth_ring.write(message)
+                except ValueError as e:
+                    logger.error(f"Error publishing to depth ring: {e}")
+
             # write to redis stream
-            json_data = json.dumps(message)
-            stream_key = self.stream_key
-            fields = {"data": json_data}
-            maxlen = 100000  # keep last 100k messages
-            await self.redis_client.xadd(  # noqa: E501
-                stream_key,
-                fields=fields,
-                maxlen=maxlen,
-            )
+            await self._write_redis(encode_fields(message, self.payload_format))
 
-            # write to parquet
+            # buffer for parquet, only a full queue of batches blocks here
             self.parquet_writer.write(message)
+            if time.monotonic() - self._last_stats_log >= STATS_LOG_INTERVAL:
+                self._log_writer_stats()
+
+            # write to tick store
+            if self.tick_store:
+                self.tick_store.write(message)
 
         except Exception as e:
             logger.error(f"Error recording message: {e}")
             raise
 
+    async def _record_decoded(self, raw: Union[str, bytes], update: Any) -> None:
+        """Record a natively decoded message to every output
+
+        Args:
+            raw: Frame as received, forwarded as the json stream entry
+            update: FixedDepthUpdate decoded from raw
+
+        Raises:
+            Exception: If error writing message
+        """
+        try:
+            if self.depth_ring:
+                try:
+                    self.depth_ring.write_levels(update)
+                except ValueError as e:
+                    logger.error(f"Error publishing to depth ring: {e}")
+
+            # the frame already is the json of a DepthUpdate
+            if self.payload_format == "json":
+                fields = {JSON_FIELD: raw}
+            else:
+                fields = encode_fields(
+                    self.decoder.to_message(update), self.payload_format
+                )
+            await self._write_redis(fields)
+
+            self.parquet_writer.write_levels(update)
+            if time.monotonic() - self._last_stats_log >= STATS_LOG_INTERVAL:
+                self._log_writer_stats()
+
+            if self.tick_store:
+                self.tick_store.write_levels(
+                    update.E, update.U, update.u, update.b, update.a
+                )
+
+        except Exception as e:
+            logger.error(f"Error recording message: {e}")
+            raise
+
+    async def _write_redis(self, fields: Dict[str, Any]) -> None:
+        """Add one stream entry, directly or through the pipeline queue
+
+        Args:
+            fields: Entry fields for XADD
+        """
+        if self.redis_batch_size > 1:
+            await self._queue_redis(fields)
+        else:
+            await self.redis_client.xadd(
+                self.stream_key,
+                fields=fields,
+                maxlen=REDIS_MAXLEN,
+            )
+
+    async def _queue_redis(self, fields: Dict[str, Any]) -> None:
+        """Queue a stream entry, sending the pipeline once it is full
+
+        Args:
+            fields: Entry fields for XADD
+        """
+        self._redis_pending.append(fields)
+        if len(self._redis_pending) >= self.redis_batch_size:
+            # a full pipeline goes now, the timer is for the slow periods
+            if self._redis_flush_task is not None:
+                self._redis_flush_task.cancel()
+                self._redis_flush_task = None
+            await self._flush_redis()
+        elif self._redis_flush_task is None:
+            self._redis_flush_task = asyncio.create_task(self._flush_redis_later())
+
+    async def _flush_redis_later(self) -> None:
+        """Send whatever is queued once the batch interval has passed"""
+        await asyncio.sleep(self.redis_batch_interval)
+        # from here on a cancel would lose the batch being sent
+        self._redis_flush_task = None
+        try:
+            await self._flush_redis()
+        except Exception as e:
+            logger.error(f"Error flushing Redis pipeline: {e}")
+
+    async def _flush_redis(self) -> None:
+        """Send the queued stream entries as one pipeline
+
+        Raises:
+            Exception: If the pipeline fails, its entries are dropped
+        """
+        async with self._redis_lock:
+            batch, self._redis_pending = self._redis_pending, []
+            if not batch:
+                return
+            async with self.redis_client.pipeline(transaction=False) as pipe:
+                for fields in batch:
+                    pipe.xadd(
+                        self.stream_key,
+                        fields,
+                        maxlen=REDIS_MAXLEN,
+                        approximate=True,
+                    )
+                await pipe.execute()
+
+    def _log_writer_stats(self) -> None:
+        """Log parquet flush latency and backpressure since the start"""
+        self._last_stats_log = time.monotonic()
+        stats = self.parquet_writer.stats()
+        logger.info(
+            f"Parquet writer: {stats['rows_written']} rows in "
+            f"{stats['batches_written']} batches, flush max "
+            f"{stats['max_flush_seconds'] * 1000:.1f}ms, "
+            f"{stats['pending_batches']}/{stats['max_pending']} pending, "
+            f"{stats['backpressure_waits']} backpressure waits "
+            f"({stats['backpressure_seconds']:.3f}s)"
+        )
+
 
 async def main() -> None:
     """Main function for testing the recorder"""
@@ -206,9 +445,46 @@ async def main() -> None:
         default="data/raw",
         help="Path to write Parquet files",
     )
+    parser.add_argument(
+        "--tick-store-path",
+        type=str,
+        default=None,
+        help="Path to also write memory-mapped tick store files",
+    )
+    parser.add_argument(
+        "--shm-ring",
+        type=str,
+        default=None,
+        help="Shared memory segment to also publish depth updates to",
+    )
+    parser.add_argument(
+        "--payload-format",
+        choices=("json", "binary"),
+        default="json",
+        help="Redis stream entry encoding",
+    )
+    parser.add_argument(
+        "--redis-batch-size",
+        type=int,
+        default=1,
+        help="Most stream entries per Redis pipeline, 1 for one XADD each",
+    )
+    parser.add_argument(
+        "--fast-decode",
+        action="store_true",
+        help="Decode frames natively into integer levels (Parquet version 2)",
+    )
     args = parser.parse_args()
 
-    recorder = MessageRecorder(timeout=args.timeout, output_path=args.output_path)
+    recorder = MessageRecorder(
+        timeout=args.timeout,
+        output_path=args.output_path,
+        tick_store_path=args.tick_store_path,
+        shm_ring=args.shm_ring,
+        payload_format=args.payload_format,
+        redis_batch_size=args.redis_batch_size,
+        fast_decode=args.fast_decode,
+    )
     try:
         await recorder.start()
     except KeyboardInterrupt:
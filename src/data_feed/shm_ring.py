@@ -0,0 +1,249 @@
+"""
+shared-memory depth ring between the recorder and the live engine
+
+This module provides a same-host transport that skips Redis and JSON:
+1. DepthRingWriter lays a match_engine.ShmRing over a named shared memory
+   segment and publishes each depth update as a fixed-size binary record
+2. DepthRingReader attaches to the segment with its own cursor; any number
+   of readers can follow one writer
+3. records hold levels as integer ticks/lots, the tick store's LEVEL_DTYPE
+
+the writer never waits for readers. a reader that falls a whole ring behind
+skips ahead and counts the skipped messages in `dropped`; Redis stays the
+durable path for anything that needs every message.
+"""
+
+import logging
+import sys
+from decimal import Decimal
+from multiprocessing import resource_tracker, shared_memory
+from typing import Any, Dict, List, Optional, Union
+
+import numpy as np
+
+from match_engine import RingReader, ShmRing
+from storage.tick_store import TickMessage
+
+from .schemas import DepthUpdate
+
+logger = logging.getLogger(__name__)
+
+DEFAULT_CAPACITY = 4096
+# levels per message, bids and asks together; larger updates are refused
+DEFAULT_MAX_LEVELS = 256
+
+
+def ring_name(symbol: str) -> str:
+    """Get the default shared memory segment name for a symbol
+
+    Args:
+        symbol: Trading pair symbol
+
+    Returns:
+        Segment name
+    """
+    return f"mm_depth_{symbol.lower()}"
+
+
+# segments created by a writer in this process, tracked for its unlink
+_created = set()
+
+
+def _attach_segment(name: str) -> shared_memory.SharedMemory:
+    """Open an existing segment without handing it to the resource tracker
+
+    before python 3.13 every process that opens a segment registers it, and
+    the tracker unlinks it when that process exits, even for a reader
+    """
+    if sys.version_info >= (3, 13):
+        return shared_memory.SharedMemory(name=name, track=False)
+    segment = shared_memory.SharedMemory(name=name)
+    if name not in _created:
+        resource_tracker.unregister(segment._name, "shared_memory")
+    return segment
+
+
+class DepthRingWriter:
+    """Publishes depth updates into a shared memory ring
+
+    Attributes:
+        name: Shared memory segment name
+        ring: Native ring over the segment
+    """
+
+    def __init__(
+        self,
+        name: str,
+        capacity: int = DEFAULT_CAPACITY,
+        max_levels: int = DEFAULT_MAX_LEVELS,
+        tick_size: Union[str, Decimal] = "0.00000001",
+        lot_size: Union[str, Decimal] = "0.00000001",
+    ) -> None:
+        """Create the segment and lay out an empty ring
+
+        Args:
+            name: Shared memory segment name
+            capacity: Messages kept, a power of two
+            max_levels: Bid plus ask levels one message may carry
+            tick_size: Price grid of published levels
+            lot_size: Quantity grid of published levels
+
+        Raises:
+            ValueError: If capacity is not a power of two
+        """
+        self.name = name
+        size = ShmRing.bytes_for(capacity, max_levels)
+        try:
+            self._segment = shared_memory.SharedMemory(
+                name=name, create=True, size=size
+            )
+        except FileExistsError:
+            # left behind by a writer that didn't shut down cleanly
+            logger.warning(f"Replacing stale depth ring segment {name}")
+            stale = shared_memory.SharedMemory(name=name)
+            stale.close()
+            stale.unlink()
+            self._segment = shared_memory.SharedMemory(
+                name=name, create=True, size=size
+            )
+        _created.add(name)
+        try:
+            self.ring = ShmRing.create(
+                self._segment.buf,
+                capacity,
+                max_levels,
+                # plain notation, str() would give "1E-8"
+                format(Decimal(str(tick_size)), "f"),
+                format(Decimal(str(lot_size)), "f"),
+            )
+        except Exception:
+            self._segment.close()
+            self._segment.unlink()
+            _created.discard(name)
+            raise
+
+    def write(self, message: Dict[str, Any]) -> None:
+        """Publish one depth update
+
+        Args:
+            message: Depth update in DepthUpdate fields (e, E, s, U, u, b, a)
+
+        Raises:
+            ValueError: If a level is off the grid or there are too many levels
+        """
+        self.ring.publish(
+            message["E"], message["U"], message["u"], message["b"], message["a"]
+        )
+
+    def write_levels(self, update: Any) -> None:
+        """Publish one depth update already on the ring's grid
+
+        Args:
+            update: FixedDepthUpdate with LEVEL_DTYPE levels on the
+                ring's grid
+
+        Raises:
+            ValueError: If there are too many levels
+        """
+        self.ring.publish_levels(update.E, update.U, update.u, update.b, update.a)
+
+    def close(self) -> None:
+        """Release and remove the segment"""
+        if self._segment is None:
+            return
+        # the ring keeps the segment's buffer exported, drop it first
+        self.ring = None
+        try:
+            self._segment.close()
+            self._segment.unlink()
+        except Exception as e:
+            logger.error(f"Error closing depth ring: {e}")
+        finally:
+            self._segment = None
+            _created.discard(self.name)
+
+
+class DepthRingReader:
+    """Follows a shared memory ring written by DepthRingWriter
+
+    Attributes:
+        name: Shared memory segment name
+        ring: Native ring over the segment
+        tick_size: Price grid of the levels
+        lot_size: Quantity grid of the levels
+    """
+
+    def __init__(self, name: str, from_oldest: bool = False) -> None:
+        """Attach to an existing ring
+
+        Args:
+            name: Shared memory segment name
+            from_oldest: Start at the oldest message still in the ring
+                instead of the next one published
+
+        Raises:
+            FileNotFoundError: If no writer has created the segment
+            ValueError: If the segment does not hold a depth ring
+        """
+        self.name = name
+        self._segment = _attach_segment(name)
+        self.ring = ShmRing.attach(self._segment.buf)
+        self._reader = RingReader(self.ring, from_oldest)
+        self.tick_size = Decimal(self.ring.tick_size)
+        self.lot_size = Decimal(self.ring.lot_size)
+
+    @property
+    def dropped(self) -> int:
+        """Messages overwritten before this reader got to them"""
+        return self._reader.dropped
+
+    def read(self) -> Optional[TickMessage]:
+        """Read the next message as integer levels
+
+        Returns:
+            (event_time, first_update_id, final_update_id, bids, asks) with
+            LEVEL_DTYPE level arrays, or None when caught up
+        """
+        return self._reader.read()
+
+    def _levels(self, levels: np.ndarray) -> List[List[str]]:
+        return [
+            [str(price * self.tick_size), str(qty * self.lot_size)]
+            for price, qty in levels.tolist()
+        ]
+
+    def read_update(self, symbol: str) -> Optional[DepthUpdate]:
+        """Read the next message as a DepthUpdate with decimal string levels
+
+        Args:
+            symbol: Symbol to put on the update
+
+        Returns:
+            Depth update, or None when caught up
+        """
+        message = self._reader.read()
+        if message is None:
+            return None
+        event_time, first_update_id, final_update_id, bids, asks = message
+        return DepthUpdate(
+            e="depthUpdate",
+            E=event_time,
+            s=symbol.upper(),
+            U=first_update_id,
+            u=final_update_id,
+            b=self._levels(bids),
+            a=self._levels(asks),
+        )
+
+    def close(self) -> None:
+        """Detach from the segment, leaving it to the writer"""
+        if self._segment is None:
+            return
+        self._reader = None
+        self.ring = None
+        try:
+            self._segment.close()
+        except Exception as e:
+            logger.error(f"Error closing depth ring: {e}")
+        finally:
+            self._segment = None
@@ -0,0 +1,152 @@
+"""
+redis stream payloads for depth updates
+
+This module provides the two encodings the recorder can put on the stream:
+1. json, the message as text under the "data" field
+2. binary, a packed header and length-prefixed level strings under "bin"
+
+a reader tells the two apart by the field name, so a stream may hold either
+and a consumer needs no setting to follow a recorder switching between them.
+levels stay the exchange's decimal strings in both, so decoding a binary
+entry gives back exactly the DepthUpdate that was encoded, without the json
+parse or any float rounding.
+"""
+
+import json
+import struct
+from typing import Any, Dict, List, Mapping
+
+from .schemas import DepthUpdate
+
+JSON_FIELD = "data"
+BINARY_FIELD = "bin"
+PAYLOAD_FORMATS = ("json", "binary")
+
+BINARY_VERSION = 1
+# version, E, U, u, bid count, ask count
+_HEADER = struct.Struct("<BqqqHH")
+
+
+def _put_string(out: bytearray, value: str) -> None:
+    data = value.encode("ascii")
+    if len(data) > 255:
+        raise ValueError(f"String too long for a binary payload: {value[:16]}...")
+    out.append(len(data))
+    out += data
+
+
+def encode_binary(message: Mapping[str, Any]) -> bytes:
+    """Pack a depth update into a binary payload
+
+    Args:
+        message: Depth update fields, as asdict(DepthUpdate)
+
+    Returns:
+        Payload bytes
+
+    Raises:
+        ValueError: If a field does not fit the format
+    """
+    bids, asks = message["b"], message["a"]
+    out = bytearray(
+        _HEADER.pack(
+            BINARY_VERSION,
+            message["E"],
+            message["U"],
+            message["u"],
+            len(bids),
+            len(asks),
+        )
+    )
+    _put_string(out, message["e"])
+    _put_string(out, message["s"])
+    for levels in (bids, asks):
+        for price, qty in levels:
+            _put_string(out, price)
+            _put_string(out, qty)
+    return bytes(out)
+
+
+def decode_binary(payload: bytes) -> DepthUpdate:
+    """Unpack a binary payload written by encode_binary()
+
+    Args:
+        payload: Payload bytes
+
+    Returns:
+        The encoded depth update
+
+    Raises:
+        ValueError: If the payload is truncated or of an unknown version
+    """
+    if len(payload) < _HEADER.size:
+        raise ValueError("Binary depth payload is truncated")
+    version, event_time, first_id, final_id, n_bids, n_asks = _HEADER.unpack_from(
+        payload
+    )
+    if version != BINARY_VERSION:
+        raise ValueError(f"Unsupported binary depth payload version {version}")
+
+    offset = _HEADER.size
+    strings: List[str] = []
+    for _ in range(2 + 2 * (n_bids + n_asks)):
+        if offset >= len(payload):
+            raise ValueError("Binary depth payload is truncated")
+        end = offset + 1 + payload[offset]
+        if end > len(payload):
+            raise ValueError("Binary depth payload is truncated")
+        strings.append(payload[offset + 1 : end].decode("ascii"))
+        offset = end
+
+    levels = [list(pair) for pair in zip(strings[2::2], strings[3::2])]
+    return DepthUpdate(
+        e=strings[0],
+        E=event_time,
+        s=strings[1],
+        U=first_id,
+        u=final_id,
+        b=levels[:n_bids],
+        a=levels[n_bids:],
+    )
+
+
+def encode_fields(message: Mapping[str, Any], payload_format: str) -> Dict[str, Any]:
+    """Build the stream entry fields for a depth update
+
+    Args:
+        message: Depth update fields, as asdict(DepthUpdate)
+        payload_format: "json" or "binary"
+
+    Returns:
+        Fields for XADD
+    """
+    if payload_format == "binary":
+        return {BINARY_FIELD: encode_binary(message)}
+    if payload_format == "json":
+        return {JSON_FIELD: json.dumps(message)}
+    raise ValueError(f"Unknown payload format: {payload_format}")
+
+
+def decode_fields(fields: Mapping[Any, Any]) -> DepthUpdate:
+    """Decode a stream entry in either format
+
+    Args:
+        fields: Entry fields as read from redis, bytes or str keys
+
+    Returns:
+        The depth update the entry carries
+
+    Raises:
+        KeyError: If the entry has neither payload field
+        ValueError: If the payload does not decode
+    """
+    for key in (BINARY_FIELD.encode(), BINARY_FIELD):
+        payload = fields.get(key)
+        if payload is not None:
+            return decode_binary(payload)
+    data = fields.get(JSON_FIELD.encode(), fields.get(JSON_FIELD))
+    if data is None:
+        raise KeyError("Stream entry has no depth payload")
+    if isinstance(data, bytes):
+        data = data.decode()
+    return DepthUpdate(**json.loads(data))
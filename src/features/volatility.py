@@ -1,10 +1,97 @@
 """
 short-term volatility feature calculation
+
+every estimator here costs O(1) per mid price update:
+1. RollingStats keeps a rolling mean/variance with welford eviction
+2. VolatilityCalculator is the rolling sample std of returns
+3. EwmaVolatility weights returns exponentially
+4. RealizedVolatility sums squared returns over several horizons at once
+
+match_engine.FeaturePipeline computes the same values natively.
 """
 
+import math
 from collections import deque
 from decimal import Decimal
-from typing import Optional
+from typing import Dict, Optional, Sequence
+
+# annualization used by VolatilityCalculator and EwmaVolatility
+ANNUALIZATION = 252**0.5
+
+
+class RollingStats:
+    """rolling mean and sample variance of the last window values
+
+    welford updates with eviction, so each push is O(1). the running sums
+    are rebuilt from the window once every window evictions so rounding
+    from repeated removals can't accumulate.
+    """
+
+    def __init__(self, window: int):
+        """
+        initialize rolling statistics
+
+        args:
+            window: number of values kept
+
+        raises:
+            ValueError: if window is less than 1
+        """
+        if window < 1:
+            raise ValueError("window must be at least 1")
+        self.window = window
+        self.values = deque(maxlen=window)
+        self.mean = 0.0
+        self._m2 = 0.0
+        self._evictions = 0
+
+    def __len__(self) -> int:
+        return len(self.values)
+
+    def push(self, value: float) -> None:
+        """
+        add a value, evicting the oldest once the window is full
+
+        args:
+            value: new sample
+        """
+        if len(self.values) == self.window:
+            self._remove(self.values[0])
+            self._evictions += 1
+        self.values.append(value)
+        delta = value - self.mean
+        self.mean += delta / len(self.values)
+        self._m2 += delta * (value - self.mean)
+        if self._evictions >= self.window:
+            self._rebuild()
+
+    def _remove(self, value: float) -> None:
+        count = len(self.values) - 1
+        if count <= 1:
+            # exact rather than a downdate that cancels to rounding noise
+            self.mean = self.values[1] if count else 0.0
+            self._m2 = 0.0
+            return
+        delta = value - self.mean
+        self.mean -= delta / count
+        self._m2 -= delta * (value - self.mean)
+
+    def _rebuild(self) -> None:
+        self.mean = math.fsum(self.values) / len(self.values)
+        self._m2 = math.fsum((v - self.mean) ** 2 for v in self.values)
+        self._evictions = 0
+
+    @property
+    def variance(self) -> float:
+        """sample variance, 0 with fewer than two values"""
+        if len(self.values) < 2:
+            return 0.0
+        return max(self._m2, 0.0) / (len(self.values) - 1)
+
+    @property
+    def std(self) -> float:
+        """sample standard deviation"""
+        return self.variance**0.5
 
 
 class VolatilityCalculator:
@@ -19,6 +106,8 @@ class VolatilityCalculator:
         """
         self.window_size = window_size
         self.prices = deque(maxlen=window_size)
+        # a window of n prices holds n - 1 returns
+        self._returns = RollingStats(max(window_size - 1, 1))
         self._last_volatility: Optional[float] = None
 
     def update(self, mid_price: Decimal) -> float:
@@ -31,27 +120,18 @@ class VolatilityCalculator:
         returns:
             current volatility estimate
         """
-        self.prices.append(float(mid_price))
+        price = float(mid_price)
+        if self.prices:
+            previous = self.prices[-1]
+            self._returns.push((price - previous) / previous)
+        self.prices.append(price)
 
-        if len(self.prices) < 2:
+        if len(self.prices) < 2 or len(self._returns) < 2:
             self._last_volatility = 0.0
             return self._last_volatility
 
-        # calculate returns
-        returns = []
-        for i in range(1, len(self.prices)):
-            ret = (self.prices[i] - self.prices[i - 1]) / self.prices[i - 1]
-            returns.append(ret)
-
-        if len(returns) < 2:
-            self._last_volatility = 0.0
-            return self._last_volatility
-
-        # calculate volatility as standard deviation of returns
-        mean_return = sum(returns) / len(returns)
-        squared_diff_sum = sum((r - mean_return) ** 2 for r in returns)
-        variance = squared_diff_sum / (len(returns) - 1)
-        self._last_volatility = (variance**0.5) * (252**0.5)  # annualized
+        # standard deviation of returns
+        self._last_volatility = self._returns.std * ANNUALIZATION  # annualized
 
         return self._last_volatility
 
@@ -59,3 +139,122 @@ class VolatilityCalculator:
     def volatility(self) -> float:
         """get current volatility estimate"""
         return self._last_volatility if self._last_volatility is not None else 0.0
+
+
+class EwmaVolatility:
+    """exponentially weighted volatility of mid price returns"""
+
+    def __init__(self, alpha: float = 0.06):
+        """
+        initialize ewma volatility
+
+        args:
+            alpha: weight of the newest squared return, in (0, 1]
+
+        raises:
+            ValueError: if alpha is outside (0, 1]
+        """
+        if not 0 < alpha <= 1:
+            raise ValueError("alpha must be in (0, 1]")
+        self.alpha = alpha
+        self._last_price: Optional[float] = None
+        self._variance: Optional[float] = None
+
+    def update(self, mid_price: Decimal) -> float:
+        """
+        update with a new mid price
+
+        args:
+            mid_price: current mid price
+
+        returns:
+            current annualized volatility, 0 before the first return
+        """
+        price = float(mid_price)
+        if self._last_price is not None:
+            ret = (price - self._last_price) / self._last_price
+            if self._variance is None:
+                self._variance = ret * ret
+            else:
+                self._variance += self.alpha * (ret * ret - self._variance)
+        self._last_price = price
+        return self.volatility
+
+    @property
+    def volatility(self) -> float:
+        """get current volatility estimate"""
+        if self._variance is None:
+            return 0.0
+        return self._variance**0.5 * ANNUALIZATION
+
+
+class RealizedVolatility:
+    """realized volatility, sqrt of summed squared returns, per horizon"""
+
+    def __init__(self, horizons: Sequence[int] = (10, 100, 1000)):
+        """
+        initialize realized volatility
+
+        args:
+            horizons: numbers of most recent returns to sum over
+
+        raises:
+            ValueError: if a horizon is less than 1
+        """
+        if not horizons or min(horizons) < 1:
+            raise ValueError("horizons must be at least 1")
+        self.horizons = tuple(sorted(set(horizons)))
+        # ring of the last max(horizons) squared returns; a list, since
+        # indexing into the middle of a deque is not O(1)
+        self._squares = [0.0] * self.horizons[-1]
+        self._head = 0
+        self._count = 0
+        self._sums = [0.0] * len(self.horizons)
+        self._pushes = 0
+        self._last_price: Optional[float] = None
+
+    def update(self, mid_price: Decimal) -> Dict[int, float]:
+        """
+        update with a new mid price
+
+        args:
+            mid_price: current mid price
+
+        returns:
+            realized volatility per horizon
+        """
+        price = float(mid_price)
+        if self._last_price is not None:
+            ret = (price - self._last_price) / self._last_price
+            square = ret * ret
+            size = len(self._squares)
+            for i, horizon in enumerate(self.horizons):
+                self._sums[i] += square
+                if self._count >= horizon:
+                    self._sums[i] -= self._squares[(self._head - horizon) % size]
+            self._squares[self._head] = square
+            self._head = (self._head + 1) % size
+            self._count = min(self._count + 1, size)
+            self._pushes += 1
+            if self._pushes >= self.horizons[-1]:
+                self._rebuild()
+        self._last_price = price
+        return self.volatility
+
+    def _rebuild(self) -> None:
+        size = len(self._squares)
+        squares = [
+            self._squares[(self._head - self._count + k) % size]
+            for k in range(self._count)
+        ]
+        for i, horizon in enumerate(self.horizons):
+            self._sums[i] = math.fsum(squares[-horizon:])
+        self._pushes = 0
+
+    @property
+    def volatility(self) -> Dict[int, float]:
+        """get current realized volatility per horizon"""
+        return {
+            horizon: max(total, 0.0) ** 0.5
+            for horizon, total in zip(self.horizons, self._sums)
+        }
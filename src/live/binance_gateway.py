@@ -14,11 +14,25 @@ logger = logging.getLogger(__name__)
 
 
 class BinanceGateway:
-    def __init__(self, api_key: str, api_secret: str, testnet: bool = True):
+    def __init__(
+        self,
+        api_key: str,
+        api_secret: str,
+        testnet: bool = True,
+        max_connections: int = 8,
+        keepalive_timeout: float = 60.0,
+        request_timeout: float = 10.0,
+    ):
         self.api_key = api_key
         self.api_secret = api_secret
         self.testnet = testnet
 
+        # concurrent order requests each need a connection; keeping them
+        # alive between ticks saves the tcp and tls handshakes
+        self.max_connections = max_connections
+        self.keepalive_timeout = keepalive_timeout
+        self.request_timeout = request_timeout
+
         if testnet:
             self.base_url = "https://testnet.binance.vision"
         else:
@@ -27,7 +41,15 @@ class BinanceGateway:
         self.session: Optional[aiohttp.ClientSession] = None
 
     async def __aenter__(self):
-        self.session = aiohttp.ClientSession()
+        connector = aiohttp.TCPConnector(
+            limit_per_host=self.max_connections,
+            keepalive_timeout=self.keepalive_timeout,
+            ttl_dns_cache=300,
+        )
+        self.session = aiohttp.ClientSession(
+            connector=connector,
+            timeout=aiohttp.ClientTimeout(total=self.request_timeout),
+        )
         return self
 
     async def __aexit__(self, exc_type, exc_val, exc_tb):
@@ -155,6 +177,45 @@ class BinanceGateway:
             logger.error(f"Failed to cancel order: {e}")
             raise
 
+    async def cancel_replace_order(
+        self,
+        symbol: str,
+        side: str,
+        cancel_order_id: int,
+        order_type: str,
+        quantity: Decimal,
+        price: Optional[Decimal] = None,
+        time_in_force: str = "GTC",
+        cancel_replace_mode: str = "STOP_ON_FAILURE",
+    ) -> Dict[str, Any]:
+        """cancel a resting order and place its replacement in one request
+
+        with STOP_ON_FAILURE the new order is only placed if the cancel
+        succeeds, so a filled order is never replaced by a second one
+        """
+        params = {
+            "symbol": symbol.upper(),
+            "side": side.upper(),
+            "type": order_type.upper(),
+            "cancelReplaceMode": cancel_replace_mode,
+            "cancelOrderId": cancel_order_id,
+            "quantity": str(quantity),
+            "timeInForce": time_in_force,
+        }
+
+        if price is not None:
+            params["price"] = str(price)
+
+        logger.info(f"Replacing order: {params}")
+
+        try:
+            result = await self._request("POST", "/api/v3/order/cancelReplace", params)
+            logger.info(f"Order replaced successfully: {result}")
+            return result
+        except Exception as e:
+            logger.error(f"Failed to replace order: {e}")
+            raise
+
     async def get_open_orders(self, symbol: Optional[str] = None) -> list:
         params = {}
         if symbol:
@@ -0,0 +1,135 @@
+"""binance websocket api gateway for order management
+
+same interface as BinanceGateway, but signed requests go over one
+persistent websocket to binance's websocket api instead of one http
+request each. requests are tagged with an id so any number can be in
+flight at once; responses are matched back to their callers as they come.
+"""
+
+import asyncio
+import itertools
+import json
+import logging
+from typing import Any, Dict, Optional
+
+import websockets.client
+from websockets.exceptions import ConnectionClosed
+
+from live.binance_gateway import BinanceGateway
+
+logger = logging.getLogger(__name__)
+
+WS_API_URLS = {
+    True: "wss://ws-api.testnet.binance.vision/ws-api/v3",
+    False: "wss://ws-api.binance.com:443/ws-api/v3",
+}
+
+# rest (method, endpoint) -> websocket api method
+WS_API_METHODS = {
+    ("POST", "/api/v3/order"): "order.place",
+    ("DELETE", "/api/v3/order"): "order.cancel",
+    ("POST", "/api/v3/order/cancelReplace"): "order.cancelReplace",
+    ("GET", "/api/v3/order"): "order.status",
+    ("GET", "/api/v3/openOrders"): "openOrders.status",
+    ("GET", "/api/v3/myTrades"): "myTrades",
+}
+
+
+class BinanceWsApiGateway(BinanceGateway):
+    def __init__(self, api_key: str, api_secret: str, testnet: bool = True, **kwargs):
+        super().__init__(api_key, api_secret, testnet, **kwargs)
+        self.ws_url = WS_API_URLS[testnet]
+        self.websocket = None
+        self._reader: Optional[asyncio.Task] = None
+        self._pending: Dict[str, asyncio.Future] = {}
+        self._request_ids = itertools.count(1)
+
+    async def __aenter__(self):
+        # the rest session stays open for anything without a websocket method
+        await super().__aenter__()
+        try:
+            self.websocket = await websockets.client.connect(self.ws_url)
+        except Exception:
+            await super().__aexit__(None, None, None)
+            raise
+        self._reader = asyncio.create_task(self._read_responses())
+        return self
+
+    async def __aexit__(self, exc_type, exc_val, exc_tb):
+        if self._reader:
+            self._reader.cancel()
+            try:
+                await self._reader
+            except asyncio.CancelledError:
+                pass
+            self._reader = None
+        if self.websocket:
+            await self.websocket.close()
+            self.websocket = None
+        self._fail_pending(ConnectionError("Order websocket closed"))
+        await super().__aexit__(exc_type, exc_val, exc_tb)
+
+    def _sign_params(self, params: Dict[str, Any]) -> Dict[str, Any]:
+        """add apiKey, timestamp and signature the way the websocket api wants
+
+        the signature covers every parameter sorted by name, rather than
+        the query string in request order as it does over rest
+        """
+        signed = dict(params)
+        signed["apiKey"] = self.api_key
+        signed["timestamp"] = self._get_timestamp()
+        payload = "&".join(f"{key}={signed[key]}" for key in sorted(signed))
+        signed["signature"] = self._generate_signature(payload)
+        return signed
+
+    async def _request(
+        self, method: str, endpoint: str, params: Dict[str, Any]
+    ) -> Dict[str, Any]:
+        ws_method = WS_API_METHODS.get((method, endpoint))
+        if ws_method is None:
+            return await super()._request(method, endpoint, params)
+        if not self.websocket:
+            raise RuntimeError("Gateway not initialized. Use async context manager.")
+
+        request_id = str(next(self._request_ids))
+        future = asyncio.get_running_loop().create_future()
+        self._pending[request_id] = future
+        try:
+            await self.websocket.send(
+                json.dumps(
+                    {
+                        "id": request_id,
+                        "method": ws_method,
+                        "params": self._sign_params(params),
+                    }
+                )
+            )
+            return await asyncio.wait_for(future, self.request_timeout)
+        finally:
+            self._pending.pop(request_id, None)
+
+    async def _read_responses(self) -> None:
+        try:
+            async for raw in self.websocket:
+                self._handle_response(json.loads(raw))
+        except ConnectionClosed as e:
+            logger.warning(f"Order websocket closed: {e}")
+        finally:
+            self._fail_pending(ConnectionError("Order websocket closed"))
+
+    def _handle_response(self, response: Dict[str, Any]) -> None:
+        future = self._pending.get(response.get("id"))
+        if future is None or future.done():
+            return
+        if response.get("status") == 200:
+            future.set_result(response["result"])
+        else:
+            logger.error(f"API error: {response.get('error')}")
+            future.set_exception(
+                Exception(f"Binance API error: {response.get('error')}")
+            )
+
+    def _fail_pending(self, error: Exception) -> None:
+        for future in self._pending.values():
+            if not future.done():
+                future.set_exception(error)
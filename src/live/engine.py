@@ -1,20 +1,22 @@
 """live trading engine for market making"""
 
 import asyncio
-import json
+import heapq
 import logging
 import time
 from decimal import Decimal
-from typing import Dict, Optional
+from typing import Dict, List, Optional, Tuple
 
 import redis.asyncio as redis
 
 from data_feed.schemas import DepthUpdate
+from data_feed.stream_codec import decode_fields
 from features.volatility import VolatilityCalculator
 from live.binance_gateway import BinanceGateway
 from live.healthcheck import HealthcheckMetrics, HealthcheckServer
+from live.order_manager import OrderManager, RestingOrder  # noqa: F401
 from models.size_calculator import SizeConfig
-from strategy.ev_maker import EVConfig, EVMaker
+from strategy.ev_maker import EVConfig, EVMaker, NativeEVMaker
 
 logging.basicConfig(
     level=logging.INFO, format="%(asctime)s - %(name)s - %(levelname)s - %(message)s"
@@ -30,6 +32,14 @@ class LiveEngine:
         api_key: Optional[str] = None,
         api_secret: Optional[str] = None,
         testnet: bool = True,
+        native_quotes: bool = False,
+        shm_ring: Optional[str] = None,
+        order_api: str = "rest",
+        cancel_replace: bool = True,
+        price_tolerance: Decimal = Decimal("0"),
+        size_tolerance: Decimal = Decimal("0"),
+        book_snapshot: bool = False,
+        snapshot_interval: float = 30.0,
     ):
         self.redis_url = redis_url
         self.redis_client = redis.from_url(redis_url)
@@ -41,25 +51,63 @@ class LiveEngine:
         self.running = False
         self.current_inventory = Decimal("0")
 
-        self.current_bid_order_id = None
-        self.current_ask_order_id = None
         self.last_trade_id = None
 
         self.api_key = api_key
         self.api_secret = api_secret
         self.testnet = testnet
 
+        # "rest" or "ws", the websocket api keeps one connection for all
+        # order requests. see OrderManager for the tolerances and
+        # cancel_replace
+        if order_api not in ("rest", "ws"):
+            raise ValueError(f"unknown order api: {order_api}")
+        self.order_api = order_api
+        self.orders = OrderManager(
+            self.symbol, cancel_replace, price_tolerance, size_tolerance
+        )
+        self.resting_orders = self.orders.resting_orders
+
         self.gateway = None
 
         self.volatility_calc = VolatilityCalculator(window_size=20)
 
         ev_config = EVConfig()
         size_config = SizeConfig()
-        self.ev_maker = EVMaker(ev_config, size_config)
+        # the native quote engine skips the python reference's Decimal math
+        maker = NativeEVMaker if native_quotes else EVMaker
+        self.ev_maker = maker(ev_config, size_config)
 
         self.metrics = HealthcheckMetrics(redis_url=redis_url)
         self.metrics_server = None
 
+        # depth from a same-host recorder's shared memory ring instead of
+        # redis, attached in start() once the recorder has created it
+        self.shm_ring = shm_ring
+        self.depth_ring = None
+        self.ring_poll_interval = 0.0001
+
+        # l2 book rebuilt from the diff stream, price -> [price, qty] as
+        # received. every queued diff past last_update_id is applied but
+        # quoting only runs on the state after the last one, so a burst
+        # costs one quote
+        self.book_bids: Dict[Decimal, List[str]] = {}
+        self.book_asks: Dict[Decimal, List[str]] = {}
+        self.quote_depth = 20
+        self.max_batch = 1000
+        self.last_stream_id = "$"
+        self.last_update_id = 0
+
+        # warm start: the book is checkpointed into redis every
+        # snapshot_interval seconds and on stop, as a native engine snapshot
+        # with the stream id it has read up to. start() reloads it and
+        # resumes the stream there instead of rebuilding the book from
+        # whatever diffs arrive next
+        self.book_snapshot = book_snapshot
+        self.snapshot_key = f"book_snapshot:{self.symbol}"
+        self.snapshot_interval = snapshot_interval
+        self._last_snapshot = 0.0
+
     async def start(self) -> None:
         """start the live engine"""
         logger.info("starting live engine")
@@ -69,7 +117,13 @@ class LiveEngine:
         self.metrics._owns_redis_connection = False
 
         if self.api_key and self.api_secret:
-            self.gateway = BinanceGateway(self.api_key, self.api_secret, self.testnet)
+            if self.order_api == "ws":
+                from live.binance_ws_api import BinanceWsApiGateway
+
+                gateway = BinanceWsApiGateway
+            else:
+                gateway = BinanceGateway
+            self.gateway = gateway(self.api_key, self.api_secret, self.testnet)
             logger.info("binance gateway initialized")
         else:
             logger.warning(
@@ -77,6 +131,8 @@ class LiveEngine:
             )
 
         await self._initialize_redis_state()
+        if self.book_snapshot and self.shm_ring is None:
+            await self._load_book_snapshot()
 
         self.metrics_server = HealthcheckServer(self.metrics, port=8000)
         await self.metrics_server.start()
@@ -97,26 +153,96 @@ class LiveEngine:
 
     async def _run_loop(self) -> None:
         """main engine loop"""
+        if self.shm_ring is not None:
+            await self._run_ring_loop()
+            return
+
         while self.running:
+            read_start = time.perf_counter_ns()
+            entries = await self._drain_stream()
+            if not entries:
+                continue
+            # only reads that returned entries, an idle wait isn't latency
+            read_ns = time.perf_counter_ns() - read_start
+            self.metrics.record_stage("stream_read", read_ns)
+
+            loop_start_time = time.time()
+            updates = []
+            with self.metrics.time_stage("decode"):
+                for fields in entries:
+                    depth_update = self._decode_message(fields)
+                    if depth_update is not None:
+                        updates.append(depth_update)
+            await self._process_batch(updates, loop_start_time)
+            if (
+                self.book_snapshot
+                and time.monotonic() - self._last_snapshot >= self.snapshot_interval
+            ):
+                await self._save_book_snapshot()
+
+    async def _drain_stream(self) -> List[Dict]:
+        """read every entry queued on the stream since the last one seen
+
+        blocks briefly for the first entry, then keeps reading without
+        blocking until a short read shows the stream is drained
+        """
+        entries = []
+        block = 100
+        while True:
             messages = await self.redis_client.xread(
-                {self.stream_key: "$"},
-                count=1,
-                block=100,
+                {self.stream_key: self.last_stream_id},
+                count=self.max_batch,
+                block=block,
             )
-
             if not messages:
-                continue
+                return entries
 
             stream_name, stream_messages = messages[0]
-
-            for message_id, fields in stream_messages:
-                await self._process_message(fields)
+            if not stream_messages:
+                return entries
+            self.last_stream_id = stream_messages[-1][0]
+            entries.extend(fields for message_id, fields in stream_messages)
+            if len(stream_messages) < self.max_batch:
+                return entries
+            block = None
+
+    async def _run_ring_loop(self) -> None:
+        """engine loop over the shared memory ring, polling without redis"""
+        from data_feed.shm_ring import DepthRingReader
+
+        self.depth_ring = DepthRingReader(self.shm_ring)
+        logger.info(f"reading depth from shared memory ring {self.shm_ring}")
+        dropped = 0
+        while self.running:
+            read_start = time.perf_counter_ns()
+            updates = []
+            while len(updates) < self.max_batch:
+                depth_update = self.depth_ring.read_update(self.symbol)
+                if depth_update is None:
+                    break
+                updates.append(depth_update)
+            if not updates:
+                await asyncio.sleep(self.ring_poll_interval)
+                continue
+            read_ns = time.perf_counter_ns() - read_start
+            self.metrics.record_stage("stream_read", read_ns)
+            if self.depth_ring.dropped != dropped:
+                logger.warning(
+                    f"depth ring overran, skipped "
+                    f"{self.depth_ring.dropped - dropped} updates"
+                )
+                dropped = self.depth_ring.dropped
+            await self._process_batch(updates)
 
     async def stop(self) -> None:
         """stop the live engine"""
         logger.info("stopping live engine")
         self.running = False
 
+        if self.depth_ring:
+            self.depth_ring.close()
+            self.depth_ring = None
+
         if self.metrics_server:
             await self.metrics_server.stop()
 
@@ -124,6 +250,8 @@ class LiveEngine:
             self.metrics.redis_client = None
 
         if self.redis_client:
+            if self.book_snapshot and self.shm_ring is None:
+                await self._save_book_snapshot()
             await self.redis_client.aclose()
 
     async def _initialize_redis_state(self) -> None:
@@ -146,37 +274,213 @@ class LiveEngine:
         except Exception as e:
             logger.error(f"error initializing redis state: {e}")
 
+    async def _save_book_snapshot(self) -> None:
+        """checkpoint the l2 book and the stream id it has read up to"""
+        self._last_snapshot = time.monotonic()
+        if self.last_stream_id == "$":
+            return
+        from match_engine import MatchEngine, Side
+
+        try:
+            engine = MatchEngine()
+            engine.reset_market(self.last_update_id)
+            books = ((Side.BUY, self.book_bids), (Side.SELL, self.book_asks))
+            for side, book in books:
+                for price, level in book.items():
+                    engine.apply_l2_delta(side, float(price), float(level[1]))
+            await self.redis_client.hset(
+                self.snapshot_key,
+                mapping={
+                    "engine": engine.snapshot(),
+                    "stream_id": self.last_stream_id,
+                },
+            )
+        except Exception as e:
+            logger.error(f"error saving book snapshot: {e}")
+
+    async def _load_book_snapshot(self) -> None:
+        """reload the book checkpointed by _save_book_snapshot, if any
+
+        the stream is then read from the checkpoint's id on, so the diffs
+        that arrived while the engine was down are applied in order
+        """
+        from match_engine import MatchEngine
+
+        try:
+            snapshot = await self.redis_client.hgetall(self.snapshot_key)
+            if not snapshot:
+                return
+            engine = MatchEngine()
+            engine.restore(snapshot[b"engine"])
+            bids, asks = engine.market_snapshot()
+            self.book_bids = self._book_levels(bids)
+            self.book_asks = self._book_levels(asks)
+            self.last_update_id = engine.last_update_id
+            self.last_stream_id = snapshot[b"stream_id"].decode()
+            logger.info(
+                f"restored book snapshot at stream id {self.last_stream_id}: "
+                f"{len(self.book_bids)} bids, {len(self.book_asks)} asks"
+            )
+        except Exception as e:
+            logger.error(f"error loading book snapshot: {e}")
+
+    @staticmethod
+    def _book_levels(levels: List[Tuple[float, float]]) -> Dict[Decimal, List[str]]:
+        """engine (price, qty) floats back to book entries as strings"""
+        book = {}
+        for price, qty in levels:
+            # repr is the shortest string that reads back as the same float
+            price_dec, qty_dec = Decimal(repr(price)), Decimal(repr(qty))
+            book[price_dec] = [str(price_dec), str(qty_dec)]
+        return book
+
+    def _decode_message(self, fields: Dict) -> Optional[DepthUpdate]:
+        # json or binary, whichever field the recorder wrote
+        try:
+            return decode_fields(fields)
+        except Exception as e:
+            logger.error(f"error processing message: {e}")
+            return None
+
     async def _process_message(self, fields: Dict) -> None:
         loop_start_time = time.time()
+        start_ns = time.perf_counter_ns()
+
+        with self.metrics.time_stage("decode"):
+            depth_update = self._decode_message(fields)
+        if depth_update is None:
+            self._record_loop(start_ns)
+            return
+        await self._process_depth_update(depth_update, loop_start_time)
+
+    async def _process_depth_update(
+        self, depth_update: DepthUpdate, loop_start_time: Optional[float] = None
+    ) -> None:
+        await self._process_batch([depth_update], loop_start_time)
+
+    def _check_sequence(self, depth_update: DepthUpdate) -> bool:
+        """check a diff's update ids against the last applied one
+
+        binance diff rules, as in the native DepthBook: a diff whose ids
+        are all applied already is stale and skipped. one that starts past
+        the next id is a gap. the diff stream has no snapshot to resync
+        from, so a gap is counted, logged and applied, as the shard runtime
+        does. a last_update_id of 0 accepts whatever diff comes next
+
+        args:
+            depth_update: diff about to be applied
+
+        returns:
+            False if the diff is stale and must not be applied
+        """
+        if self.last_update_id:
+            if depth_update.u <= self.last_update_id:
+                self.metrics.record_depth_stale()
+                return False
+            if depth_update.U > self.last_update_id + 1:
+                self.metrics.record_depth_gap()
+                logger.warning(
+                    f"depth sequence gap: expected {self.last_update_id + 1}, "
+                    f"got {depth_update.U}"
+                )
+        self.last_update_id = depth_update.u
+        return True
+
+    def _apply_depth_update(self, depth_update: DepthUpdate) -> None:
+        """apply one diff to the local book, a zero quantity removes the level"""
+        for book, levels in (
+            (self.book_bids, depth_update.b),
+            (self.book_asks, depth_update.a),
+        ):
+            for level in levels:
+                price = Decimal(level[0])
+                if Decimal(level[1]) == 0:
+                    book.pop(price, None)
+                else:
+                    book[price] = level
+
+    async def _process_batch(
+        self, updates: List[DepthUpdate], loop_start_time: Optional[float] = None
+    ) -> None:
+        """apply a drained batch of diffs in order, then quote once
+
+        args:
+            updates: depth updates in stream order
+            loop_start_time: when the batch was read, defaults to now
+        """
+        start_ns = time.perf_counter_ns()
+        if loop_start_time is None:
+            loop_start_time = time.time()
+        if not updates:
+            return
 
         try:
-            message_data = json.loads(fields[b"data"].decode())
-            depth_update = DepthUpdate(**message_data)
+            applied = 0
+            with self.metrics.time_stage("book"):
+                for depth_update in updates:
+                    if self._check_sequence(depth_update):
+                        self._apply_depth_update(depth_update)
+                        applied += 1
+            if not applied:
+                # nothing new, the book and so the quote are as they were
+                self._record_loop(start_ns)
+                return
+            # event times are exchange milliseconds
+            queue_lag = max(loop_start_time - updates[0].E / 1000.0, 0.0)
+            self.metrics.record_depth_batch(applied, queue_lag)
+        except Exception as e:
+            logger.error(f"error processing message: {e}")
+            self._record_loop(start_ns)
+            return
+
+        await self._quote(start_ns, updates[-1].E)
 
-            bids = depth_update.b
-            asks = depth_update.a
+    def _record_loop(self, start_ns: int) -> None:
+        self.metrics.record_engine_loop((time.perf_counter_ns() - start_ns) / 1e9)
 
-            if not bids or not asks:
+    async def _quote(self, start_ns: int, event_time: int) -> None:
+        """quote on the current book and work the orders
+
+        args:
+            start_ns: perf_counter_ns when the loop started
+            event_time: exchange event time of the newest update applied
+        """
+        try:
+            if not self.book_bids or not self.book_asks:
                 return
 
+            features_start = time.perf_counter_ns()
+            bids = [
+                self.book_bids[price]
+                for price in heapq.nlargest(self.quote_depth, self.book_bids)
+            ]
+            asks = [
+                self.book_asks[price]
+                for price in heapq.nsmallest(self.quote_depth, self.book_asks)
+            ]
+
             best_bid = Decimal(bids[0][0])
             best_ask = Decimal(asks[0][0])
             mid_price = (best_bid + best_ask) / Decimal("2")
 
             volatility = self.volatility_calc.update(mid_price)
-
-            bid_quote, ask_quote = self.ev_maker.quote_prices(
-                mid_price=mid_price,
-                volatility=Decimal(str(volatility)),
-                bid_probability=Decimal("0.5"),
-                ask_probability=Decimal("0.5"),
-                inventory=self.current_inventory,
-                best_bid=best_bid,
-                best_ask=best_ask,
-                bids=bids,
-                asks=asks,
+            self.metrics.record_stage(
+                "features", time.perf_counter_ns() - features_start
             )
 
+            with self.metrics.time_stage("quote"):
+                bid_quote, ask_quote = self.ev_maker.quote_prices(
+                    mid_price=mid_price,
+                    volatility=Decimal(str(volatility)),
+                    bid_probability=Decimal("0.5"),
+                    ask_probability=Decimal("0.5"),
+                    inventory=self.current_inventory,
+                    best_bid=best_bid,
+                    best_ask=best_ask,
+                    bids=bids,
+                    asks=asks,
+                )
+
             print(
                 f"quote: bid={bid_quote.price}@{bid_quote.size} "
                 f"ask={ask_quote.price}@{ask_quote.size} "
@@ -184,86 +488,38 @@ class LiveEngine:
             )
 
             if self.gateway:
-                await self._manage_orders(bid_quote, ask_quote)
-                await self._check_for_fills()
+                with self.metrics.time_stage("orders"):
+                    await self._manage_orders(bid_quote, ask_quote)
+                self.metrics.record_event_to_quote(event_time)
+                with self.metrics.time_stage("fills"):
+                    await self._check_for_fills()
+            else:
+                self.metrics.record_event_to_quote(event_time)
 
-            loop_duration = time.time() - loop_start_time
-            self.metrics.record_engine_loop(loop_duration)
+            self._record_loop(start_ns)
 
         except Exception as e:
             logger.error(f"error processing message: {e}")
-            loop_duration = time.time() - loop_start_time
-            self.metrics.record_engine_loop(loop_duration)
+            self._record_loop(start_ns)
 
-    async def _manage_orders(self, bid_quote, ask_quote) -> None:
-        try:
-            await self._cancel_existing_orders()
+    @property
+    def current_bid_order_id(self) -> Optional[str]:
+        return self.orders.order_id("BUY")
 
-            symbol = self.symbol.upper()
+    @property
+    def current_ask_order_id(self) -> Optional[str]:
+        return self.orders.order_id("SELL")
 
-            try:
-                bid_result = await self.gateway.post_order(
-                    symbol=symbol,
-                    side="BUY",
-                    order_type="LIMIT",
-                    quantity=bid_quote.size,
-                    price=bid_quote.price,
-                    time_in_force="GTC",
-                )
-                self.current_bid_order_id = str(bid_result.get("orderId"))
-                logger.info(f"placed bid order: {bid_result}")
-            except Exception as e:
-                logger.error(f"failed to place bid order: {e}")
-
-            try:
-                ask_result = await self.gateway.post_order(
-                    symbol=symbol,
-                    side="SELL",
-                    order_type="LIMIT",
-                    quantity=ask_quote.size,
-                    price=ask_quote.price,
-                    time_in_force="GTC",
-                )
-                self.current_ask_order_id = str(ask_result.get("orderId"))
-                logger.info(f"placed ask order: {ask_result}")
-            except Exception as e:
-                logger.error(f"failed to place ask order: {e}")
-
-            bid_count = 1 if self.current_bid_order_id else 0
-            ask_count = 1 if self.current_ask_order_id else 0
-            await self.metrics.update_outstanding_orders(bid_count, ask_count)
-
-        except Exception as e:
-            logger.error(f"error managing orders: {e}")
-
-    async def _cancel_existing_orders(self) -> None:
+    async def _manage_orders(self, bid_quote, ask_quote) -> None:
+        """requote both sides at once; each side's own requests stay in order"""
         try:
-            symbol = self.symbol.upper()
-
-            if self.current_bid_order_id:
-                try:
-                    await self.gateway.cancel_order(
-                        symbol, order_id=int(self.current_bid_order_id)
-                    )
-                    logger.info(f"canceled bid order: {self.current_bid_order_id}")
-                except Exception as e:
-                    logger.warning(f"failed to cancel bid order: {e}")
-                finally:
-                    self.current_bid_order_id = None
-
-            if self.current_ask_order_id:
-                try:
-                    await self.gateway.cancel_order(
-                        symbol, order_id=int(self.current_ask_order_id)
-                    )
-                    logger.info(f"canceled ask order: {self.current_ask_order_id}")
-                except Exception as e:
-                    logger.warning(f"failed to cancel ask order: {e}")
-                finally:
-                    self.current_ask_order_id = None
+            await self.orders.requote(self.gateway, bid_quote, ask_quote)
+            await self.metrics.update_outstanding_orders(
+                self.orders.count("BUY"), self.orders.count("SELL")
+            )
 
         except Exception as e:
-            logger.error(f"error canceling orders: {e}")
+            logger.error(f"error managing orders: {e}")
 
     async def _check_for_fills(self) -> None:
         try:
@@ -329,15 +585,18 @@ class LiveEngine:
         is_buyer: bool,
     ) -> None:
         try:
-            position = float(self.current_inventory)
-            await self.redis_client.set(self.position_key, str(position))
-
-            current_pnl_str = await self.redis_client.get(self.pnl_key)
-            current_pnl = (
-                Decimal(current_pnl_str.decode()) if current_pnl_str else Decimal("0")
-            )
-            new_pnl = current_pnl + pnl_change
-            await self.redis_client.set(self.pnl_key, str(new_pnl))
+            with self.metrics.time_stage("redis"):
+                position = float(self.current_inventory)
+                await self.redis_client.set(self.position_key, str(position))
+
+                current_pnl_str = await self.redis_client.get(self.pnl_key)
+                current_pnl = (
+                    Decimal(current_pnl_str.decode())
+                    if current_pnl_str
+                    else Decimal("0")
+                )
+                new_pnl = current_pnl + pnl_change
+                await self.redis_client.set(self.pnl_key, str(new_pnl))
 
             logger.info(f"updated redis: position={position}, pnl={new_pnl}")
 
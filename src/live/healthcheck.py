@@ -1,6 +1,8 @@
 """prometheus metrics endpoint for live trading system"""
 
 import asyncio
+import time
+from contextlib import contextmanager
 from decimal import Decimal
 
 import redis.asyncio as redis
@@ -12,6 +14,134 @@ from prometheus_client import (
     Histogram,
     generate_latest,
 )
+from prometheus_client.core import (
+    CounterMetricFamily,
+    GaugeMetricFamily,
+    HistogramMetricFamily,
+)
+
+# engine stages take microseconds, the default buckets start at 5ms
+STAGE_BUCKETS = (
+    0.00001,
+    0.000025,
+    0.00005,
+    0.0001,
+    0.00025,
+    0.0005,
+    0.001,
+    0.0025,
+    0.005,
+    0.01,
+    0.025,
+    0.05,
+    0.1,
+    0.25,
+    0.5,
+    1.0,
+)
+
+# exchange event to quote sent includes the network both ways
+EVENT_TO_QUOTE_BUCKETS = (
+    0.001,
+    0.0025,
+    0.005,
+    0.01,
+    0.025,
+    0.05,
+    0.1,
+    0.25,
+    0.5,
+    1.0,
+    2.5,
+    5.0,
+)
+
+
+def _cumulative_buckets(bounds, counts):
+    """native per-bucket counts, +inf last, as prometheus le buckets"""
+    buckets = []
+    cumulative = 0
+    for bound, count in zip(bounds, counts):
+        cumulative += count
+        buckets.append((str(bound), cumulative))
+    buckets.append(("+Inf", cumulative + counts[-1]))
+    return buckets
+
+
+class NativeLatencyCollector:
+    """exports a match_engine engine's native insert/cancel timers
+
+    the engine keeps its own fixed buckets, so they are read on each scrape
+    rather than observed one by one through a Histogram
+    """
+
+    def __init__(self, engine):
+        self.engine = engine
+
+    def collect(self):
+        family = HistogramMetricFamily(
+            "native_match_latency_seconds",
+            "Time spent inside the native matching engine per call",
+            labels=["op"],
+        )
+        for op, (bounds, counts, total) in sorted(self.engine.latency_stats().items()):
+            family.add_metric([op], _cumulative_buckets(bounds, counts), total)
+        yield family
+
+
+# ShardRuntime.stats() counters, exported as <name>_total
+SHARD_COUNTERS = {
+    "messages": "Depth updates read from the shard's ring",
+    "dropped": "Depth updates overwritten in the ring before the shard read them",
+    "stale": "Depth updates older than the shard's book",
+    "gaps": "Depth update sequence gaps",
+    "quotes": "Changed quotes the shard queued",
+    "queue_full": "Quotes the outbound queue had no room for",
+    "errors": "Depth updates the shard could not apply",
+}
+
+SHARD_GAUGES = {
+    "mid": "Mid price of the shard's book",
+    "spread": "Spread of the shard's book",
+    "volatility": "Mid price volatility of the shard's book",
+    "inventory": "Inventory the shard quotes with, in lots",
+}
+
+
+class ShardRuntimeCollector:
+    """exports every symbol of a match_engine.ShardRuntime on one endpoint
+
+    stats are copied out of each shard on scrape, labelled by symbol
+    """
+
+    def __init__(self, runtime):
+        self.runtime = runtime
+
+    def collect(self):
+        counters = {
+            name: CounterMetricFamily(f"shard_{name}", description, labels=["symbol"])
+            for name, description in SHARD_COUNTERS.items()
+        }
+        gauges = {
+            name: GaugeMetricFamily(f"shard_{name}", description, labels=["symbol"])
+            for name, description in SHARD_GAUGES.items()
+        }
+        latency = HistogramMetricFamily(
+            "shard_quote_latency_seconds",
+            "Time from a shard's ring read to its quote being queued",
+            labels=["symbol"],
+        )
+        for index, symbol in enumerate(self.runtime.symbols):
+            stats = self.runtime.stats(index)
+            for name, family in counters.items():
+                family.add_metric([symbol], stats[name])
+            for name, family in gauges.items():
+                family.add_metric([symbol], stats[name])
+            bounds, counts, total = self.runtime.latency_stats(index)
+            latency.add_metric([symbol], _cumulative_buckets(bounds, counts), total)
+        yield from counters.values()
+        yield from gauges.values()
+        yield latency
 
 
 class HealthcheckMetrics:
@@ -28,6 +158,23 @@ class HealthcheckMetrics:
         self.engine_loop_latency = Histogram(
             "engine_loop_latency_seconds",
             "Time spent processing each engine loop",
+            buckets=STAGE_BUCKETS,
+            registry=self.registry,
+        )
+
+        self.stage_latency = Histogram(
+            "engine_stage_latency_seconds",
+            "Time spent in each stage of the engine pipeline",
+            ["stage"],
+            buckets=STAGE_BUCKETS,
+            registry=self.registry,
+        )
+
+        self.event_to_quote_latency = Histogram(
+            "event_to_quote_latency_seconds",
+            "Time from the exchange event a quote was computed on to the quote "
+            "being sent",
+            buckets=EVENT_TO_QUOTE_BUCKETS,
             registry=self.registry,
         )
 
@@ -61,6 +208,43 @@ class HealthcheckMetrics:
             registry=self.registry,
         )
 
+        self.depth_updates_total = Counter(
+            "depth_updates_total",
+            "Total number of depth updates applied to the book",
+            registry=self.registry,
+        )
+
+        self.depth_stale_total = Counter(
+            "depth_stale_updates_total",
+            "Depth updates skipped as already applied to the book",
+            registry=self.registry,
+        )
+
+        self.depth_gaps_total = Counter(
+            "depth_sequence_gaps_total",
+            "Depth updates that skipped past the next update id",
+            registry=self.registry,
+        )
+
+        self.depth_conflation_ratio = Gauge(
+            "depth_conflation_ratio",
+            "Depth updates applied per quote in the last drained batch",
+            registry=self.registry,
+        )
+
+        self.depth_queue_lag = Histogram(
+            "depth_queue_lag_seconds",
+            "Age of the oldest depth update in a batch when it is applied",
+            buckets=(0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5),
+            registry=self.registry,
+        )
+
+        self.depth_queue_lag_current = Gauge(
+            "depth_queue_lag_current_seconds",
+            "Age of the oldest depth update in the last drained batch",
+            registry=self.registry,
+        )
+
     async def update_outstanding_orders(
         self, bid_orders: int = 0, ask_orders: int = 0
     ) -> None:
@@ -92,6 +276,70 @@ class HealthcheckMetrics:
         self.engine_loop_latency.observe(duration)
         self.engine_loops_total.inc()
 
+    def record_stage(self, stage: str, duration_ns: int) -> None:
+        self.stage_latency.labels(stage=stage).observe(duration_ns / 1e9)
+
+    @contextmanager
+    def time_stage(self, stage: str):
+        """time the enclosed block into the stage histogram
+
+        args:
+            stage: stage label, e.g. decode, book, quote or orders
+        """
+        start = time.perf_counter_ns()
+        try:
+            yield
+        finally:
+            self.record_stage(stage, time.perf_counter_ns() - start)
+
+    def record_event_to_quote(self, event_time_ms: int) -> None:
+        """record the age of a quote's exchange event as the quote goes out
+
+        args:
+            event_time_ms: exchange event time of the newest update quoted on
+        """
+        self.event_to_quote_latency.observe(
+            max(time.time() - event_time_ms / 1000.0, 0.0)
+        )
+
+    def register_native_latency(self, engine) -> None:
+        """export a match_engine engine's insert/cancel timers
+
+        turns the engine's native timing on; the histogram is read from it
+        on every scrape
+
+        args:
+            engine: MatchEngine, MapMatchEngine or LadderMatchEngine
+        """
+        engine.timing = True
+        self.registry.register(NativeLatencyCollector(engine))
+
+    def register_shard_runtime(self, runtime) -> None:
+        """export a match_engine.ShardRuntime's per-symbol stats
+
+        args:
+            runtime: ShardRuntime, read on every scrape
+        """
+        self.registry.register(ShardRuntimeCollector(runtime))
+
+    def record_depth_batch(self, updates: int, queue_lag: float) -> None:
+        """record one drained batch of depth updates that was quoted once
+
+        args:
+            updates: depth updates applied before the quote
+            queue_lag: seconds between the oldest update's event time and now
+        """
+        self.depth_updates_total.inc(updates)
+        self.depth_conflation_ratio.set(updates)
+        self.depth_queue_lag.observe(queue_lag)
+        self.depth_queue_lag_current.set(queue_lag)
+
+    def record_depth_stale(self) -> None:
+        self.depth_stale_total.inc()
+
+    def record_depth_gap(self) -> None:
+        self.depth_gaps_total.inc()
+
     def record_fill(self, side: str) -> None:
         self.fills_total.labels(side=side).inc()
 
@@ -0,0 +1,349 @@
+"""
+multi-symbol live engine over the native shard runtime
+
+this module provides:
+1. one match_engine.ShardRuntime holding every symbol's book, features and
+   quote engine, sharded over worker threads pinned to cores
+2. depth in through one shared memory ring per symbol: the recorders'
+   rings, or rings this process fills from one redis XREAD over every
+   symbol's stream
+3. quotes out through the runtime's lock-free queue, conflated to the
+   latest per symbol and worked by one OrderManager per symbol
+4. one metrics endpoint covering every symbol
+
+running N symbols costs one process, one redis connection and one
+metrics port instead of N LiveEngines, and quoting scales with workers.
+"""
+
+import asyncio
+import json
+import logging
+import os
+from decimal import Decimal
+from typing import Dict, List, Optional, Sequence, Tuple
+
+import numpy as np
+import redis.asyncio as redis
+
+from data_feed.shm_ring import DepthRingReader, DepthRingWriter, ring_name
+from live.binance_gateway import BinanceGateway
+from live.healthcheck import HealthcheckMetrics, HealthcheckServer
+from live.order_manager import OrderManager
+from match_engine import QUOTE_DTYPE, ShardRuntime
+from models.size_calculator import SizeConfig
+from strategy.ev_maker import EVConfig, Quote
+
+logger = logging.getLogger(__name__)
+
+# (tick size, lot size) of rings this process creates for redis input
+DEFAULT_GRID = ("0.00000001", "0.00000001")
+
+
+class MultiSymbolEngine:
+    """quotes many symbols from one process on a native ShardRuntime"""
+
+    def __init__(
+        self,
+        symbols: Sequence[str],
+        redis_url: str = "redis://localhost:6379",
+        api_key: Optional[str] = None,
+        api_secret: Optional[str] = None,
+        testnet: bool = True,
+        workers: Optional[int] = None,
+        cpus: Optional[Sequence[int]] = None,
+        shm_rings: bool = False,
+        grids: Optional[Dict[str, Tuple[str, str]]] = None,
+        order_api: str = "rest",
+        cancel_replace: bool = True,
+        price_tolerance: Decimal = Decimal("0"),
+        size_tolerance: Decimal = Decimal("0"),
+        queue_capacity: int = 4096,
+        metrics_port: int = 8000,
+    ):
+        """set up the runtime; rings are opened and workers started in start()
+
+        args:
+            symbols: trading pairs, each one shard
+            redis_url: redis connection url
+            api_key: binance api key, None runs without orders
+            api_secret: binance api secret
+            testnet: trade on the binance testnet
+            workers: worker threads, default one per symbol up to the cores
+            cpus: cores to pin worker i to, cpus[i % len(cpus)]; empty or
+                None leaves scheduling to the os
+            shm_rings: follow each recorder's ring_name(symbol) segment
+                instead of reading redis
+            grids: symbol -> (tick size, lot size) for redis input,
+                DEFAULT_GRID otherwise; attached rings bring their own
+            order_api: "rest" or "ws"
+            cancel_replace: replace orders in one request, see OrderManager
+            price_tolerance: price move left resting, see OrderManager
+            size_tolerance: size change left resting, see OrderManager
+            queue_capacity: outbound quote queue size, a power of two
+            metrics_port: port of the shared metrics endpoint
+        """
+        if not symbols:
+            raise ValueError("at least one symbol is needed")
+        if order_api not in ("rest", "ws"):
+            raise ValueError(f"unknown order api: {order_api}")
+
+        self.symbols = [symbol.lower() for symbol in symbols]
+        self.redis_client = redis.from_url(redis_url)
+        self.stream_keys = {
+            f"depth_updates:{symbol}": symbol for symbol in self.symbols
+        }
+        self.running = False
+
+        self.api_key = api_key
+        self.api_secret = api_secret
+        self.testnet = testnet
+        self.order_api = order_api
+        self.gateway = None
+
+        self.shm_rings = shm_rings
+        self.grids = grids or {}
+        # symbol -> DepthRingReader or DepthRingWriter, and its (tick, lot)
+        self.rings: Dict[str, object] = {}
+        self.units: Dict[str, Tuple[Decimal, Decimal]] = {}
+
+        if workers is None:
+            workers = min(len(self.symbols), os.cpu_count() or 1)
+        self.runtime = ShardRuntime(
+            workers=workers, cpus=list(cpus or []), queue_capacity=queue_capacity
+        )
+        self.quote_buffer = np.zeros(queue_capacity, dtype=QUOTE_DTYPE)
+        self.poll_interval = 0.0005
+
+        self.orders = {
+            symbol: OrderManager(
+                symbol, cancel_replace, price_tolerance, size_tolerance
+            )
+            for symbol in self.symbols
+        }
+        # newest unworked quote row per shard, and the task working it
+        self._latest: Dict[int, Tuple] = {}
+        self._working: Dict[int, asyncio.Task] = {}
+
+        self.inventory = {symbol: Decimal("0") for symbol in self.symbols}
+        self.last_trade_ids: Dict[str, Optional[int]] = {
+            symbol: None for symbol in self.symbols
+        }
+        self.fill_interval = 1.0
+        self.max_batch = 1000
+
+        # HealthcheckMetrics' position gauges follow the first symbol, the
+        # shard metrics carry every symbol's inventory
+        self.metrics = HealthcheckMetrics(redis_url=redis_url, symbol=self.symbols[0])
+        self.metrics.register_shard_runtime(self.runtime)
+        self.metrics_port = metrics_port
+        self.metrics_server = None
+
+    def _open_rings(self) -> None:
+        """attach or create one ring per symbol and add its shard"""
+        ev_config = EVConfig()
+        size_config = SizeConfig()
+        for symbol in self.symbols:
+            if self.shm_rings:
+                ring = DepthRingReader(ring_name(symbol))
+            else:
+                tick_size, lot_size = self.grids.get(symbol, DEFAULT_GRID)
+                ring = DepthRingWriter(
+                    f"{ring_name(symbol)}_{os.getpid()}",
+                    tick_size=tick_size,
+                    lot_size=lot_size,
+                )
+            self.rings[symbol] = ring
+            self.units[symbol] = (
+                Decimal(ring.ring.tick_size),
+                Decimal(ring.ring.lot_size),
+            )
+            self.runtime.add_symbol(symbol, ring.ring, ev_config, size_config)
+
+    async def start(self) -> None:
+        """start the shards and run until stopped"""
+        logger.info(f"starting multi-symbol engine for {len(self.symbols)} symbols")
+        self.running = True
+
+        self.metrics.redis_client = self.redis_client
+        self.metrics._owns_redis_connection = False
+
+        if self.api_key and self.api_secret:
+            if self.order_api == "ws":
+                from live.binance_ws_api import BinanceWsApiGateway
+
+                gateway = BinanceWsApiGateway
+            else:
+                gateway = BinanceGateway
+            self.gateway = gateway(self.api_key, self.api_secret, self.testnet)
+        else:
+            logger.warning(
+                "no binance credentials provided, running in simulation mode"
+            )
+
+        await self._load_positions()
+        self._open_rings()
+        for index, symbol in enumerate(self.symbols):
+            self._sync_inventory(index, symbol)
+        self.runtime.start()
+
+        self.metrics_server = HealthcheckServer(self.metrics, port=self.metrics_port)
+        await self.metrics_server.start()
+        logger.info(f"metrics server started on :{self.metrics_port}")
+
+        loops = [self._quote_loop()]
+        if not self.shm_rings:
+            loops.append(self._feed_loop())
+        try:
+            if self.gateway:
+                loops.append(self._fill_loop())
+                async with self.gateway:
+                    await asyncio.gather(*loops)
+            else:
+                await asyncio.gather(*loops)
+        except Exception as e:
+            logger.error(f"error in multi-symbol engine: {e}")
+        finally:
+            await self.stop()
+
+    async def stop(self) -> None:
+        """stop the shards and release the rings"""
+        logger.info("stopping multi-symbol engine")
+        self.running = False
+
+        for task in list(self._working.values()):
+            task.cancel()
+
+        # the shards read the rings' memory, drop them first
+        self.runtime.close()
+        for ring in self.rings.values():
+            ring.close()
+        self.rings.clear()
+
+        if self.metrics_server:
+            await self.metrics_server.stop()
+            self.metrics_server = None
+
+        self.metrics.redis_client = None
+        if self.redis_client:
+            await self.redis_client.aclose()
+
+    async def _load_positions(self) -> None:
+        """start each shard from the position the single-symbol engine keeps"""
+        for symbol in self.symbols:
+            try:
+                position = await self.redis_client.get(f"position:{symbol}")
+                if position:
+                    self.inventory[symbol] = Decimal(position.decode())
+            except Exception as e:
+                logger.error(f"error loading {symbol} position: {e}")
+
+    async def _feed_loop(self) -> None:
+        """publish every symbol's redis depth stream into its ring"""
+        last_ids = {key: "$" for key in self.stream_keys}
+        while self.running:
+            messages = await self.redis_client.xread(
+                last_ids, count=self.max_batch, block=100
+            )
+            self._publish(messages or [], last_ids)
+
+    def _publish(self, messages: List, last_ids: Dict[str, str]) -> None:
+        for key, entries in messages:
+            if not entries:
+                continue
+            if isinstance(key, bytes):
+                key = key.decode()
+            ring = self.rings[self.stream_keys[key]]
+            for _, fields in entries:
+                try:
+                    ring.write(json.loads(fields[b"data"]))
+                except Exception as e:
+                    logger.error(f"error publishing {key} update: {e}")
+            last_ids[key] = entries[-1][0]
+
+    async def _quote_loop(self) -> None:
+        """drain the runtime's quotes and hand them to the order managers"""
+        while self.running:
+            count = self.runtime.drain(self.quote_buffer)
+            if count == 0:
+                await asyncio.sleep(self.poll_interval)
+                continue
+            self._on_quotes(self.quote_buffer[:count].tolist())
+            # let the order tasks run between drains
+            await asyncio.sleep(0)
+
+    def _on_quotes(self, rows: List[Tuple]) -> None:
+        """keep the newest quote per shard and work each idle shard
+
+        a shard still waiting on the gateway picks up only the newest quote
+        when its requests return, so a slow symbol never builds a backlog
+        and never holds up the others
+
+        args:
+            rows: QUOTE_DTYPE rows as tuples, oldest first
+        """
+        for row in rows:
+            self._latest[row[0]] = row
+        for shard in list(self._latest):
+            if shard not in self._working:
+                self._working[shard] = asyncio.create_task(self._work_orders(shard))
+
+    async def _work_orders(self, shard: int) -> None:
+        try:
+            while shard in self._latest:
+                await self._requote(self._latest.pop(shard))
+        finally:
+            del self._working[shard]
+
+    async def _requote(self, row: Tuple) -> None:
+        shard, bid_ticks, bid_lots, ask_ticks, ask_lots, event_time = row
+        symbol = self.symbols[shard]
+        tick_size, lot_size = self.units[symbol]
+        bid_quote = Quote(bid_ticks * tick_size, bid_lots * lot_size)
+        ask_quote = Quote(ask_ticks * tick_size, ask_lots * lot_size)
+        if self.gateway:
+            try:
+                with self.metrics.time_stage("orders"):
+                    await self.orders[symbol].requote(
+                        self.gateway, bid_quote, ask_quote
+                    )
+            except Exception as e:
+                logger.error(f"error managing {symbol} orders: {e}")
+        self.metrics.record_event_to_quote(event_time)
+
+    async def _fill_loop(self) -> None:
+        while self.running:
+            for index, symbol in enumerate(self.symbols):
+                await self._check_for_fills(index, symbol)
+            await asyncio.sleep(self.fill_interval)
+
+    async def _check_for_fills(self, index: int, symbol: str) -> None:
+        """apply new account trades to the symbol's inventory and its shard"""
+        try:
+            trades = await self.gateway.get_account_trades(
+                symbol=symbol.upper(),
+                limit=100,
+                from_id=self.last_trade_ids[symbol],
+            )
+            changed = False
+            for trade in trades or []:
+                trade_id = int(trade["id"])
+                last_trade_id = self.last_trade_ids[symbol]
+                if last_trade_id and trade_id <= last_trade_id:
+                    continue
+                qty = Decimal(trade["qty"])
+                self.inventory[symbol] += qty if trade["isBuyer"] else -qty
+                self.last_trade_ids[symbol] = trade_id
+                self.metrics.record_fill("buy" if trade["isBuyer"] else "sell")
+                changed = True
+            if changed:
+                await self.redis_client.set(
+                    f"position:{symbol}", str(self.inventory[symbol])
+                )
+            self._sync_inventory(index, symbol)
+        except Exception as e:
+            logger.error(f"error checking {symbol} fills: {e}")
+
+    def _sync_inventory(self, index: int, symbol: str) -> None:
+        if symbol in self.units:
+            lot_size = self.units[symbol][1]
+            self.runtime.set_inventory(index, int(self.inventory[symbol] / lot_size))
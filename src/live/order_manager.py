@@ -0,0 +1,129 @@
+"""resting order bookkeeping and requoting for one symbol"""
+
+import asyncio
+import logging
+from dataclasses import dataclass
+from decimal import Decimal
+from typing import Dict, Optional
+
+logger = logging.getLogger(__name__)
+
+
+@dataclass
+class RestingOrder:
+    """an order the engine has working on one side of the book"""
+
+    order_id: str
+    price: Decimal
+    size: Decimal
+
+
+class OrderManager:
+    """works one bid and one ask for a symbol against a gateway
+
+    a resting order within tolerance of its new quote is left alone;
+    otherwise it is replaced with cancelReplace, one round trip, unless
+    cancel_replace is off and it is cancelled before the new post
+    """
+
+    def __init__(
+        self,
+        symbol: str,
+        cancel_replace: bool = True,
+        price_tolerance: Decimal = Decimal("0"),
+        size_tolerance: Decimal = Decimal("0"),
+    ):
+        self.symbol = symbol.upper()
+        self.cancel_replace = cancel_replace
+        self.price_tolerance = Decimal(price_tolerance)
+        self.size_tolerance = Decimal(size_tolerance)
+        # updated in place, callers may hold on to the dict
+        self.resting_orders: Dict[str, Optional[RestingOrder]] = {
+            "BUY": None,
+            "SELL": None,
+        }
+
+    def order_id(self, side: str) -> Optional[str]:
+        order = self.resting_orders[side]
+        return order.order_id if order else None
+
+    def count(self, side: str) -> int:
+        return 1 if self.resting_orders[side] else 0
+
+    async def requote(self, gateway, bid_quote, ask_quote) -> None:
+        """requote both sides at once; each side's own requests stay in order
+
+        args:
+            gateway: BinanceGateway or BinanceWsApiGateway
+            bid_quote: quote with price and size for the bid
+            ask_quote: quote with price and size for the ask
+        """
+        await asyncio.gather(
+            self.requote_side(gateway, "BUY", bid_quote),
+            self.requote_side(gateway, "SELL", ask_quote),
+        )
+
+    def _within_tolerance(self, order: RestingOrder, quote) -> bool:
+        return (
+            abs(quote.price - order.price) <= self.price_tolerance
+            and abs(quote.size - order.size) <= self.size_tolerance
+        )
+
+    async def requote_side(self, gateway, side: str, quote) -> None:
+        name = "bid" if side == "BUY" else "ask"
+        order = self.resting_orders[side]
+
+        if order is not None:
+            if self._within_tolerance(order, quote):
+                return
+            if self.cancel_replace:
+                await self.replace_order(gateway, side, order, quote)
+                return
+            try:
+                await gateway.cancel_order(self.symbol, order_id=int(order.order_id))
+                logger.info(f"canceled {name} order: {order.order_id}")
+            except Exception as e:
+                logger.warning(f"failed to cancel {name} order: {e}")
+            finally:
+                self.resting_orders[side] = None
+
+        try:
+            result = await gateway.post_order(
+                symbol=self.symbol,
+                side=side,
+                order_type="LIMIT",
+                quantity=quote.size,
+                price=quote.price,
+                time_in_force="GTC",
+            )
+            self.resting_orders[side] = RestingOrder(
+                str(result.get("orderId")), quote.price, quote.size
+            )
+            logger.info(f"placed {name} order: {result}")
+        except Exception as e:
+            logger.error(f"failed to place {name} order: {e}")
+
+    async def replace_order(
+        self, gateway, side: str, order: RestingOrder, quote
+    ) -> None:
+        name = "bid" if side == "BUY" else "ask"
+        try:
+            result = await gateway.cancel_replace_order(
+                symbol=self.symbol,
+                side=side,
+                cancel_order_id=int(order.order_id),
+                order_type="LIMIT",
+                quantity=quote.size,
+                price=quote.price,
+                time_in_force="GTC",
+            )
+            new_order = result["newOrderResponse"]
+            self.resting_orders[side] = RestingOrder(
+                str(new_order.get("orderId")), quote.price, quote.size
+            )
+            logger.info(f"replaced {name} order: {result}")
+        except Exception as e:
+            # the cancel failing, e.g. because the order filled, stops the
+            # replacement too; the next tick posts a fresh order
+            logger.warning(f"failed to replace {name} order: {e}")
+            self.resting_orders[side] = None
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+// arrow c data interface, copied from the stable abi in
+// https://arrow.apache.org/docs/format/CDataInterface.html so we can read
+// pyarrow buffers zero-copy without linking libarrow
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+
+struct ArrowSchema {
+    // array type description
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+
+    // release callback
+    void (*release)(struct ArrowSchema*);
+    // opaque producer-specific data
+    void* private_data;
+};
+
+struct ArrowArray {
+    // array data description
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+
+    // release callback
+    void (*release)(struct ArrowArray*);
+    // opaque producer-specific data
+    void* private_data;
+};
+
+}  // extern "C"
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+// releases an exported array/schema pair when it goes out of scope
+struct ArrowExport {
+    ArrowArray array{};
+    ArrowSchema schema{};
+
+    ArrowExport() = default;
+    ArrowExport(const ArrowExport&) = delete;
+    ArrowExport& operator=(const ArrowExport&) = delete;
+
+    ~ArrowExport() {
+        if (array.release) array.release(&array);
+        if (schema.release) schema.release(&schema);
+    }
+};
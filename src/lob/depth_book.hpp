@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+
+#include "side.hpp"
+
+// outcome of checking a depth update's U/u ids against the book
+enum class DepthSync : uint8_t {
+    // in sequence (or the first update seen), apply it
+    APPLIED = 0,
+    // every change is already in the book, skip it
+    STALE = 1,
+    // updates between the book and this one were missed, resync
+    GAP = 2
+};
+
+// aggregated market depth (price -> visible quantity) for one symbol,
+// prices in ticks and quantities in lots. this is the exchange's book as
+// seen in the depth stream, kept apart from our own orders in MatchEngine.
+class DepthBook {
+public:
+    // drops every level; last_update_id is the snapshot's lastUpdateId, or
+    // 0 to accept whatever update comes next
+    void clear(int64_t last_update_id = 0) {
+        bids_.clear();
+        asks_.clear();
+        last_update_id_ = last_update_id;
+    }
+
+    int64_t last_update_id() const { return last_update_id_; }
+    // accept an update after a GAP without a fresh snapshot
+    void set_last_update_id(int64_t id) { last_update_id_ = id; }
+
+    // binance diff rules: an update covers ids [first, final] and applies
+    // when it straddles last_update_id + 1. advances the book's id only for
+    // APPLIED, so on GAP the caller decides whether to resync or force it.
+    DepthSync begin_update(int64_t first_update_id, int64_t final_update_id) {
+        if (last_update_id_ != 0) {
+            if (final_update_id <= last_update_id_) return DepthSync::STALE;
+            if (first_update_id > last_update_id_ + 1) return DepthSync::GAP;
+        }
+        last_update_id_ = final_update_id;
+        return DepthSync::APPLIED;
+    }
+
+    // a zero quantity removes the level
+    void set(Side side, int64_t price, int64_t qty) {
+        if (side == Side::BUY) {
+            set_level(bids_, price, qty);
+        } else {
+            set_level(asks_, price, qty);
+        }
+    }
+
+    // 0 if the side is empty
+    int64_t best_bid() const { return bids_.empty() ? 0 : bids_.begin()->first; }
+    int64_t best_ask() const { return asks_.empty() ? 0 : asks_.begin()->first; }
+    // furthest level from the touch, 0 if the side is empty
+    int64_t worst_bid() const { return bids_.empty() ? 0 : bids_.rbegin()->first; }
+    int64_t worst_ask() const { return asks_.empty() ? 0 : asks_.rbegin()->first; }
+
+    size_t level_count(Side side) const {
+        return side == Side::BUY ? bids_.size() : asks_.size();
+    }
+
+    // quantity shown at price, 0 if there is no level
+    int64_t qty_at(Side side, int64_t price) const {
+        if (side == Side::BUY) {
+            auto it = bids_.find(price);
+            return it == bids_.end() ? 0 : it->second;
+        }
+        auto it = asks_.find(price);
+        return it == asks_.end() ? 0 : it->second;
+    }
+
+    // visit up to depth levels from best to worst
+    template <class Fn>
+    void for_each(Side side, size_t depth, Fn&& fn) const {
+        if (side == Side::BUY) {
+            visit(bids_, depth, fn);
+        } else {
+            visit(asks_, depth, fn);
+        }
+    }
+
+private:
+    std::map<int64_t, int64_t, std::greater<int64_t>> bids_;
+    std::map<int64_t, int64_t, std::less<int64_t>> asks_;
+    int64_t last_update_id_ = 0;
+
+    template <class Levels>
+    static void set_level(Levels& levels, int64_t price, int64_t qty) {
+        if (qty <= 0) {
+            levels.erase(price);
+        } else {
+            levels[price] = qty;
+        }
+    }
+
+    template <class Levels, class Fn>
+    static void visit(const Levels& levels, size_t depth, Fn& fn) {
+        size_t n = 0;
+        for (auto it = levels.begin(); it != levels.end() && n < depth; ++it, ++n) {
+            fn(it->first, it->second);
+        }
+    }
+};
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include "depth_decode.hpp"
+
+namespace py = pybind11;
+
+namespace {
+
+using LevelArray = py::array_t<RingLevel, py::array::c_style>;
+
+// python face of DepthDecoder. the grid comes in as decimal strings like
+// ShmRing's, and one DepthMessage is kept to reuse its level storage.
+class PyDepthDecoder {
+public:
+    PyDepthDecoder(const std::string& tick_size, const std::string& lot_size)
+        : decoder_(Instrument(depth_replay_detail::parse_decimal(tick_size),
+                              depth_replay_detail::parse_decimal(lot_size))),
+          tick_size_(tick_size),
+          lot_size_(lot_size) {}
+
+    // (e, E, s, U, u, bids, asks) with LEVEL_DTYPE level arrays, or None
+    // for a frame that isn't a depth update
+    py::object decode(const std::string& text) {
+        if (!decoder_.decode(text, message_)) return py::none();
+        return py::make_tuple(message_.event_type, message_.event_time,
+                              message_.symbol, message_.first_update_id,
+                              message_.final_update_id, to_array(message_.bids),
+                              to_array(message_.asks));
+    }
+
+    const std::string& tick_size() const { return tick_size_; }
+    const std::string& lot_size() const { return lot_size_; }
+
+private:
+    DepthDecoder decoder_;
+    DepthMessage message_;
+    std::string tick_size_;
+    std::string lot_size_;
+
+    static LevelArray to_array(const std::vector<RingLevel>& levels) {
+        LevelArray out(static_cast<py::ssize_t>(levels.size()));
+        std::copy(levels.begin(), levels.end(), out.mutable_data());
+        return out;
+    }
+};
+
+}  // namespace
+
+void bind_depth_decode(py::module_& m) {
+    // accepts str or bytes frames; the numpy dtype of the level arrays is
+    // registered by bind_shm_ring
+    py::class_<PyDepthDecoder>(m, "DepthDecoder")
+        .def(py::init<const std::string&, const std::string&>(),
+             py::arg("tick_size") = "0.00000001", py::arg("lot_size") = "0.00000001")
+        .def("decode", &PyDepthDecoder::decode, py::arg("text"))
+        .def_property_readonly("tick_size", &PyDepthDecoder::tick_size)
+        .def_property_readonly("lot_size", &PyDepthDecoder::lot_size);
+}
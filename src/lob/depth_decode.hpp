@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "depth_replay.hpp"
+#include "match_engine.hpp"
+#include "shm_ring.hpp"
+
+// a binance depth update with its levels already on a tick/lot grid
+struct DepthMessage {
+    std::string event_type;
+    std::string symbol;
+    int64_t event_time = 0;
+    int64_t first_update_id = 0;
+    int64_t final_update_id = 0;
+    std::vector<RingLevel> bids;
+    std::vector<RingLevel> asks;
+};
+
+namespace depth_decode_detail {
+
+// reads one json document front to back, nothing is materialised except
+// what the decoder asks for
+class Cursor {
+public:
+    explicit Cursor(std::string_view text) : text_(text) {}
+
+    bool consume(char c) {
+        skip_space();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) fail(std::string("expected '") + c + "'");
+    }
+
+    // a string without escapes, which is all a depth update carries
+    std::string_view string() {
+        expect('"');
+        size_t start = pos_;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            if (text_[pos_] == '\\') fail("escaped string in a depth field");
+            ++pos_;
+        }
+        if (pos_ == text_.size()) fail("unterminated string");
+        return text_.substr(start, pos_++ - start);
+    }
+
+    int64_t integer() {
+        skip_space();
+        bool negative = pos_ < text_.size() && text_[pos_] == '-';
+        if (negative) ++pos_;
+        size_t start = pos_;
+        uint64_t value = 0;
+        while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+            uint64_t digit = static_cast<uint64_t>(text_[pos_] - '0');
+            if (value > (static_cast<uint64_t>(INT64_MAX) - digit) / 10) {
+                fail("integer out of range");
+            }
+            value = value * 10 + digit;
+            ++pos_;
+        }
+        if (pos_ == start) fail("expected an integer");
+        int64_t signed_value = static_cast<int64_t>(value);
+        return negative ? -signed_value : signed_value;
+    }
+
+    // any value of a field the decoder has no use for
+    void skip_value() {
+        skip_space();
+        if (pos_ == text_.size()) fail("unexpected end");
+        char c = text_[pos_];
+        if (c == '"') {
+            skip_string();
+        } else if (c == '{' || c == '[') {
+            int depth = 0;
+            do {
+                c = text_[pos_];
+                if (c == '"') {
+                    skip_string();
+                    continue;
+                }
+                if (c == '{' || c == '[') ++depth;
+                if (c == '}' || c == ']') --depth;
+                ++pos_;
+            } while (depth > 0 && pos_ < text_.size());
+            if (depth > 0) fail("unexpected end");
+        } else {
+            // number, true, false or null
+            size_t start = pos_;
+            while (pos_ < text_.size() && !is_delimiter(text_[pos_])) ++pos_;
+            if (pos_ == start) fail("expected a value");
+        }
+    }
+
+    void finish() {
+        skip_space();
+        if (pos_ != text_.size()) fail("trailing characters");
+    }
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::invalid_argument("Malformed depth message at offset " +
+                                    std::to_string(pos_) + ": " + what);
+    }
+
+private:
+    std::string_view text_;
+    size_t pos_ = 0;
+
+    void skip_space() {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\n' ||
+                                       text_[pos_] == '\r' || text_[pos_] == '\t')) {
+            ++pos_;
+        }
+    }
+
+    void skip_string() {
+        ++pos_;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            pos_ += text_[pos_] == '\\' ? 2 : 1;
+        }
+        if (pos_ >= text_.size()) fail("unterminated string");
+        ++pos_;
+    }
+
+    static bool is_delimiter(char c) {
+        return c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' ||
+               c == '\r' || c == '\t';
+    }
+};
+
+}  // namespace depth_decode_detail
+
+// parses depth stream frames straight onto a grid in one pass: fields are
+// read in place, levels go from their decimal strings to ticks/lots with
+// the same rounding rules as the ring and the replay, and no intermediate
+// json tree or python object is built. fields other than the seven of a
+// depth update are skipped.
+class DepthDecoder {
+public:
+    explicit DepthDecoder(Instrument instrument = Instrument())
+        : instrument_(instrument) {}
+
+    const Instrument& instrument() const { return instrument_; }
+
+    // false for a well-formed object that isn't a depth update, such as a
+    // subscription reply. out is reused, so its level storage is too.
+    bool decode(std::string_view text, DepthMessage& out) const {
+        depth_decode_detail::Cursor cursor(text);
+        out.bids.clear();
+        out.asks.clear();
+        unsigned seen = 0;
+        cursor.expect('{');
+        if (!cursor.consume('}')) {
+            do {
+                std::string_view key = cursor.string();
+                cursor.expect(':');
+                unsigned field = field_bit(key);
+                if (seen & field) cursor.fail("duplicate field " + std::string(key));
+                seen |= field;
+                switch (field) {
+                case kEventType:
+                    out.event_type.assign(cursor.string());
+                    break;
+                case kEventTime:
+                    out.event_time = cursor.integer();
+                    break;
+                case kSymbol:
+                    out.symbol.assign(cursor.string());
+                    break;
+                case kFirstId:
+                    out.first_update_id = cursor.integer();
+                    break;
+                case kFinalId:
+                    out.final_update_id = cursor.integer();
+                    break;
+                case kBids:
+                    levels(cursor, out.bids);
+                    break;
+                case kAsks:
+                    levels(cursor, out.asks);
+                    break;
+                default:
+                    cursor.skip_value();
+                }
+            } while (cursor.consume(','));
+            cursor.expect('}');
+        }
+        cursor.finish();
+        return seen == kAll;
+    }
+
+private:
+    enum : unsigned {
+        kOther = 0,
+        kEventType = 1u << 0,
+        kEventTime = 1u << 1,
+        kSymbol = 1u << 2,
+        kFirstId = 1u << 3,
+        kFinalId = 1u << 4,
+        kBids = 1u << 5,
+        kAsks = 1u << 6,
+        kAll = (1u << 7) - 1,
+    };
+
+    Instrument instrument_;
+
+    static unsigned field_bit(std::string_view key) {
+        if (key.size() != 1) return kOther;
+        switch (key[0]) {
+        case 'e': return kEventType;
+        case 'E': return kEventTime;
+        case 's': return kSymbol;
+        case 'U': return kFirstId;
+        case 'u': return kFinalId;
+        case 'b': return kBids;
+        case 'a': return kAsks;
+        default: return kOther;
+        }
+    }
+
+    // [["price", "qty"], ...]
+    void levels(depth_decode_detail::Cursor& cursor,
+                std::vector<RingLevel>& out) const {
+        cursor.expect('[');
+        if (cursor.consume(']')) return;
+        do {
+            cursor.expect('[');
+            std::string_view price = cursor.string();
+            cursor.expect(',');
+            std::string_view qty = cursor.string();
+            cursor.expect(']');
+            out.push_back(RingLevel{
+                instrument_.to_ticks(depth_replay_detail::parse_decimal(price)),
+                instrument_.to_lots(depth_replay_detail::parse_decimal(qty))});
+        } while (cursor.consume(','));
+        cursor.expect(']');
+    }
+};
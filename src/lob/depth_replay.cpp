@@ -0,0 +1,128 @@
+#include <cstdint>
+#include <utility>
+#include <pybind11/pybind11.h>
+
+#include "depth_replay.hpp"
+#include "feature_pipeline.hpp"
+#include "queue_fill.hpp"
+
+namespace py = pybind11;
+
+// [(price, qty), ...] best first, in exchange units
+py::list depth_levels(const DepthBook& book, const Instrument& instrument, Side side,
+                      size_t depth) {
+    py::list out;
+    book.for_each(side, depth, [&](int64_t price, int64_t qty) {
+        out.append(py::make_tuple(instrument.from_ticks(price),
+                                  instrument.from_lots(qty)));
+    });
+    return out;
+}
+
+namespace {
+
+// python face of DepthReplay. batches come from pyarrow through the arrow c
+// data interface so the level strings are parsed straight out of arrow's
+// buffers, and the GIL is only taken back for sampled callbacks.
+class PyDepthReplay {
+public:
+    PyDepthReplay(double tick_size, double lot_size, bool incremental)
+        : replay_(Instrument(tick_size, lot_size), incremental) {}
+
+    // batch is a pyarrow RecordBatch or Table. callback(event_time, bids,
+    // asks) runs after every sample_every-th message with up to depth levels
+    // per side, 0 for all of them. tick_size/lot_size give the grid of
+    // integer level columns, 0 when it is the replay's own.
+    int64_t replay(py::object batch, py::object callback, uint64_t sample_every,
+                   size_t depth, double tick_size, double lot_size) {
+        if (py::hasattr(batch, "to_batches")) {
+            int64_t rows = 0;
+            for (py::handle part : batch.attr("to_batches")()) {
+                rows += replay(py::reinterpret_borrow<py::object>(part), callback,
+                               sample_every, depth, tick_size, lot_size);
+            }
+            return rows;
+        }
+        const Instrument& instrument = replay_.instrument();
+        const Instrument source(tick_size == 0 ? instrument.tick_size : tick_size,
+                                lot_size == 0 ? instrument.lot_size : lot_size);
+
+        ArrowExport exported;
+        batch.attr("_export_to_c")(reinterpret_cast<uintptr_t>(&exported.array),
+                                   reinterpret_cast<uintptr_t>(&exported.schema));
+
+        const size_t limit = depth == 0 ? SIZE_MAX : depth;
+        py::gil_scoped_release release;
+        return replay_.replay(
+            exported.schema, exported.array, sample_every, source,
+            [&](const DepthEvent& event, const DepthBook& book) {
+                py::gil_scoped_acquire acquire;
+                callback(event.event_time,
+                         depth_levels(book, instrument, Side::BUY, limit),
+                         depth_levels(book, instrument, Side::SELL, limit));
+            });
+    }
+
+    py::tuple snapshot(size_t depth) const {
+        const size_t limit = depth == 0 ? SIZE_MAX : depth;
+        const DepthBook& book = replay_.book();
+        return py::make_tuple(
+            depth_levels(book, replay_.instrument(), Side::BUY, limit),
+            depth_levels(book, replay_.instrument(), Side::SELL, limit));
+    }
+
+    // model is a QueueFillModel on the replay's grid, or None to detach.
+    // the replay holds on to it while attached.
+    void set_queue_model(py::object model) {
+        replay_.set_queue(model.is_none() ? nullptr : model.cast<QueueFillModel*>());
+        queue_model_ = std::move(model);
+    }
+
+    const DepthReplay& core() const { return replay_; }
+
+private:
+    DepthReplay replay_;
+    py::object queue_model_;
+};
+
+}  // namespace
+
+void bind_depth_replay(py::module_& m) {
+    py::class_<PyDepthReplay>(m, "DepthReplay")
+        .def(py::init<double, double, bool>(),
+             py::arg("tick_size") = kDefaultTickSize,
+             py::arg("lot_size") = kDefaultLotSize,
+             py::arg("incremental") = false)
+        .def("replay", &PyDepthReplay::replay, py::arg("batch"),
+             py::arg("callback"), py::arg("sample_every") = 1,
+             py::arg("depth") = 0, py::arg("tick_size") = 0.0,
+             py::arg("lot_size") = 0.0)
+        .def("snapshot", &PyDepthReplay::snapshot, py::arg("depth") = 0)
+        .def("set_queue_model", &PyDepthReplay::set_queue_model, py::arg("model"))
+        .def_property_readonly("messages", [](const PyDepthReplay& r) {
+            return r.core().messages();
+        })
+        .def_property_readonly("incremental", [](const PyDepthReplay& r) {
+            return r.core().incremental();
+        })
+        .def_property_readonly("stale", [](const PyDepthReplay& r) {
+            return r.core().stale();
+        })
+        .def_property_readonly("gaps", [](const PyDepthReplay& r) {
+            return r.core().gaps();
+        })
+        .def_property_readonly("last_update_id", [](const PyDepthReplay& r) {
+            return r.core().book().last_update_id();
+        })
+        .def_property_readonly("best_bid", [](const PyDepthReplay& r) {
+            const DepthReplay& core = r.core();
+            return core.instrument().from_ticks(core.book().best_bid());
+        })
+        .def_property_readonly("best_ask", [](const PyDepthReplay& r) {
+            const DepthReplay& core = r.core();
+            return core.instrument().from_ticks(core.book().best_ask());
+        })
+        .def("update_features", [](const PyDepthReplay& r, FeaturePipeline& features) {
+            features.on_book(r.core().book(), r.core().instrument());
+        }, py::arg("features"));
+}
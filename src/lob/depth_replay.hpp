@@ -0,0 +1,340 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "arrow_c.hpp"
+#include "depth_book.hpp"
+#include "match_engine.hpp"
+#include "queue_fill.hpp"
+
+// one depth message as seen by the sampling callback
+struct DepthEvent {
+    int64_t event_time;
+    int64_t first_update_id;
+    int64_t final_update_id;
+    // messages replayed so far, including this one
+    uint64_t sequence;
+};
+
+namespace depth_replay_detail {
+
+inline bool is_valid(const ArrowArray& array, int64_t i) {
+    if (array.null_count == 0 || array.buffers[0] == nullptr) return true;
+    const auto* bits = static_cast<const uint8_t*>(array.buffers[0]);
+    int64_t bit = array.offset + i;
+    return (bits[bit >> 3] >> (bit & 7)) & 1;
+}
+
+// an int64 column, read in place
+struct Int64Column {
+    const ArrowArray* array = nullptr;
+
+    int64_t operator[](int64_t i) const {
+        if (array == nullptr || !is_valid(*array, i)) return 0;
+        return static_cast<const int64_t*>(array->buffers[1])[array->offset + i];
+    }
+};
+
+// the bids/asks column: list<string> of "price,qty" (schema version 1) or
+// list<struct<price: int64, qty: int64>> of ticks/lots (version 2), either
+// with int32 or int64 list offsets. read in place.
+struct LevelListColumn {
+    const ArrowArray* list = nullptr;
+    // string values, or the struct array of integer levels
+    const ArrowArray* values = nullptr;
+    Int64Column prices;
+    Int64Column qtys;
+    bool large_list = false;
+    bool large_string = false;
+    bool integer = false;
+
+    // calls on_string(std::string_view) or on_units(price, qty) for every
+    // level in row i, depending on the column type
+    template <class OnString, class OnUnits>
+    void for_each(int64_t i, OnString&& on_string, OnUnits&& on_units) const {
+        if (list == nullptr || !is_valid(*list, i)) return;
+        int64_t idx = list->offset + i;
+        int64_t begin = offset_at(list->buffers[1], large_list, idx);
+        int64_t end = offset_at(list->buffers[1], large_list, idx + 1);
+        if (integer) {
+            for (int64_t j = begin; j < end; ++j) {
+                if (!is_valid(*values, j)) continue;
+                int64_t level = values->offset + j;
+                on_units(prices[level], qtys[level]);
+            }
+            return;
+        }
+        const char* data = static_cast<const char*>(values->buffers[2]);
+        for (int64_t j = begin; j < end; ++j) {
+            if (!is_valid(*values, j)) continue;
+            int64_t s = offset_at(values->buffers[1], large_string, values->offset + j);
+            int64_t e =
+                offset_at(values->buffers[1], large_string, values->offset + j + 1);
+            on_string(std::string_view(data + s, static_cast<size_t>(e - s)));
+        }
+    }
+
+private:
+    static int64_t offset_at(const void* buffer, bool large, int64_t i) {
+        return large ? static_cast<const int64_t*>(buffer)[i]
+                     : static_cast<const int32_t*>(buffer)[i];
+    }
+};
+
+// plain decimal ("12345.678") to double without locale or a terminating nul
+inline double parse_decimal(std::string_view text) {
+    static const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,
+                                    1e7,  1e8,  1e9,  1e10, 1e11, 1e12, 1e13,
+                                    1e14, 1e15, 1e16, 1e17, 1e18};
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int frac = -1;
+    for (char c : text) {
+        if (c == '.' && frac < 0) {
+            frac = 0;
+        } else if (c >= '0' && c <= '9') {
+            // leading zeros carry no precision
+            if (mantissa != 0 || c != '0') ++digits;
+            if (digits > 18) {
+                throw std::invalid_argument("Too many digits in depth level");
+            }
+            mantissa = mantissa * 10 + static_cast<uint64_t>(c - '0');
+            if (frac >= 0) ++frac;
+        } else {
+            throw std::invalid_argument("Malformed depth level: " + std::string(text));
+        }
+        if (frac > 18) {
+            throw std::invalid_argument("Too many digits in depth level");
+        }
+    }
+    if (text.empty() || text == ".") {
+        throw std::invalid_argument("Malformed depth level: " + std::string(text));
+    }
+    return static_cast<double>(mantissa) / kPow10[frac < 0 ? 0 : frac];
+}
+
+}  // namespace depth_replay_detail
+
+// replays depth messages exported from pyarrow record batches into a
+// DepthBook without going through python objects, and only every
+// sample_every-th message is handed to the caller.
+//
+// by default each message is a full snapshot of the levels it carries, the
+// same view Simulator builds in python. incremental replay treats messages
+// as binance diffs instead: only the listed levels change (qty 0 deletes),
+// stale updates are skipped and a sequence gap is counted then applied,
+// since a recording has no snapshot to resync from.
+class DepthReplay {
+public:
+    explicit DepthReplay(Instrument instrument = Instrument(), bool incremental = false)
+        : instrument_(instrument), incremental_(incremental) {}
+
+    const Instrument& instrument() const { return instrument_; }
+    const DepthBook& book() const { return book_; }
+    bool incremental() const { return incremental_; }
+    uint64_t messages() const { return messages_; }
+    uint64_t stale() const { return stale_; }
+    uint64_t gaps() const { return gaps_; }
+
+    // feeds every level change and the resulting best prices to queue, on
+    // every message rather than only sampled ones; nullptr detaches it.
+    // the model works in ticks/lots, so it must share the replay's grid.
+    void set_queue(QueueFillModel* queue) {
+        if (queue != nullptr &&
+            (queue->instrument().tick_size != instrument_.tick_size ||
+             queue->instrument().lot_size != instrument_.lot_size)) {
+            throw std::invalid_argument("Queue model grid must match the replay's");
+        }
+        queue_ = queue;
+    }
+    QueueFillModel* queue() const { return queue_; }
+
+    // replays every row of a struct array laid out like ParquetWriter's
+    // schema, calling on_sample(const DepthEvent&, const DepthBook&) after
+    // every sample_every-th message. the sampling phase carries over between
+    // calls so a file split into batches samples like one long stream.
+    // integer levels are in the source grid and rescaled when it differs
+    // from the replay's. returns the number of rows replayed.
+    template <class OnSample>
+    int64_t replay(const ArrowSchema& schema, const ArrowArray& batch,
+                   uint64_t sample_every, OnSample&& on_sample) {
+        return replay(schema, batch, sample_every, instrument_,
+                      std::forward<OnSample>(on_sample));
+    }
+
+    template <class OnSample>
+    int64_t replay(const ArrowSchema& schema, const ArrowArray& batch,
+                   uint64_t sample_every, const Instrument& source,
+                   OnSample&& on_sample) {
+        if (sample_every == 0) {
+            throw std::invalid_argument("Sample interval must be positive");
+        }
+        if (std::strcmp(schema.format, "+s") != 0) {
+            throw std::invalid_argument("Depth batch must be a struct array");
+        }
+
+        depth_replay_detail::Int64Column event_time =
+            int64_column(schema, batch, "event_time");
+        depth_replay_detail::Int64Column first_update_id =
+            int64_column(schema, batch, "first_update_id");
+        depth_replay_detail::Int64Column final_update_id =
+            int64_column(schema, batch, "final_update_id");
+        depth_replay_detail::LevelListColumn bids =
+            level_column(schema, batch, "bids");
+        depth_replay_detail::LevelListColumn asks =
+            level_column(schema, batch, "asks");
+        const bool same_grid = source.tick_size == instrument_.tick_size &&
+                               source.lot_size == instrument_.lot_size;
+        auto bid_units = [&](int64_t price, int64_t qty) {
+            apply_units(Side::BUY, price, qty, source, same_grid);
+        };
+        auto ask_units = [&](int64_t price, int64_t qty) {
+            apply_units(Side::SELL, price, qty, source, same_grid);
+        };
+
+        for (int64_t i = 0; i < batch.length; ++i) {
+            int64_t row = batch.offset + i;
+            if (incremental_) {
+                DepthSync sync =
+                    book_.begin_update(first_update_id[row], final_update_id[row]);
+                if (sync == DepthSync::STALE) {
+                    ++stale_;
+                    continue;
+                }
+                if (sync == DepthSync::GAP) {
+                    ++gaps_;
+                    book_.set_last_update_id(final_update_id[row]);
+                }
+            } else {
+                book_.clear();
+            }
+            event_time_ = event_time[row];
+            bids.for_each(
+                row, [this](std::string_view level) { apply_level(Side::BUY, level); },
+                bid_units);
+            asks.for_each(
+                row, [this](std::string_view level) { apply_level(Side::SELL, level); },
+                ask_units);
+            if (queue_ != nullptr) {
+                // the clear above dropped levels the message did not list
+                if (!incremental_) queue_->on_book(book_, event_time_);
+                queue_->on_best(book_.best_bid(), book_.best_ask(), event_time_);
+            }
+
+            ++messages_;
+            if (messages_ % sample_every == 0) {
+                DepthEvent event{event_time[row], first_update_id[row],
+                                 final_update_id[row], messages_};
+                on_sample(static_cast<const DepthEvent&>(event),
+                          static_cast<const DepthBook&>(book_));
+            }
+        }
+        return batch.length;
+    }
+
+private:
+    Instrument instrument_;
+    bool incremental_;
+    DepthBook book_;
+    uint64_t messages_ = 0;
+    uint64_t stale_ = 0;
+    uint64_t gaps_ = 0;
+    QueueFillModel* queue_ = nullptr;
+    // event time of the message being applied
+    int64_t event_time_ = 0;
+
+    void set_level(Side side, int64_t price, int64_t qty) {
+        book_.set(side, price, qty);
+        if (queue_ != nullptr) queue_->on_level(side, price, qty, event_time_);
+    }
+
+    // "price,qty" with exchange-formatted decimals
+    void apply_level(Side side, std::string_view level) {
+        size_t comma = level.find(',');
+        if (comma == std::string_view::npos) {
+            throw std::invalid_argument("Malformed depth level: " + std::string(level));
+        }
+        double price = depth_replay_detail::parse_decimal(level.substr(0, comma));
+        double qty = depth_replay_detail::parse_decimal(level.substr(comma + 1));
+        set_level(side, instrument_.to_ticks(price), instrument_.to_lots(qty));
+    }
+
+    // ticks/lots already on a grid, rescaled if it is not the replay's
+    void apply_units(Side side, int64_t price, int64_t qty, const Instrument& source,
+                     bool same_grid) {
+        if (same_grid) {
+            set_level(side, price, qty);
+            return;
+        }
+        set_level(side, instrument_.to_ticks(source.from_ticks(price)),
+                  instrument_.to_lots(source.from_lots(qty)));
+    }
+
+    static int64_t child_index(const ArrowSchema& schema, const char* name) {
+        for (int64_t i = 0; i < schema.n_children; ++i) {
+            const char* child = schema.children[i]->name;
+            if (child != nullptr && std::strcmp(child, name) == 0) return i;
+        }
+        return -1;
+    }
+
+    // ids and times are optional, missing ones read as 0
+    static depth_replay_detail::Int64Column int64_column(const ArrowSchema& schema,
+                                                         const ArrowArray& batch,
+                                                         const char* name) {
+        depth_replay_detail::Int64Column column;
+        int64_t idx = child_index(schema, name);
+        if (idx < 0) return column;
+        if (std::strcmp(schema.children[idx]->format, "l") != 0) {
+            throw std::invalid_argument(std::string("Column ") + name +
+                                        " must be int64");
+        }
+        column.array = batch.children[idx];
+        return column;
+    }
+
+    static depth_replay_detail::LevelListColumn level_column(
+        const ArrowSchema& schema, const ArrowArray& batch, const char* name) {
+        int64_t idx = child_index(schema, name);
+        if (idx < 0) {
+            throw std::invalid_argument(std::string("Missing column ") + name);
+        }
+        const ArrowSchema& list = *schema.children[idx];
+        depth_replay_detail::LevelListColumn column;
+        column.large_list = std::strcmp(list.format, "+L") == 0;
+        if (!column.large_list && std::strcmp(list.format, "+l") != 0) {
+            throw std::invalid_argument(std::string("Column ") + name +
+                                        " must be a list of levels");
+        }
+        column.list = batch.children[idx];
+        column.values = column.list->children[0];
+
+        const ArrowSchema& item = *list.children[0];
+        if (std::strcmp(item.format, "+s") == 0) {
+            int64_t price = child_index(item, "price");
+            int64_t qty = child_index(item, "qty");
+            if (price < 0 || qty < 0 ||
+                std::strcmp(item.children[price]->format, "l") != 0 ||
+                std::strcmp(item.children[qty]->format, "l") != 0) {
+                throw std::invalid_argument(std::string("Column ") + name +
+                                            " levels must be int64 price/qty");
+            }
+            column.integer = true;
+            column.prices.array = column.values->children[price];
+            column.qtys.array = column.values->children[qty];
+            return column;
+        }
+        column.large_string = std::strcmp(item.format, "U") == 0;
+        if (!column.large_string && std::strcmp(item.format, "u") != 0) {
+            throw std::invalid_argument(std::string("Column ") + name +
+                                        " must be a list of levels");
+        }
+        return column;
+    }
+};
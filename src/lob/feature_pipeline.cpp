@@ -0,0 +1,42 @@
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "feature_pipeline.hpp"
+
+namespace py = pybind11;
+
+void bind_feature_pipeline(py::module_& m) {
+    // engines and DepthReplay feed it through update_features(pipeline)
+    py::class_<FeaturePipeline>(m, "FeaturePipeline")
+        .def(py::init<size_t, double, std::vector<size_t>>(), py::arg("window") = 100,
+             py::arg("ewma_alpha") = 0.06,
+             py::arg("horizons") = std::vector<size_t>{10, 100, 1000})
+        .def("update_mid", [](FeaturePipeline& f, double mid) {
+            f.on_mid(mid);
+            return f.volatility();
+        }, py::arg("mid_price"))
+        // same keys as features.imbalance.get_imbalance_features
+        .def("imbalance_features", [](const FeaturePipeline& f) {
+            return std::map<std::string, double>{{"imbalance_1", f.imbalance_1()},
+                                                 {"imbalance_2", f.imbalance_2()},
+                                                 {"imbalance_5", f.imbalance_5()}};
+        })
+        .def_property_readonly("updates", &FeaturePipeline::updates)
+        .def_property_readonly("mid", &FeaturePipeline::mid)
+        .def_property_readonly("spread", &FeaturePipeline::spread)
+        .def_property_readonly("microprice", &FeaturePipeline::microprice)
+        .def_property_readonly("volatility", &FeaturePipeline::volatility)
+        .def_property_readonly("ewma_volatility", &FeaturePipeline::ewma_volatility)
+        .def_property_readonly("realized_volatility", [](const FeaturePipeline& f) {
+            std::map<size_t, double> out;
+            const std::vector<size_t>& horizons = f.horizons();
+            for (size_t k = 0; k < horizons.size(); ++k) {
+                out[horizons[k]] = f.realized_volatility(k);
+            }
+            return out;
+        });
+}
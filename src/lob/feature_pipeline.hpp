@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "depth_book.hpp"
+#include "match_engine.hpp"
+
+// rolling mean and sample variance of the last `window` values. welford
+// updates with eviction, O(1) per push; the sums are rebuilt from the ring
+// once every `window` evictions so repeated removals can't drift. mirrors
+// features.volatility.RollingStats.
+class RollingStats {
+public:
+    explicit RollingStats(size_t window) : ring_(window) {
+        if (window == 0) throw std::invalid_argument("Window must be at least 1");
+    }
+
+    size_t window() const { return ring_.size(); }
+    size_t count() const { return count_; }
+    double mean() const { return mean_; }
+
+    // sample variance, 0 with fewer than two values
+    double variance() const {
+        return count_ < 2 ? 0.0 : std::max(m2_, 0.0) / static_cast<double>(count_ - 1);
+    }
+    double std() const { return std::sqrt(variance()); }
+
+    void push(double value) {
+        if (count_ == ring_.size()) {
+            remove_oldest();
+            ++evictions_;
+        }
+        ring_[(head_ + count_) % ring_.size()] = value;
+        ++count_;
+        double delta = value - mean_;
+        mean_ += delta / static_cast<double>(count_);
+        m2_ += delta * (value - mean_);
+        if (evictions_ >= ring_.size()) rebuild();
+    }
+
+    void clear() {
+        head_ = count_ = evictions_ = 0;
+        mean_ = m2_ = 0.0;
+    }
+
+private:
+    std::vector<double> ring_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    size_t evictions_ = 0;
+    double mean_ = 0.0;
+    double m2_ = 0.0;
+
+    void remove_oldest() {
+        double value = ring_[head_];
+        head_ = (head_ + 1) % ring_.size();
+        --count_;
+        if (count_ <= 1) {
+            // exact rather than a downdate that cancels to rounding noise
+            mean_ = count_ == 1 ? ring_[head_] : 0.0;
+            m2_ = 0.0;
+            return;
+        }
+        double delta = value - mean_;
+        mean_ -= delta / static_cast<double>(count_);
+        m2_ -= delta * (value - mean_);
+    }
+
+    void rebuild() {
+        double sum = 0.0;
+        for (size_t i = 0; i < count_; ++i) sum += at(i);
+        mean_ = sum / static_cast<double>(count_);
+        m2_ = 0.0;
+        for (size_t i = 0; i < count_; ++i) {
+            double d = at(i) - mean_;
+            m2_ += d * d;
+        }
+        evictions_ = 0;
+    }
+
+    double at(size_t i) const { return ring_[(head_ + i) % ring_.size()]; }
+};
+
+// sqrt of summed squared returns over several horizons from one ring,
+// O(horizons) per push. mirrors features.volatility.RealizedVolatility.
+class RealizedVariance {
+public:
+    explicit RealizedVariance(std::vector<size_t> horizons) : horizons_(std::move(horizons)) {
+        std::sort(horizons_.begin(), horizons_.end());
+        horizons_.erase(std::unique(horizons_.begin(), horizons_.end()), horizons_.end());
+        if (horizons_.empty() || horizons_.front() == 0) {
+            throw std::invalid_argument("Horizons must be at least 1");
+        }
+        squares_.assign(horizons_.back(), 0.0);
+        sums_.assign(horizons_.size(), 0.0);
+    }
+
+    const std::vector<size_t>& horizons() const { return horizons_; }
+
+    double volatility(size_t k) const { return std::sqrt(std::max(sums_[k], 0.0)); }
+
+    void push(double square) {
+        const size_t size = squares_.size();
+        for (size_t k = 0; k < horizons_.size(); ++k) {
+            sums_[k] += square;
+            if (count_ >= horizons_[k]) {
+                sums_[k] -= squares_[(head_ + size - horizons_[k]) % size];
+            }
+        }
+        squares_[head_] = square;
+        head_ = (head_ + 1) % size;
+        count_ = std::min(count_ + 1, size);
+        if (++pushes_ >= size) rebuild();
+    }
+
+    void clear() {
+        std::fill(sums_.begin(), sums_.end(), 0.0);
+        head_ = count_ = pushes_ = 0;
+    }
+
+private:
+    std::vector<size_t> horizons_;
+    std::vector<double> squares_;
+    std::vector<double> sums_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    size_t pushes_ = 0;
+
+    void rebuild() {
+        const size_t size = squares_.size();
+        for (size_t k = 0; k < horizons_.size(); ++k) {
+            double sum = 0.0;
+            size_t n = std::min(horizons_[k], count_);
+            for (size_t i = 1; i <= n; ++i) sum += squares_[(head_ + size - i) % size];
+            sums_[k] = sum;
+        }
+        pushes_ = 0;
+    }
+};
+
+// book and volatility features maintained incrementally, one update per
+// book change. the book side reads only the top few levels, never sums the
+// whole book; the volatility side is O(1) per mid price (see
+// features.volatility for the python reference of each estimator).
+class FeaturePipeline {
+public:
+    static constexpr double kAnnualization = 15.874507866387544;  // sqrt(252)
+    static constexpr size_t kImbalanceDepth = 5;
+
+    // window follows VolatilityCalculator: prices kept, so window - 1 returns
+    FeaturePipeline(size_t window = 100, double ewma_alpha = 0.06,
+                    std::vector<size_t> horizons = {10, 100, 1000})
+        : window_(window),
+          returns_(std::max<size_t>(window, 2) - 1),
+          ewma_alpha_(ewma_alpha),
+          realized_(std::move(horizons)) {
+        if (window == 0) throw std::invalid_argument("Window must be at least 1");
+        if (!(ewma_alpha > 0 && ewma_alpha <= 1)) {
+            throw std::invalid_argument("EWMA alpha must be in (0, 1]");
+        }
+    }
+
+    // top-of-book features from the maintained book; the mid feeds the
+    // volatility estimators. a one-sided book leaves everything unchanged.
+    void on_book(const DepthBook& book, const Instrument& instrument) {
+        int64_t bid_qty[kImbalanceDepth] = {};
+        int64_t ask_qty[kImbalanceDepth] = {};
+        size_t bids = 0, asks = 0;
+        book.for_each(Side::BUY, kImbalanceDepth,
+                      [&](int64_t, int64_t qty) { bid_qty[bids++] = qty; });
+        book.for_each(Side::SELL, kImbalanceDepth,
+                      [&](int64_t, int64_t qty) { ask_qty[asks++] = qty; });
+        if (bids == 0 || asks == 0) return;
+
+        const double best_bid = instrument.from_ticks(book.best_bid());
+        const double best_ask = instrument.from_ticks(book.best_ask());
+        const double bid_top = instrument.from_lots(bid_qty[0]);
+        const double ask_top = instrument.from_lots(ask_qty[0]);
+        const double mid = (best_bid + best_ask) / 2.0;
+        spread_ = best_ask - best_bid;
+        microprice_ = bid_top + ask_top == 0
+                          ? mid
+                          : (best_bid * ask_top + best_ask * bid_top) / (bid_top + ask_top);
+        imbalance_1_ = imbalance(bid_qty, ask_qty, 1);
+        imbalance_2_ = imbalance(bid_qty, ask_qty, 2);
+        imbalance_5_ = imbalance(bid_qty, ask_qty, 5);
+        on_mid(mid);
+    }
+
+    // volatility estimators only, for callers without a book
+    void on_mid(double mid) {
+        if (has_mid_) {
+            double ret = (mid - mid_) / mid_;
+            returns_.push(ret);
+            if (has_ewma_) {
+                ewma_variance_ += ewma_alpha_ * (ret * ret - ewma_variance_);
+            } else {
+                ewma_variance_ = ret * ret;
+                has_ewma_ = true;
+            }
+            realized_.push(ret * ret);
+        }
+        mid_ = mid;
+        has_mid_ = true;
+        ++updates_;
+    }
+
+    uint64_t updates() const { return updates_; }
+    double mid() const { return mid_; }
+    double spread() const { return spread_; }
+    double microprice() const { return microprice_; }
+    double imbalance_1() const { return imbalance_1_; }
+    double imbalance_2() const { return imbalance_2_; }
+    double imbalance_5() const { return imbalance_5_; }
+
+    // VolatilityCalculator(window).volatility
+    double volatility() const {
+        if (window_ < 2 || returns_.count() < 2) return 0.0;
+        return returns_.std() * kAnnualization;
+    }
+    // EwmaVolatility(alpha).volatility
+    double ewma_volatility() const {
+        return has_ewma_ ? std::sqrt(ewma_variance_) * kAnnualization : 0.0;
+    }
+    // RealizedVolatility(horizons).volatility, k-th sorted horizon
+    const std::vector<size_t>& horizons() const { return realized_.horizons(); }
+    double realized_volatility(size_t k) const { return realized_.volatility(k); }
+
+private:
+    size_t window_;
+    RollingStats returns_;
+    double ewma_alpha_;
+    double ewma_variance_ = 0.0;
+    bool has_ewma_ = false;
+    RealizedVariance realized_;
+    bool has_mid_ = false;
+    uint64_t updates_ = 0;
+    double mid_ = 0.0;
+    double spread_ = 0.0;
+    double microprice_ = 0.0;
+    double imbalance_1_ = 0.0;
+    double imbalance_2_ = 0.0;
+    double imbalance_5_ = 0.0;
+
+    // calculate_imbalance over the first `levels` levels, lots cancel out
+    static double imbalance(const int64_t* bids, const int64_t* asks, size_t levels) {
+        int64_t bid_volume = 0, ask_volume = 0;
+        for (size_t i = 0; i < levels; ++i) {
+            bid_volume += bids[i];
+            ask_volume += asks[i];
+        }
+        int64_t total = bid_volume + ask_volume;
+        if (total == 0) return 0.0;
+        return static_cast<double>(bid_volume - ask_volume) / static_cast<double>(total);
+    }
+};
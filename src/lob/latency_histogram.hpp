@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// fixed power-of-two histogram of nanosecond durations, cheap enough to
+// record on every insert. bucket i counts durations in (32 << (i - 1),
+// 32 << i] ns, the last one everything above ~1s, so the bounds map onto
+// prometheus le buckets without any configuration.
+class LatencyHistogram {
+public:
+    static constexpr size_t kBuckets = 26;  // 32ns .. 2^30ns, then +inf
+    static constexpr int64_t kFirstBoundNs = 32;
+
+    void record(int64_t ns) {
+        size_t index = 0;
+        if (ns > kFirstBoundNs) {
+            uint64_t v = static_cast<uint64_t>(ns - 1) >> 5;
+            while (v && index < kBuckets) {
+                v >>= 1;
+                ++index;
+            }
+        }
+        ++counts_[index];
+        ++count_;
+        sum_ns_ += ns > 0 ? ns : 0;
+    }
+
+    // upper bound of bucket i in ns; the last bucket has none
+    static int64_t upper_bound_ns(size_t i) { return kFirstBoundNs << i; }
+
+    // per bucket, not cumulative; kBuckets + 1 entries
+    const std::array<uint64_t, kBuckets + 1>& counts() const { return counts_; }
+    uint64_t count() const { return count_; }
+    int64_t sum_ns() const { return sum_ns_; }
+
+    void reset() { *this = LatencyHistogram(); }
+
+private:
+    std::array<uint64_t, kBuckets + 1> counts_{};
+    uint64_t count_ = 0;
+    int64_t sum_ns_ = 0;
+};
+
+// times its scope into a histogram, or does nothing when given none
+class ScopedLatency {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedLatency(LatencyHistogram* histogram) : histogram_(histogram) {
+        if (histogram_) start_ = Clock::now();
+    }
+
+    ~ScopedLatency() {
+        if (histogram_) {
+            histogram_->record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                                     start_)
+                    .count());
+        }
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram* histogram_;
+    Clock::time_point start_;
+};
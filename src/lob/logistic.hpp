@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+// 1 / (1 + exp(-z)) without overflowing exp for large |z|
+inline double sigmoid(double z) {
+    if (z >= 0) return 1.0 / (1.0 + std::exp(-z));
+    double e = std::exp(z);
+    return e / (1.0 + e);
+}
+
+// logistic regression scores for a row-major rows x cols feature matrix,
+// out[r] = sigmoid(x[r] . weights + intercept). four rows are accumulated
+// side by side so the inner loop has independent lanes to vectorize.
+inline void logistic_scores(const double* x, size_t rows, size_t cols,
+                            const double* weights, double intercept, double* out) {
+    constexpr size_t kLanes = 4;
+    size_t r = 0;
+    for (; r + kLanes <= rows; r += kLanes) {
+        double z[kLanes] = {intercept, intercept, intercept, intercept};
+        const double* block = x + r * cols;
+        for (size_t c = 0; c < cols; ++c) {
+            const double w = weights[c];
+            for (size_t k = 0; k < kLanes; ++k) z[k] += block[k * cols + c] * w;
+        }
+        for (size_t k = 0; k < kLanes; ++k) out[r + k] = sigmoid(z[k]);
+    }
+    for (; r < rows; ++r) {
+        double z = intercept;
+        const double* row = x + r * cols;
+        for (size_t c = 0; c < cols; ++c) z += row[c] * weights[c];
+        out[r] = sigmoid(z);
+    }
+}
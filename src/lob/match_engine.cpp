@@ -1,296 +1,937 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
-#include <memory>
-#include <stdexcept>
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 
+#include "depth_replay.hpp"
+#include "feature_pipeline.hpp"
+#include "logistic.hpp"
+#include "match_engine.hpp"
+
 namespace py = pybind11;
 
-// forward declarations
-struct Order;
-struct Fill;
+// defined in depth_replay.cpp, quote_engine.cpp, feature_pipeline.cpp,
+// shm_ring.cpp, shard_runtime.cpp and queue_fill.cpp
+void bind_depth_replay(py::module_& m);
+void bind_quote_engine(py::module_& m);
+void bind_feature_pipeline(py::module_& m);
+void bind_shm_ring(py::module_& m);
+void bind_shard_runtime(py::module_& m);
+void bind_queue_fill(py::module_& m);
+void bind_depth_decode(py::module_& m);
+py::list depth_levels(const DepthBook& book, const Instrument& instrument, Side side,
+                      size_t depth);
+
+// engine ids handed out for python string ids start here, numeric ids
+// passed in directly must stay below it
+constexpr OrderId kStringIdBase = OrderId(1) << 63;
+
+// maps python string ids onto engine ids once at the boundary, so the
+// engine itself only ever hashes and stores integers
+class StringIds {
+public:
+    // 0 if the string has no resting order
+    OrderId lookup(const std::string& name) const {
+        auto it = to_id_.find(name);
+        return it == to_id_.end() ? 0 : it->second;
+    }
+
+    OrderId assign(const std::string& name) {
+        if (name.empty()) {
+            throw std::invalid_argument("Order ID cannot be empty");
+        }
+        OrderId id = next_++;
+        to_id_.emplace(name, id);
+        to_name_.emplace(id, name);
+        return id;
+    }
 
-// order book side (bids or asks)
-enum class Side {
-    BUY,
-    SELL
+    void release(OrderId id) {
+        auto it = to_name_.find(id);
+        if (it == to_name_.end()) return;
+        to_id_.erase(it->second);
+        to_name_.erase(it);
+    }
+
+    std::string name(OrderId id) const {
+        auto it = to_name_.find(id);
+        return it == to_name_.end() ? std::to_string(id) : it->second;
+    }
+
+    // appends the mapping as the next id to hand out, a count and then
+    // (id, name length, name) records, fixed width in host byte order
+    void save(std::string& out) const {
+        append(out, uint64_t(next_));
+        append(out, uint64_t(to_name_.size()));
+        for (const auto& [id, name] : to_name_) {
+            append(out, uint64_t(id));
+            append(out, uint32_t(name.size()));
+            out.append(name);
+        }
+    }
+
+    // a mapping written by save(), throws std::invalid_argument on bytes
+    // that are not one. empty input is a mapping with no entries.
+    static StringIds load(const char* data, size_t size) {
+        StringIds ids;
+        if (size == 0) return ids;
+        uint64_t next = take<uint64_t>(data, size);
+        uint64_t count = take<uint64_t>(data, size);
+        for (uint64_t i = 0; i < count; ++i) {
+            OrderId id = take<uint64_t>(data, size);
+            uint32_t length = take<uint32_t>(data, size);
+            if (length == 0 || length > size || id < kStringIdBase || id >= next) {
+                throw std::invalid_argument("Snapshot string IDs are invalid");
+            }
+            std::string name(data, length);
+            data += length;
+            size -= length;
+            if (!ids.to_id_.emplace(name, id).second ||
+                !ids.to_name_.emplace(id, name).second) {
+                throw std::invalid_argument("Snapshot string IDs are invalid");
+            }
+        }
+        if (size != 0 || next < kStringIdBase) {
+            throw std::invalid_argument("Snapshot string IDs are invalid");
+        }
+        ids.next_ = next;
+        return ids;
+    }
+
+private:
+    std::unordered_map<std::string, OrderId> to_id_;
+    std::unordered_map<OrderId, std::string> to_name_;
+    OrderId next_ = kStringIdBase;
+
+    template <class T>
+    static void append(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof value);
+    }
+
+    template <class T>
+    static T take(const char*& data, size_t& size) {
+        if (size < sizeof(T)) {
+            throw std::invalid_argument("Snapshot string IDs are truncated");
+        }
+        T value;
+        std::memcpy(&value, data, sizeof value);
+        data += sizeof value;
+        size -= sizeof value;
+        return value;
+    }
 };
 
-// represents a single order
-struct Order {
-    std::string order_id;
-    Side side;
+// fill converted back to exchange units at the python boundary
+struct PyFill {
+    std::string taker_order_id;
+    std::string maker_order_id;
+    OrderId taker_id;
+    OrderId maker_id;
     double price;
     double size;
+    int64_t price_ticks;
+    int64_t size_lots;
     int64_t timestamp;
+};
 
-    Order(std::string id, Side s, double p, double sz, int64_t ts)
-        : order_id(std::move(id)), side(s), price(p), size(sz), timestamp(ts) {}
+// batch operation kinds
+enum class OpType : uint8_t {
+    INSERT = 0,
+    CANCEL = 1,
+    AMEND = 2
 };
 
-// represents a fill event
-struct Fill {
-    std::string taker_order_id;
-    std::string maker_order_id;
+// one row of the OP_DTYPE structured array accepted by apply_batch.
+// cancel only reads order_id, amend reads order_id and size.
+struct BatchOp {
+    uint8_t op;
+    uint8_t side;
     double price;
     double size;
     int64_t timestamp;
-
-    Fill(std::string taker, std::string maker, double p, double sz, int64_t ts)
-        : taker_order_id(std::move(taker)), maker_order_id(std::move(maker)),
-          price(p), size(sz), timestamp(ts) {}
+    uint64_t order_id;
 };
 
-// price level in the order book
-struct PriceLevel {
-    std::vector<std::shared_ptr<Order>> orders;
+// one row of the FILL_DTYPE record array returned by apply_batch
+struct BatchFill {
+    int64_t op_index;
+    uint64_t taker_id;
+    uint64_t maker_id;
+    double price;
+    double size;
+    int64_t timestamp;
 };
 
-// common type for ask book (ascending)
-using AskBook = std::map<double, PriceLevel, std::less<double>>;
-// common type for bid book (descending)
-using BidBook = std::map<double, PriceLevel, std::greater<double>>;
+// python-facing engine: the native engine plus the string id edge.
+//
+// threading: every binding holds the engine's mutex for its whole call
+// (see locked() below), so python threads may share one engine and each
+// call sees it whole. apply_batch keeps it while the GIL is released, and
+// a call that finds it taken waits with the GIL released too, so neither
+// can hold up the other or the rest of the interpreter.
+template <class Engine>
+struct PyEngine {
+    Engine engine;
+    StringIds ids;
+    // scratch for apply_depth_update, kept to reuse the storage
+    std::vector<std::pair<int64_t, int64_t>> bid_levels_;
+    std::vector<std::pair<int64_t, int64_t>> ask_levels_;
+    mutable std::mutex mutex_;
+    // storage the live last_fills_view() arrays read, shared with them. it
+    // is the engine's own buffer until the next call that refills or
+    // regrows it, which first swaps the engine onto a spare, so an array
+    // keeps both its storage and its fills. only touched with the GIL
+    // held, which is also when python drops an array's share.
+    std::shared_ptr<std::vector<Fill>> viewed_fills_;
+    // the buffer of a view python has let go, taken by the next detach so
+    // viewing in a loop alternates between two allocations
+    std::shared_ptr<std::vector<Fill>> spare_fills_ =
+        std::make_shared<std::vector<Fill>>();
 
-class MatchEngine {
-private:
-    // price -> orders at that price
-    BidBook bids;
-    AskBook asks;
-    // order_id -> (side, price)
-    std::map<std::string, std::pair<Side, double>> order_map;
-
-    std::vector<Fill> match_buy(std::shared_ptr<Order>& order) {
-        if (!order) {
-            throw std::invalid_argument("Order cannot be null");
+    // called with the GIL held; never re-entered from the same thread
+    std::unique_lock<std::mutex> lock() const {
+        std::unique_lock<std::mutex> guard(mutex_, std::try_to_lock);
+        if (!guard.owns_lock()) {
+            py::gil_scoped_release release;
+            guard.lock();
         }
-        if (order->size <= 0) {
-            throw std::invalid_argument("Order size must be positive");
+        return guard;
+    }
+
+    PyEngine(double tick_size, double lot_size, size_t ladder_levels)
+        : engine(Instrument(tick_size, lot_size), ladder_levels) {}
+
+    // views may outlive the engine, so they take their buffer with them
+    ~PyEngine() { detach_fills(); }
+
+    // read-only view of the last fills; see viewed_fills_
+    py::array fills_view() {
+        if (!viewed_fills_) {
+            std::weak_ptr<std::vector<Fill>> spare = spare_fills_;
+            viewed_fills_.reset(new std::vector<Fill>(), [spare](std::vector<Fill>* v) {
+                // keep the larger buffer for the next detach
+                auto slot = spare.lock();
+                if (slot && slot->capacity() < v->capacity()) slot->swap(*v);
+                delete v;
+            });
         }
-        std::vector<Fill> fills;
-        
-        auto ask_it = asks.begin();
-        while (ask_it != asks.end() && order->size > 0) {
-            if (ask_it->first > order->price) break;
-            
-            auto& level = ask_it->second;
-            auto order_it = level.orders.begin();
-            
-            while (order_it != level.orders.end() && order->size > 0) {
-                auto maker = *order_it;
-                if (!maker || maker->size <= 0) {
-                    order_it = level.orders.erase(order_it);
-                    continue;
-                }
-                
-                double match_size = std::min(order->size, maker->size);
-                fills.emplace_back(
-                    order->order_id,
-                    maker->order_id,
-                    ask_it->first,
-                    match_size,
-                    order->timestamp
-                );
-                
-                order->size -= match_size;
-                maker->size -= match_size;
-                
-                if (maker->size <= 0) {
-                    order_map.erase(maker->order_id);
-                    order_it = level.orders.erase(order_it);
-                } else {
-                    ++order_it;
-                }
-            }
-            
-            if (level.orders.empty()) {
-                ask_it = asks.erase(ask_it);
-            } else {
-                ++ask_it;
-            }
+        using Share = std::shared_ptr<std::vector<Fill>>;
+        auto share = std::make_unique<Share>(viewed_fills_);
+        py::capsule owner(share.get(), [](void* p) { delete static_cast<Share*>(p); });
+        share.release();
+        const auto& fills = engine.fills();
+        py::array_t<Fill> view({static_cast<py::ssize_t>(fills.size())},
+                               fills.data(), owner);
+        view.attr("setflags")(py::arg("write") = false);
+        return view;
+    }
+
+    // before a call that refills or regrows the engine's fill buffer: if a
+    // view still reads it, hand it to the view and carry on in the spare
+    void detach_fills() {
+        if (!viewed_fills_) return;
+        if (viewed_fills_.use_count() > 1) {
+            std::vector<Fill> fresh;
+            fresh.swap(*spare_fills_);
+            fresh.clear();
+            fresh.reserve(engine.fills().capacity());
+            engine.swap_fills(fresh);
+            viewed_fills_->swap(fresh);
         }
-        
-        return fills;
+        viewed_fills_.reset();
     }
-    
-    std::vector<Fill> match_sell(std::shared_ptr<Order>& order) {
-        if (!order) {
-            throw std::invalid_argument("Order cannot be null");
+
+    const Instrument& instrument() const { return engine.instrument(); }
+
+    int64_t ticks(double price) const {
+        // reject non-positive input before it is rounded onto the grid
+        if (price <= 0) {
+            throw std::invalid_argument("Price must be positive");
         }
-        if (order->size <= 0) {
-            throw std::invalid_argument("Order size must be positive");
+        return instrument().to_ticks(price);
+    }
+
+    int64_t lots(double size) const {
+        if (size <= 0) {
+            throw std::invalid_argument("Size must be positive");
         }
-        std::vector<Fill> fills;
-        
-        auto bid_it = bids.begin();
-        while (bid_it != bids.end() && order->size > 0) {
-            if (bid_it->first < order->price) break;
-            
-            auto& level = bid_it->second;
-            auto order_it = level.orders.begin();
-            
-            while (order_it != level.orders.end() && order->size > 0) {
-                auto maker = *order_it;
-                if (!maker || maker->size <= 0) {
-                    order_it = level.orders.erase(order_it);
-                    continue;
-                }
-                
-                double match_size = std::min(order->size, maker->size);
-                fills.emplace_back(
-                    order->order_id,
-                    maker->order_id,
-                    bid_it->first,
-                    match_size,
-                    order->timestamp
-                );
-                
-                order->size -= match_size;
-                maker->size -= match_size;
-                
-                if (maker->size <= 0) {
-                    order_map.erase(maker->order_id);
-                    order_it = level.orders.erase(order_it);
-                } else {
-                    ++order_it;
-                }
-            }
-            
-            if (level.orders.empty()) {
-                bid_it = bids.erase(bid_it);
-            } else {
-                ++bid_it;
-            }
+        return instrument().to_lots(size);
+    }
+
+    static OrderId numeric(OrderId order_id) {
+        if (order_id >= kStringIdBase) {
+            throw std::invalid_argument("Numeric order IDs must be below 2**63");
         }
-        
-        return fills;
+        return order_id;
     }
-    
-    void add_to_book(const std::shared_ptr<Order>& order) {
-        if (!order) {
-            throw std::invalid_argument("Order cannot be null");
+
+    OrderId new_string_id(const std::string& order_id) {
+        if (ids.lookup(order_id) != 0) {
+            throw std::invalid_argument("Duplicate order ID");
         }
-        if (order->size <= 0) {
-            throw std::invalid_argument("Order size must be positive");
+        return ids.assign(order_id);
+    }
+
+    // convert fills, then drop the mappings of orders that have left the book
+    std::vector<PyFill> finish(const std::vector<Fill>& fills, OrderId taker) {
+        const auto& instrument = this->instrument();
+        std::vector<PyFill> out;
+        out.reserve(fills.size());
+        for (const auto& fill : fills) {
+            out.push_back(PyFill{
+                ids.name(fill.taker_order_id),
+                ids.name(fill.maker_order_id),
+                fill.taker_order_id,
+                fill.maker_order_id,
+                instrument.from_ticks(fill.price),
+                instrument.from_lots(fill.size),
+                fill.price,
+                fill.size,
+                fill.timestamp
+            });
         }
-        if (order->price <= 0) {
-            throw std::invalid_argument("Order price must be positive");
+        for (const auto& fill : fills) {
+            if (!engine.contains(fill.maker_order_id)) {
+                ids.release(fill.maker_order_id);
+            }
         }
-        if (order->order_id.empty()) {
-            throw std::invalid_argument("Order ID cannot be empty");
+        if (!engine.contains(taker)) {
+            ids.release(taker);
         }
-        
-        if (order->side == Side::BUY) {
-            bids[order->price].orders.push_back(order);
-        } else {
-            asks[order->price].orders.push_back(order);
+        return out;
+    }
+
+    // the engine's snapshot followed by the string id mapping, so orders
+    // placed under python string ids keep their names after a restore
+    py::bytes snapshot() const {
+        std::string out;
+        engine.snapshot(out);
+        ids.save(out);
+        return py::bytes(out);
+    }
+
+    // both halves are parsed before either is replaced, so bad input
+    // leaves the engine and its ids as they were
+    void restore(const std::string& data) {
+        const size_t engine_size = Engine::snapshot_size(data.data(), data.size());
+        StringIds restored =
+            StringIds::load(data.data() + engine_size, data.size() - engine_size);
+        engine.restore(data.data(), data.size());
+        ids = std::move(restored);
+    }
+
+    // a depth level field, either a float or an exchange decimal string
+    static double level_value(py::handle value) {
+        if (py::isinstance<py::str>(value)) {
+            return depth_replay_detail::parse_decimal(value.cast<std::string>());
         }
-        order_map[order->order_id] = {order->side, order->price};
+        return value.cast<double>();
     }
 
-public:
-    std::vector<Fill> insert(const std::string& order_id, Side side, 
-                            double price, double size, int64_t timestamp) {
-        if (order_id.empty()) {
-            throw std::invalid_argument("Order ID cannot be empty");
+    // [(price, qty), ...] -> ticks/lots, qty 0 means delete
+    void convert_levels(const py::sequence& levels,
+                        std::vector<std::pair<int64_t, int64_t>>& out) const {
+        out.clear();
+        for (py::handle level : levels) {
+            auto pair = py::reinterpret_borrow<py::sequence>(level);
+            if (pair.size() != 2) {
+                throw std::invalid_argument("Depth level must be (price, qty)");
+            }
+            double qty = level_value(pair[1]);
+            if (qty < 0) {
+                throw std::invalid_argument("Quantity cannot be negative");
+            }
+            out.emplace_back(ticks(level_value(pair[0])), instrument().to_lots(qty));
         }
-        if (price <= 0) {
-            throw std::invalid_argument("Price must be positive");
+    }
+
+    // levels are converted before the ids are checked, so a bad level
+    // leaves both the market book and its sequence untouched
+    DepthSync apply_depth_update(int64_t first_update_id, int64_t final_update_id,
+                                 const py::sequence& bids, const py::sequence& asks) {
+        convert_levels(bids, bid_levels_);
+        convert_levels(asks, ask_levels_);
+        DepthSync sync = engine.begin_depth_update(first_update_id, final_update_id);
+        if (sync != DepthSync::APPLIED) return sync;
+        for (const auto& [price, qty] : bid_levels_) {
+            engine.apply_l2_delta(Side::BUY, price, qty);
         }
-        if (size <= 0) {
-            throw std::invalid_argument("Size must be positive");
+        for (const auto& [price, qty] : ask_levels_) {
+            engine.apply_l2_delta(Side::SELL, price, qty);
         }
-        if (timestamp < 0) {
-            throw std::invalid_argument("Timestamp must be non-negative");
+        return sync;
+    }
+
+    // top levels as (price, qty) rows of a caller-owned (levels, 2) buffer,
+    // float64 in exchange units or int64 in ticks/lots. market reads the
+    // exchange depth instead of our orders; cumulative turns qty into the
+    // running total from the best level. rows past the last level are
+    // zeroed. returns the number of levels written.
+    template <class T>
+    size_t depth_into(Side side, py::array_t<T, py::array::c_style>& out,
+                      bool cumulative, bool market) const {
+        if (out.ndim() != 2 || out.shape(1) != 2) {
+            throw std::invalid_argument("Depth buffer must have shape (levels, 2)");
         }
-        
-        auto order = std::make_shared<Order>(order_id, side, price, size, timestamp);
-        std::vector<Fill> fills;
-        
-        try {
-            if (side == Side::BUY) {
-                fills = match_buy(order);
+        const size_t rows = static_cast<size_t>(out.shape(0));
+        T* data = out.mutable_data();
+        const auto& instrument = this->instrument();
+        size_t n = 0;
+        int64_t total = 0;
+        auto write = [&](int64_t price, int64_t qty) {
+            total = cumulative ? total + qty : qty;
+            if constexpr (std::is_same_v<T, double>) {
+                data[2 * n] = instrument.from_ticks(price);
+                data[2 * n + 1] = instrument.from_lots(total);
             } else {
-                fills = match_sell(order);
-            }
-            
-            if (order->size > 0) {
-                add_to_book(order);
+                data[2 * n] = price;
+                data[2 * n + 1] = total;
             }
-            
-            return fills;
-        } catch (const std::exception& e) {
-            throw std::runtime_error(std::string("Error in insert: ") + e.what());
+            ++n;
+        };
+        if (market) {
+            engine.market().for_each(side, rows, write);
+        } else {
+            engine.for_each_level(side, rows,
+                                  [&](int64_t price, int64_t qty, size_t) {
+                                      write(price, qty);
+                                  });
+        }
+        std::fill(data + 2 * n, data + 2 * rows, T(0));
+        return n;
+    }
+
+    // total size over the best levels, all of them for levels == 0
+    double cumulative_volume(Side side, size_t levels, bool market) const {
+        const size_t limit = levels == 0 ? SIZE_MAX : levels;
+        int64_t total = 0;
+        if (market) {
+            engine.market().for_each(side, limit,
+                                     [&](int64_t, int64_t qty) { total += qty; });
+        } else {
+            engine.for_each_level(side, limit, [&](int64_t, int64_t qty, size_t) {
+                total += qty;
+            });
+        }
+        return instrument().from_lots(total);
+    }
+
+    // (orders ahead, size ahead) at the order's price, None if not resting
+    py::object queue_position(OrderId id) const {
+        typename Engine::QueuePosition pos;
+        if (id == 0 || !engine.queue_position(id, pos)) return py::none();
+        return py::make_tuple(pos.orders_ahead, instrument().from_lots(pos.qty_ahead));
+    }
+
+    std::vector<PyFill> insert(OrderId id, Side side, int64_t price, int64_t size,
+                               int64_t timestamp) {
+        detach_fills();
+        const std::vector<Fill>* fills;
+        try {
+            fills = &engine.insert(id, side, price, size, timestamp);
+        } catch (...) {
+            if (!engine.contains(id)) ids.release(id);
+            throw;
         }
+        return finish(*fills, id);
+    }
+
+    std::vector<PyFill> insert_str(const std::string& order_id, Side side,
+                                   double price, double size, int64_t timestamp) {
+        int64_t price_ticks = ticks(price);
+        int64_t size_lots = lots(size);
+        return insert(new_string_id(order_id), side, price_ticks, size_lots,
+                      timestamp);
     }
-    
-    bool cancel(const std::string& order_id) {
+
+    std::vector<PyFill> insert_ticks_str(const std::string& order_id, Side side,
+                                         int64_t price_ticks, int64_t size_lots,
+                                         int64_t timestamp) {
+        return insert(new_string_id(order_id), side, price_ticks, size_lots,
+                      timestamp);
+    }
+
+    bool cancel_str(const std::string& order_id) {
         if (order_id.empty()) {
             throw std::invalid_argument("Order ID cannot be empty");
         }
-        
-        auto it = order_map.find(order_id);
-        if (it == order_map.end()) {
+        OrderId id = ids.lookup(order_id);
+        if (id == 0) {
             return false;
         }
-        
-        auto [side, price] = it->second;
-        order_map.erase(it);
-        
-        if (side == Side::BUY) {
-            auto bid_it = bids.find(price);
-            if (bid_it != bids.end()) {
-                auto& orders = bid_it->second.orders;
-                orders.erase(
-                    std::remove_if(orders.begin(), orders.end(),
-                        [&order_id](const std::shared_ptr<Order>& order) {
-                            return order && order->order_id == order_id;
-                        }
-                    ),
-                    orders.end()
-                );
-                if (orders.empty()) {
-                    bids.erase(bid_it);
+        bool cancelled = engine.cancel(id);
+        ids.release(id);
+        return cancelled;
+    }
+
+    bool amend_str(const std::string& order_id, double size) {
+        int64_t size_lots = lots(size);
+        OrderId id = ids.lookup(order_id);
+        return id != 0 && engine.amend(id, size_lots);
+    }
+
+    std::vector<PyFill> replace(OrderId id, OrderId new_id, int64_t price,
+                                int64_t size, int64_t timestamp) {
+        detach_fills();
+        const std::vector<Fill>* fills;
+        try {
+            fills = &engine.replace(id, new_id, price, size, timestamp);
+        } catch (...) {
+            if (new_id != id && !engine.contains(new_id)) ids.release(new_id);
+            throw;
+        }
+        if (new_id != id) ids.release(id);
+        return finish(*fills, new_id);
+    }
+
+    // makers entered through the string api may have filled out
+    void release_filled_makers(const std::vector<Fill>& fills) {
+        for (const auto& fill : fills) {
+            if (fill.maker_order_id >= kStringIdBase &&
+                !engine.contains(fill.maker_order_id)) {
+                ids.release(fill.maker_order_id);
+            }
+        }
+    }
+
+    // numeric-id insert that leaves its fills in the engine's buffer for
+    // last_fills(_view) instead of converting them, returns how many there were.
+    // the order type picks the engine's instantiation here, once per call.
+    size_t submit(OrderId id, Side side, int64_t price, int64_t size,
+                  int64_t timestamp, OrderType type) {
+        id = numeric(id);
+        detach_fills();
+        const auto& fills = dispatch_order_type(
+            type, [&](auto tag) -> const std::vector<Fill>& {
+                return engine.template insert<decltype(tag)>(id, side, price, size,
+                                                             timestamp);
+            });
+        release_filled_makers(fills);
+        return fills.size();
+    }
+
+    size_t submit_replace(OrderId id, OrderId new_id, int64_t price, int64_t size,
+                          int64_t timestamp, OrderType type) {
+        id = numeric(id);
+        new_id = numeric(new_id);
+        detach_fills();
+        const auto& fills = dispatch_order_type(
+            type, [&](auto tag) -> const std::vector<Fill>& {
+                return engine.template replace<decltype(tag)>(id, new_id, price, size,
+                                                              timestamp);
+            });
+        release_filled_makers(fills);
+        return fills.size();
+    }
+
+    std::vector<PyFill> replace_str(const std::string& order_id,
+                                    const std::string& new_order_id, double price,
+                                    double size, int64_t timestamp) {
+        int64_t price_ticks = ticks(price);
+        int64_t size_lots = lots(size);
+        OrderId id = ids.lookup(order_id);
+        if (id == 0) {
+            throw std::invalid_argument("Unknown order ID");
+        }
+        OrderId new_id = new_order_id == order_id ? id : new_string_id(new_order_id);
+        return replace(id, new_id, price_ticks, size_lots, timestamp);
+    }
+
+    // run a whole array of numeric-id ops without the GIL. the binding
+    // holds the engine's mutex throughout, so other threads calling into
+    // this engine wait for the batch. ops before a failing row stay
+    // applied and the error names the row.
+    py::array apply_batch(py::array_t<BatchOp, py::array::c_style> ops) {
+        const BatchOp* rows = ops.data();
+        const size_t count = static_cast<size_t>(ops.size());
+        detach_fills();
+        auto out = std::make_unique<std::vector<BatchFill>>();
+        // makers entered through the string api may have filled out. a
+        // failing batch keeps the rows before it, so it releases them too.
+        auto release_makers = [this, &out] {
+            for (const auto& fill : *out) {
+                if (fill.maker_id >= kStringIdBase &&
+                    !engine.contains(fill.maker_id)) {
+                    ids.release(fill.maker_id);
                 }
             }
-        } else {
-            auto ask_it = asks.find(price);
-            if (ask_it != asks.end()) {
-                auto& orders = ask_it->second.orders;
-                orders.erase(
-                    std::remove_if(orders.begin(), orders.end(),
-                        [&order_id](const std::shared_ptr<Order>& order) {
-                            return order && order->order_id == order_id;
-                        }
-                    ),
-                    orders.end()
-                );
-                if (orders.empty()) {
-                    asks.erase(ask_it);
+        };
+
+        try {
+            py::gil_scoped_release release;
+            for (size_t i = 0; i < count; ++i) {
+                try {
+                    apply_op(rows[i], static_cast<int64_t>(i), *out);
+                } catch (const std::exception& e) {
+                    throw std::invalid_argument("op " + std::to_string(i) + ": " +
+                                                e.what());
                 }
             }
+        } catch (...) {
+            release_makers();
+            throw;
         }
-        
-        return true;
+        release_makers();
+
+        // hand the vector to numpy without copying
+        py::capsule owner(out.get(), [](void* p) {
+            delete static_cast<std::vector<BatchFill>*>(p);
+        });
+        std::vector<BatchFill>* fills = out.release();
+        return py::array_t<BatchFill>(
+            {static_cast<py::ssize_t>(fills->size())}, fills->data(), owner);
+    }
+
+    void apply_op(const BatchOp& row, int64_t index, std::vector<BatchFill>& out) {
+        const auto& instrument = this->instrument();
+        OrderId id = numeric(row.order_id);
+        switch (static_cast<OpType>(row.op)) {
+        case OpType::INSERT: {
+            if (row.side > 1) {
+                throw std::invalid_argument("Unknown side");
+            }
+            Side side = row.side == 0 ? Side::BUY : Side::SELL;
+            for (const auto& fill : engine.insert(id, side, ticks(row.price),
+                                                  lots(row.size), row.timestamp)) {
+                out.push_back(BatchFill{
+                    index,
+                    fill.taker_order_id,
+                    fill.maker_order_id,
+                    instrument.from_ticks(fill.price),
+                    instrument.from_lots(fill.size),
+                    fill.timestamp
+                });
+            }
+            break;
+        }
+        case OpType::CANCEL:
+            engine.cancel(id);
+            break;
+        case OpType::AMEND:
+            engine.amend(id, lots(row.size));
+            break;
+        default:
+            throw std::invalid_argument("Unknown op type");
+        }
+    }
+};
+
+// caller-owned depth buffers; bound with noconvert so a wrong dtype or
+// layout is rejected rather than silently written into a copy
+template <class T>
+using DepthArray = py::array_t<T, py::array::c_style>;
+
+// (upper bounds in seconds, per-bucket counts with +inf last, sum in
+// seconds), the pieces of a prometheus histogram
+using LatencyStats = std::tuple<std::vector<double>, std::vector<uint64_t>, double>;
+
+// also used by the shard runtime's per-symbol quote timers
+LatencyStats latency_stats(const LatencyHistogram& histogram) {
+    std::vector<double> bounds;
+    bounds.reserve(LatencyHistogram::kBuckets);
+    for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+        bounds.push_back(LatencyHistogram::upper_bound_ns(i) * 1e-9);
+    }
+    const auto& counts = histogram.counts();
+    return {bounds, std::vector<uint64_t>(counts.begin(), counts.end()),
+            histogram.sum_ns() * 1e-9};
+}
+
+// locked(f) is f with PyEngine::lock() held for the call. it takes a
+// member function or a lambda whose first parameter is the engine and
+// keeps the exact signature, so pybind11 still sees the argument types.
+template <class Fn>
+struct LockedLambda;
+
+template <class R, class Closure, class Self, class... Args>
+struct LockedLambda<R (Closure::*)(Self, Args...) const> {
+    template <class Fn>
+    static auto wrap(Fn fn) {
+        return [fn](Self self, Args... args) -> R {
+            auto guard = self.lock();
+            return fn(self, std::forward<Args>(args)...);
+        };
     }
 };
 
+template <class Fn>
+auto locked(Fn fn) {
+    return LockedLambda<decltype(&Fn::operator())>::wrap(fn);
+}
+
+template <class R, class E, class... Args>
+auto locked(R (E::*fn)(Args...)) {
+    return [fn](E& e, Args... args) -> R {
+        auto guard = e.lock();
+        return (e.*fn)(std::forward<Args>(args)...);
+    };
+}
+
+template <class R, class E, class... Args>
+auto locked(R (E::*fn)(Args...) const) {
+    return [fn](const E& e, Args... args) -> R {
+        auto guard = e.lock();
+        return (e.*fn)(std::forward<Args>(args)...);
+    };
+}
+
+template <class Engine>
+static void bind_engine(py::module_& m, const char* name) {
+    using E = PyEngine<Engine>;
+    py::class_<E>(m, name)
+        .def(py::init<double, double, size_t>(),
+             py::arg("tick_size") = kDefaultTickSize,
+             py::arg("lot_size") = kDefaultLotSize,
+             py::arg("ladder_levels") = kDefaultLadderLevels)
+        .def_property_readonly("tick_size", locked([](const E& e) {
+            return e.instrument().tick_size;
+        }))
+        .def_property_readonly("lot_size", locked([](const E& e) {
+            return e.instrument().lot_size;
+        }))
+        // string ids are mapped onto engine ids here; integer ids below
+        // 2**63 go straight to the engine without touching the map
+        .def("insert", locked(&E::insert_str))
+        .def("insert", locked([](E& e, OrderId order_id, Side side, double price,
+                                 double size, int64_t timestamp) {
+            return e.insert(E::numeric(order_id), side, e.ticks(price),
+                            e.lots(size), timestamp);
+        }))
+        .def("insert_ticks", locked(&E::insert_ticks_str))
+        .def("insert_ticks", locked([](E& e, OrderId order_id, Side side,
+                                       int64_t price_ticks, int64_t size_lots,
+                                       int64_t timestamp) {
+            return e.insert(E::numeric(order_id), side, price_ticks, size_lots,
+                            timestamp);
+        }))
+        .def("cancel", locked(&E::cancel_str))
+        .def("cancel", locked([](E& e, OrderId order_id) {
+            return e.engine.cancel(E::numeric(order_id));
+        }))
+        .def("amend", locked(&E::amend_str))
+        .def("amend", locked([](E& e, OrderId order_id, double size) {
+            return e.engine.amend(E::numeric(order_id), e.lots(size));
+        }))
+        .def("replace", locked(&E::replace_str))
+        .def("replace", locked([](E& e, OrderId order_id, OrderId new_order_id,
+                                  double price, double size, int64_t timestamp) {
+            return e.replace(E::numeric(order_id), E::numeric(new_order_id),
+                             e.ticks(price), e.lots(size), timestamp);
+        }))
+        .def("apply_batch", locked(&E::apply_batch), py::arg("ops"))
+        // numeric-id hot path: fills stay in the engine's buffer and are
+        // read through last_fills or last_fills_view, so nothing is built
+        // per fill
+        .def("submit", locked(&E::submit), py::arg("order_id"), py::arg("side"),
+             py::arg("price_ticks"), py::arg("size_lots"), py::arg("timestamp"),
+             py::arg("order_type") = OrderType::LIMIT)
+        .def("submit_replace", locked(&E::submit_replace), py::arg("order_id"),
+             py::arg("new_order_id"), py::arg("price_ticks"), py::arg("size_lots"),
+             py::arg("timestamp"), py::arg("order_type") = OrderType::LIMIT)
+        // TICK_FILL_DTYPE copy of the last insert or replace's fills, the
+        // caller's to keep. without a base, numpy copies the buffer.
+        .def_property_readonly("last_fills", locked([](const E& e) {
+            const auto& fills = e.engine.fills();
+            return py::array_t<Fill>(static_cast<py::ssize_t>(fills.size()),
+                                     fills.data());
+        }))
+        // the same fills without the copy, as a read-only view. later calls
+        // refill the engine's buffer, not the view's: an array keeps the
+        // fills it was taken with for as long as python holds it.
+        .def("last_fills_view", locked(&E::fills_view))
+        .def("reserve_fills", locked([](E& e, size_t n) {
+            e.detach_fills();
+            e.engine.reserve_fills(n);
+        }), py::arg("n"))
+        // native insert/cancel timers, off until timing is set
+        .def_property("timing",
+                      locked([](const E& e) { return e.engine.timing(); }),
+                      locked([](E& e, bool on) { e.engine.set_timing(on); }))
+        .def("latency_stats", locked([](const E& e) {
+            return std::map<std::string, LatencyStats>{
+                {"insert", latency_stats(e.engine.insert_latency())},
+                {"cancel", latency_stats(e.engine.cancel_latency())}};
+        }))
+        .def("reset_latency", locked([](E& e) { e.engine.reset_latency(); }))
+        .def("reserve", locked([](E& e, size_t n) { e.engine.reserve(n); }))
+        .def("__contains__", locked([](const E& e, const std::string& order_id) {
+            return e.ids.lookup(order_id) != 0;
+        }))
+        .def("__contains__", locked([](const E& e, OrderId order_id) {
+            return e.engine.contains(order_id);
+        }))
+        .def("__len__", locked([](const E& e) { return e.engine.order_count(); }))
+        // every resting order in queue order, the market depth and the
+        // string ids as bytes, for a file or a redis key; restore() takes
+        // them back on an engine with the same grid
+        .def("snapshot", locked(&E::snapshot))
+        .def("restore", locked(&E::restore), py::arg("data"))
+        // aggregated exchange depth, kept apart from our own orders
+        .def("apply_l2_delta", locked([](E& e, Side side, double price, double qty) {
+            if (qty < 0) {
+                throw std::invalid_argument("Quantity cannot be negative");
+            }
+            e.engine.apply_l2_delta(side, e.ticks(price), e.instrument().to_lots(qty));
+        }), py::arg("side"), py::arg("price"), py::arg("qty"))
+        .def("apply_depth_update", locked(&E::apply_depth_update),
+             py::arg("first_update_id"), py::arg("final_update_id"),
+             py::arg("bids"), py::arg("asks"))
+        .def("reset_market", locked([](E& e, int64_t last_update_id) {
+            e.engine.reset_market(last_update_id);
+        }), py::arg("last_update_id") = 0)
+        .def("market_snapshot", locked([](const E& e, size_t depth) {
+            const size_t limit = depth == 0 ? SIZE_MAX : depth;
+            const DepthBook& market = e.engine.market();
+            return py::make_tuple(
+                depth_levels(market, e.instrument(), Side::BUY, limit),
+                depth_levels(market, e.instrument(), Side::SELL, limit));
+        }), py::arg("depth") = 0)
+        .def("market_qty", locked([](const E& e, Side side, double price) {
+            return e.instrument().from_lots(
+                e.engine.market().qty_at(side, e.ticks(price)));
+        }))
+        .def_property_readonly("market_best_bid", locked([](const E& e) {
+            return e.instrument().from_ticks(e.engine.market().best_bid());
+        }))
+        .def_property_readonly("market_best_ask", locked([](const E& e) {
+            return e.instrument().from_ticks(e.engine.market().best_ask());
+        }))
+        .def_property_readonly("last_update_id", locked([](const E& e) {
+            return e.engine.market().last_update_id();
+        }))
+        // read-only views of our resting orders and the market depth,
+        // written into caller buffers so features skip building lists
+        .def_property_readonly("best_bid", locked([](const E& e) {
+            return e.instrument().from_ticks(e.engine.best_bid());
+        }))
+        .def_property_readonly("best_ask", locked([](const E& e) {
+            return e.instrument().from_ticks(e.engine.best_ask());
+        }))
+        .def("depth", locked([](const E& e, Side side, DepthArray<double> out,
+                                bool cumulative) {
+            return e.depth_into(side, out, cumulative, false);
+        }), py::arg("side"), py::arg("out").noconvert(), py::arg("cumulative") = false)
+        .def("depth", locked([](const E& e, Side side, DepthArray<int64_t> out,
+                                bool cumulative) {
+            return e.depth_into(side, out, cumulative, false);
+        }), py::arg("side"), py::arg("out").noconvert(), py::arg("cumulative") = false)
+        .def("market_depth", locked([](const E& e, Side side, DepthArray<double> out,
+                                       bool cumulative) {
+            return e.depth_into(side, out, cumulative, true);
+        }), py::arg("side"), py::arg("out").noconvert(), py::arg("cumulative") = false)
+        .def("market_depth", locked([](const E& e, Side side, DepthArray<int64_t> out,
+                                       bool cumulative) {
+            return e.depth_into(side, out, cumulative, true);
+        }), py::arg("side"), py::arg("out").noconvert(), py::arg("cumulative") = false)
+        .def("cumulative_volume", locked([](const E& e, Side side, size_t levels) {
+            return e.cumulative_volume(side, levels, false);
+        }), py::arg("side"), py::arg("levels") = 0)
+        .def("market_cumulative_volume", locked([](const E& e, Side side,
+                                                   size_t levels) {
+            return e.cumulative_volume(side, levels, true);
+        }), py::arg("side"), py::arg("levels") = 0)
+        .def("queue_position", locked([](const E& e, const std::string& order_id) {
+            return e.queue_position(e.ids.lookup(order_id));
+        }))
+        .def("queue_position", locked([](const E& e, OrderId order_id) {
+            return e.queue_position(E::numeric(order_id));
+        }))
+        // one feature update from the market depth, after each book change
+        .def("update_features", locked([](const E& e, FeaturePipeline& features) {
+            features.on_book(e.engine.market(), e.instrument());
+        }), py::arg("features"));
+}
+
 PYBIND11_MODULE(match_engine, m) {
     py::enum_<Side>(m, "Side")
         .value("BUY", Side::BUY)
         .value("SELL", Side::SELL)
         .export_values();
-    
-    py::class_<Fill>(m, "Fill")
-        .def_readonly("taker_order_id", &Fill::taker_order_id)
-        .def_readonly("maker_order_id", &Fill::maker_order_id)
-        .def_readonly("price", &Fill::price)
-        .def_readonly("size", &Fill::size)
-        .def_readonly("timestamp", &Fill::timestamp);
-    
-    py::class_<MatchEngine>(m, "MatchEngine")
-        .def(py::init<>())
-        .def("insert", &MatchEngine::insert)
-        .def("cancel", &MatchEngine::cancel);
-} 
\ No newline at end of file
+
+    // what happens to an order that can't rest is in order_type.hpp
+    py::enum_<OrderType>(m, "OrderType")
+        .value("LIMIT", OrderType::LIMIT)
+        .value("POST_ONLY", OrderType::POST_ONLY)
+        .value("IOC", OrderType::IOC)
+        .value("FOK", OrderType::FOK)
+        .value("MARKET", OrderType::MARKET);
+
+    py::enum_<DepthSync>(m, "DepthSync")
+        .value("APPLIED", DepthSync::APPLIED)
+        .value("STALE", DepthSync::STALE)
+        .value("GAP", DepthSync::GAP);
+
+    py::enum_<OpType>(m, "OpType")
+        .value("INSERT", OpType::INSERT)
+        .value("CANCEL", OpType::CANCEL)
+        .value("AMEND", OpType::AMEND);
+
+    PYBIND11_NUMPY_DTYPE(BatchOp, op, side, price, size, timestamp, order_id);
+    PYBIND11_NUMPY_DTYPE(BatchFill, op_index, taker_id, maker_id, price, size,
+                         timestamp);
+    // the engine's own fill records, named like the Fill attributes
+    PYBIND11_NUMPY_DTYPE_EX(Fill, taker_order_id, "taker_id", maker_order_id,
+                            "maker_id", price, "price_ticks", size, "size_lots",
+                            timestamp, "timestamp");
+    // side uses 0 = BUY, 1 = SELL to match Side
+    m.attr("OP_DTYPE") = py::dtype::of<BatchOp>();
+    m.attr("FILL_DTYPE") = py::dtype::of<BatchFill>();
+    m.attr("TICK_FILL_DTYPE") = py::dtype::of<Fill>();
+
+    py::class_<PyFill>(m, "Fill")
+        .def_readonly("taker_order_id", &PyFill::taker_order_id)
+        .def_readonly("maker_order_id", &PyFill::maker_order_id)
+        .def_readonly("taker_id", &PyFill::taker_id)
+        .def_readonly("maker_id", &PyFill::maker_id)
+        .def_readonly("price", &PyFill::price)
+        .def_readonly("size", &PyFill::size)
+        .def_readonly("price_ticks", &PyFill::price_ticks)
+        .def_readonly("size_lots", &PyFill::size_lots)
+        .def_readonly("timestamp", &PyFill::timestamp);
+
+    bind_engine<MapMatchEngine>(m, "MapMatchEngine");
+    bind_engine<LadderMatchEngine>(m, "LadderMatchEngine");
+    // plain MatchEngine follows the backend picked in setup.py
+    m.attr("MatchEngine") = m.attr(
+        std::is_same_v<MatchEngine, LadderMatchEngine> ? "LadderMatchEngine"
+                                                       : "MapMatchEngine");
+
+    bind_feature_pipeline(m);
+    bind_depth_replay(m);
+    bind_quote_engine(m);
+    bind_shm_ring(m);
+    bind_shard_runtime(m);
+    bind_queue_fill(m);
+    bind_depth_decode(m);
+
+    // batched fill-probability scoring for FillProbabilityModel.predict_batch
+    m.def(
+        "logistic_proba",
+        [](py::array_t<double, py::array::c_style | py::array::forcecast> features,
+           py::array_t<double, py::array::c_style | py::array::forcecast> weights,
+           double intercept) {
+            if (features.ndim() != 2) {
+                throw std::invalid_argument("Features must be a 2-d array");
+            }
+            const size_t rows = static_cast<size_t>(features.shape(0));
+            const size_t cols = static_cast<size_t>(features.shape(1));
+            if (weights.ndim() != 1 || static_cast<size_t>(weights.shape(0)) != cols) {
+                throw std::invalid_argument("Expected one weight per feature column");
+            }
+            py::array_t<double> out(static_cast<py::ssize_t>(rows));
+            logistic_scores(features.data(), rows, cols, weights.data(), intercept,
+                            out.mutable_data());
+            return out;
+        },
+        py::arg("features"), py::arg("weights"), py::arg("intercept") = 0.0);
+}
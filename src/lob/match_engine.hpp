@@ -0,0 +1,966 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "depth_book.hpp"
+#include "latency_histogram.hpp"
+#include "order_index.hpp"
+#include "order_pool.hpp"
+#include "order_type.hpp"
+#include "price_ladder.hpp"
+#include "side.hpp"
+
+// forward declarations
+struct Order;
+struct Fill;
+
+// binance quotes prices and quantities with at most 8 decimals
+constexpr double kDefaultTickSize = 1e-8;
+constexpr double kDefaultLotSize = 1e-8;
+
+// per-symbol price/quantity grid, used to convert exchange units
+// into the integer ticks and lots the engine works in
+struct Instrument {
+    double tick_size;
+    double lot_size;
+
+    Instrument(double tick = kDefaultTickSize, double lot = kDefaultLotSize)
+        : tick_size(tick), lot_size(lot) {
+        if (!(tick_size > 0) || !std::isfinite(tick_size)) {
+            throw std::invalid_argument("Tick size must be positive");
+        }
+        if (!(lot_size > 0) || !std::isfinite(lot_size)) {
+            throw std::invalid_argument("Lot size must be positive");
+        }
+    }
+
+    int64_t to_ticks(double price) const {
+        return to_units(price, tick_size, "Price is not a multiple of tick size");
+    }
+
+    int64_t to_lots(double size) const {
+        return to_units(size, lot_size, "Size is not a multiple of lot size");
+    }
+
+    double from_ticks(int64_t ticks) const {
+        return static_cast<double>(ticks) * tick_size;
+    }
+
+    double from_lots(int64_t lots) const {
+        return static_cast<double>(lots) * lot_size;
+    }
+
+private:
+    static constexpr double kGridUlps = 64 * std::numeric_limits<double>::epsilon();
+
+    static int64_t to_units(double value, double unit, const char* error) {
+        double scaled = value / unit;
+        if (!std::isfinite(scaled) || std::fabs(scaled) >= 9.2e18) {
+            throw std::invalid_argument("Value out of range for tick/lot grid");
+        }
+        double rounded = std::round(scaled);
+        // tolerate the few ulps of representation error a decimal string
+        // picks up on its way here, reject anything further off the grid
+        // so distinct prices never share a level. the bound scales with
+        // the value's ulp, not its size: a half tick at 60000 is off grid.
+        double tolerance = kGridUlps * std::max(1.0, std::fabs(scaled));
+        if (std::fabs(scaled - rounded) > tolerance) {
+            throw std::invalid_argument(error);
+        }
+        return static_cast<int64_t>(rounded);
+    }
+};
+
+// numeric order id, 0 is reserved as "no order"
+using OrderId = uint64_t;
+
+// represents a single order, price in ticks and size in lots.
+// resting orders are linked into their level's FIFO through prev/next.
+struct Order {
+    OrderId order_id;
+    Side side;
+    int64_t price;
+    int64_t size;
+    int64_t timestamp;
+    Order* prev = nullptr;
+    Order* next = nullptr;
+
+    Order(OrderId id, Side s, int64_t p, int64_t sz, int64_t ts)
+        : order_id(id), side(s), price(p), size(sz), timestamp(ts) {}
+};
+
+// represents a fill event, price in ticks and size in lots. plain 8-byte
+// fields so the engine's fill buffer can be viewed as a numpy record array.
+struct Fill {
+    OrderId taker_order_id;
+    OrderId maker_order_id;
+    int64_t price;
+    int64_t size;
+    int64_t timestamp;
+
+    Fill(OrderId taker, OrderId maker, int64_t p, int64_t sz, int64_t ts)
+        : taker_order_id(taker), maker_order_id(maker),
+          price(p), size(sz), timestamp(ts) {}
+};
+
+// price level in the order book, an intrusive doubly-linked FIFO so
+// removing any order is O(1) and never shifts the rest of the queue
+struct PriceLevel {
+    Order* head = nullptr;
+    Order* tail = nullptr;
+
+    bool empty() const { return head == nullptr; }
+
+    void push_back(Order* order) {
+        order->prev = tail;
+        order->next = nullptr;
+        if (tail) {
+            tail->next = order;
+        } else {
+            head = order;
+        }
+        tail = order;
+    }
+
+    void remove(Order* order) {
+        if (order->prev) {
+            order->prev->next = order->next;
+        } else {
+            head = order->next;
+        }
+        if (order->next) {
+            order->next->prev = order->prev;
+        } else {
+            tail = order->prev;
+        }
+        order->prev = nullptr;
+        order->next = nullptr;
+    }
+};
+
+// one side of the book as a red-black tree of levels
+template <class Compare>
+class MapSide {
+public:
+    // the tree grows on demand, capacity is only a hint for array backends
+    explicit MapSide(size_t /*capacity*/ = 0) {}
+
+    bool empty() const { return levels.empty(); }
+    size_t level_count() const { return levels.size(); }
+
+    // precondition: !empty()
+    int64_t best_price() const { return levels.begin()->first; }
+    PriceLevel& best_level() { return levels.begin()->second; }
+
+    PriceLevel* find(int64_t price) {
+        auto it = levels.find(price);
+        return it == levels.end() ? nullptr : &it->second;
+    }
+
+    PriceLevel& get_or_create(int64_t price) { return levels[price]; }
+    void erase(int64_t price) { levels.erase(price); }
+    void erase_best() { levels.erase(levels.begin()); }
+
+    // visit levels from best to worst until fn returns false
+    template <class Fn>
+    void for_each(Fn&& fn) {
+        for (auto& [price, level] : levels) {
+            if (!fn(price, level)) return;
+        }
+    }
+
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& [price, level] : levels) {
+            if (!fn(price, level)) return;
+        }
+    }
+
+private:
+    std::map<int64_t, PriceLevel, Compare> levels;
+};
+
+// one side on a price ladder while its levels fit in one. a price that
+// would stretch the ladder past its largest window, such as bids a dollar
+// apart on the default 1e-8 grid, moves the side's levels into a MapSide
+// instead of failing; the side goes back to the ladder once it empties.
+template <bool Descending>
+class LadderSide {
+public:
+    explicit LadderSide(size_t capacity = 4096) : ladder_(capacity) {}
+
+    bool empty() const { return spilled_ ? map_.empty() : ladder_.empty(); }
+    size_t level_count() const {
+        return spilled_ ? map_.level_count() : ladder_.level_count();
+    }
+    bool spilled() const { return spilled_; }
+
+    // precondition: !empty()
+    int64_t best_price() const {
+        return spilled_ ? map_.best_price() : ladder_.best_price();
+    }
+    PriceLevel& best_level() {
+        return spilled_ ? map_.best_level() : ladder_.best_level();
+    }
+
+    PriceLevel* find(int64_t price) {
+        return spilled_ ? map_.find(price) : ladder_.find(price);
+    }
+
+    PriceLevel& get_or_create(int64_t price) {
+        if (!spilled_) {
+            if (ladder_.fits(price)) return ladder_.get_or_create(price);
+            spill();
+        }
+        return map_.get_or_create(price);
+    }
+
+    void erase(int64_t price) {
+        if (!spilled_) {
+            ladder_.erase(price);
+            return;
+        }
+        map_.erase(price);
+        spilled_ = !map_.empty();
+    }
+
+    void erase_best() { erase(best_price()); }
+
+    // visit levels from best to worst until fn returns false
+    template <class Fn>
+    void for_each(Fn&& fn) {
+        if (spilled_) {
+            map_.for_each(fn);
+        } else {
+            ladder_.for_each(fn);
+        }
+    }
+
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        if (spilled_) {
+            map_.for_each(fn);
+        } else {
+            ladder_.for_each(fn);
+        }
+    }
+
+private:
+    using Compare =
+        std::conditional_t<Descending, std::greater<int64_t>, std::less<int64_t>>;
+
+    PriceLadder<PriceLevel, Descending> ladder_;
+    MapSide<Compare> map_;
+    bool spilled_ = false;
+
+    // levels are plain head/tail pairs, so copying one moves its queue
+    void spill() {
+        ladder_.for_each([this](int64_t price, PriceLevel& level) {
+            map_.get_or_create(price) = level;
+            return true;
+        });
+        ladder_.clear();
+        spilled_ = true;
+    }
+};
+
+// std::map sides, ask book ascending and bid book descending
+struct MapBackend {
+    using BidBook = MapSide<std::greater<int64_t>>;
+    using AskBook = MapSide<std::less<int64_t>>;
+};
+
+// flat tick-indexed arrays around the mid, see price_ladder.hpp, with the
+// map as a fallback for a side whose prices spread too far apart
+struct LadderBackend {
+    using BidBook = LadderSide<true>;
+    using AskBook = LadderSide<false>;
+};
+
+// default number of tick slots per side for array backends
+constexpr size_t kDefaultLadderLevels = 4096;
+
+// binary engine snapshot: a SnapshotHeader, then one SnapshotOrder per
+// resting order (bids best to worst, then asks, each level in queue order),
+// then the market's bid and ask levels best first as SnapshotLevels. the
+// fields are fixed width in host byte order, so a snapshot loads back on
+// any machine of the same endianness without parsing text.
+constexpr char kSnapshotMagic[8] = {'M', 'M', 'E', 'N', 'G', 'S', 'N', 'P'};
+constexpr uint32_t kSnapshotVersion = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    // the grid prices and sizes below are counted on
+    double tick_size;
+    double lot_size;
+    int64_t last_update_id;
+    uint64_t orders;
+    uint64_t market_bids;
+    uint64_t market_asks;
+};
+
+struct SnapshotOrder {
+    OrderId order_id;
+    int64_t price;
+    int64_t size;
+    int64_t timestamp;
+    uint8_t side;
+    uint8_t reserved[7];
+};
+
+struct SnapshotLevel {
+    int64_t price;
+    int64_t qty;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader layout");
+static_assert(sizeof(SnapshotOrder) == 40, "SnapshotOrder layout");
+static_assert(sizeof(SnapshotLevel) == 16, "SnapshotLevel layout");
+
+// fills the engine's buffer holds before it first has to grow
+constexpr size_t kDefaultFillCapacity = 256;
+
+template <class Backend>
+class BasicMatchEngine {
+private:
+    Instrument instrument_;
+    // the sides' starting ladder size, kept so restore can build fresh ones
+    size_t ladder_levels_;
+    // price -> orders at that price
+    typename Backend::BidBook bids;
+    typename Backend::AskBook asks;
+    // recycled storage for every order the engine holds
+    ObjectPool<Order> pool_;
+    // order_id -> resting order
+    OrderIndex<Order> order_map;
+    // aggregated exchange depth, never matched against our orders
+    DepthBook market_;
+    // fills of the last insert or replace, cleared and refilled by each
+    // call so matching reuses the same storage instead of returning a
+    // fresh vector every time
+    std::vector<Fill> fills_;
+    bool timing_ = false;
+    LatencyHistogram insert_latency_;
+    LatencyHistogram cancel_latency_;
+
+    void release(Order* order) {
+        order_map.erase(order->order_id);
+        pool_.destroy(order);
+    }
+
+    // the book a side S order matches against
+    template <Side S>
+    auto& opposite_book() {
+        if constexpr (S == Side::BUY) {
+            return asks;
+        } else {
+            return bids;
+        }
+    }
+
+    template <Side S>
+    const auto& opposite_book() const {
+        if constexpr (S == Side::BUY) {
+            return asks;
+        } else {
+            return bids;
+        }
+    }
+
+    // whether a maker at price is inside a side S taker's limit
+    template <Side S>
+    static bool within(int64_t price, int64_t limit) {
+        if constexpr (S == Side::BUY) {
+            return price <= limit;
+        } else {
+            return price >= limit;
+        }
+    }
+
+    // the one matching loop, instantiated per side and order type: the side
+    // fixes the book taken from and the direction prices compare in, the
+    // type whether there is a price limit at all
+    template <Side S, class Type>
+    void match(Order& order) {
+        if (order.size <= 0) {
+            throw std::invalid_argument("Order size must be positive");
+        }
+
+        auto& book = opposite_book<S>();
+        while (!book.empty() && order.size > 0) {
+            int64_t price = book.best_price();
+            if constexpr (Type::kPriceLimited) {
+                if (!within<S>(price, order.price)) break;
+            }
+
+            auto& level = book.best_level();
+            Order* maker = level.head;
+
+            while (maker && order.size > 0) {
+                Order* next = maker->next;
+
+                int64_t match_size = std::min(order.size, maker->size);
+                fills_.emplace_back(
+                    order.order_id,
+                    maker->order_id,
+                    price,
+                    match_size,
+                    order.timestamp
+                );
+
+                order.size -= match_size;
+                maker->size -= match_size;
+
+                if (maker->size <= 0) {
+                    level.remove(maker);
+                    release(maker);
+                }
+                maker = next;
+            }
+
+            if (level.empty()) {
+                book.erase_best();
+            }
+        }
+    }
+
+    // whether order would match anything on entry
+    template <Side S>
+    bool crosses(const Order& order) const {
+        const auto& book = opposite_book<S>();
+        return !book.empty() && within<S>(book.best_price(), order.price);
+    }
+
+    // whether the makers inside order's limit add up to its whole size,
+    // walked best first and stopped as soon as they do
+    template <Side S, class Type>
+    bool fillable(const Order& order) const {
+        int64_t left = order.size;
+        opposite_book<S>().for_each([&](int64_t price, const PriceLevel& level) {
+            if constexpr (Type::kPriceLimited) {
+                if (!within<S>(price, order.price)) return false;
+            }
+            for (const Order* o = level.head; o && left > 0; o = o->next) {
+                left -= o->size;
+            }
+            return left > 0;
+        });
+        return left <= 0;
+    }
+
+    // matches order as its type allows, true if a remainder should rest
+    template <Side S, class Type>
+    bool enter(Order& order) {
+        if constexpr (!Type::kTakes) {
+            if (crosses<S>(order)) return false;
+        } else {
+            if constexpr (Type::kAllOrNone) {
+                if (!fillable<S, Type>(order)) return false;
+            }
+            match<S, Type>(order);
+        }
+        return Type::kRests && order.size > 0;
+    }
+
+    void add_to_book(Order* order) {
+        if (!order) {
+            throw std::invalid_argument("Order cannot be null");
+        }
+        if (order->size <= 0) {
+            throw std::invalid_argument("Order size must be positive");
+        }
+        if (order->price <= 0) {
+            throw std::invalid_argument("Order price must be positive");
+        }
+        if (order->order_id == 0) {
+            throw std::invalid_argument("Order ID cannot be zero");
+        }
+
+        link(order);
+        order_map.insert(order->order_id, order);
+    }
+
+    void link(Order* order) {
+        if (order->side == Side::BUY) {
+            bids.get_or_create(order->price).push_back(order);
+        } else {
+            asks.get_or_create(order->price).push_back(order);
+        }
+    }
+
+    template <class Book>
+    static void unlink_from(Book& book, Order* order) {
+        PriceLevel* level = book.find(order->price);
+        if (!level) return;
+        level->remove(order);
+        if (level->empty()) {
+            book.erase(order->price);
+        }
+    }
+
+    void unlink(Order* order) {
+        if (order->side == Side::BUY) {
+            unlink_from(bids, order);
+        } else {
+            unlink_from(asks, order);
+        }
+    }
+
+    // takes ownership of a pooled order that is not in the book yet
+    template <class Type>
+    const std::vector<Fill>& match_and_rest(Order* order) {
+        try {
+            bool rest = order->side == Side::BUY ? enter<Side::BUY, Type>(*order)
+                                                 : enter<Side::SELL, Type>(*order);
+
+            if (rest) {
+                add_to_book(order);
+            } else {
+                pool_.destroy(order);
+            }
+
+            return fills_;
+        } catch (const std::exception& e) {
+            if (!order_map.contains(order->order_id)) {
+                pool_.destroy(order);
+            }
+            throw std::runtime_error(std::string("Error in insert: ") + e.what());
+        }
+    }
+
+    // a market order's price is never read, so it is not checked either
+    template <class Type>
+    static void validate(OrderId order_id, int64_t price, int64_t size,
+                         int64_t timestamp) {
+        if (order_id == 0) {
+            throw std::invalid_argument("Order ID cannot be zero");
+        }
+        if (Type::kPriceLimited && price <= 0) {
+            throw std::invalid_argument("Price must be positive");
+        }
+        if (size <= 0) {
+            throw std::invalid_argument("Size must be positive");
+        }
+        if (timestamp < 0) {
+            throw std::invalid_argument("Timestamp must be non-negative");
+        }
+    }
+
+public:
+    explicit BasicMatchEngine(Instrument instrument = Instrument(),
+                              size_t ladder_levels = kDefaultLadderLevels)
+        : instrument_(instrument),
+          ladder_levels_(ladder_levels),
+          bids(ladder_levels),
+          asks(ladder_levels) {
+        fills_.reserve(kDefaultFillCapacity);
+    }
+
+    // orders live in the engine's pool, so engines are move-only
+    BasicMatchEngine(const BasicMatchEngine&) = delete;
+    BasicMatchEngine& operator=(const BasicMatchEngine&) = delete;
+    BasicMatchEngine(BasicMatchEngine&&) = default;
+    BasicMatchEngine& operator=(BasicMatchEngine&&) = default;
+
+    const Instrument& instrument() const { return instrument_; }
+
+    // when on, insert and cancel time themselves into the histograms below.
+    // off by default so replays and backtests don't pay for the clock.
+    void set_timing(bool on) { timing_ = on; }
+    bool timing() const { return timing_; }
+    const LatencyHistogram& insert_latency() const { return insert_latency_; }
+    const LatencyHistogram& cancel_latency() const { return cancel_latency_; }
+    void reset_latency() {
+        insert_latency_.reset();
+        cancel_latency_.reset();
+    }
+
+    // price in ticks, size in lots. the fills live in the engine's buffer
+    // and stay valid until the next insert or replace. Type is one of the
+    // tags in order_type.hpp, e.g. insert<PostOnlyOrder>(...).
+    template <class Type = LimitOrder>
+    const std::vector<Fill>& insert(OrderId order_id, Side side,
+                                    int64_t price, int64_t size,
+                                    int64_t timestamp) {
+        ScopedLatency timer(timing_ ? &insert_latency_ : nullptr);
+        fills_.clear();
+        validate<Type>(order_id, price, size, timestamp);
+        if (order_map.contains(order_id)) {
+            throw std::invalid_argument("Duplicate order ID");
+        }
+
+        return match_and_rest<Type>(
+            pool_.create(order_id, side, price, size, timestamp));
+    }
+
+    bool cancel(OrderId order_id) {
+        ScopedLatency timer(timing_ ? &cancel_latency_ : nullptr);
+        if (order_id == 0) {
+            throw std::invalid_argument("Order ID cannot be zero");
+        }
+
+        Order* order = order_map.find(order_id);
+        if (!order) {
+            return false;
+        }
+
+        unlink(order);
+        release(order);
+        return true;
+    }
+
+    // change the resting size in place. shrinking keeps queue priority,
+    // growing sends the order to the back of its level like an exchange.
+    bool amend(OrderId order_id, int64_t size) {
+        if (order_id == 0) {
+            throw std::invalid_argument("Order ID cannot be zero");
+        }
+        if (size <= 0) {
+            throw std::invalid_argument("Size must be positive");
+        }
+
+        Order* order = order_map.find(order_id);
+        if (!order) {
+            return false;
+        }
+
+        if (size > order->size) {
+            unlink(order);
+            order->size = size;
+            link(order);
+        } else {
+            order->size = size;
+        }
+        return true;
+    }
+
+    // cancel order_id and enter a new order in its place, which may match.
+    // the new order always joins the back of its level. fills and Type as
+    // for insert; a new order that is dropped leaves neither order resting.
+    template <class Type = LimitOrder>
+    const std::vector<Fill>& replace(OrderId order_id, OrderId new_order_id,
+                                     int64_t price, int64_t size,
+                                     int64_t timestamp) {
+        fills_.clear();
+        validate<Type>(new_order_id, price, size, timestamp);
+
+        Order* order = order_map.find(order_id);
+        if (!order) {
+            throw std::invalid_argument("Unknown order ID");
+        }
+        if (new_order_id != order_id && order_map.contains(new_order_id)) {
+            throw std::invalid_argument("Duplicate order ID");
+        }
+
+        // reuse the record, the id only changes when asked to
+        unlink(order);
+        order_map.erase(order_id);
+        order->order_id = new_order_id;
+        order->price = price;
+        order->size = size;
+        order->timestamp = timestamp;
+
+        return match_and_rest<Type>(order);
+    }
+
+    // fills of the last insert or replace
+    const std::vector<Fill>& fills() const { return fills_; }
+
+    // size the fill buffer so a sweep of up to n makers doesn't grow it
+    void reserve_fills(size_t n) { fills_.reserve(n); }
+
+    // trade the fill buffer for other, so a reader can keep the current
+    // fills past the next insert without copying them
+    void swap_fills(std::vector<Fill>& other) { fills_.swap(other); }
+
+    bool contains(OrderId order_id) const { return order_map.contains(order_id); }
+
+    size_t order_count() const { return order_map.size(); }
+
+    // size the pool and index so n resting orders need no further allocation
+    void reserve(size_t n) {
+        pool_.reserve(n);
+        order_map.reserve(n);
+    }
+
+    // set one aggregated market level from a depth diff, qty 0 deletes it.
+    // market levels live beside our own orders, so applying a diff costs
+    // O(levels changed) and never touches resting orders.
+    void apply_l2_delta(Side side, int64_t price, int64_t qty) {
+        if (price <= 0) {
+            throw std::invalid_argument("Price must be positive");
+        }
+        if (qty < 0) {
+            throw std::invalid_argument("Quantity cannot be negative");
+        }
+        market_.set(side, price, qty);
+    }
+
+    // check a diff's U/u ids before applying its levels, see DepthBook
+    DepthSync begin_depth_update(int64_t first_update_id, int64_t final_update_id) {
+        return market_.begin_update(first_update_id, final_update_id);
+    }
+
+    // accept the next update after a GAP without a fresh snapshot
+    void set_last_update_id(int64_t id) { market_.set_last_update_id(id); }
+
+    // drop all market levels, e.g. before loading a fresh snapshot
+    void reset_market(int64_t last_update_id = 0) { market_.clear(last_update_id); }
+
+    const DepthBook& market() const { return market_; }
+
+    // best resting prices of our own orders in ticks, 0 if the side is empty
+    int64_t best_bid() const { return bids.empty() ? 0 : bids.best_price(); }
+    int64_t best_ask() const { return asks.empty() ? 0 : asks.best_price(); }
+
+    size_t level_count(Side side) const {
+        return side == Side::BUY ? bids.level_count() : asks.level_count();
+    }
+
+    // visit up to depth resting levels from best to worst as
+    // fn(price, qty, orders). a level's qty is summed from its queue, so
+    // this costs O(orders) over the levels visited.
+    template <class Fn>
+    void for_each_level(Side side, size_t depth, Fn&& fn) const {
+        if (side == Side::BUY) {
+            visit_levels(bids, depth, fn);
+        } else {
+            visit_levels(asks, depth, fn);
+        }
+    }
+
+    // what rests ahead of an order at its own price
+    struct QueuePosition {
+        size_t orders_ahead;
+        int64_t qty_ahead;
+    };
+
+    // false if order_id isn't resting
+    bool queue_position(OrderId order_id, QueuePosition& out) const {
+        const Order* order = order_map.find(order_id);
+        if (!order) return false;
+        out = QueuePosition{0, 0};
+        for (const Order* ahead = order->prev; ahead; ahead = ahead->prev) {
+            ++out.orders_ahead;
+            out.qty_ahead += ahead->size;
+        }
+        return true;
+    }
+
+    // appends the engine's resting orders, in queue order, and its market
+    // depth to out, see SnapshotHeader. the fill buffer and latency
+    // histograms are not part of the state.
+    void snapshot(std::string& out) const {
+        SnapshotHeader header{};
+        std::memcpy(header.magic, kSnapshotMagic, sizeof header.magic);
+        header.version = kSnapshotVersion;
+        header.tick_size = instrument_.tick_size;
+        header.lot_size = instrument_.lot_size;
+        header.last_update_id = market_.last_update_id();
+        header.orders = order_map.size();
+        header.market_bids = market_.level_count(Side::BUY);
+        header.market_asks = market_.level_count(Side::SELL);
+
+        size_t start = out.size();
+        out.resize(start + snapshot_bytes(header));
+        char* cursor = &out[start];
+        cursor = put(cursor, header);
+        auto orders = [&cursor](int64_t, const PriceLevel& level) {
+            for (const Order* o = level.head; o; o = o->next) {
+                SnapshotOrder record{};
+                record.order_id = o->order_id;
+                record.price = o->price;
+                record.size = o->size;
+                record.timestamp = o->timestamp;
+                record.side = static_cast<uint8_t>(o->side);
+                cursor = put(cursor, record);
+            }
+            return true;
+        };
+        bids.for_each(orders);
+        asks.for_each(orders);
+        auto levels = [&cursor](int64_t price, int64_t qty) {
+            cursor = put(cursor, SnapshotLevel{price, qty});
+        };
+        market_.for_each(Side::BUY, SIZE_MAX, levels);
+        market_.for_each(Side::SELL, SIZE_MAX, levels);
+    }
+
+    std::string snapshot() const {
+        std::string out;
+        snapshot(out);
+        return out;
+    }
+
+    // bytes the snapshot at data takes up, so callers can keep their own
+    // data after it. throws std::invalid_argument if it is not a complete
+    // snapshot this build can read.
+    static size_t snapshot_size(const char* data, size_t size) {
+        return snapshot_bytes(read_header(data, size, nullptr));
+    }
+
+    // replaces every resting order and market level with the snapshot's
+    // and returns the bytes it took up. order_map is rebuilt as the orders
+    // are linked back, in the same queue order they were written in.
+    //
+    // the whole snapshot is checked before the engine is touched, so a
+    // truncated or malformed one, or one from another grid, throws
+    // std::invalid_argument and leaves the engine as it was. the book is
+    // then rebuilt in a scratch engine and moved in only once complete, so
+    // a failure part way through (bad_alloc) leaves it as it was too. fills
+    // and latency counters are not part of a snapshot and are kept.
+    size_t restore(const char* data, size_t size) {
+        SnapshotHeader header = read_header(data, size, &instrument_);
+        const char* cursor = data + sizeof(SnapshotHeader);
+        std::vector<SnapshotOrder> orders(header.orders);
+        std::vector<SnapshotLevel> levels(header.market_bids + header.market_asks);
+        if (!orders.empty()) {
+            std::memcpy(orders.data(), cursor, orders.size() * sizeof(SnapshotOrder));
+            cursor += orders.size() * sizeof(SnapshotOrder);
+        }
+        if (!levels.empty()) {
+            std::memcpy(levels.data(), cursor, levels.size() * sizeof(SnapshotLevel));
+        }
+        check_orders(orders);
+        for (const SnapshotLevel& level : levels) {
+            if (level.price <= 0 || level.qty <= 0) {
+                throw std::invalid_argument("Snapshot market level is invalid");
+            }
+        }
+
+        BasicMatchEngine scratch(instrument_, ladder_levels_);
+        scratch.market_.clear(header.last_update_id);
+        scratch.reserve(orders.size());
+        for (const SnapshotOrder& record : orders) {
+            scratch.add_to_book(scratch.pool_.create(
+                record.order_id, static_cast<Side>(record.side), record.price,
+                record.size, record.timestamp));
+        }
+        for (size_t i = 0; i < levels.size(); ++i) {
+            Side side = i < header.market_bids ? Side::BUY : Side::SELL;
+            scratch.market_.set(side, levels[i].price, levels[i].qty);
+        }
+
+        // the old orders go with the old pool, no need to unlink them
+        bids = std::move(scratch.bids);
+        asks = std::move(scratch.asks);
+        pool_ = std::move(scratch.pool_);
+        order_map = std::move(scratch.order_map);
+        market_ = std::move(scratch.market_);
+        return snapshot_bytes(header);
+    }
+
+private:
+    template <class Book, class Fn>
+    static void visit_levels(const Book& book, size_t depth, Fn& fn) {
+        size_t seen = 0;
+        book.for_each([&](int64_t price, const PriceLevel& level) {
+            if (seen++ == depth) return false;
+            int64_t qty = 0;
+            size_t orders = 0;
+            for (const Order* o = level.head; o; o = o->next) {
+                qty += o->size;
+                ++orders;
+            }
+            fn(price, qty, orders);
+            return true;
+        });
+    }
+
+    template <class T>
+    static char* put(char* out, const T& value) {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+
+    static size_t snapshot_bytes(const SnapshotHeader& header) {
+        return sizeof(SnapshotHeader) + header.orders * sizeof(SnapshotOrder) +
+               (header.market_bids + header.market_asks) * sizeof(SnapshotLevel);
+    }
+
+    // checks the header and that size covers every record it announces,
+    // and the grid too when instrument is given
+    static SnapshotHeader read_header(const char* data, size_t size,
+                                      const Instrument* instrument) {
+        SnapshotHeader header;
+        if (size < sizeof header) {
+            throw std::invalid_argument("Snapshot is truncated");
+        }
+        std::memcpy(&header, data, sizeof header);
+        if (std::memcmp(header.magic, kSnapshotMagic, sizeof header.magic) != 0) {
+            throw std::invalid_argument("Not a match engine snapshot");
+        }
+        if (header.version != kSnapshotVersion) {
+            throw std::invalid_argument("Unsupported snapshot version " +
+                                        std::to_string(header.version));
+        }
+        if (instrument && (header.tick_size != instrument->tick_size ||
+                           header.lot_size != instrument->lot_size)) {
+            throw std::invalid_argument("Snapshot grid does not match the engine's");
+        }
+        // compare counts against what is left before multiplying them, so a
+        // corrupt count cannot overflow into a size that looks complete
+        size_t left = size - sizeof header;
+        if (header.orders > left / sizeof(SnapshotOrder)) {
+            throw std::invalid_argument("Snapshot is truncated");
+        }
+        left -= header.orders * sizeof(SnapshotOrder);
+        if (header.market_bids > left / sizeof(SnapshotLevel) ||
+            header.market_asks > left / sizeof(SnapshotLevel) - header.market_bids) {
+            throw std::invalid_argument("Snapshot is truncated");
+        }
+        return header;
+    }
+
+    // everything add_to_book would refuse, plus duplicate ids and a book
+    // that crosses itself, caught before the engine changes
+    static void check_orders(const std::vector<SnapshotOrder>& orders) {
+        std::unordered_set<OrderId> ids;
+        ids.reserve(orders.size());
+        int64_t best_bid = 0;
+        int64_t best_ask = 0;
+        for (const SnapshotOrder& record : orders) {
+            if (record.order_id == 0 || record.price <= 0 || record.size <= 0 ||
+                record.timestamp < 0 || record.side > uint8_t(Side::SELL)) {
+                throw std::invalid_argument("Snapshot order is invalid");
+            }
+            if (!ids.insert(record.order_id).second) {
+                throw std::invalid_argument("Snapshot order ID " +
+                                            std::to_string(record.order_id) +
+                                            " is duplicated");
+            }
+            if (record.side == uint8_t(Side::BUY)) {
+                best_bid = std::max(best_bid, record.price);
+            } else if (best_ask == 0 || record.price < best_ask) {
+                best_ask = record.price;
+            }
+        }
+        if (best_bid != 0 && best_ask != 0 && best_bid >= best_ask) {
+            throw std::invalid_argument("Snapshot book is crossed");
+        }
+    }
+};
+
+using MapMatchEngine = BasicMatchEngine<MapBackend>;
+using LadderMatchEngine = BasicMatchEngine<LadderBackend>;
+
+// backend behind the plain MatchEngine name, chosen at build time
+#ifdef MATCH_ENGINE_LADDER
+using MatchEngine = LadderMatchEngine;
+#else
+using MatchEngine = MapMatchEngine;
+#endif
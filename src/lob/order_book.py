@@ -2,7 +2,6 @@
 order book implementation for maintaining limit order book state
 """
 
-import time
 from dataclasses import dataclass
 from decimal import Decimal
 from typing import Dict, List, Optional, Tuple
@@ -27,6 +26,7 @@ class Fill:
     maker_order_id: str
     price: Decimal
     size: Decimal
+    # the taker's timestamp, like MatchEngine, so replays stay reproducible
     timestamp: int
 
 
@@ -106,7 +106,7 @@ class OrderBook:
                     maker_order_id=maker.order_id,
                     price=price,
                     size=match_size,
-                    timestamp=int(time.time() * 1000),
+                    timestamp=order.timestamp,
                 )
                 fills.append(fill)
 
@@ -142,7 +142,7 @@ class OrderBook:
                     maker_order_id=maker.order_id,
                     price=price,
                     size=match_size,
-                    timestamp=int(time.time() * 1000),
+                    timestamp=order.timestamp,
                 )
                 fills.append(fill)
 
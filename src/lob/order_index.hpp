@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// open-addressing hash map from 64-bit order id to a record pointer.
+// linear probing with backward-shift deletion keeps lookups to a few
+// adjacent slots, and nothing is allocated unless the table has to grow.
+// id 0 marks an empty slot, so it is never a valid key.
+template <class T>
+class OrderIndex {
+public:
+    explicit OrderIndex(size_t capacity = 1024) { rehash(capacity); }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+
+    T* find(uint64_t id) const {
+        for (size_t i = slot_for(id);; i = (i + 1) & mask_) {
+            const Slot& slot = slots_[i];
+            if (slot.id == id) return slot.value;
+            if (slot.id == 0) return nullptr;
+        }
+    }
+
+    bool contains(uint64_t id) const { return find(id) != nullptr; }
+
+    // returns false if id is already present
+    bool insert(uint64_t id, T* value) {
+        if ((size_ + 1) * 2 > slots_.size()) rehash(slots_.size() * 2);
+        for (size_t i = slot_for(id);; i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (slot.id == id) return false;
+            if (slot.id == 0) {
+                slot.id = id;
+                slot.value = value;
+                ++size_;
+                return true;
+            }
+        }
+    }
+
+    bool erase(uint64_t id) {
+        size_t i = slot_for(id);
+        while (slots_[i].id != id) {
+            if (slots_[i].id == 0) return false;
+            i = (i + 1) & mask_;
+        }
+        // pull later members of the probe chain back into the hole
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask_; slots_[j].id != 0; j = (j + 1) & mask_) {
+            size_t home = slot_for(slots_[j].id);
+            if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+                slots_[hole] = slots_[j];
+                hole = j;
+            }
+        }
+        slots_[hole] = Slot{};
+        --size_;
+        return true;
+    }
+
+    void reserve(size_t n) {
+        if (n * 2 > slots_.size()) rehash(n * 2);
+    }
+
+private:
+    struct Slot {
+        uint64_t id = 0;
+        T* value = nullptr;
+    };
+
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+
+    // splitmix64 finalizer, sequential ids spread across the table
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    size_t slot_for(uint64_t id) const { return mix(id) & mask_; }
+
+    void rehash(size_t capacity) {
+        size_t cap = 16;
+        while (cap < capacity) cap <<= 1;
+        std::vector<Slot> old(cap);
+        old.swap(slots_);
+        mask_ = cap - 1;
+        size_ = 0;
+        for (const Slot& slot : old) {
+            if (slot.id != 0) insert(slot.id, slot.value);
+        }
+    }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// slab allocator for fixed-size records. memory is carved out in chunks
+// and freed records go on an intrusive freelist, so once the pool has
+// grown to the working set, create/destroy never touch the heap.
+template <class T, size_t ChunkSize = 4096>
+class ObjectPool {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "pooled records are dropped without running destructors");
+
+public:
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+    ObjectPool(ObjectPool&&) = default;
+    ObjectPool& operator=(ObjectPool&&) = default;
+
+    template <class... Args>
+    T* create(Args&&... args) {
+        if (!free_) grow();
+        Slot* slot = free_;
+        free_ = slot->next;
+        ++live_;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object) {
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = free_;
+        free_ = slot;
+        --live_;
+    }
+
+    // make sure n records fit without another chunk allocation
+    void reserve(size_t n) {
+        while (capacity() - live_ < n) grow();
+    }
+
+    size_t live() const { return live_; }
+    size_t capacity() const { return chunks_.size() * ChunkSize; }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> chunks_;
+    Slot* free_ = nullptr;
+    size_t live_ = 0;
+
+    void grow() {
+        // owned before it is pushed, so a throwing push does not leak it
+        std::unique_ptr<Slot[]> owned(new Slot[ChunkSize]);
+        Slot* chunk = owned.get();
+        chunks_.push_back(std::move(owned));
+        for (size_t i = ChunkSize; i-- > 0;) {
+            chunk[i].next = free_;
+            free_ = &chunk[i];
+        }
+    }
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+
+// how an incoming order meets the book. each type is a tag whose constants
+// the matching core reads with if constexpr, so every type gets its own
+// instantiation of the matching loop and a plain limit order pays for none
+// of the others' checks.
+//
+// an order that ends up not resting (an IOC or market remainder, a
+// post-only that would have matched, a FOK that could not fill in full) is
+// dropped, not rejected: there is no error, and contains() tells the
+// caller whether it rested.
+
+// matches what it can and rests the rest, good till cancelled
+struct LimitOrder {
+    static constexpr bool kTakes = true;
+    static constexpr bool kRests = true;
+    static constexpr bool kAllOrNone = false;
+    static constexpr bool kPriceLimited = true;
+};
+
+// only ever rests, dropped whole if it would match on entry
+struct PostOnlyOrder {
+    static constexpr bool kTakes = false;
+    static constexpr bool kRests = true;
+    static constexpr bool kAllOrNone = false;
+    static constexpr bool kPriceLimited = true;
+};
+
+// matches up to its price, the remainder is dropped
+struct ImmediateOrCancelOrder {
+    static constexpr bool kTakes = true;
+    static constexpr bool kRests = false;
+    static constexpr bool kAllOrNone = false;
+    static constexpr bool kPriceLimited = true;
+};
+
+// fills its whole size up to its price or does nothing
+struct FillOrKillOrder {
+    static constexpr bool kTakes = true;
+    static constexpr bool kRests = false;
+    static constexpr bool kAllOrNone = true;
+    static constexpr bool kPriceLimited = true;
+};
+
+// matches at any price, the remainder is dropped. its price is ignored.
+struct MarketOrder {
+    static constexpr bool kTakes = true;
+    static constexpr bool kRests = false;
+    static constexpr bool kAllOrNone = false;
+    static constexpr bool kPriceLimited = false;
+};
+
+// runtime name of the tags, for boundaries where the type arrives as data
+enum class OrderType : uint8_t {
+    LIMIT = 0,
+    POST_ONLY = 1,
+    IOC = 2,
+    FOK = 3,
+    MARKET = 4
+};
+
+// calls fn with the tag for type. the switch runs once per order, before
+// matching, and each branch calls a separately compiled fn.
+template <class Fn>
+decltype(auto) dispatch_order_type(OrderType type, Fn&& fn) {
+    switch (type) {
+    case OrderType::LIMIT: return fn(LimitOrder{});
+    case OrderType::POST_ONLY: return fn(PostOnlyOrder{});
+    case OrderType::IOC: return fn(ImmediateOrCancelOrder{});
+    case OrderType::FOK: return fn(FillOrKillOrder{});
+    case OrderType::MARKET: return fn(MarketOrder{});
+    }
+    throw std::invalid_argument("Unknown order type");
+}
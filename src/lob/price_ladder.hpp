@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// one side of the book stored as a flat array of levels indexed by tick
+// offset from a movable anchor. a bitmap of non-empty slots lets us step
+// to the next occupied level without touching the empty ones, and empty
+// levels keep their storage so a level that is refilled costs nothing.
+//
+// Descending = true orders best as the highest price (bids), false as the
+// lowest price (asks).
+template <class Level, bool Descending>
+class PriceLadder {
+public:
+    explicit PriceLadder(size_t capacity = 4096) {
+        size_t cap = 64;
+        while (cap < capacity) cap <<= 1;
+        levels_.resize(cap);
+        bitmap_.assign(cap / 64, 0);
+    }
+
+    bool empty() const { return count_ == 0; }
+    size_t level_count() const { return count_; }
+    size_t capacity() const { return levels_.size(); }
+    int64_t anchor() const { return anchor_; }
+
+    // precondition: !empty()
+    int64_t best_price() const { return anchor_ + static_cast<int64_t>(best_); }
+    Level& best_level() { return levels_[best_]; }
+
+    Level* find(int64_t price) {
+        if (!in_window(price)) return nullptr;
+        size_t idx = static_cast<size_t>(price - anchor_);
+        return test(idx) ? &levels_[idx] : nullptr;
+    }
+
+    Level& get_or_create(int64_t price) {
+        if (!in_window(price)) recenter(price);
+        size_t idx = static_cast<size_t>(price - anchor_);
+        if (!test(idx)) {
+            set(idx);
+            if (count_ == 0 || better(idx, best_)) best_ = idx;
+            ++count_;
+        }
+        return levels_[idx];
+    }
+
+    // the level must already be empty; its storage is kept for reuse
+    void erase(int64_t price) {
+        size_t idx = static_cast<size_t>(price - anchor_);
+        clear(idx);
+        --count_;
+        if (count_ > 0 && idx == best_) {
+            best_ = Descending ? prev_set(idx) : next_set(idx);
+        }
+    }
+
+    void erase_best() { erase(best_price()); }
+
+    // false if get_or_create(price) would need a window past kMaxCapacity
+    bool fits(int64_t price) const {
+        if (count_ == 0 || in_window(price)) return true;
+        int64_t lo = std::min(price, anchor_ + static_cast<int64_t>(lowest()));
+        int64_t hi = std::max(price, anchor_ + static_cast<int64_t>(highest()));
+        return static_cast<uint64_t>(hi - lo) + 1 <= kMaxCapacity / 2;
+    }
+
+    // drop every level; the window and its storage are kept
+    void clear() {
+        for (size_t idx = next_set(0); idx != npos; idx = next_set(idx + 1)) {
+            levels_[idx] = Level();
+        }
+        std::fill(bitmap_.begin(), bitmap_.end(), 0);
+        best_ = 0;
+        count_ = 0;
+    }
+
+    // visit occupied levels from best to worst until fn returns false
+    template <class Fn>
+    void for_each(Fn&& fn) {
+        visit(*this, fn);
+    }
+
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        visit(*this, fn);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    // 16M levels; beyond that the map backend is the better fit
+    static constexpr size_t kMaxCapacity = size_t(1) << 24;
+
+    std::vector<Level> levels_;
+    std::vector<uint64_t> bitmap_;
+    int64_t anchor_ = 0;
+    size_t best_ = 0;
+    size_t count_ = 0;
+
+    // shared by both for_each overloads, Self is const or not
+    template <class Self, class Fn>
+    static void visit(Self& self, Fn& fn) {
+        if (self.count_ == 0) return;
+        size_t idx = self.best_;
+        for (size_t seen = 0; seen < self.count_; ++seen) {
+            int64_t price = self.anchor_ + static_cast<int64_t>(idx);
+            if (!fn(price, self.levels_[idx])) return;
+            if (seen + 1 < self.count_) {
+                idx = Descending ? self.prev_set(idx - 1) : self.next_set(idx + 1);
+            }
+        }
+    }
+
+    bool in_window(int64_t price) const {
+        return price >= anchor_ &&
+               price - anchor_ < static_cast<int64_t>(levels_.size());
+    }
+
+    bool better(size_t a, size_t b) const { return Descending ? a > b : a < b; }
+
+    bool test(size_t idx) const { return (bitmap_[idx >> 6] >> (idx & 63)) & 1; }
+    void set(size_t idx) { bitmap_[idx >> 6] |= uint64_t(1) << (idx & 63); }
+    void clear(size_t idx) { bitmap_[idx >> 6] &= ~(uint64_t(1) << (idx & 63)); }
+
+    // lowest occupied index >= idx, npos if none
+    size_t next_set(size_t idx) const {
+        size_t word = idx >> 6;
+        if (word >= bitmap_.size()) return npos;
+        uint64_t bits = bitmap_[word] & (~uint64_t(0) << (idx & 63));
+        while (true) {
+            if (bits) return (word << 6) + __builtin_ctzll(bits);
+            if (++word == bitmap_.size()) return npos;
+            bits = bitmap_[word];
+        }
+    }
+
+    // highest occupied index <= idx, npos if none
+    size_t prev_set(size_t idx) const {
+        if (idx == npos) return npos;
+        size_t word = idx >> 6;
+        unsigned shift = 63 - (idx & 63);
+        uint64_t bits = bitmap_[word] & (~uint64_t(0) >> shift);
+        while (true) {
+            if (bits) return (word << 6) + 63 - __builtin_clzll(bits);
+            if (word-- == 0) return npos;
+            bits = bitmap_[word];
+        }
+    }
+
+    size_t lowest() const { return next_set(0); }
+    size_t highest() const { return prev_set(levels_.size() - 1); }
+
+    // move the window so price fits, growing it if the occupied span plus
+    // the new price no longer does. occupied levels keep their order.
+    void recenter(int64_t price) {
+        size_t cap = levels_.size();
+        if (count_ == 0) {
+            anchor_ = price - static_cast<int64_t>(cap / 2);
+            return;
+        }
+
+        int64_t lo = std::min(price, anchor_ + static_cast<int64_t>(lowest()));
+        int64_t hi = std::max(price, anchor_ + static_cast<int64_t>(highest()));
+        uint64_t span = static_cast<uint64_t>(hi - lo) + 1;
+        size_t new_cap = cap;
+        while (span > new_cap / 2) {
+            if (new_cap >= kMaxCapacity) {
+                throw std::length_error(
+                    "Price ladder span too large, use a coarser tick size");
+            }
+            new_cap <<= 1;
+        }
+
+        int64_t new_anchor = lo + static_cast<int64_t>(span / 2) -
+                             static_cast<int64_t>(new_cap / 2);
+
+        std::vector<Level> levels(new_cap);
+        std::vector<uint64_t> bitmap(new_cap / 64, 0);
+        size_t best = best_;
+        for (size_t idx = next_set(0); idx != npos; idx = next_set(idx + 1)) {
+            size_t moved = static_cast<size_t>(anchor_ + static_cast<int64_t>(idx) -
+                                               new_anchor);
+            levels[moved] = std::move(levels_[idx]);
+            bitmap[moved >> 6] |= uint64_t(1) << (moved & 63);
+            if (idx == best) best_ = moved;
+        }
+        levels_ = std::move(levels);
+        bitmap_ = std::move(bitmap);
+        anchor_ = new_anchor;
+    }
+};
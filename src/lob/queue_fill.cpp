@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <pybind11/pybind11.h>
+
+#include "queue_fill.hpp"
+
+namespace py = pybind11;
+
+void bind_queue_fill(py::module_& m) {
+    // prices and sizes cross in exchange units on the model's grid, like
+    // MatchEngine, and fills come back as (order_id, side, price, size,
+    // timestamp)
+    py::class_<QueueFillModel>(m, "QueueFillModel")
+        .def(py::init([](double tick_size, double lot_size) {
+                 return QueueFillModel(Instrument(tick_size, lot_size));
+             }),
+             py::arg("tick_size") = kDefaultTickSize,
+             py::arg("lot_size") = kDefaultLotSize)
+        .def("place", [](QueueFillModel& q, Side side, double price, double size,
+                         double shown) {
+            const Instrument& instrument = q.instrument();
+            return q.place(side, instrument.to_ticks(price), instrument.to_lots(size),
+                           instrument.to_lots(shown));
+        }, py::arg("side"), py::arg("price"), py::arg("size"), py::arg("shown") = 0.0)
+        .def("cancel", &QueueFillModel::cancel, py::arg("order_id"))
+        .def("on_level", [](QueueFillModel& q, Side side, double price, double qty,
+                            int64_t timestamp) {
+            const Instrument& instrument = q.instrument();
+            q.on_level(side, instrument.to_ticks(price), instrument.to_lots(qty),
+                       timestamp);
+        }, py::arg("side"), py::arg("price"), py::arg("qty"), py::arg("timestamp"))
+        .def("on_best", [](QueueFillModel& q, double best_bid, double best_ask,
+                           int64_t timestamp) {
+            const Instrument& instrument = q.instrument();
+            q.on_best(instrument.to_ticks(best_bid), instrument.to_ticks(best_ask),
+                      timestamp);
+        }, py::arg("best_bid"), py::arg("best_ask"), py::arg("timestamp"))
+        .def("take_fills", [](QueueFillModel& q) {
+            const Instrument& instrument = q.instrument();
+            py::list out;
+            for (const QueueFill& fill : q.fills()) {
+                out.append(py::make_tuple(fill.id, fill.side,
+                                          instrument.from_ticks(fill.price),
+                                          instrument.from_lots(fill.size),
+                                          fill.timestamp));
+            }
+            q.clear_fills();
+            return out;
+        })
+        // (ahead, remaining) of a resting order, None once it is gone
+        .def("queue", [](const QueueFillModel& q, OrderId order_id) -> py::object {
+            const QueuedOrder* order = q.find(order_id);
+            if (order == nullptr) return py::none();
+            const Instrument& instrument = q.instrument();
+            return py::make_tuple(instrument.from_lots(order->ahead),
+                                  instrument.from_lots(order->remaining));
+        }, py::arg("order_id"))
+        .def("clear", &QueueFillModel::clear)
+        .def("__len__", &QueueFillModel::size)
+        .def("__contains__", [](const QueueFillModel& q, OrderId order_id) {
+            return q.find(order_id) != nullptr;
+        })
+        .def_property_readonly("tick_size", [](const QueueFillModel& q) {
+            return q.instrument().tick_size;
+        })
+        .def_property_readonly("lot_size", [](const QueueFillModel& q) {
+            return q.instrument().lot_size;
+        });
+}
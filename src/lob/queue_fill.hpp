@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "depth_book.hpp"
+#include "match_engine.hpp"
+#include "side.hpp"
+
+// one of our simulated orders, waiting behind the size shown before it
+struct QueuedOrder {
+    OrderId id;
+    // lots still to fill
+    int64_t remaining;
+    // displayed lots ahead of us at our price
+    int64_t ahead;
+};
+
+// a passive fill of a queued order, at the order's own price
+struct QueueFill {
+    OrderId id;
+    Side side;
+    int64_t price;
+    int64_t size;
+    int64_t timestamp;
+};
+
+// passive fills for simulated orders resting in a recorded depth stream.
+//
+// an order joins the back of its level, behind whatever size the book
+// showed there. depth data cannot tell trades from cancels, so every drop
+// in a level's size is taken from the front of the queue: it first moves
+// our orders up and then, once nothing is left ahead, fills them. size
+// added to a level joins behind us. a book that trades through our price
+// fills what is left outright.
+//
+// the book's recorded size never includes our orders, which are simulated
+// on top of it. levels are fed one at a time as they change, so a depth
+// message costs one lookup per level it touches plus the work at levels
+// we actually rest at.
+class QueueFillModel {
+public:
+    explicit QueueFillModel(Instrument instrument = Instrument())
+        : instrument_(instrument) {}
+
+    const Instrument& instrument() const { return instrument_; }
+
+    // rests size lots at price behind the shown lots already displayed
+    // there, 0 for a price inside the spread. quotes that cross should take
+    // liquidity before they get here; a crossing order fills on the next
+    // on_best.
+    OrderId place(Side side, int64_t price, int64_t size, int64_t shown) {
+        if (size <= 0) {
+            throw std::invalid_argument("Order size must be positive");
+        }
+        if (shown < 0) {
+            throw std::invalid_argument("Shown size cannot be negative");
+        }
+        OrderId id = next_id_++;
+        Level& level = side == Side::BUY ? bids_[price] : asks_[price];
+        // a level we already rest at keeps the size it has been tracking
+        if (level.orders.empty()) level.shown = shown;
+        level.orders.push_back({id, size, level.shown});
+        index_.emplace(id, Key{side, price});
+        return id;
+    }
+
+    // false if the order already filled or was never placed
+    bool cancel(OrderId id) {
+        auto it = index_.find(id);
+        if (it == index_.end()) return false;
+        Key key = it->second;
+        index_.erase(it);
+        if (key.side == Side::BUY) {
+            remove(bids_, key.price, id);
+        } else {
+            remove(asks_, key.price, id);
+        }
+        return true;
+    }
+
+    // the book now shows qty lots at price, 0 once the level is gone
+    void on_level(Side side, int64_t price, int64_t qty, int64_t timestamp) {
+        if (side == Side::BUY) {
+            advance(bids_, side, price, qty, timestamp);
+        } else {
+            advance(asks_, side, price, qty, timestamp);
+        }
+    }
+
+    // the other side's best reached our price: the market traded through
+    // every order there, so each fills in full. 0 is an empty side.
+    void on_best(int64_t best_bid, int64_t best_ask, int64_t timestamp) {
+        if (best_ask != 0) {
+            while (!bids_.empty() && bids_.begin()->first >= best_ask) {
+                fill_level(bids_, Side::BUY, timestamp);
+            }
+        }
+        if (best_bid != 0) {
+            while (!asks_.empty() && asks_.begin()->first <= best_bid) {
+                fill_level(asks_, Side::SELL, timestamp);
+            }
+        }
+    }
+
+    // the book was replaced whole, as a full depth message replaces it. a
+    // level we rest at within the book's range now shows what the book has
+    // there, 0 if the message left it out; one past the book's worst price
+    // is out of view and keeps the size it was tracking.
+    void on_book(const DepthBook& book, int64_t timestamp) {
+        sync(bids_, Side::BUY, book, book.worst_bid(), timestamp);
+        sync(asks_, Side::SELL, book, book.worst_ask(), timestamp);
+    }
+
+    // cheap guard for callers that would look the shown size up first
+    bool tracks(Side side, int64_t price) const {
+        return side == Side::BUY ? bids_.count(price) != 0 : asks_.count(price) != 0;
+    }
+
+    // nullptr once filled or cancelled
+    const QueuedOrder* find(OrderId id) const {
+        auto it = index_.find(id);
+        if (it == index_.end()) return nullptr;
+        const Key& key = it->second;
+        const std::vector<QueuedOrder>& orders =
+            key.side == Side::BUY ? bids_.at(key.price).orders
+                                  : asks_.at(key.price).orders;
+        for (const QueuedOrder& order : orders) {
+            if (order.id == id) return &order;
+        }
+        return nullptr;
+    }
+
+    size_t size() const { return index_.size(); }
+    bool empty() const { return index_.empty(); }
+
+    // fills since the last clear_fills(), oldest first
+    const std::vector<QueueFill>& fills() const { return fills_; }
+    void clear_fills() { fills_.clear(); }
+
+    void clear() {
+        bids_.clear();
+        asks_.clear();
+        index_.clear();
+        fills_.clear();
+    }
+
+private:
+    struct Level {
+        // lots the book last showed here
+        int64_t shown = 0;
+        // ours, in the order they joined
+        std::vector<QueuedOrder> orders;
+    };
+
+    struct Key {
+        Side side;
+        int64_t price;
+    };
+
+    Instrument instrument_;
+    // best first, so trade-throughs are found at begin()
+    std::map<int64_t, Level, std::greater<int64_t>> bids_;
+    std::map<int64_t, Level> asks_;
+    std::unordered_map<OrderId, Key> index_;
+    std::vector<QueueFill> fills_;
+    OrderId next_id_ = 1;
+
+    template <class Levels>
+    void advance(Levels& levels, Side side, int64_t price, int64_t qty,
+                 int64_t timestamp) {
+        auto it = levels.find(price);
+        if (it == levels.end()) return;
+        Level& level = it->second;
+        int64_t traded = level.shown - qty;
+        level.shown = qty;
+        if (traded <= 0) return;
+
+        // lots of this drop already filled into our earlier orders, which
+        // later ones wait behind as well as the book
+        int64_t taken = 0;
+        for (QueuedOrder& order : level.orders) {
+            int64_t moved = std::min(order.ahead, traded);
+            order.ahead -= moved;
+            int64_t size = std::min(order.remaining, traded - moved - taken);
+            if (size <= 0) continue;
+            order.remaining -= size;
+            taken += size;
+            fills_.push_back({order.id, side, price, size, timestamp});
+        }
+        prune(levels, it);
+    }
+
+    template <class Levels>
+    void sync(Levels& levels, Side side, const DepthBook& book, int64_t worst,
+              int64_t timestamp) {
+        if (worst == 0) return;
+        for (auto it = levels.begin(); it != levels.end();) {
+            // advance can erase the level, so step past it first
+            int64_t price = (it++)->first;
+            if (levels.key_comp()(worst, price)) break;
+            advance(levels, side, price, book.qty_at(side, price), timestamp);
+        }
+    }
+
+    template <class Levels>
+    void fill_level(Levels& levels, Side side, int64_t timestamp) {
+        auto it = levels.begin();
+        for (QueuedOrder& order : it->second.orders) {
+            fills_.push_back({order.id, side, it->first, order.remaining, timestamp});
+            index_.erase(order.id);
+        }
+        levels.erase(it);
+    }
+
+    // drops filled orders, and the level once none of ours is left
+    template <class Levels>
+    void prune(Levels& levels, typename Levels::iterator it) {
+        std::vector<QueuedOrder>& orders = it->second.orders;
+        for (const QueuedOrder& order : orders) {
+            if (order.remaining == 0) index_.erase(order.id);
+        }
+        orders.erase(std::remove_if(orders.begin(), orders.end(),
+                                    [](const QueuedOrder& order) {
+                                        return order.remaining == 0;
+                                    }),
+                     orders.end());
+        if (orders.empty()) levels.erase(it);
+    }
+
+    template <class Levels>
+    static void remove(Levels& levels, int64_t price, OrderId id) {
+        auto it = levels.find(price);
+        if (it == levels.end()) return;
+        std::vector<QueuedOrder>& orders = it->second.orders;
+        orders.erase(std::remove_if(orders.begin(), orders.end(),
+                                    [id](const QueuedOrder& order) {
+                                        return order.id == id;
+                                    }),
+                     orders.end());
+        if (orders.empty()) levels.erase(it);
+    }
+};
@@ -0,0 +1,131 @@
+#include <cstdint>
+#include <string>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include "quote_engine.hpp"
+
+namespace py = pybind11;
+
+// reads the python dataclasses once; Decimal fields go through __float__.
+// shared with the shard runtime, which builds one QuoteEngine per symbol.
+QuoteConfig quote_config(py::handle ev_config, py::handle size_config) {
+    py::handle skew = ev_config.attr("inventory_config");
+    QuoteConfig c;
+    c.min_spread = ev_config.attr("min_spread").cast<double>();
+    c.max_spread = ev_config.attr("max_spread").cast<double>();
+    c.num_points = ev_config.attr("num_points").cast<int>();
+    c.skew_max_position = skew.attr("max_position").cast<double>();
+    c.skew_factor = skew.attr("skew_factor").cast<double>();
+    c.min_spread_bps = skew.attr("min_spread_bps").cast<double>();
+    c.spread_factor = skew.attr("spread_factor").cast<double>();
+    c.continuity_clip = skew.attr("continuity_clip").cast<double>();
+    c.float_tolerance = skew.attr("float_tolerance").cast<double>();
+    c.base_size = size_config.attr("base_size").cast<double>();
+    c.max_size_mult = size_config.attr("max_size_mult").cast<double>();
+    c.size_max_position = size_config.attr("max_position").cast<double>();
+    py::handle scaling = size_config.attr("scaling_type");
+    c.sigmoid_sizing = scaling.attr("value").cast<std::string>() == "sigmoid";
+    c.sigmoid_steepness = size_config.attr("sigmoid_steepness").cast<double>();
+    c.min_size_mult = size_config.attr("min_size_mult").cast<double>();
+    return c;
+}
+
+namespace {
+
+using ProbArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+// python face of QuoteEngine. per-candidate probabilities are optional
+// float64 arrays of num_points entries, read in place.
+class PyQuoteEngine {
+public:
+    PyQuoteEngine(py::handle ev_config, py::handle size_config, double tick_size,
+                  double lot_size)
+        : engine_(quote_config(ev_config, size_config),
+                  Instrument(tick_size, lot_size)) {}
+
+    py::tuple quote(double mid_price, double inventory, double bid_probability,
+                    double ask_probability, py::object bid_probs,
+                    py::object ask_probs) {
+        ProbArray bids, asks;
+        QuotePair q = engine_.quote(mid_price, inventory, bid_probability,
+                                    ask_probability, probabilities(bid_probs, bids),
+                                    probabilities(ask_probs, asks));
+        return py::make_tuple(py::make_tuple(q.bid_price, q.bid_size),
+                              py::make_tuple(q.ask_price, q.ask_size));
+    }
+
+    py::tuple quote_ticks(int64_t best_bid, int64_t best_ask, int64_t inventory,
+                          double bid_probability, double ask_probability,
+                          py::object bid_probs, py::object ask_probs) {
+        ProbArray bids, asks;
+        QuoteTicks q = engine_.quote_ticks(best_bid, best_ask, inventory,
+                                           bid_probability, ask_probability,
+                                           probabilities(bid_probs, bids),
+                                           probabilities(ask_probs, asks));
+        return py::make_tuple(py::make_tuple(q.bid_ticks, q.bid_lots),
+                              py::make_tuple(q.ask_ticks, q.ask_lots));
+    }
+
+    // candidate prices for fill-probability scoring before quote()
+    py::tuple candidates(double mid_price, double inventory) const {
+        double base_bid, base_ask;
+        engine_.base_prices(mid_price, inventory, base_bid, base_ask);
+        const auto n = static_cast<py::ssize_t>(engine_.num_points());
+        py::array_t<double> bids(n);
+        py::array_t<double> asks(n);
+        double* bid_out = bids.mutable_data();
+        double* ask_out = asks.mutable_data();
+        for (int i = 0; i < engine_.num_points(); ++i) {
+            bid_out[i] = base_bid - engine_.spread_at(i);
+            ask_out[i] = base_ask + engine_.spread_at(i);
+        }
+        return py::make_tuple(bids, asks);
+    }
+
+    py::tuple sizes(double inventory) const {
+        double bid_size, ask_size;
+        engine_.sizes(inventory, bid_size, ask_size);
+        return py::make_tuple(bid_size, ask_size);
+    }
+
+    void reset() { engine_.reset(); }
+    const QuoteEngine& core() const { return engine_; }
+
+private:
+    QuoteEngine engine_;
+
+    // null for None, otherwise the data of probs converted into keep
+    const double* probabilities(const py::object& probs, ProbArray& keep) const {
+        if (probs.is_none()) return nullptr;
+        keep = probs.cast<ProbArray>();
+        if (keep.ndim() != 1 || keep.shape(0) != engine_.num_points()) {
+            throw std::invalid_argument("Expected num_points fill probabilities");
+        }
+        return keep.data();
+    }
+};
+
+}  // namespace
+
+void bind_quote_engine(py::module_& m) {
+    py::class_<PyQuoteEngine>(m, "QuoteEngine")
+        .def(py::init<py::handle, py::handle, double, double>(), py::arg("ev_config"),
+             py::arg("size_config"), py::arg("tick_size") = kDefaultTickSize,
+             py::arg("lot_size") = kDefaultLotSize)
+        .def("quote", &PyQuoteEngine::quote, py::arg("mid_price"),
+             py::arg("inventory") = 0.0, py::arg("bid_probability") = 0.5,
+             py::arg("ask_probability") = 0.5, py::arg("bid_probs") = py::none(),
+             py::arg("ask_probs") = py::none())
+        .def("quote_ticks", &PyQuoteEngine::quote_ticks, py::arg("best_bid"),
+             py::arg("best_ask"), py::arg("inventory") = 0,
+             py::arg("bid_probability") = 0.5, py::arg("ask_probability") = 0.5,
+             py::arg("bid_probs") = py::none(), py::arg("ask_probs") = py::none())
+        .def("candidates", &PyQuoteEngine::candidates, py::arg("mid_price"),
+             py::arg("inventory") = 0.0)
+        .def("sizes", &PyQuoteEngine::sizes, py::arg("inventory"))
+        .def("reset", &PyQuoteEngine::reset)
+        .def_property_readonly("num_points", [](const PyQuoteEngine& q) {
+            return q.core().num_points();
+        });
+}
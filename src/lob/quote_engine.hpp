@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include "match_engine.hpp"
+
+// EVConfig, its InventorySkewConfig and SizeConfig flattened into doubles
+struct QuoteConfig {
+    // EVConfig
+    double min_spread = 0.0005;
+    double max_spread = 0.005;
+    int num_points = 10;
+    // InventorySkewConfig
+    double skew_max_position = 1.0;
+    double skew_factor = 0.5;
+    double min_spread_bps = 1.0;
+    double spread_factor = 1.0;
+    double continuity_clip = 0.1;
+    double float_tolerance = 1e-10;
+    // SizeConfig
+    double base_size = 0.001;
+    double max_size_mult = 3.0;
+    double size_max_position = 1.0;
+    bool sigmoid_sizing = false;
+    double sigmoid_steepness = 4.0;
+    double min_size_mult = 0.1;
+};
+
+// both quotes in exchange units
+struct QuotePair {
+    double bid_price;
+    double bid_size;
+    double ask_price;
+    double ask_size;
+};
+
+// both quotes on the instrument grid: bids round down, asks round up and
+// sizes round down, so a quote is never more aggressive than computed
+struct QuoteTicks {
+    int64_t bid_ticks;
+    int64_t bid_lots;
+    int64_t ask_ticks;
+    int64_t ask_lots;
+};
+
+// EVMaker.quote_prices -> InventorySkew.apply_skew -> SizeCalculator.get_sizes
+// in doubles, without allocating. the python classes are the reference;
+// this follows them step for step, including the continuity clip state.
+class QuoteEngine {
+public:
+    explicit QuoteEngine(QuoteConfig config = QuoteConfig(),
+                         Instrument instrument = Instrument())
+        : config_(config), instrument_(instrument) {
+        if (config_.num_points < 2) {
+            throw std::invalid_argument("Number of points must be at least 2");
+        }
+        if (!(config_.skew_max_position > 0) || !(config_.size_max_position > 0)) {
+            throw std::invalid_argument("Max position must be positive");
+        }
+    }
+
+    const QuoteConfig& config() const { return config_; }
+    const Instrument& instrument() const { return instrument_; }
+    int num_points() const { return config_.num_points; }
+
+    // forget the previous quotes so the next one isn't continuity clipped
+    void reset() { has_prev_ = false; }
+
+    // the i-th candidate distance from the skewed base price
+    double spread_at(int i) const {
+        return i * config_.max_spread / (config_.num_points - 1);
+    }
+
+    // skewed (bid, ask) before the ev search, without advancing the
+    // continuity state; candidates are base_bid - spread_at(i) and
+    // base_ask + spread_at(i)
+    void base_prices(double mid_price, double inventory, double& bid,
+                     double& ask) const {
+        const QuoteConfig& c = config_;
+        double inv = std::clamp(inventory / c.skew_max_position, -1.0, 1.0);
+        double min_spread = mid_price * c.min_spread_bps / 10000.0;
+        double spread = min_spread * (1.0 + std::fabs(inv) * c.spread_factor);
+        double half_spread = spread / 2.0;
+        double centre_shift = -inv * c.skew_factor * spread;
+        bid = mid_price + centre_shift - half_spread;
+        ask = mid_price + centre_shift + half_spread;
+
+        if (has_prev_) {
+            const double lim = c.continuity_clip;
+            bid = prev_bid_ + clip_move(bid - prev_bid_, lim);
+            ask = prev_ask_ + clip_move(ask - prev_ask_, lim);
+        }
+    }
+
+    // bid_probs/ask_probs hold one fill probability per candidate, or are
+    // null to use bid_probability/ask_probability for every candidate
+    QuotePair quote(double mid_price, double inventory, double bid_probability,
+                    double ask_probability, const double* bid_probs = nullptr,
+                    const double* ask_probs = nullptr) {
+        double base_bid, base_ask;
+        base_prices(mid_price, inventory, base_bid, base_ask);
+        prev_bid_ = base_bid;
+        prev_ask_ = base_ask;
+        has_prev_ = true;
+
+        double bid = best_candidate(base_bid, -1.0, bid_probability, bid_probs);
+        double ask = best_candidate(base_ask, 1.0, ask_probability, ask_probs);
+        if (ask - bid < config_.min_spread) {
+            double mid = (ask + bid) / 2.0;
+            bid = mid - config_.min_spread / 2.0;
+            ask = mid + config_.min_spread / 2.0;
+        }
+
+        QuotePair out{bid, 0.0, ask, 0.0};
+        sizes(inventory, out.bid_size, out.ask_size);
+        return out;
+    }
+
+    // the same from the best bid/ask in ticks and inventory in lots
+    QuoteTicks quote_ticks(int64_t best_bid, int64_t best_ask, int64_t inventory,
+                           double bid_probability, double ask_probability,
+                           const double* bid_probs = nullptr,
+                           const double* ask_probs = nullptr) {
+        const double tick = instrument_.tick_size;
+        const double lot = instrument_.lot_size;
+        double mid = static_cast<double>(best_bid + best_ask) * tick / 2.0;
+        QuotePair q = quote(mid, instrument_.from_lots(inventory), bid_probability,
+                            ask_probability, bid_probs, ask_probs);
+        return QuoteTicks{round_down(q.bid_price / tick), round_down(q.bid_size / lot),
+                          round_up(q.ask_price / tick), round_down(q.ask_size / lot)};
+    }
+
+    // SizeCalculator.get_sizes with side_bias
+    void sizes(double inventory, double& bid_size, double& ask_size) const {
+        const QuoteConfig& c = config_;
+        double norm_inv = inventory / c.size_max_position;
+        if (std::fabs(norm_inv) > 1) norm_inv = std::copysign(1.0, norm_inv);
+
+        double scaled_inv = norm_inv;
+        if (c.sigmoid_sizing) {
+            double sig = 1.0 / (1.0 + std::exp(-norm_inv * c.sigmoid_steepness));
+            scaled_inv = 2.0 * sig - 1.0;
+            // stay within the linear bounds
+            if (std::fabs(norm_inv) >= 1) {
+                scaled_inv = norm_inv;
+            } else if (norm_inv > 0) {
+                scaled_inv = std::min(scaled_inv, norm_inv);
+            } else {
+                scaled_inv = std::max(scaled_inv, norm_inv);
+            }
+        }
+
+        const double base_mult = (c.max_size_mult - 1.0) / 2.0;
+        const double shift = scaled_inv * base_mult * 2;
+        double bid_mult, ask_mult;
+        // the side that adds to the position only goes to zero at the limit
+        if (scaled_inv > 0) {
+            bid_mult = scaled_inv >= 1 ? 0.0 : std::max(c.min_size_mult, 1.0 - shift);
+            ask_mult = 1.0 + shift;
+        } else {
+            bid_mult = 1.0 - shift;
+            ask_mult = scaled_inv <= -1 ? 0.0 : std::max(c.min_size_mult, 1.0 + shift);
+        }
+        bid_size = c.base_size * bid_mult;
+        ask_size = c.base_size * ask_mult;
+    }
+
+private:
+    // keeps a price computed just above a grid line from rounding off it
+    static constexpr double kGridEps = 1e-9;
+
+    static int64_t round_down(double units) {
+        return static_cast<int64_t>(std::floor(units + kGridEps));
+    }
+    static int64_t round_up(double units) {
+        return static_cast<int64_t>(std::ceil(units - kGridEps));
+    }
+
+    QuoteConfig config_;
+    Instrument instrument_;
+    bool has_prev_ = false;
+    double prev_bid_ = 0.0;
+    double prev_ask_ = 0.0;
+
+    double clip_move(double move, double lim) const {
+        // a move of exactly the limit stays the limit despite rounding
+        if (std::fabs(std::fabs(move) - lim) < config_.float_tolerance && move != 0) {
+            move = std::copysign(lim, move);
+        }
+        return std::clamp(move, -lim, lim);
+    }
+
+    // direction -1 walks bids down from base, +1 walks asks up. the first
+    // candidate with the highest probability * spread wins.
+    double best_candidate(double base, double direction, double probability,
+                          const double* probs) const {
+        double best_ev = -std::numeric_limits<double>::infinity();
+        double best = base;
+        for (int i = 0; i < config_.num_points; ++i) {
+            double spread = spread_at(i);
+            double p = probs != nullptr ? probs[i] : probability;
+            double ev = p * spread;
+            if (ev > best_ev) {
+                best_ev = ev;
+                best = base + direction * spread;
+            }
+        }
+        return best;
+    }
+};
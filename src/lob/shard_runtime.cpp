@@ -0,0 +1,136 @@
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include "depth_replay.hpp"
+#include "shard_runtime.hpp"
+
+namespace py = pybind11;
+
+// defined next to the bindings they come from
+QuoteConfig quote_config(py::handle ev_config, py::handle size_config);
+ShmRing shm_ring_core(py::handle ring);
+using LatencyStats = std::tuple<std::vector<double>, std::vector<uint64_t>, double>;
+LatencyStats latency_stats(const LatencyHistogram& histogram);
+
+namespace {
+
+using QuoteArray = py::array_t<ShardQuote, py::array::c_style>;
+
+// python face of ShardRuntime. symbols are added while stopped, each
+// following its own ShmRing; quoting then runs without the GIL.
+class PyShardRuntime {
+public:
+    PyShardRuntime(size_t workers, std::vector<int> cpus, size_t queue_capacity,
+                   size_t max_batch, int64_t idle_sleep_us)
+        : runtime_(workers, std::move(cpus), queue_capacity, max_batch,
+                   std::chrono::microseconds(idle_sleep_us)) {}
+
+    // the instrument is the ring's grid, so quotes come back on it
+    size_t add_symbol(const std::string& symbol, py::handle ring,
+                      py::handle ev_config, py::handle size_config,
+                      bool from_oldest) {
+        ShmRing core = shm_ring_core(ring);
+        Instrument instrument(depth_replay_detail::parse_decimal(core.tick_size()),
+                              depth_replay_detail::parse_decimal(core.lot_size()));
+        size_t index = runtime_.add(std::make_unique<SymbolShard>(
+            symbol, core, instrument, quote_config(ev_config, size_config),
+            from_oldest));
+        rings_.push_back(py::reinterpret_borrow<py::object>(ring));
+        return index;
+    }
+
+    // stop, drop every symbol and let go of their rings
+    void close() {
+        {
+            py::gil_scoped_release release;
+            runtime_.clear();
+        }
+        rings_.clear();
+    }
+
+    std::vector<std::string> symbols() const {
+        std::vector<std::string> out;
+        for (size_t i = 0; i < runtime_.size(); ++i) {
+            out.push_back(runtime_.shard(i).symbol());
+        }
+        return out;
+    }
+
+    py::dict stats(size_t index) const {
+        const SymbolShard& shard = runtime_.shard(index);
+        ShardStats s = shard.stats();
+        py::dict out;
+        out["messages"] = s.messages;
+        out["dropped"] = s.dropped;
+        out["stale"] = s.stale;
+        out["gaps"] = s.gaps;
+        out["quotes"] = s.quotes;
+        out["queue_full"] = s.queue_full;
+        out["errors"] = s.errors;
+        out["mid"] = s.mid;
+        out["spread"] = s.spread;
+        out["volatility"] = s.volatility;
+        out["inventory"] = shard.inventory();
+        return out;
+    }
+
+    // caller-owned QUOTE_DTYPE buffer, bound with noconvert like depth()
+    size_t drain(QuoteArray out) {
+        return runtime_.drain(out.mutable_data(), static_cast<size_t>(out.size()));
+    }
+
+    ShardRuntime& core() { return runtime_; }
+    const ShardRuntime& core() const { return runtime_; }
+
+private:
+    // the rings' python objects keep their mappings alive until close().
+    // declared first so the workers are joined before the rings go.
+    std::vector<py::object> rings_;
+    ShardRuntime runtime_;
+};
+
+}  // namespace
+
+void bind_shard_runtime(py::module_& m) {
+    PYBIND11_NUMPY_DTYPE(ShardQuote, shard, bid_ticks, bid_lots, ask_ticks, ask_lots,
+                         event_time);
+    m.attr("QUOTE_DTYPE") = py::dtype::of<ShardQuote>();
+
+    py::class_<PyShardRuntime>(m, "ShardRuntime")
+        .def(py::init<size_t, std::vector<int>, size_t, size_t, int64_t>(),
+             py::arg("workers") = 1, py::arg("cpus") = std::vector<int>{},
+             py::arg("queue_capacity") = 4096, py::arg("max_batch") = 1000,
+             py::arg("idle_sleep_us") = 50)
+        .def("add_symbol", &PyShardRuntime::add_symbol, py::arg("symbol"),
+             py::arg("ring"), py::arg("ev_config"), py::arg("size_config"),
+             py::arg("from_oldest") = false)
+        .def("start", [](PyShardRuntime& r) { r.core().start(); })
+        .def("stop", [](PyShardRuntime& r) {
+            py::gil_scoped_release release;
+            r.core().stop();
+        })
+        .def("close", &PyShardRuntime::close)
+        .def("drain", &PyShardRuntime::drain, py::arg("out").noconvert())
+        .def("set_inventory", [](PyShardRuntime& r, size_t index, int64_t lots) {
+            r.core().shard(index).set_inventory(lots);
+        }, py::arg("index"), py::arg("lots"))
+        .def("stats", &PyShardRuntime::stats, py::arg("index"))
+        .def("latency_stats", [](const PyShardRuntime& r, size_t index) {
+            return latency_stats(r.core().shard(index).stats().latency);
+        }, py::arg("index"))
+        .def("__len__", [](const PyShardRuntime& r) { return r.core().size(); })
+        .def_property_readonly("symbols", &PyShardRuntime::symbols)
+        .def_property_readonly("running", [](const PyShardRuntime& r) {
+            return r.core().running();
+        })
+        .def_property_readonly("pinned", [](const PyShardRuntime& r) {
+            return r.core().pinned();
+        });
+}
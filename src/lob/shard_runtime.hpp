@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "feature_pipeline.hpp"
+#include "latency_histogram.hpp"
+#include "match_engine.hpp"
+#include "quote_engine.hpp"
+#include "shm_ring.hpp"
+
+// bounded multi-producer single-consumer queue using vyukov's per-cell
+// sequence numbers: a producer claims a cell with one CAS on the tail and
+// the consumer never contends with producers. a full queue refuses the
+// push instead of waiting.
+template <class T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity) : mask_(capacity - 1) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("Queue capacity must be a power of two");
+        }
+        cells_.reset(new Cell[capacity]);
+        for (size_t i = 0; i < capacity; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    bool push(const T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // only one thread may pop
+    bool pop(T& out) {
+        Cell& cell = cells_[head_ & mask_];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(seq - (head_ + 1)) < 0) return false;
+        out = cell.value;
+        cell.seq.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) size_t head_ = 0;
+};
+
+// one quote from a shard to the gateway, on the shard's grid. every field
+// is 8 bytes so a drained batch can be read as a numpy record array.
+struct ShardQuote {
+    uint64_t shard;
+    int64_t bid_ticks;
+    int64_t bid_lots;
+    int64_t ask_ticks;
+    int64_t ask_lots;
+    // exchange time of the newest update the quote was computed on
+    int64_t event_time;
+};
+
+// counters and the latest features of one shard, copied out under its lock
+struct ShardStats {
+    uint64_t messages = 0;
+    // overwritten in the ring before the shard read them
+    uint64_t dropped = 0;
+    uint64_t stale = 0;
+    uint64_t gaps = 0;
+    uint64_t quotes = 0;
+    // quotes the outbound queue had no room for
+    uint64_t queue_full = 0;
+    uint64_t errors = 0;
+    double mid = 0.0;
+    double spread = 0.0;
+    double volatility = 0.0;
+    // ring read to quote enqueued, per batch
+    LatencyHistogram latency;
+};
+
+// one symbol's book, features and quoting, driven by a single thread.
+// depth comes from a ShmRing cursor, so the publisher never waits on it.
+class SymbolShard {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    SymbolShard(std::string symbol, const ShmRing& ring, Instrument instrument,
+                QuoteConfig config, bool from_oldest = false)
+        : symbol_(std::move(symbol)),
+          instrument_(instrument),
+          cursor_(ring, from_oldest),
+          engine_(instrument),
+          quoter_(config, instrument) {
+        levels_.reserve(ring.max_levels());
+    }
+
+    const std::string& symbol() const { return symbol_; }
+    const Instrument& instrument() const { return instrument_; }
+
+    // position in lots, read by the shard's thread before each quote
+    void set_inventory(int64_t lots) {
+        inventory_.store(lots, std::memory_order_relaxed);
+    }
+    int64_t inventory() const { return inventory_.load(std::memory_order_relaxed); }
+
+    ShardStats stats() const {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        return stats_;
+    }
+
+    // apply up to max_batch queued updates, then quote once on the result
+    // if it changed. returns false when the ring had nothing new.
+    bool poll(uint64_t index, MpscQueue<ShardQuote>& out, size_t max_batch) {
+        const auto start = Clock::now();
+        ShardStats batch;
+        int64_t event_time = 0;
+        size_t read = 0;
+        const uint64_t dropped_before = cursor_.dropped();
+        while (read < max_batch) {
+            int64_t first_update_id, final_update_id;
+            size_t n_bids = 0;
+            auto status = cursor_.read(event_time, first_update_id, final_update_id,
+                                       [&](size_t bids, size_t asks) {
+                                           n_bids = bids;
+                                           levels_.resize(bids + asks);
+                                           return levels_.data();
+                                       });
+            if (status == RingCursor::Status::EMPTY) break;
+            ++read;
+            apply(first_update_id, final_update_id, n_bids, batch);
+        }
+        batch.dropped = cursor_.dropped() - dropped_before;
+        if (read == 0 && batch.dropped == 0) return false;
+        batch.messages = read;
+
+        bool quoted = false;
+        const DepthBook& market = engine_.market();
+        if (read > 0 && market.best_bid() != 0 && market.best_ask() != 0) {
+            features_.on_book(market, instrument_);
+            QuoteTicks q = quoter_.quote_ticks(market.best_bid(), market.best_ask(),
+                                               inventory(), 0.5, 0.5);
+            // an unchanged quote needs no order traffic
+            if (!has_last_ || changed(q)) {
+                if (out.push(ShardQuote{index, q.bid_ticks, q.bid_lots, q.ask_ticks,
+                                        q.ask_lots, event_time})) {
+                    last_ = q;
+                    has_last_ = true;
+                    quoted = true;
+                } else {
+                    // try again on the next change rather than drop it silently
+                    has_last_ = false;
+                    ++batch.queue_full;
+                }
+            }
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 Clock::now() - start)
+                                 .count();
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.messages += batch.messages;
+        stats_.dropped += batch.dropped;
+        stats_.stale += batch.stale;
+        stats_.gaps += batch.gaps;
+        stats_.errors += batch.errors;
+        stats_.queue_full += batch.queue_full;
+        stats_.quotes += quoted ? 1 : 0;
+        stats_.mid = features_.mid();
+        stats_.spread = features_.spread();
+        stats_.volatility = features_.volatility();
+        if (read > 0) stats_.latency.record(elapsed);
+        return true;
+    }
+
+private:
+    std::string symbol_;
+    Instrument instrument_;
+    RingCursor cursor_;
+    MatchEngine engine_;
+    FeaturePipeline features_;
+    QuoteEngine quoter_;
+    std::atomic<int64_t> inventory_{0};
+    // bids then asks of the message being applied
+    std::vector<RingLevel> levels_;
+    QuoteTicks last_{};
+    bool has_last_ = false;
+    mutable std::mutex stats_mutex_;
+    ShardStats stats_;
+
+    void apply(int64_t first_update_id, int64_t final_update_id, size_t n_bids,
+               ShardStats& batch) {
+        DepthSync sync = engine_.begin_depth_update(first_update_id, final_update_id);
+        if (sync == DepthSync::STALE) {
+            ++batch.stale;
+            return;
+        }
+        if (sync == DepthSync::GAP) {
+            // the ring carries diffs only, there is no snapshot to resync
+            // from; count it and carry on from this update like LiveEngine
+            ++batch.gaps;
+            engine_.set_last_update_id(first_update_id - 1);
+            engine_.begin_depth_update(first_update_id, final_update_id);
+        }
+        try {
+            for (size_t i = 0; i < levels_.size(); ++i) {
+                engine_.apply_l2_delta(i < n_bids ? Side::BUY : Side::SELL,
+                                       levels_[i].price, levels_[i].qty);
+            }
+        } catch (const std::exception&) {
+            // a bad level can't be allowed to take down the worker thread
+            ++batch.errors;
+        }
+    }
+
+    bool changed(const QuoteTicks& q) const {
+        return q.bid_ticks != last_.bid_ticks || q.bid_lots != last_.bid_lots ||
+               q.ask_ticks != last_.ask_ticks || q.ask_lots != last_.ask_lots;
+    }
+};
+
+// symbols sharded over pinned worker threads. each shard belongs to one
+// worker, so books, features and quoting need no locks; quotes from every
+// worker meet in one lock-free queue drained by the gateway side.
+class ShardRuntime {
+public:
+    ShardRuntime(size_t workers, std::vector<int> cpus, size_t queue_capacity,
+                 size_t max_batch = 1000,
+                 std::chrono::microseconds idle_sleep = std::chrono::microseconds(50))
+        : workers_(workers),
+          cpus_(std::move(cpus)),
+          max_batch_(max_batch),
+          idle_sleep_(idle_sleep),
+          quotes_(queue_capacity) {
+        if (workers_ == 0) throw std::invalid_argument("Workers must be at least 1");
+        if (max_batch_ == 0) throw std::invalid_argument("Max batch must be positive");
+    }
+
+    ~ShardRuntime() { stop(); }
+
+    ShardRuntime(const ShardRuntime&) = delete;
+    ShardRuntime& operator=(const ShardRuntime&) = delete;
+
+    // shards can only be added while stopped; returns the shard's index
+    size_t add(std::unique_ptr<SymbolShard> shard) {
+        if (running()) throw std::logic_error("Cannot add symbols while running");
+        shards_.push_back(std::move(shard));
+        return shards_.size() - 1;
+    }
+
+    size_t size() const { return shards_.size(); }
+    SymbolShard& shard(size_t i) { return *shards_.at(i); }
+    const SymbolShard& shard(size_t i) const { return *shards_.at(i); }
+
+    bool running() const { return running_.load(std::memory_order_acquire); }
+    size_t pinned() const { return pinned_.load(std::memory_order_relaxed); }
+
+    // shard i runs on worker i % workers, never more workers than shards
+    void start() {
+        if (running()) return;
+        running_.store(true, std::memory_order_release);
+        pinned_.store(0, std::memory_order_relaxed);
+        const size_t n = std::max<size_t>(1, std::min(workers_, shards_.size()));
+        for (size_t w = 0; w < n; ++w) {
+            threads_.emplace_back([this, w, n] { run(w, n); });
+        }
+    }
+
+    void stop() {
+        running_.store(false, std::memory_order_release);
+        for (auto& thread : threads_) thread.join();
+        threads_.clear();
+    }
+
+    // stop and drop every shard, after which their rings may be unmapped
+    void clear() {
+        stop();
+        shards_.clear();
+    }
+
+    // move up to n queued quotes into out, oldest first; one caller at a time
+    size_t drain(ShardQuote* out, size_t n) {
+        size_t count = 0;
+        while (count < n && quotes_.pop(out[count])) ++count;
+        return count;
+    }
+
+private:
+    size_t workers_;
+    std::vector<int> cpus_;
+    size_t max_batch_;
+    std::chrono::microseconds idle_sleep_;
+    std::vector<std::unique_ptr<SymbolShard>> shards_;
+    MpscQueue<ShardQuote> quotes_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> pinned_{0};
+
+    // empty polls spent spinning before a worker starts sleeping
+    static constexpr int kSpinPolls = 1000;
+
+    void run(size_t worker, size_t workers) {
+        if (pin(worker)) pinned_.fetch_add(1, std::memory_order_relaxed);
+        int idle = 0;
+        while (running()) {
+            bool busy = false;
+            for (size_t i = worker; i < shards_.size(); i += workers) {
+                busy |= shards_[i]->poll(i, quotes_, max_batch_);
+            }
+            if (busy) {
+                idle = 0;
+            } else if (++idle > kSpinPolls) {
+                std::this_thread::sleep_for(idle_sleep_);
+            }
+        }
+    }
+
+    bool pin(size_t worker) const {
+        if (cpus_.empty()) return false;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus_[worker % cpus_.size()], &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        // no portable affinity call; threads still own their shards
+        return false;
+#endif
+    }
+};
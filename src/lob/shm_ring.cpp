@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include "depth_replay.hpp"
+#include "shm_ring.hpp"
+
+namespace py = pybind11;
+
+namespace {
+
+using LevelArray = py::array_t<RingLevel, py::array::c_style>;
+
+// python face of ShmRing over a writable buffer, normally the buf of a
+// multiprocessing.shared_memory.SharedMemory. the ring keeps the buffer
+// exported for its lifetime, so the segment can't be closed underneath it.
+class PyShmRing {
+public:
+    static PyShmRing create(py::buffer buffer, size_t capacity, size_t max_levels,
+                            const std::string& tick_size, const std::string& lot_size) {
+        auto view = writable(buffer);
+        ShmRing ring = ShmRing::create(view->ptr, static_cast<size_t>(view->size),
+                                       capacity, max_levels, tick_size, lot_size);
+        return PyShmRing(std::move(view), ring);
+    }
+
+    static PyShmRing attach(py::buffer buffer) {
+        auto view = writable(buffer);
+        ShmRing ring = ShmRing::attach(view->ptr, static_cast<size_t>(view->size));
+        return PyShmRing(std::move(view), ring);
+    }
+
+    // levels are [price, qty] decimal strings as they arrive from binance,
+    // parsed onto the ring's grid without going through Decimal
+    void publish(int64_t event_time, int64_t first_update_id, int64_t final_update_id,
+                 const py::sequence& bids, const py::sequence& asks) {
+        convert(bids, bid_levels_);
+        convert(asks, ask_levels_);
+        ring_.publish(event_time, first_update_id, final_update_id, bid_levels_.data(),
+                      bid_levels_.size(), ask_levels_.data(), ask_levels_.size());
+    }
+
+    // levels already on the grid, LEVEL_DTYPE arrays as the tick store has
+    void publish_levels(int64_t event_time, int64_t first_update_id,
+                        int64_t final_update_id, const LevelArray& bids,
+                        const LevelArray& asks) {
+        ring_.publish(event_time, first_update_id, final_update_id, bids.data(),
+                      static_cast<size_t>(bids.size()), asks.data(),
+                      static_cast<size_t>(asks.size()));
+    }
+
+    const ShmRing& core() const { return ring_; }
+
+private:
+    std::shared_ptr<py::buffer_info> view_;
+    ShmRing ring_;
+    Instrument instrument_;
+    // scratch for publish, kept to reuse the storage
+    std::vector<RingLevel> bid_levels_;
+    std::vector<RingLevel> ask_levels_;
+
+    PyShmRing(std::shared_ptr<py::buffer_info> view, ShmRing ring)
+        : view_(std::move(view)),
+          ring_(ring),
+          instrument_(depth_replay_detail::parse_decimal(ring.tick_size()),
+                      depth_replay_detail::parse_decimal(ring.lot_size())) {}
+
+    static std::shared_ptr<py::buffer_info> writable(py::buffer& buffer) {
+        auto view = std::make_shared<py::buffer_info>(buffer.request(true));
+        if (view->ndim != 1 || view->itemsize != 1) {
+            throw std::invalid_argument("Ring buffer must be a flat byte buffer");
+        }
+        return view;
+    }
+
+    void convert(const py::sequence& levels, std::vector<RingLevel>& out) const {
+        out.clear();
+        for (py::handle level : levels) {
+            auto pair = py::reinterpret_borrow<py::sequence>(level);
+            if (pair.size() != 2) {
+                throw std::invalid_argument("Depth level must be (price, qty)");
+            }
+            out.push_back(RingLevel{
+                instrument_.to_ticks(
+                    depth_replay_detail::parse_decimal(pair[0].cast<std::string>())),
+                instrument_.to_lots(
+                    depth_replay_detail::parse_decimal(pair[1].cast<std::string>()))});
+        }
+    }
+};
+
+// one consumer's cursor into a PyShmRing
+class PyRingReader {
+public:
+    PyRingReader(const PyShmRing& ring, bool from_oldest)
+        : cursor_(ring.core(), from_oldest) {
+        scratch_.resize(ring.core().max_levels());
+    }
+
+    // (event_time, first_update_id, final_update_id, bids, asks) with
+    // LEVEL_DTYPE level arrays, or None when the consumer is caught up
+    py::object read() {
+        int64_t event_time, first_update_id, final_update_id;
+        size_t n_bids = 0, n_asks = 0;
+        auto alloc = [&](size_t bids, size_t asks) {
+            n_bids = bids;
+            n_asks = asks;
+            return scratch_.data();
+        };
+        RingCursor::Status status =
+            cursor_.read(event_time, first_update_id, final_update_id, alloc);
+        if (status == RingCursor::Status::EMPTY) return py::none();
+        LevelArray bids(static_cast<py::ssize_t>(n_bids));
+        LevelArray asks(static_cast<py::ssize_t>(n_asks));
+        std::copy(scratch_.begin(), scratch_.begin() + n_bids, bids.mutable_data());
+        std::copy(scratch_.begin() + n_bids, scratch_.begin() + n_bids + n_asks,
+                  asks.mutable_data());
+        return py::make_tuple(event_time, first_update_id, final_update_id, bids, asks);
+    }
+
+    const RingCursor& cursor() const { return cursor_; }
+
+private:
+    RingCursor cursor_;
+    std::vector<RingLevel> scratch_;
+};
+
+}  // namespace
+
+// the native ring behind a python ShmRing, for consumers in other modules.
+// the caller keeps the python object alive while it uses the ring.
+ShmRing shm_ring_core(py::handle ring) {
+    return ring.cast<const PyShmRing&>().core();
+}
+
+void bind_shm_ring(py::module_& m) {
+    PYBIND11_NUMPY_DTYPE(RingLevel, price, qty);
+
+    py::class_<PyShmRing>(m, "ShmRing")
+        .def_static("bytes_for", &ShmRing::bytes_for, py::arg("capacity"),
+                    py::arg("max_levels"))
+        .def_static("create", &PyShmRing::create, py::arg("buffer"),
+                    py::arg("capacity"), py::arg("max_levels"), py::arg("tick_size"),
+                    py::arg("lot_size"))
+        .def_static("attach", &PyShmRing::attach, py::arg("buffer"))
+        .def("publish", &PyShmRing::publish, py::arg("event_time"),
+             py::arg("first_update_id"), py::arg("final_update_id"), py::arg("bids"),
+             py::arg("asks"))
+        .def("publish_levels", &PyShmRing::publish_levels, py::arg("event_time"),
+             py::arg("first_update_id"), py::arg("final_update_id"), py::arg("bids"),
+             py::arg("asks"))
+        .def_property_readonly("capacity", [](const PyShmRing& r) {
+            return r.core().capacity();
+        })
+        .def_property_readonly("max_levels", [](const PyShmRing& r) {
+            return r.core().max_levels();
+        })
+        .def_property_readonly("tick_size", [](const PyShmRing& r) {
+            return r.core().tick_size();
+        })
+        .def_property_readonly("lot_size", [](const PyShmRing& r) {
+            return r.core().lot_size();
+        })
+        .def_property_readonly("write_seq", [](const PyShmRing& r) {
+            return r.core().write_seq();
+        });
+
+    // the reader keeps its ring, and so the mapping, alive
+    py::class_<PyRingReader>(m, "RingReader")
+        .def(py::init<const PyShmRing&, bool>(), py::arg("ring"),
+             py::arg("from_oldest") = false, py::keep_alive<1, 2>())
+        .def("read", &PyRingReader::read)
+        .def_property_readonly("position", [](const PyRingReader& r) {
+            return r.cursor().position();
+        })
+        .def_property_readonly("dropped", [](const PyRingReader& r) {
+            return r.cursor().dropped();
+        });
+}
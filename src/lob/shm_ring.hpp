@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// one depth level on the ring's grid, laid out like the tick store's
+// LEVEL_DTYPE (price ticks, qty lots)
+struct RingLevel {
+    int64_t price;
+    int64_t qty;
+};
+
+namespace shm_ring_detail {
+
+constexpr uint64_t kMagic = 0x31474e49524d4d;  // "MMRING1"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kCacheLine = 64;
+constexpr size_t kGridChars = 24;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory ring needs address-free 64-bit atomics");
+
+// start of the mapping. the grid is kept as the decimal strings it was
+// created from so python readers can rebuild exact Decimal levels.
+struct RingHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t max_levels;
+    uint64_t capacity;
+    uint64_t slot_size;
+    char tick_size[kGridChars];
+    char lot_size[kGridChars];
+    // messages published so far; the only word consumers poll
+    alignas(kCacheLine) std::atomic<uint64_t> write_seq;
+};
+
+// each slot is a seqlock: seq is odd while message n is being written and
+// 2n + 2 once it is complete, so a reader can tell a finished message from
+// a torn or newer one without any lock
+struct SlotHeader {
+    std::atomic<uint64_t> seq;
+    int64_t event_time;
+    int64_t first_update_id;
+    int64_t final_update_id;
+    uint32_t n_bids;
+    uint32_t n_asks;
+};
+
+inline size_t round_up(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+inline uint64_t done_seq(uint64_t n) { return 2 * n + 2; }
+
+}  // namespace shm_ring_detail
+
+// single-producer, multi-consumer broadcast ring of fixed-size depth
+// records over memory the caller maps, e.g. a POSIX shared memory segment.
+// the producer never waits: a consumer that falls a full ring behind is
+// lapped and skips ahead, so a durable transport must cover catch-up.
+class ShmRing {
+public:
+    static size_t slot_size(size_t max_levels) {
+        using namespace shm_ring_detail;
+        return round_up(sizeof(SlotHeader) + max_levels * sizeof(RingLevel),
+                        kCacheLine);
+    }
+
+    static size_t bytes_for(size_t capacity, size_t max_levels) {
+        using namespace shm_ring_detail;
+        return round_up(sizeof(RingHeader), kCacheLine) +
+               capacity * slot_size(max_levels);
+    }
+
+    // lay out a fresh ring in [base, base + size). capacity must be a power
+    // of two; tick and lot are the grid as decimal strings.
+    static ShmRing create(void* base, size_t size, size_t capacity, size_t max_levels,
+                          std::string_view tick_size, std::string_view lot_size) {
+        using namespace shm_ring_detail;
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("Ring capacity must be a power of two");
+        }
+        if (max_levels == 0 || max_levels > UINT32_MAX) {
+            throw std::invalid_argument("Ring max levels must be positive");
+        }
+        if (tick_size.size() >= kGridChars || lot_size.size() >= kGridChars) {
+            throw std::invalid_argument("Ring grid must fit in 23 characters");
+        }
+        if (size < bytes_for(capacity, max_levels)) {
+            throw std::invalid_argument("Ring buffer is too small");
+        }
+        check_alignment(base);
+        std::memset(base, 0, bytes_for(capacity, max_levels));
+        auto* header = new (base) RingHeader;
+        header->version = kVersion;
+        header->max_levels = static_cast<uint32_t>(max_levels);
+        header->capacity = capacity;
+        header->slot_size = slot_size(max_levels);
+        std::memcpy(header->tick_size, tick_size.data(), tick_size.size());
+        std::memcpy(header->lot_size, lot_size.data(), lot_size.size());
+        header->write_seq.store(0, std::memory_order_relaxed);
+        // magic last, so an attach racing the create sees no ring rather
+        // than a half-written header
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = kMagic;
+        return ShmRing(header);
+    }
+
+    // map onto a ring another process created
+    static ShmRing attach(void* base, size_t size) {
+        using namespace shm_ring_detail;
+        if (size < sizeof(RingHeader)) {
+            throw std::invalid_argument("Ring buffer is too small");
+        }
+        check_alignment(base);
+        auto* header = static_cast<RingHeader*>(base);
+        if (header->magic != kMagic) {
+            throw std::invalid_argument("Not a depth ring");
+        }
+        if (header->version != kVersion) {
+            throw std::invalid_argument("Unsupported depth ring version");
+        }
+        if (header->slot_size != slot_size(header->max_levels) ||
+            size < bytes_for(header->capacity, header->max_levels)) {
+            throw std::invalid_argument("Depth ring header does not match its size");
+        }
+        return ShmRing(header);
+    }
+
+    size_t capacity() const { return header_->capacity; }
+    size_t max_levels() const { return header_->max_levels; }
+    std::string tick_size() const { return grid(header_->tick_size); }
+    std::string lot_size() const { return grid(header_->lot_size); }
+
+    uint64_t write_seq() const {
+        return header_->write_seq.load(std::memory_order_acquire);
+    }
+
+    // append one message, overwriting the oldest once the ring is full.
+    // only one process may publish to a ring.
+    void publish(int64_t event_time, int64_t first_update_id, int64_t final_update_id,
+                 const RingLevel* bids, size_t n_bids, const RingLevel* asks,
+                 size_t n_asks) {
+        using namespace shm_ring_detail;
+        if (n_bids + n_asks > header_->max_levels) {
+            throw std::invalid_argument(
+                "Depth update has more levels than a ring slot");
+        }
+        const uint64_t n = header_->write_seq.load(std::memory_order_relaxed);
+        SlotHeader* slot = slot_at(n);
+        slot->seq.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot->event_time = event_time;
+        slot->first_update_id = first_update_id;
+        slot->final_update_id = final_update_id;
+        slot->n_bids = static_cast<uint32_t>(n_bids);
+        slot->n_asks = static_cast<uint32_t>(n_asks);
+        RingLevel* levels = levels_of(slot);
+        if (n_bids) std::memcpy(levels, bids, n_bids * sizeof(RingLevel));
+        if (n_asks) std::memcpy(levels + n_bids, asks, n_asks * sizeof(RingLevel));
+
+        slot->seq.store(done_seq(n), std::memory_order_release);
+        header_->write_seq.store(n + 1, std::memory_order_release);
+    }
+
+private:
+    friend class RingCursor;
+
+    shm_ring_detail::RingHeader* header_;
+
+    explicit ShmRing(shm_ring_detail::RingHeader* header) : header_(header) {}
+
+    shm_ring_detail::SlotHeader* slot_at(uint64_t n) const {
+        char* slots = reinterpret_cast<char*>(header_) +
+                      shm_ring_detail::round_up(sizeof(shm_ring_detail::RingHeader),
+                                                shm_ring_detail::kCacheLine);
+        return reinterpret_cast<shm_ring_detail::SlotHeader*>(
+            slots + (n & (header_->capacity - 1)) * header_->slot_size);
+    }
+
+    static RingLevel* levels_of(shm_ring_detail::SlotHeader* slot) {
+        return reinterpret_cast<RingLevel*>(slot + 1);
+    }
+
+    static void check_alignment(const void* base) {
+        if (reinterpret_cast<uintptr_t>(base) % shm_ring_detail::kCacheLine != 0) {
+            throw std::invalid_argument("Ring buffer must be 64-byte aligned");
+        }
+    }
+
+    static std::string grid(const char* text) {
+        return std::string(text, strnlen(text, shm_ring_detail::kGridChars));
+    }
+};
+
+// one consumer's position in a ring. consumers never write to the
+// mapping, so any number of them can follow one producer.
+class RingCursor {
+public:
+    enum class Status { EMPTY, READ };
+
+    // from_oldest starts at the oldest message still in the ring, otherwise
+    // only messages published after the cursor is made are read
+    explicit RingCursor(const ShmRing& ring, bool from_oldest = false) : ring_(ring) {
+        const uint64_t head = ring_.write_seq();
+        next_ = head;
+        if (from_oldest) next_ = head > ring_.capacity() ? head - ring_.capacity() : 0;
+    }
+
+    uint64_t position() const { return next_; }
+    // messages overwritten before this cursor got to them
+    uint64_t dropped() const { return dropped_; }
+
+    // copy the next message out: alloc(n_bids, n_asks) returns storage for
+    // n_bids + n_asks levels, bids first. a message overwritten while it
+    // was being copied is counted as dropped and the read moves on.
+    template <class Alloc>
+    Status read(int64_t& event_time, int64_t& first_update_id, int64_t& final_update_id,
+                Alloc&& alloc) {
+        using namespace shm_ring_detail;
+        while (true) {
+            const uint64_t head = ring_.write_seq();
+            if (next_ == head) return Status::EMPTY;
+            if (head - next_ > ring_.capacity()) {
+                dropped_ += head - ring_.capacity() - next_;
+                next_ = head - ring_.capacity();
+            }
+
+            SlotHeader* slot = ring_.slot_at(next_);
+            const uint64_t seq = slot->seq.load(std::memory_order_acquire);
+            if (seq != done_seq(next_)) {
+                // the producer has already lapped this slot
+                skip();
+                continue;
+            }
+            event_time = slot->event_time;
+            first_update_id = slot->first_update_id;
+            final_update_id = slot->final_update_id;
+            // counts can be torn too, bound them before copying
+            size_t n_bids = std::min<size_t>(slot->n_bids, ring_.max_levels());
+            size_t n_asks = std::min<size_t>(slot->n_asks, ring_.max_levels() - n_bids);
+            RingLevel* out = alloc(n_bids, n_asks);
+            std::memcpy(out, ShmRing::levels_of(slot),
+                        (n_bids + n_asks) * sizeof(RingLevel));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->seq.load(std::memory_order_relaxed) != seq) {
+                skip();
+                continue;
+            }
+            ++next_;
+            return Status::READ;
+        }
+    }
+
+private:
+    ShmRing ring_;
+    uint64_t next_ = 0;
+    uint64_t dropped_ = 0;
+
+    void skip() {
+        ++dropped_;
+        ++next_;
+    }
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+// order book side (bids or asks)
+enum class Side {
+    BUY,
+    SELL
+};
@@ -12,7 +12,7 @@ import logging
 from dataclasses import dataclass
 from decimal import Decimal
 from pathlib import Path
-from typing import List
+from typing import Any, Iterable, List, Optional, Sequence, Tuple, Union
 
 import joblib
 import numpy as np
@@ -23,6 +23,12 @@ from sklearn.model_selection import train_test_split
 from sklearn.preprocessing import StandardScaler
 
 from features.imbalance import get_imbalance_features
+from models.training_set import NEGATIVES_PER_FILL, build_training_set
+
+try:
+    from match_engine import logistic_proba
+except ImportError:  # extension not built, score with numpy
+    logistic_proba = None
 
 logging.basicConfig(
     level=logging.INFO, format="%(asctime)s - %(name)s - %(levelname)s - %(message)s"
@@ -89,6 +95,8 @@ class FillProbabilityModel:
         """
         self.model = None
         self.scaler = StandardScaler()
+        # (model, weights, intercept) with the scaler folded in
+        self._linear: Optional[Tuple[LogisticRegression, np.ndarray, float]] = None
         self.model_path = Path(model_path)
         self.model_path.parent.mkdir(parents=True, exist_ok=True)
 
@@ -112,6 +120,36 @@ class FillProbabilityModel:
         returns:
             FillFeatures instance
         """
+        mid_price, book = self._book_state(bids, asks)
+
+        # calculate price distance from mid
+        price_distance = float(abs(order_price - mid_price)) / float(mid_price)
+
+        return FillFeatures(
+            bid_ask_spread=book[0],
+            mid_price=book[1],
+            bid_volume=book[2],
+            ask_volume=book[3],
+            imbalance_1=book[4],
+            imbalance_2=book[5],
+            imbalance_5=book[6],
+            price_distance=price_distance,
+            size=float(order_size),
+            side=order_side,
+        )
+
+    def _book_state(
+        self, bids: List[List[str]], asks: List[List[str]]
+    ) -> Tuple[Decimal, List[float]]:
+        """compute the order book features shared by every order
+
+        args:
+            bids: list of [price, quantity] pairs, sorted descending
+            asks: list of [price, quantity] pairs, sorted ascending
+
+        returns:
+            (mid price, the first seven FillFeatures columns in order)
+        """
         # get best bid and ask
         best_bid = Decimal(bids[0][0]) if bids else Decimal("0")
         best_ask = Decimal(asks[0][0]) if asks else Decimal("0")
@@ -127,79 +165,75 @@ class FillProbabilityModel:
         # get imbalance features
         imbalance_features = get_imbalance_features(bids, asks)
 
-        # calculate price distance from mid
-        price_distance = float(abs(order_price - mid_price)) / float(mid_price)
+        return mid_price, [
+            spread,
+            float(mid_price),
+            float(bid_volume),
+            float(ask_volume),
+            imbalance_features["imbalance_1"],
+            imbalance_features["imbalance_2"],
+            imbalance_features["imbalance_5"],
+        ]
+
+    def feature_matrix(
+        self,
+        bids: List[List[str]],
+        asks: List[List[str]],
+        order_prices: Sequence[Decimal],
+        order_size: Decimal,
+        order_sides: Sequence[str],
+    ) -> np.ndarray:
+        """build model input for many orders against one order book state
 
-        return FillFeatures(
-            bid_ask_spread=spread,
-            mid_price=float(mid_price),
-            bid_volume=float(bid_volume),
-            ask_volume=float(ask_volume),
-            imbalance_1=imbalance_features["imbalance_1"],
-            imbalance_2=imbalance_features["imbalance_2"],
-            imbalance_5=imbalance_features["imbalance_5"],
-            price_distance=price_distance,
-            size=float(order_size),
-            side=order_side,
-        )
+        the book features are computed once and broadcast, so each extra
+        order only costs its price distance
+
+        args:
+            bids: list of [price, quantity] pairs, sorted descending
+            asks: list of [price, quantity] pairs, sorted ascending
+            order_prices: price of each order
+            order_size: size shared by every order
+            order_sides: side of each order (buy or sell)
+
+        returns:
+            (len(order_prices), 10) array in FillFeatures.to_array() order
+        """
+        mid_price, book = self._book_state(bids, asks)
+        mid = float(mid_price)
+        X = np.empty((len(order_prices), 10))
+        X[:, :7] = book
+        X[:, 7] = [float(abs(price - mid_price)) / mid for price in order_prices]
+        X[:, 8] = float(order_size)
+        X[:, 9] = [1.0 if side == "buy" else 0.0 for side in order_sides]
+        return X
 
     def train(
         self,
-        fills_df: pd.DataFrame,
+        fills_df: Union[pd.DataFrame, Iterable[Any]],
         test_size: float = 0.2,
         random_state: int = 42,
+        negatives: int = NEGATIVES_PER_FILL,
+        workers: int = 1,
     ) -> float:
         """train model on backtest fill data
 
+        each fill is paired with synthetic unfilled orders behind its
+        price. rows are built column-wise by models.training_set, in
+        FillFeatures.to_array() order, so saved models stay compatible.
+
         args:
-            fills_df: dataframe with fill data
+            fills_df: dataframe with fill data, or an iterable of dataframe
+                or arrow record batch chunks for logs larger than memory
             test_size: proportion of data to use for testing
             random_state: random seed for reproducibility
+            negatives: unfilled orders generated per fill
+            workers: processes building chunks
 
         returns:
             auc score on test set
         """
         # extract features and labels
-        X = []
-        y = []
-
-        for _, row in fills_df.iterrows():
-            features = self.extract_features(
-                row["bids"],
-                row["asks"],
-                Decimal(str(row["price"])),
-                Decimal(str(row["size"])),
-                row["side"],
-            )
-            X.append(features.to_array())
-            y.append(1)  # filled order
-
-            # add negative examples (unfilled orders)
-            # sample from a range of prices around the mid price
-            mid_price = Decimal(str(row["price"]))
-            spread = Decimal("0.01")  # 1% spread
-            for _ in range(5):  # generate 5 negative examples per fill
-                if row["side"] == "buy":
-                    worse_price = mid_price - spread * Decimal(
-                        str(np.random.uniform(0.5, 1.5))
-                    )
-                else:
-                    worse_price = mid_price + spread * Decimal(
-                        str(np.random.uniform(0.5, 1.5))
-                    )
-
-                features = self.extract_features(
-                    row["bids"],
-                    row["asks"],
-                    worse_price,
-                    Decimal(str(row["size"])),
-                    row["side"],
-                )
-                X.append(features.to_array())
-                y.append(0)  # unfilled order
-
-        X = np.array(X)
-        y = np.array(y)
+        X, y = build_training_set(fills_df, negatives=negatives, workers=workers)
 
         # split data
         X_train, X_test, y_train, y_test = train_test_split(
@@ -252,6 +286,52 @@ class FillProbabilityModel:
         X_scaled = self.scaler.transform(X)
         return float(self.model.predict_proba(X_scaled)[0, 1])
 
+    def predict_batch(
+        self,
+        bids: List[List[str]],
+        asks: List[List[str]],
+        order_prices: Sequence[Decimal],
+        order_size: Decimal,
+        order_sides: Sequence[str],
+    ) -> np.ndarray:
+        """predict fill probabilities for many orders in one pass
+
+        same result as calling predict() per order, but the book features
+        are extracted once and every row is scored by one native logistic
+        kernel call (numpy when the extension isn't built)
+
+        args:
+            bids: list of [price, quantity] pairs, sorted descending
+            asks: list of [price, quantity] pairs, sorted ascending
+            order_prices: price of each order
+            order_size: size shared by every order
+            order_sides: side of each order (buy or sell)
+
+        returns:
+            predicted fill probability of each order
+        """
+        if self.model is None:
+            raise RuntimeError("model not trained")
+
+        X = self.feature_matrix(bids, asks, order_prices, order_size, order_sides)
+        weights, intercept = self._linear_weights()
+        if logistic_proba is not None:
+            return logistic_proba(X, weights, intercept)
+        return 1.0 / (1.0 + np.exp(-(X @ weights + intercept)))
+
+    def _linear_weights(self) -> Tuple[np.ndarray, float]:
+        """fold the scaler into the logistic weights
+
+        returns:
+            (weights, intercept) so that raw features score as
+            sigmoid(x . weights + intercept)
+        """
+        if self._linear is None or self._linear[0] is not self.model:
+            weights = self.model.coef_[0] / self.scaler.scale_
+            intercept = float(self.model.intercept_[0] - weights @ self.scaler.mean_)
+            self._linear = (self.model, np.ascontiguousarray(weights), intercept)
+        return self._linear[1], self._linear[2]
+
     def save(self) -> None:
         """save model and scaler to disk"""
         if self.model is None:
@@ -0,0 +1,298 @@
+"""
+columnar training set construction for the fill probability model
+
+this module provides:
+1. padded level arrays from whole columns of book snapshots, either python
+   [price, qty] lists or arrow list<struct<price, qty>> tick/lot columns
+2. book and order features over those arrays in FillFeatures.to_array() order
+3. chunked building from an iterable of frames or record batches, so the
+   raw books never have to fit in memory at once, with the per-chunk work
+   optionally spread over worker processes
+
+only the feature rows are kept, 80 bytes per row, so a fill log much larger
+than memory still trains as long as its features fit.
+"""
+
+import multiprocessing
+from collections import deque
+from concurrent.futures import ProcessPoolExecutor
+from decimal import Decimal
+from itertools import chain
+from typing import Any, Iterable, List, Optional, Tuple, Union
+
+import numpy as np
+import pandas as pd
+import pyarrow as pa
+import pyarrow.compute as pc
+
+from data_feed.parquet_writer import decode_levels, schema_units
+
+# FillFeatures.to_array() column order, shared with saved models
+FEATURE_COLUMNS = (
+    "bid_ask_spread",
+    "mid_price",
+    "bid_volume",
+    "ask_volume",
+    "imbalance_1",
+    "imbalance_2",
+    "imbalance_5",
+    "price_distance",
+    "size",
+    "side",
+)
+
+NEGATIVES_PER_FILL = 5
+# negatives sit this far (times U(0.5, 1.5)) behind the fill price
+NEGATIVE_OFFSET = 0.01
+# chunks submitted ahead of the one being collected, per worker
+_PREFETCH = 2
+
+Chunk = Union[pd.DataFrame, pa.RecordBatch, pa.Table]
+Units = Optional[Tuple[Decimal, Decimal]]
+
+
+def _pad(
+    lengths: np.ndarray, prices: np.ndarray, qtys: np.ndarray
+) -> Tuple[np.ndarray, np.ndarray]:
+    """scatter flat levels into zero-padded (rows, max levels) arrays"""
+    rows = len(lengths)
+    width = max(int(lengths.max(initial=0)), 1)
+    row_index = np.repeat(np.arange(rows), lengths)
+    starts = np.cumsum(lengths) - lengths
+    col_index = np.arange(len(row_index)) - np.repeat(starts, lengths)
+    padded_prices = np.zeros((rows, width))
+    padded_qtys = np.zeros((rows, width))
+    padded_prices[row_index, col_index] = prices
+    padded_qtys[row_index, col_index] = qtys
+    return padded_prices, padded_qtys
+
+
+def level_arrays(column: Any, units: Units = None) -> Tuple[np.ndarray, np.ndarray]:
+    """convert a column of book sides into padded price and quantity arrays
+
+    empty levels are zero, so a side without levels has best price 0 like
+    FillProbabilityModel.extract_features assumes
+
+    args:
+        column: sequence of [[price, qty], ...] lists, or an arrow array of
+            either parquet schema version
+        units: (tick_size, lot_size) for arrow tick/lot columns, usually
+            parquet_writer.schema_units() of the file
+
+    returns:
+        (prices, quantities), each (rows, max levels) float64
+    """
+    if isinstance(column, pa.ChunkedArray):
+        column = column.combine_chunks()
+    is_list = isinstance(column, pa.Array) and pa.types.is_list(column.type)
+    if is_list and pa.types.is_struct(column.type.value_type):
+        if units is None:
+            raise ValueError("tick/lot levels need the file's tick and lot size")
+        tick_size, lot_size = units
+        lengths = pc.fill_null(pc.list_value_length(column), 0).to_numpy()
+        values = column.flatten()
+        prices = values.field("price").to_numpy(zero_copy_only=False)
+        qtys = values.field("qty").to_numpy(zero_copy_only=False)
+        return _pad(
+            lengths.astype(np.intp),
+            prices * float(tick_size),
+            qtys * float(lot_size),
+        )
+
+    if is_list and pa.types.is_string(column.type.value_type):
+        # version 1 "price,qty" strings
+        column = [decode_levels(levels, None) for levels in column.to_pylist()]
+    elif isinstance(column, pa.Array):
+        column = column.to_pylist()
+    lengths = np.fromiter(
+        (len(levels) for levels in column), dtype=np.intp, count=len(column)
+    )
+    # numpy parses the decimal strings in one pass over the flattened levels
+    flat = np.array(list(chain.from_iterable(column)), dtype=np.float64)
+    flat = flat.reshape(-1, 2)
+    return _pad(lengths, flat[:, 0], flat[:, 1])
+
+
+def _imbalance(bid_qtys: np.ndarray, ask_qtys: np.ndarray, levels: int) -> np.ndarray:
+    """calculate_imbalance over every row, 0 where both sides are empty"""
+    bid_volume = bid_qtys[:, :levels].sum(axis=1)
+    ask_volume = ask_qtys[:, :levels].sum(axis=1)
+    total = bid_volume + ask_volume
+    out = np.zeros(len(total))
+    np.divide(bid_volume - ask_volume, total, out=out, where=total != 0)
+    return out
+
+
+def book_features(
+    bid_prices: np.ndarray,
+    bid_qtys: np.ndarray,
+    ask_prices: np.ndarray,
+    ask_qtys: np.ndarray,
+) -> np.ndarray:
+    """compute the book part of FillFeatures for every snapshot
+
+    args:
+        bid_prices: (rows, levels) bid prices, best first, zero padded
+        bid_qtys: matching bid quantities
+        ask_prices: (rows, levels) ask prices, best first, zero padded
+        ask_qtys: matching ask quantities
+
+    returns:
+        (rows, 7) array: spread, mid, bid volume, ask volume and the
+        1/2/5-level imbalances
+
+    raises:
+        ValueError: if a snapshot has neither a bid nor an ask
+    """
+    best_bid = bid_prices[:, 0]
+    best_ask = ask_prices[:, 0]
+    mid = (best_bid + best_ask) / 2
+    empty = np.flatnonzero(mid == 0)
+    if len(empty):
+        raise ValueError(f"book snapshot {empty[0]} has no bids or asks")
+
+    out = np.empty((len(mid), 7))
+    out[:, 0] = (best_ask - best_bid) / mid
+    out[:, 1] = mid
+    out[:, 2] = bid_qtys.sum(axis=1)
+    out[:, 3] = ask_qtys.sum(axis=1)
+    out[:, 4] = _imbalance(bid_qtys, ask_qtys, 1)
+    out[:, 5] = _imbalance(bid_qtys, ask_qtys, 2)
+    out[:, 6] = _imbalance(bid_qtys, ask_qtys, 5)
+    return out
+
+
+def fill_features(
+    book: np.ndarray,
+    prices: np.ndarray,
+    sizes: np.ndarray,
+    is_buy: np.ndarray,
+    offsets: np.ndarray,
+) -> Tuple[np.ndarray, np.ndarray]:
+    """build each fill's row followed by its synthetic unfilled orders
+
+    the unfilled orders copy the fill but sit NEGATIVE_OFFSET * offset
+    behind its price: below it for buys, above it for sells
+
+    args:
+        book: (rows, 7) output of book_features
+        prices: fill prices
+        sizes: fill sizes
+        is_buy: true for buy fills
+        offsets: (rows, negatives) multipliers, U(0.5, 1.5) in training
+
+    returns:
+        (features, labels) with rows * (negatives + 1) rows in fill order
+    """
+    rows, negatives = offsets.shape
+    sign = np.where(is_buy, 1.0, -1.0)
+    order_prices = np.empty((rows, negatives + 1))
+    order_prices[:, 0] = prices
+    order_prices[:, 1:] = prices[:, None] - (sign * NEGATIVE_OFFSET)[:, None] * offsets
+
+    mid = book[:, 1]
+    X = np.empty((rows, negatives + 1, len(FEATURE_COLUMNS)))
+    X[:, :, :7] = book[:, None, :]
+    X[:, :, 7] = np.abs(order_prices - mid[:, None]) / mid[:, None]
+    X[:, :, 8] = sizes[:, None]
+    X[:, :, 9] = is_buy[:, None]
+
+    y = np.zeros((rows, negatives + 1), dtype=np.int64)
+    y[:, 0] = 1
+    return X.reshape(-1, len(FEATURE_COLUMNS)), y.reshape(-1)
+
+
+def _float_column(values: Any) -> np.ndarray:
+    if isinstance(values, (pa.Array, pa.ChunkedArray)):
+        values = pc.cast(values, pa.float64()).to_numpy(zero_copy_only=False)
+    return np.asarray(values, dtype=np.float64)
+
+
+def _chunk_rows(
+    chunk: Chunk, offsets: np.ndarray, units: Units
+) -> Tuple[np.ndarray, np.ndarray]:
+    """features and labels of one chunk, run in a worker when parallel"""
+    if isinstance(chunk, pd.DataFrame):
+        bids, asks = chunk["bids"].tolist(), chunk["asks"].tolist()
+        is_buy = chunk["side"].to_numpy() == "buy"
+    else:
+        if units is None:
+            units = schema_units(chunk.schema)
+        bids, asks = chunk.column("bids"), chunk.column("asks")
+        is_buy = pc.equal(chunk.column("side"), "buy").to_numpy(zero_copy_only=False)
+
+    book = book_features(*level_arrays(bids, units), *level_arrays(asks, units))
+    return fill_features(
+        book,
+        _float_column(chunk["price"]),
+        _float_column(chunk["size"]),
+        is_buy,
+        offsets,
+    )
+
+
+def _context() -> multiprocessing.context.BaseContext:
+    # same choice as the sweep runner: fork where available
+    if "fork" in multiprocessing.get_all_start_methods():
+        return multiprocessing.get_context("fork")
+    return multiprocessing.get_context()
+
+
+def build_training_set(
+    fills: Union[Chunk, Iterable[Chunk]],
+    negatives: int = NEGATIVES_PER_FILL,
+    workers: int = 1,
+    units: Units = None,
+) -> Tuple[np.ndarray, np.ndarray]:
+    """build fill probability training rows from fills and their books
+
+    every chunk needs bids, asks, price, size and side columns. pandas
+    chunks hold [price, qty] lists, arrow chunks may also hold tick/lot
+    structs, scaled by units or the chunk's schema metadata. the negative
+    offsets come from np.random in chunk order, so a seeded run gives the
+    same rows for any chunking and worker count.
+
+    args:
+        fills: one frame/batch/table, or an iterable of them such as
+            pyarrow.parquet.ParquetFile.iter_batches()
+        negatives: synthetic unfilled orders per fill
+        workers: processes building chunks, 1 builds them in this process
+        units: (tick_size, lot_size) of arrow tick/lot levels
+
+    returns:
+        (features, labels): (rows, 10) float64 in FillFeatures.to_array()
+        order and int64 labels, 1 for fills
+
+    raises:
+        ValueError: if workers is less than 1 or a book is empty
+    """
+    if workers < 1:
+        raise ValueError("workers must be at least 1")
+    if isinstance(fills, (pd.DataFrame, pa.RecordBatch, pa.Table)):
+        fills = [fills]
+
+    def tasks():
+        for chunk in fills:
+            offsets = np.random.uniform(0.5, 1.5, size=(len(chunk), negatives))
+            yield chunk, offsets, units
+
+    parts: List[Tuple[np.ndarray, np.ndarray]] = []
+    if workers == 1:
+        parts = [_chunk_rows(*task) for task in tasks()]
+    else:
+        # bounded look-ahead keeps only a few raw chunks in flight
+        with ProcessPoolExecutor(max_workers=workers, mp_context=_context()) as pool:
+            pending: deque = deque()
+            for task in tasks():
+                pending.append(pool.submit(_chunk_rows, *task))
+                if len(pending) >= _PREFETCH * workers:
+                    parts.append(pending.popleft().result())
+            parts.extend(future.result() for future in pending)
+
+    if not parts:
+        return np.empty((0, len(FEATURE_COLUMNS))), np.empty(0, dtype=np.int64)
+    return (
+        np.concatenate([X for X, _ in parts]),
+        np.concatenate([y for _, y in parts]),
+    )
+
@@ -0,0 +1,57 @@
+"""
+match engine snapshots on disk
+
+this module writes the bytes of MatchEngine.snapshot() to a file beside its
+final path and renames it over that path, so a reader never sees half a
+snapshot. the same bytes go into redis as a plain value, see LiveEngine.
+
+the bytes are the engine's own binary image (orders in queue order, market
+depth and string ids), so loading one is a copy and a relink of the orders,
+not a replay of the updates that built the book
+"""
+
+import os
+from pathlib import Path
+from typing import Any, Union
+
+
+def save_engine(engine: Any, path: Union[str, Path]) -> int:
+    """write an engine snapshot to path atomically
+
+    Args:
+        engine: MatchEngine (or either backend) to snapshot
+        path: file to write
+
+    Returns:
+        snapshot size in bytes
+    """
+    path = Path(path)
+    data = engine.snapshot()
+    tmp_path = path.with_name(path.name + ".tmp")
+    with open(tmp_path, "wb") as f:
+        f.write(data)
+        f.flush()
+        os.fsync(f.fileno())
+    os.replace(tmp_path, path)
+    return len(data)
+
+
+def load_engine(engine: Any, path: Union[str, Path]) -> bool:
+    """restore an engine from a snapshot file
+
+    Args:
+        engine: engine on the snapshot's tick/lot grid
+        path: file written by save_engine()
+
+    Returns:
+        False if there is no snapshot at path, the engine is then untouched
+
+    Raises:
+        ValueError: if the file is not a snapshot for this engine's grid
+    """
+    try:
+        data = Path(path).read_bytes()
+    except FileNotFoundError:
+        return False
+    engine.restore(data)
+    return True
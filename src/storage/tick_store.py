@@ -0,0 +1,751 @@
+"""
+memory-mapped tick store for depth updates
+
+this module provides an append-only binary format for depth messages:
+1. `{symbol}_{YYYYMMDD}.ticks` holds fixed-size level records (price ticks,
+   qty lots), each message's bids followed by its asks
+2. `{symbol}_{YYYYMMDD}.tidx` holds one fixed-size entry per message with its
+   event time, update ids and the offset/count of its level records
+3. readers memory-map both files, so seeking to a timestamp is a binary
+   search over the index and never touches the preceding records
+4. load_parquet() decodes a parquet day into the same layout in memory, for
+   callers that replay it many times
+5. optional `.tckp`/`.tckl` checkpoint files hold the full book a diff
+   replay has built every n messages, so a replay can start anywhere in the
+   day from the nearest checkpoint instead of from an empty book
+
+every file starts with a 64-byte header carrying a magic, the format version,
+the record size and the tick/lot grid as decimal strings. messages must be
+appended in event time order for seeks to be exact.
+"""
+
+import datetime
+import logging
+import os
+from decimal import Decimal
+from pathlib import Path
+from typing import Any, Dict, Iterator, List, Optional, Tuple, Union
+
+import numpy as np
+import pyarrow.parquet as pq
+
+from data_feed.parquet_writer import schema_units, to_units
+from data_feed.schemas import DepthUpdate
+
+logger = logging.getLogger(__name__)
+
+FORMAT_VERSION = 1
+TICKS_MAGIC = b"MMTICKS1"
+INDEX_MAGIC = b"MMTIDX01"
+CHECKPOINT_MAGIC = b"MMTCKP01"
+CHECKPOINT_LEVELS_MAGIC = b"MMTCKL01"
+
+HEADER_DTYPE = np.dtype(
+    [
+        ("magic", "S8"),
+        ("version", "<u4"),
+        ("record_size", "<u4"),
+        ("tick_size", "S24"),
+        ("lot_size", "S24"),
+    ]
+)
+HEADER_SIZE = HEADER_DTYPE.itemsize
+
+# one price level, 16 bytes
+LEVEL_DTYPE = np.dtype([("price", "<i8"), ("qty", "<i8")])
+
+# one message, 40 bytes; offset counts level records, not bytes
+INDEX_DTYPE = np.dtype(
+    [
+        ("event_time", "<i8"),
+        ("first_update_id", "<i8"),
+        ("final_update_id", "<i8"),
+        ("offset", "<i8"),
+        ("n_bids", "<u4"),
+        ("n_asks", "<u4"),
+    ]
+)
+
+# one checkpoint, 40 bytes: the book after messages [0, position), with its
+# bid then ask levels at offset in the checkpoint level file. event_time is
+# that of message position, last_update_id the final id applied before it
+CHECKPOINT_DTYPE = np.dtype(
+    [
+        ("position", "<i8"),
+        ("event_time", "<i8"),
+        ("last_update_id", "<i8"),
+        ("offset", "<i8"),
+        ("n_bids", "<u4"),
+        ("n_asks", "<u4"),
+    ]
+)
+
+
+# (event_time, first_update_id, final_update_id, bids, asks), levels as
+# (price ticks, qty lots) arrays of LEVEL_DTYPE
+TickMessage = Tuple[int, int, int, np.ndarray, np.ndarray]
+
+# (position, last_update_id, bids, asks), bids best first and asks best first
+Checkpoint = Tuple[int, int, np.ndarray, np.ndarray]
+
+
+def tick_store_paths(
+    base_path: Path, symbol: str, date: datetime.date
+) -> Tuple[Path, Path]:
+    """get level and index file paths for a day
+
+    Args:
+        base_path: directory holding tick store files
+        symbol: trading pair symbol
+        date: day of the files
+
+    Returns:
+        (ticks path, index path)
+    """
+    stem = f"{symbol.lower()}_{date.strftime('%Y%m%d')}"
+    return base_path / f"{stem}.ticks", base_path / f"{stem}.tidx"
+
+
+def checkpoint_paths(
+    base_path: Path, symbol: str, date: datetime.date
+) -> Tuple[Path, Path]:
+    """get checkpoint level and entry file paths for a day
+
+    Args:
+        base_path: directory holding tick store files
+        symbol: trading pair symbol
+        date: day of the files
+
+    Returns:
+        (checkpoint levels path, checkpoint entries path)
+    """
+    ticks_path, _ = tick_store_paths(base_path, symbol, date)
+    return ticks_path.with_suffix(".tckl"), ticks_path.with_suffix(".tckp")
+
+
+def _header(
+    magic: bytes, record_size: int, tick_size: Decimal, lot_size: Decimal
+) -> bytes:
+    header = np.zeros(1, dtype=HEADER_DTYPE)
+    header["magic"] = magic
+    header["version"] = FORMAT_VERSION
+    header["record_size"] = record_size
+    header["tick_size"] = str(tick_size).encode()
+    header["lot_size"] = str(lot_size).encode()
+    return header.tobytes()
+
+
+def _read_header(path: Path, magic: bytes, record_size: int) -> np.void:
+    with open(path, "rb") as f:
+        raw = f.read(HEADER_SIZE)
+    if len(raw) < HEADER_SIZE:
+        raise ValueError(f"truncated tick store header: {path}")
+    header = np.frombuffer(raw, dtype=HEADER_DTYPE)[0]
+    if header["magic"] != magic:
+        raise ValueError(f"not a tick store file: {path}")
+    if header["version"] != FORMAT_VERSION:
+        raise ValueError(
+            f"unsupported tick store version {header['version']}: {path}"
+        )
+    if header["record_size"] != record_size:
+        raise ValueError(f"unexpected record size in {path}")
+    return header
+
+
+def _complete_entries(index: np.ndarray, level_count: int) -> int:
+    """count leading index entries whose level records are all on disk
+
+    the two files are buffered separately, so after a crash the index can
+    run ahead of the level records
+    """
+    ends = index["offset"] + index["n_bids"] + index["n_asks"]
+    return int(np.searchsorted(ends, level_count, side="right"))
+
+
+class TickStoreWriter:
+    """appends depth updates to daily tick store files
+
+    files rotate at UTC midnight like ParquetWriter. reopening an existing
+    day appends to it, so a restarted recorder keeps one file per day.
+
+    Attributes:
+        symbol: trading pair symbol
+        base_path: directory for tick store files
+        tick_size: price grid of stored levels
+        lot_size: quantity grid of stored levels
+        current_date: date of the open files
+    """
+
+    def __init__(
+        self,
+        symbol: str = "btcusdt",
+        base_path: str = "data/ticks",
+        tick_size: Union[str, Decimal] = "0.00000001",
+        lot_size: Union[str, Decimal] = "0.00000001",
+    ) -> None:
+        """initialize writer
+
+        Args:
+            symbol: trading pair symbol
+            base_path: directory for tick store files
+            tick_size: price grid of stored levels
+            lot_size: quantity grid of stored levels
+        """
+        self.symbol = symbol.lower()
+        self.base_path = Path(base_path)
+        self.tick_size = Decimal(str(tick_size))
+        self.lot_size = Decimal(str(lot_size))
+        self.current_date: Optional[datetime.date] = None
+        self._ticks = None
+        self._index = None
+        self._offset = 0
+        self.base_path.mkdir(parents=True, exist_ok=True)
+
+    def _open(self, path: Path, magic: bytes, record_size: int):
+        """open a file for appending, writing the header if it is new"""
+        if path.exists() and path.stat().st_size >= HEADER_SIZE:
+            header = _read_header(path, magic, record_size)
+            grid = (
+                Decimal(header["tick_size"].decode()),
+                Decimal(header["lot_size"].decode()),
+            )
+            if grid != (self.tick_size, self.lot_size):
+                raise ValueError(f"tick store grid mismatch in {path}: {grid}")
+            # drop a record torn by an interrupted write so appends stay aligned
+            f = open(path, "r+b")
+            whole = (path.stat().st_size - HEADER_SIZE) // record_size
+            f.truncate(HEADER_SIZE + whole * record_size)
+            f.seek(0, 2)
+            return f
+        f = open(path, "wb")
+        f.write(_header(magic, record_size, self.tick_size, self.lot_size))
+        return f
+
+    def _rotate_if_needed(self, event_time: int) -> None:
+        """switch files when the message falls on a new UTC day"""
+        date = datetime.datetime.fromtimestamp(
+            event_time / 1000.0, tz=datetime.UTC
+        ).date()
+        if date == self.current_date:
+            return
+        self.close()
+        ticks_path, index_path = tick_store_paths(self.base_path, self.symbol, date)
+        self._ticks = self._open(ticks_path, TICKS_MAGIC, LEVEL_DTYPE.itemsize)
+        self._index = self._open(index_path, INDEX_MAGIC, INDEX_DTYPE.itemsize)
+        # an interrupted append can leave level records without an index
+        # entry; new entries point past them, readers never see them
+        self._offset = (self._ticks.tell() - HEADER_SIZE) // LEVEL_DTYPE.itemsize
+        index = np.fromfile(index_path, dtype=INDEX_DTYPE, offset=HEADER_SIZE)
+        complete = _complete_entries(index, self._offset)
+        if complete < len(index):
+            self._index.truncate(HEADER_SIZE + complete * INDEX_DTYPE.itemsize)
+            self._index.seek(0, 2)
+        self.current_date = date
+        logger.info(f"Rotated to new tick store file: {ticks_path}")
+
+    def _levels(self, levels: List[List[str]]) -> np.ndarray:
+        """convert [price, qty] decimal strings to LEVEL_DTYPE records"""
+        out = np.empty(len(levels), dtype=LEVEL_DTYPE)
+        for i, (price, qty) in enumerate(levels):
+            out[i] = (to_units(price, self.tick_size), to_units(qty, self.lot_size))
+        return out
+
+    def write(self, message: Dict[str, Any]) -> None:
+        """append one depth update
+
+        Args:
+            message: depth update in DepthUpdate fields (e, E, s, U, u, b, a)
+
+        Raises:
+            ValueError: if a level is not on the grid
+        """
+        depth_update = DepthUpdate(**message)
+        self.write_levels(
+            depth_update.E,
+            depth_update.U,
+            depth_update.u,
+            self._levels(depth_update.b),
+            self._levels(depth_update.a),
+        )
+
+    def write_levels(
+        self,
+        event_time: int,
+        first_update_id: int,
+        final_update_id: int,
+        bids: np.ndarray,
+        asks: np.ndarray,
+    ) -> None:
+        """append one depth update already converted to ticks/lots
+
+        Args:
+            event_time: event time in milliseconds
+            first_update_id: first update id (U)
+            final_update_id: final update id (u)
+            bids: LEVEL_DTYPE array of bid levels
+            asks: LEVEL_DTYPE array of ask levels
+        """
+        self._rotate_if_needed(event_time)
+        entry = np.zeros(1, dtype=INDEX_DTYPE)
+        entry[0] = (
+            event_time,
+            first_update_id,
+            final_update_id,
+            self._offset,
+            len(bids),
+            len(asks),
+        )
+        # levels first; if a crash still loses some, readers drop the
+        # index entries that point past the end of the level file
+        self._ticks.write(np.ascontiguousarray(bids, dtype=LEVEL_DTYPE).tobytes())
+        self._ticks.write(np.ascontiguousarray(asks, dtype=LEVEL_DTYPE).tobytes())
+        self._index.write(entry.tobytes())
+        self._offset += len(bids) + len(asks)
+
+    def flush(self) -> None:
+        """flush buffered records to the open files"""
+        if self._ticks is not None:
+            self._ticks.flush()
+            self._index.flush()
+
+    def close(self) -> None:
+        """close the open files"""
+        if self._ticks is not None:
+            try:
+                self._ticks.close()
+                self._index.close()
+            except Exception as e:
+                logger.error(f"Error closing tick store: {e}")
+            finally:
+                self._ticks = None
+                self._index = None
+                self.current_date = None
+
+
+class TickStoreReader:
+    """read access to one day of a tick store
+
+    readers over files memory-map them; load_parquet() builds one over
+    in-memory arrays instead
+
+    Attributes:
+        tick_size: price grid of stored levels
+        lot_size: quantity grid of stored levels
+        index: INDEX_DTYPE entries, one per message
+        levels: LEVEL_DTYPE records
+        checkpoints: CHECKPOINT_DTYPE entries in position order, empty
+            unless checkpoints were loaded or set
+        checkpoint_levels: LEVEL_DTYPE records the checkpoints point into
+    """
+
+    def __init__(
+        self,
+        index: np.ndarray,
+        levels: np.ndarray,
+        tick_size: Decimal,
+        lot_size: Decimal,
+    ) -> None:
+        """wrap decoded index entries and level records
+
+        Args:
+            index: INDEX_DTYPE entries in event time order
+            levels: LEVEL_DTYPE records the entries point into
+            tick_size: price grid of the levels
+            lot_size: quantity grid of the levels
+        """
+        self.tick_size = Decimal(str(tick_size))
+        self.lot_size = Decimal(str(lot_size))
+        self.levels = levels
+        self.index = index[: _complete_entries(index, len(levels))]
+        self.checkpoints = np.empty(0, dtype=CHECKPOINT_DTYPE)
+        self.checkpoint_levels = np.empty(0, dtype=LEVEL_DTYPE)
+
+    @classmethod
+    def from_files(cls, ticks_path: Path, index_path: Path) -> "TickStoreReader":
+        """open and map a day's files
+
+        Args:
+            ticks_path: path to the .ticks file
+            index_path: path to the .tidx file
+
+        Returns:
+            reader over the mapped files
+
+        Raises:
+            FileNotFoundError: if either file doesn't exist
+            ValueError: if a file is not a tick store file
+        """
+        for path in (ticks_path, index_path):
+            if not Path(path).exists():
+                raise FileNotFoundError(f"tick store file not found: {path}")
+        header = _read_header(index_path, INDEX_MAGIC, INDEX_DTYPE.itemsize)
+        _read_header(ticks_path, TICKS_MAGIC, LEVEL_DTYPE.itemsize)
+        return cls(
+            cls._map(index_path, INDEX_DTYPE),
+            cls._map(ticks_path, LEVEL_DTYPE),
+            Decimal(header["tick_size"].decode()),
+            Decimal(header["lot_size"].decode()),
+        )
+
+    @staticmethod
+    def _map(path: Path, dtype: np.dtype) -> np.ndarray:
+        # whole records only, a writer may be mid-append
+        count = (Path(path).stat().st_size - HEADER_SIZE) // dtype.itemsize
+        if count == 0:
+            return np.empty(0, dtype=dtype)
+        return np.memmap(
+            path, dtype=dtype, mode="r", offset=HEADER_SIZE, shape=(count,)
+        )
+
+    @classmethod
+    def open(
+        cls, base_path: str, symbol: str, date: datetime.date
+    ) -> "TickStoreReader":
+        """open a day's files by symbol and date
+
+        Args:
+            base_path: directory holding tick store files
+            symbol: trading pair symbol
+            date: day to open
+
+        Returns:
+            reader for that day, with its checkpoints if the day has them
+        """
+        reader = cls.from_files(*tick_store_paths(Path(base_path), symbol, date))
+        levels_path, entries_path = checkpoint_paths(Path(base_path), symbol, date)
+        if levels_path.exists() and entries_path.exists():
+            reader.load_checkpoints(levels_path, entries_path)
+        return reader
+
+    def load_checkpoints(self, levels_path: Path, entries_path: Path) -> None:
+        """map checkpoint files written by write_checkpoints()
+
+        Args:
+            levels_path: path to the .tckl file
+            entries_path: path to the .tckp file
+
+        Raises:
+            ValueError: if a file is not a checkpoint file for this grid
+        """
+        header = _read_header(
+            entries_path, CHECKPOINT_MAGIC, CHECKPOINT_DTYPE.itemsize
+        )
+        _read_header(levels_path, CHECKPOINT_LEVELS_MAGIC, LEVEL_DTYPE.itemsize)
+        grid = (
+            Decimal(header["tick_size"].decode()),
+            Decimal(header["lot_size"].decode()),
+        )
+        if grid != (self.tick_size, self.lot_size):
+            raise ValueError(f"checkpoint grid mismatch in {entries_path}: {grid}")
+        self.set_checkpoints(
+            self._map(entries_path, CHECKPOINT_DTYPE),
+            self._map(levels_path, LEVEL_DTYPE),
+        )
+
+    def set_checkpoints(self, checkpoints: np.ndarray, levels: np.ndarray) -> None:
+        """use checkpoints built for this day, see build_checkpoints()
+
+        checkpoints past the messages this reader holds are dropped, so a
+        day that was cut short never starts from a book it cannot reach
+
+        Args:
+            checkpoints: CHECKPOINT_DTYPE entries in position order
+            levels: LEVEL_DTYPE records the entries point into
+        """
+        checkpoints = checkpoints[: _complete_entries(checkpoints, len(levels))]
+        end = int(np.searchsorted(checkpoints["position"], len(self), side="right"))
+        self.checkpoints = checkpoints[:end]
+        self.checkpoint_levels = levels
+
+    def checkpoint(self, position: int) -> Optional[Checkpoint]:
+        """find the latest checkpoint at or before a message position
+
+        Args:
+            position: message position a replay starts at
+
+        Returns:
+            (position, last_update_id, bids, asks) of the checkpoint, levels
+            as LEVEL_DTYPE views, None if there is none that early
+        """
+        i = int(np.searchsorted(self.checkpoints["position"], position, "right")) - 1
+        if i < 0:
+            return None
+        entry = self.checkpoints[i]
+        start = int(entry["offset"])
+        mid = start + int(entry["n_bids"])
+        end = mid + int(entry["n_asks"])
+        return (
+            int(entry["position"]),
+            int(entry["last_update_id"]),
+            self.checkpoint_levels[start:mid],
+            self.checkpoint_levels[mid:end],
+        )
+
+    def __len__(self) -> int:
+        """number of messages"""
+        return len(self.index)
+
+    def seek(self, timestamp: int) -> int:
+        """find the first message at or after a timestamp
+
+        Args:
+            timestamp: event time in milliseconds
+
+        Returns:
+            message position, len(self) if every message is earlier
+        """
+        return int(np.searchsorted(self.index["event_time"], timestamp, side="left"))
+
+    def message(self, position: int) -> TickMessage:
+        """read one message without copying its levels
+
+        Args:
+            position: message position
+
+        Returns:
+            (event_time, first_update_id, final_update_id, bids, asks)
+        """
+        entry = self.index[position]
+        start = int(entry["offset"])
+        mid = start + int(entry["n_bids"])
+        end = mid + int(entry["n_asks"])
+        return (
+            int(entry["event_time"]),
+            int(entry["first_update_id"]),
+            int(entry["final_update_id"]),
+            self.levels[start:mid],
+            self.levels[mid:end],
+        )
+
+    def iter_messages(
+        self, start_time: Optional[int] = None, end_time: Optional[int] = None
+    ) -> Iterator[TickMessage]:
+        """iterate messages in [start_time, end_time)
+
+        Args:
+            start_time: first event time to include, None for the start of day
+            end_time: event time to stop before, None for the end of day
+
+        Returns:
+            iterator of messages as from message()
+        """
+        start = 0 if start_time is None else self.seek(start_time)
+        stop = len(self) if end_time is None else self.seek(end_time)
+        for position in range(start, stop):
+            yield self.message(position)
+
+
+def build_checkpoints(
+    reader: TickStoreReader, every: int = 10000
+) -> Tuple[np.ndarray, np.ndarray]:
+    """apply a day's diffs to a book and keep it every n messages
+
+    diffs follow the binance rules the simulator's incremental replay uses:
+    one whose final id was already applied is skipped, a gap is applied
+    anyway, and a zero quantity removes the level
+
+    Args:
+        reader: day to checkpoint
+        every: messages between checkpoints
+
+    Returns:
+        (CHECKPOINT_DTYPE entries, LEVEL_DTYPE records), see set_checkpoints()
+    """
+    if every < 1:
+        raise ValueError("every must be at least 1")
+    books: Tuple[Dict[int, int], Dict[int, int]] = ({}, {})
+    last_update_id = 0
+    entries = np.zeros(max(len(reader) - 1, 0) // every, dtype=CHECKPOINT_DTYPE)
+    chunks: List[np.ndarray] = []
+    offset = 0
+    for position in range(len(reader)):
+        event_time, first_id, final_id, bids, asks = reader.message(position)
+        if position and position % every == 0:
+            bid_levels = np.array(
+                sorted(books[0].items(), reverse=True), dtype=LEVEL_DTYPE
+            )
+            ask_levels = np.array(sorted(books[1].items()), dtype=LEVEL_DTYPE)
+            entries[position // every - 1] = (
+                position,
+                event_time,
+                last_update_id,
+                offset,
+                len(bid_levels),
+                len(ask_levels),
+            )
+            chunks.extend((bid_levels, ask_levels))
+            offset += len(bid_levels) + len(ask_levels)
+        if last_update_id and final_id <= last_update_id:
+            continue
+        last_update_id = final_id
+        for book, levels in zip(books, (bids, asks)):
+            for price, qty in levels.tolist():
+                if qty > 0:
+                    book[price] = qty
+                else:
+                    book.pop(price, None)
+    levels = np.concatenate(chunks) if chunks else np.empty(0, dtype=LEVEL_DTYPE)
+    return entries, levels
+
+
+def write_checkpoints(
+    base_path: str, symbol: str, date: datetime.date, every: int = 10000
+) -> int:
+    """build checkpoint files for a day already in the tick store
+
+    TickStoreReader.open() picks them up from then on
+
+    Args:
+        base_path: directory holding tick store files
+        symbol: trading pair symbol
+        date: day to checkpoint
+        every: messages between checkpoints
+
+    Returns:
+        number of checkpoints written
+    """
+    base_path = Path(base_path)
+    reader = TickStoreReader.from_files(*tick_store_paths(base_path, symbol, date))
+    entries, levels = build_checkpoints(reader, every)
+    levels_path, entries_path = checkpoint_paths(base_path, symbol, date)
+    grid = (reader.tick_size, reader.lot_size)
+    # each file is renamed into place, so readers that already mapped the
+    # old checkpoints keep reading them rather than a truncated file
+    for path, magic, records in (
+        (levels_path, CHECKPOINT_LEVELS_MAGIC, levels),
+        (entries_path, CHECKPOINT_MAGIC, entries),
+    ):
+        tmp_path = path.with_name(path.name + ".tmp")
+        with open(tmp_path, "wb") as f:
+            f.write(_header(magic, records.dtype.itemsize, *grid))
+            f.write(records.tobytes())
+        os.replace(tmp_path, path)
+    return len(entries)
+
+
+def _grid(
+    units: Optional[Tuple[Decimal, Decimal]],
+    tick_size: Union[str, Decimal, None],
+    lot_size: Union[str, Decimal, None],
+) -> Tuple[Decimal, Decimal]:
+    """target grid for a parquet file, defaulting to the file's own"""
+    if units is not None:
+        tick_size = units[0] if tick_size is None else tick_size
+        lot_size = units[1] if lot_size is None else lot_size
+    return (
+        Decimal(str(tick_size or "0.00000001")),
+        Decimal(str(lot_size or "0.00000001")),
+    )
+
+
+def _parquet_messages(
+    parquet_file: pq.ParquetFile,
+    grid: Tuple[Decimal, Decimal],
+    batch_size: int,
+) -> Iterator[TickMessage]:
+    """decode a ParquetWriter file of either version into tick messages"""
+    units = schema_units(parquet_file.schema_arrow)
+    tick_size, lot_size = grid
+
+    def on_grid(levels: List[List[str]]) -> np.ndarray:
+        out = np.empty(len(levels), dtype=LEVEL_DTYPE)
+        for i, (price, qty) in enumerate(levels):
+            out[i] = (to_units(price, tick_size), to_units(qty, lot_size))
+        return out
+
+    def levels(cell: List[Any]) -> np.ndarray:
+        if units is None:
+            return on_grid([level.split(",") for level in cell])
+        out = np.array([(lv["price"], lv["qty"]) for lv in cell], dtype=LEVEL_DTYPE)
+        if units != grid:
+            # rescale through decimals so off-grid levels are still rejected
+            return on_grid(
+                [[str(p * units[0]), str(q * units[1])] for p, q in out.tolist()]
+            )
+        return out
+
+    for batch in parquet_file.iter_batches(batch_size=batch_size):
+        for row in batch.to_pylist():
+            yield (
+                row["event_time"],
+                row["first_update_id"],
+                row["final_update_id"],
+                levels(row["bids"] or []),
+                levels(row["asks"] or []),
+            )
+
+
+def convert_parquet(
+    parquet_path: str,
+    base_path: str,
+    symbol: str,
+    tick_size: Union[str, Decimal, None] = None,
+    lot_size: Union[str, Decimal, None] = None,
+    batch_size: int = 65536,
+) -> int:
+    """build tick store files from a ParquetWriter file of either version
+
+    Args:
+        parquet_path: source parquet file
+        base_path: directory for tick store files
+        symbol: trading pair symbol
+        tick_size: price grid, defaults to the file's for version 2 files
+        lot_size: quantity grid, defaults to the file's for version 2 files
+        batch_size: rows decoded at a time
+
+    Returns:
+        number of messages written
+    """
+    parquet_file = pq.ParquetFile(parquet_path)
+    grid = _grid(schema_units(parquet_file.schema_arrow), tick_size, lot_size)
+    writer = TickStoreWriter(
+        symbol=symbol, base_path=base_path, tick_size=grid[0], lot_size=grid[1]
+    )
+    count = 0
+    try:
+        for message in _parquet_messages(parquet_file, grid, batch_size):
+            writer.write_levels(*message)
+            count += 1
+    finally:
+        writer.close()
+    return count
+
+
+def load_parquet(
+    parquet_path: str,
+    tick_size: Union[str, Decimal, None] = None,
+    lot_size: Union[str, Decimal, None] = None,
+    batch_size: int = 65536,
+) -> TickStoreReader:
+    """decode a ParquetWriter file into an in-memory tick store
+
+    the result holds two flat numpy arrays, so it can be replayed many times
+    (or shared with forked processes) without decoding the file again
+
+    Args:
+        parquet_path: source parquet file
+        tick_size: price grid, defaults to the file's for version 2 files
+        lot_size: quantity grid, defaults to the file's for version 2 files
+        batch_size: rows decoded at a time
+
+    Returns:
+        reader over the decoded messages
+
+    Raises:
+        FileNotFoundError: if the file doesn't exist
+    """
+    if not Path(parquet_path).exists():
+        raise FileNotFoundError(f"parquet file not found: {parquet_path}")
+    parquet_file = pq.ParquetFile(parquet_path)
+    grid = _grid(schema_units(parquet_file.schema_arrow), tick_size, lot_size)
+    index = np.zeros(parquet_file.metadata.num_rows, dtype=INDEX_DTYPE)
+    chunks: List[np.ndarray] = []
+    offset = 0
+    for i, (event_time, first_id, final_id, bids, asks) in enumerate(
+        _parquet_messages(parquet_file, grid, batch_size)
+    ):
+        index[i] = (event_time, first_id, final_id, offset, len(bids), len(asks))
+        chunks.extend((bids, asks))
+        offset += len(bids) + len(asks)
+    levels = np.concatenate(chunks) if chunks else np.empty(0, dtype=LEVEL_DTYPE)
+    return TickStoreReader(index, levels, grid[0], grid[1])
@@ -4,6 +4,8 @@ from dataclasses import dataclass, field
 from decimal import Decimal
 from typing import List, NamedTuple, Tuple
 
+import numpy as np
+
 from models.fill_prob import FillProbabilityModel
 from models.inventory_skew import InventorySkew, InventorySkewConfig
 from models.size_calculator import SizeCalculator, SizeConfig
@@ -85,15 +87,25 @@ class EVMaker:
         best_bid_price = base_bid_dec
         best_ask_price = base_ask_dec
 
+        bid_prices = [base_bid_dec - spread for spread in bid_spreads]
+        ask_prices = [base_ask_dec + spread for spread in ask_spreads]
+        if fill_model is not None:
+            # book features once, every candidate on both sides in one call
+            probs = fill_model.predict_batch(
+                bids,
+                asks,
+                bid_prices + ask_prices,
+                self.size_config.base_size,
+                ["buy"] * len(bid_prices) + ["sell"] * len(ask_prices),
+            )
+            bid_probs = probs[: len(bid_prices)]
+            ask_probs = probs[len(bid_prices) :]
+        else:
+            bid_probs = [bid_probability] * len(bid_prices)
+            ask_probs = [ask_probability] * len(ask_prices)
+
         print("\nbid optimization:")
-        for spread in bid_spreads:
-            price = base_bid_dec - spread
-            if fill_model is not None:
-                fill_prob = fill_model.predict(
-                    bids, asks, price, self.size_config.base_size, "buy"
-                )
-            else:
-                fill_prob = bid_probability
+        for price, spread, fill_prob in zip(bid_prices, bid_spreads, bid_probs):
             fill_prob_dec = Decimal(str(float(fill_prob)))
             ev = fill_prob_dec * spread
             print(
@@ -104,14 +116,7 @@ class EVMaker:
                 best_bid_price = price
 
         print("\nask optimization:")
-        for spread in ask_spreads:
-            price = base_ask_dec + spread
-            if fill_model is not None:
-                fill_prob = fill_model.predict(
-                    bids, asks, price, self.size_config.base_size, "sell"
-                )
-            else:
-                fill_prob = ask_probability
+        for price, spread, fill_prob in zip(ask_prices, ask_spreads, ask_probs):
             fill_prob_dec = Decimal(str(float(fill_prob)))
             ev = fill_prob_dec * spread
             print(
@@ -141,3 +146,70 @@ class EVMaker:
         ), "ask moved too far from base"
 
         return Quote(best_bid_price, bid_size), Quote(best_ask_price, ask_size)
+
+
+class NativeEVMaker:
+    """EVMaker on the native QuoteEngine
+
+    same interface and quotes as EVMaker, which stays the reference
+    implementation, but skew, ev search and sizing run in C++ doubles in
+    one call instead of Decimal arithmetic per candidate
+    """
+
+    def __init__(
+        self,
+        config: EVConfig,
+        size_config: SizeConfig,
+        tick_size: float = 1e-8,
+        lot_size: float = 1e-8,
+    ):
+        from match_engine import QuoteEngine
+
+        self.config = config
+        self.size_config = size_config
+        self.engine = QuoteEngine(config, size_config, tick_size, lot_size)
+
+    def quote_prices(
+        self,
+        mid_price: Decimal,
+        volatility: Decimal,
+        bid_probability: Decimal,
+        ask_probability: Decimal,
+        inventory: Decimal = Decimal("0"),
+        best_bid: Decimal = None,
+        best_ask: Decimal = None,
+        bids: List[List[str]] = None,
+        asks: List[List[str]] = None,
+        fill_model: FillProbabilityModel = None,
+    ) -> Tuple[Quote, Quote]:
+        mid = float(mid_price)
+        inv = float(inventory)
+        bid_probs = ask_probs = None
+        if fill_model is not None:
+            bid_prices, ask_prices = self.engine.candidates(mid, inv)
+            n = len(bid_prices)
+            probs = np.asarray(
+                fill_model.predict_batch(
+                    bids,
+                    asks,
+                    [Decimal(repr(p)) for p in [*bid_prices, *ask_prices]],
+                    self.size_config.base_size,
+                    ["buy"] * n + ["sell"] * n,
+                ),
+                dtype=float,
+            )
+            bid_probs, ask_probs = probs[:n], probs[n:]
+
+        (bid_price, bid_size), (ask_price, ask_size) = self.engine.quote(
+            mid,
+            inv,
+            float(bid_probability),
+            float(ask_probability),
+            bid_probs,
+            ask_probs,
+        )
+        # repr is the shortest decimal that round-trips the double
+        return (
+            Quote(Decimal(repr(bid_price)), Decimal(repr(bid_size))),
+            Quote(Decimal(repr(ask_price)), Decimal(repr(ask_size))),
+        )
@@ -133,6 +133,47 @@ async def test_cancel_order_success():
         assert result == mock_response
 
 
+@pytest.mark.asyncio
+async def test_cancel_replace_order():
+    """Test cancel/replace goes out as one request"""
+    gateway = BinanceGateway("key", "secret", testnet=True)
+
+    mock_response = {
+        "cancelResult": "SUCCESS",
+        "newOrderResult": "SUCCESS",
+        "newOrderResponse": {"orderId": 123457},
+    }
+
+    with patch.object(gateway, "_request", new_callable=AsyncMock) as mock_request:
+        mock_request.return_value = mock_response
+
+        result = await gateway.cancel_replace_order(
+            symbol="btcusdt",
+            side="sell",
+            cancel_order_id=123456,
+            order_type="LIMIT",
+            quantity=Decimal("0.5"),
+            price=Decimal("50001.0"),
+        )
+
+        assert result == mock_response
+        method, endpoint, params = mock_request.call_args[0]
+        assert (method, endpoint) == ("POST", "/api/v3/order/cancelReplace")
+        assert params["cancelOrderId"] == 123456
+        assert params["cancelReplaceMode"] == "STOP_ON_FAILURE"
+        assert params["side"] == "SELL"
+        assert params["price"] == "50001.0"
+
+
+@pytest.mark.asyncio
+async def test_session_keeps_connections_alive():
+    """Test the session pools keep-alive connections for concurrent orders"""
+    gateway = BinanceGateway("key", "secret", max_connections=4)
+
+    async with gateway as g:
+        assert g.session.connector.limit_per_host == 4
+
+
 @pytest.mark.asyncio
 async def test_cancel_order_no_id_raises_error():
     """Test that canceling without order ID raises error"""
@@ -130,6 +130,35 @@ async def test_binance_ws_receive(monkeypatch):
     assert message == test_message
 
 
+@pytest.mark.asyncio
+async def test_binance_ws_receive_depth(monkeypatch):
+    """test native decoding skips frames that are not depth updates"""
+    from data_feed.depth_decoder import DepthDecoder
+
+    test_message = {
+        "e": "depthUpdate",
+        "E": 1234567890000,
+        "s": "BTCUSDT",
+        "U": 1234567,
+        "u": 1234568,
+        "b": [["50000.00", "1.000"]],
+        "a": [],
+    }
+    frames = ['{"result": null, "id": 1}', "[]", json.dumps(test_message)]
+
+    async def mock_connect(*args, **kwargs):
+        return MockWebSocket(frames)
+
+    monkeypatch.setattr("websockets.client.connect", mock_connect)
+    ws = BinanceWebSocket()
+    await ws.connect()
+    raw, update = await ws.receive_depth(DepthDecoder(tick_size="0.01"))
+    assert raw == frames[-1]
+    assert update.u == 1234568
+    assert update.b.tolist() == [(5000000, 100000000)]
+    assert ws.message_count == 1
+
+
 @pytest.mark.asyncio
 async def test_binance_ws_receive_connection_closed(monkeypatch):
     """test websocket connection closed handling"""
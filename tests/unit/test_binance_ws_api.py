@@ -0,0 +1,111 @@
+"""
+unit tests for the binance websocket api gateway
+"""
+
+import asyncio
+import contextlib
+import hashlib
+import hmac
+import json
+from decimal import Decimal
+from unittest.mock import AsyncMock, patch
+
+import pytest
+
+from live.binance_ws_api import BinanceWsApiGateway
+
+
+class FakeWebSocket:
+    """answers each request once the test releases it"""
+
+    def __init__(self):
+        self.sent = []
+        self.responses = asyncio.Queue()
+
+    async def send(self, raw):
+        self.sent.append(json.loads(raw))
+
+    def reply(self, index, **response):
+        response["id"] = self.sent[index]["id"]
+        self.responses.put_nowait(json.dumps(response))
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self):
+        return await self.responses.get()
+
+    async def close(self):
+        pass
+
+
+@contextlib.asynccontextmanager
+async def connected():
+    """gateway connected to a FakeWebSocket"""
+    gateway = BinanceWsApiGateway("key", "secret", testnet=True)
+    websocket = FakeWebSocket()
+    with patch(
+        "live.binance_ws_api.websockets.client.connect",
+        new=AsyncMock(return_value=websocket),
+    ):
+        async with gateway:
+            yield gateway, websocket
+
+
+def test_signature_covers_sorted_params():
+    """test requests are signed over every parameter sorted by name"""
+    gateway = BinanceWsApiGateway("key", "secret")
+    with patch.object(gateway, "_get_timestamp", return_value=1700000000000):
+        signed = gateway._sign_params({"symbol": "BTCUSDT", "orderId": 5})
+
+    payload = "apiKey=key&orderId=5&symbol=BTCUSDT&timestamp=1700000000000"
+    expected = hmac.new(b"secret", payload.encode(), hashlib.sha256).hexdigest()
+    assert signed["signature"] == expected
+    assert signed["apiKey"] == "key"
+
+
+@pytest.mark.asyncio
+async def test_concurrent_requests_match_their_responses():
+    """test responses coming back out of order reach the right caller"""
+    async with connected() as (gateway, websocket):
+        bid = asyncio.create_task(
+            gateway.post_order("BTCUSDT", "BUY", "LIMIT", Decimal("1"), Decimal("100"))
+        )
+        ask = asyncio.create_task(
+            gateway.post_order("BTCUSDT", "SELL", "LIMIT", Decimal("1"), Decimal("9"))
+        )
+        while len(websocket.sent) < 2:
+            await asyncio.sleep(0)
+
+        assert [r["method"] for r in websocket.sent] == ["order.place"] * 2
+        websocket.reply(1, status=200, result={"orderId": 2})
+        websocket.reply(0, status=200, result={"orderId": 1})
+
+        assert (await bid)["orderId"] == 1
+        assert (await ask)["orderId"] == 2
+        assert gateway._pending == {}
+
+
+@pytest.mark.asyncio
+async def test_error_response_raises():
+    """test a rejected request raises like a rest api error"""
+    async with connected() as (gateway, websocket):
+        cancel = asyncio.create_task(gateway.cancel_order("BTCUSDT", order_id=9))
+        while not websocket.sent:
+            await asyncio.sleep(0)
+
+        assert websocket.sent[0]["method"] == "order.cancel"
+        assert websocket.sent[0]["params"]["orderId"] == 9
+        websocket.reply(0, status=400, error={"code": -2011, "msg": "Unknown order"})
+
+        with pytest.raises(Exception, match="Binance API error"):
+            await cancel
+
+
+@pytest.mark.asyncio
+async def test_request_without_connection_raises_error():
+    """test requests need the context manager"""
+    gateway = BinanceWsApiGateway("key", "secret")
+
+    with pytest.raises(RuntimeError, match="Gateway not initialized"):
+        await gateway._request("POST", "/api/v3/order", {})
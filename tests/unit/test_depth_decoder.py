@@ -0,0 +1,64 @@
+"""
+tests for native depth frame decoding
+"""
+
+import json
+
+import pytest
+
+from data_feed.depth_decoder import DepthDecoder, FixedDepthUpdate
+from data_feed.parquet_writer import to_units
+from data_feed.schemas import DepthUpdate
+
+FRAME = {
+    "e": "depthUpdate",
+    "E": 1623456789000,
+    "s": "BTCUSDT",
+    "U": 1234567,
+    "u": 1234568,
+    "b": [["50000.00", "1.00000000"], ["49999.99", "0.00000000"]],
+    "a": [["50001.00", "0.00012345"]],
+}
+
+
+def test_decodes_onto_the_grid():
+    """test levels match what the decimal conversion would give"""
+    decoder = DepthDecoder()
+    update = decoder.decode(json.dumps(FRAME))
+    assert isinstance(update, FixedDepthUpdate)
+    assert (update.e, update.E, update.s, update.U, update.u) == (
+        "depthUpdate",
+        1623456789000,
+        "BTCUSDT",
+        1234567,
+        1234568,
+    )
+    for levels, expected in ((update.b, FRAME["b"]), (update.a, FRAME["a"])):
+        assert levels.tolist() == [
+            (to_units(price, decoder.tick_size), to_units(qty, decoder.lot_size))
+            for price, qty in expected
+        ]
+
+    # bytes frames, other whitespace and extra fields decode the same
+    raw = json.dumps(dict(FRAME, x={"y": [1, "]"]}), indent=2).encode()
+    assert decoder.decode(raw).b.tolist() == update.b.tolist()
+
+    message = decoder.to_message(update)
+    assert DepthUpdate(**message).u == FRAME["u"]
+    assert [[float(v) for v in level] for level in message["b"]] == [
+        [float(v) for v in level] for level in FRAME["b"]
+    ]
+
+
+def test_other_frames_and_errors():
+    """test non-depth frames give None and bad ones raise"""
+    decoder = DepthDecoder(tick_size="0.01", lot_size="0.001")
+    assert decoder.decode('{"result": null, "id": 1}') is None
+    assert decoder.decode("{}") is None
+
+    with pytest.raises(ValueError, match="Malformed"):
+        decoder.decode('{"e": "depthUpdate", "E": ')
+    with pytest.raises(ValueError, match="Malformed"):
+        decoder.decode("[1, 2]")
+    with pytest.raises(ValueError, match="tick size"):
+        decoder.decode(json.dumps(dict(FRAME, b=[["50000.005", "1.000"]])))
@@ -0,0 +1,150 @@
+import pyarrow as pa
+import pytest
+
+from match_engine import DepthReplay
+
+SCHEMA = pa.schema(
+    [
+        ("event_type", pa.string()),
+        ("event_time", pa.int64()),
+        ("symbol", pa.string()),
+        ("first_update_id", pa.int64()),
+        ("final_update_id", pa.int64()),
+        ("bids", pa.list_(pa.string())),
+        ("asks", pa.list_(pa.string())),
+    ]
+)
+
+
+def _batch(rows, update_ids=None):
+    if update_ids is None:
+        update_ids = [(i, i) for i in range(1, len(rows) + 1)]
+    messages = [
+        {
+            "event_type": "depthUpdate",
+            "event_time": event_time,
+            "symbol": "btcusdt",
+            "first_update_id": first,
+            "final_update_id": final,
+            "bids": bids,
+            "asks": asks,
+        }
+        for (event_time, bids, asks), (first, final) in zip(rows, update_ids)
+    ]
+    return pa.RecordBatch.from_pylist(messages, schema=SCHEMA)
+
+
+def test_replay_builds_book():
+    replay = DepthReplay(tick_size=0.5, lot_size=0.25)
+    seen = []
+    rows = replay.replay(
+        _batch([(1000, ["100.0,1.5", "99.5,2.00000000"], ["100.5,0.25"])]),
+        lambda event_time, bids, asks: seen.append((event_time, bids, asks)),
+    )
+    assert rows == 1
+    assert replay.messages == 1
+    assert seen == [(1000, [(100.0, 1.5), (99.5, 2.0)], [(100.5, 0.25)])]
+    assert replay.best_bid == 100.0
+    assert replay.best_ask == 100.5
+
+
+def test_each_message_replaces_book():
+    replay = DepthReplay()
+    replay.replay(
+        _batch([(1, ["100.0,1.0"], ["101.0,1.0"]), (2, ["99.0,3.0"], [])]),
+        lambda *args: None,
+    )
+    assert replay.snapshot() == ([(99.0, 3.0)], [])
+
+
+def test_zero_quantity_levels_are_dropped():
+    replay = DepthReplay()
+    replay.replay(_batch([(1, ["100.0,0.00000000", "99.0,1.0"], [])]), lambda *a: 0)
+    bids, _ = replay.snapshot()
+    assert bids == [(99.0, 1.0)]
+
+
+def test_sampling_carries_across_batches():
+    replay = DepthReplay()
+    times = []
+    for start in (0, 5):
+        rows = [(t, ["100.0,1.0"], ["101.0,1.0"]) for t in range(start, start + 5)]
+        batch = _batch(rows)
+        replay.replay(batch, lambda t, bids, asks: times.append(t), sample_every=3)
+    assert times == [2, 5, 8]
+    assert replay.messages == 10
+
+
+def test_depth_limits_callback_levels():
+    replay = DepthReplay()
+    seen = []
+    bids = ["100.0,1.0", "99.0,1.0", "98.0,1.0"]
+    asks = ["101.0,1.0", "102.0,1.0"]
+    replay.replay(
+        _batch([(1, bids, asks)]),
+        lambda t, bids, asks: seen.append((len(bids), len(asks))),
+        depth=1,
+    )
+    assert seen == [(1, 1)]
+
+
+def test_replay_accepts_table():
+    table = pa.Table.from_batches(
+        [_batch([(1, ["100.0,1.0"], [])]), _batch([(2, ["100.5,1.0"], [])])]
+    )
+    replay = DepthReplay()
+    assert replay.replay(table, lambda *args: None) == 2
+    assert replay.best_bid == 100.5
+
+
+def test_malformed_level_raises():
+    replay = DepthReplay()
+    with pytest.raises(ValueError):
+        replay.replay(_batch([(1, ["100.0"], [])]), lambda *args: None)
+    with pytest.raises(ValueError):
+        replay.replay(_batch([(1, ["1e2,1.0"], [])]), lambda *args: None)
+
+
+def test_off_grid_level_raises():
+    replay = DepthReplay(tick_size=0.5, lot_size=1.0)
+    with pytest.raises(ValueError):
+        replay.replay(_batch([(1, ["100.25,1"], [])]), lambda *args: None)
+
+
+def test_callback_errors_propagate():
+    def boom(*args):
+        raise RuntimeError("strategy failed")
+
+    replay = DepthReplay()
+    with pytest.raises(RuntimeError, match="strategy failed"):
+        replay.replay(_batch([(1, ["100.0,1.0"], [])]), boom)
+
+
+def test_incremental_replay_applies_diffs():
+    replay = DepthReplay(incremental=True)
+    rows = [
+        (1, ["100.0,1.0", "99.0,2.0"], ["101.0,1.0"]),
+        (2, ["99.0,0"], ["101.0,3.0", "102.0,1.0"]),
+    ]
+    replay.replay(_batch(rows), lambda *args: None)
+    assert replay.snapshot() == ([(100.0, 1.0)], [(101.0, 3.0), (102.0, 1.0)])
+    assert replay.last_update_id == 2
+
+
+def test_incremental_replay_sequence():
+    replay = DepthReplay(incremental=True)
+    seen = []
+    rows = [
+        (1, ["100.0,1.0"], []),
+        (2, ["100.0,0"], []),  # stale, ids already applied
+        (3, ["99.0,1.0"], []),  # gap, still applied
+    ]
+    replay.replay(
+        _batch(rows, update_ids=[(10, 12), (11, 12), (20, 21)]),
+        lambda t, bids, asks: seen.append(t),
+    )
+    assert seen == [1, 3]
+    assert replay.stale == 1
+    assert replay.gaps == 1
+    assert replay.messages == 2
+    assert replay.snapshot() == ([(100.0, 1.0), (99.0, 1.0)], [])
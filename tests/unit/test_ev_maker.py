@@ -36,7 +36,7 @@ class TestEVMaker(unittest.TestCase):
     def test_quote_prices_min_spread(self):
         """test that quotes maintain minimum spread"""
         # mock fill model to return high probabilities
-        self.fill_model.predict.side_effect = [
+        self.fill_model.predict_batch.return_value = [
             0.8
         ] * 20  # 10 points for bid side + 10 for ask side
 
@@ -61,7 +61,7 @@ class TestEVMaker(unittest.TestCase):
         # mock fill model to return different probabilities for each price point
         # for 3 bid points: closest to mid gets highest prob, further gets lower
         # for 3 ask points: closest to mid gets lowest prob, further gets higher
-        self.fill_model.predict.side_effect = [0.9, 0.5, 0.1, 0.1, 0.5, 0.9]
+        self.fill_model.predict_batch.return_value = [0.9, 0.5, 0.1, 0.1, 0.5, 0.9]
 
         # Configure for fewer points
         ev_config = EVConfig(num_points=3)  # fewer points for faster test
@@ -83,7 +83,7 @@ class TestEVMaker(unittest.TestCase):
     def test_quote_prices_size(self):
         """test that quote sizes are correct"""
         # mock fill model to return high probabilities
-        self.fill_model.predict.side_effect = [
+        self.fill_model.predict_batch.return_value = [
             0.8
         ] * 20  # 10 points for bid side + 10 for ask side
 
@@ -107,11 +107,36 @@ class TestEVMaker(unittest.TestCase):
         self.assertEqual(bid_quote.size, Decimal("0.002"))
         self.assertEqual(ask_quote.size, Decimal("0.002"))
 
+    def test_quote_prices_scores_one_batch(self):
+        """test every candidate on both sides is scored in one call"""
+        self.fill_model.predict_batch.return_value = [0.5] * 6
+        maker = EVMaker(EVConfig(num_points=3), self.size_config)
+
+        maker.quote_prices(
+            mid_price=self.mid_price,
+            volatility=self.volatility,
+            bid_probability=self.bid_probability,
+            ask_probability=self.ask_probability,
+            bids=self.bids,
+            asks=self.asks,
+            fill_model=self.fill_model,
+        )
+
+        self.fill_model.predict.assert_not_called()
+        self.fill_model.predict_batch.assert_called_once()
+        bids, asks, prices, size, sides = self.fill_model.predict_batch.call_args[0]
+        self.assertEqual((bids, asks), (self.bids, self.asks))
+        self.assertEqual(size, self.size_config.base_size)
+        self.assertEqual(sides, ["buy"] * 3 + ["sell"] * 3)
+        self.assertEqual(prices[:3], sorted(prices[:3], reverse=True))
+        self.assertEqual(prices[3:], sorted(prices[3:]))
+        self.assertLess(max(prices[:3]), min(prices[3:]))
+
     def test_inventory_parameter(self):
         """test that inventory parameter is handled correctly"""
         # mock fill probability model
         fill_model = Mock()
-        fill_model.predict.return_value = 0.5
+        fill_model.predict_batch.return_value = [0.5] * 20
 
         maker = EVMaker(self.ev_config, self.size_config)
 
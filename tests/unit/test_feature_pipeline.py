@@ -0,0 +1,91 @@
+"""
+tests for the native feature pipeline against the python estimators
+"""
+
+import random
+from decimal import Decimal
+
+import pytest
+
+from features.imbalance import get_imbalance_features
+from features.volatility import EwmaVolatility, RealizedVolatility, VolatilityCalculator
+from match_engine import (
+    DepthReplay,
+    FeaturePipeline,
+    LadderMatchEngine,
+    MapMatchEngine,
+    Side,
+)
+
+BIDS = [["50000.00", "2.0"], ["49999.99", "1.0"], ["49999.90", "0.5"]]
+ASKS = [["50000.02", "1.0"], ["50000.10", "3.0"]]
+
+
+def test_volatility_matches_python():
+    """test every estimator tracks its python reference mid by mid"""
+    pipeline = FeaturePipeline(window=20, ewma_alpha=0.06, horizons=[10, 100])
+    calc = VolatilityCalculator(window_size=20)
+    ewma = EwmaVolatility(alpha=0.06)
+    realized = RealizedVolatility(horizons=(10, 100))
+
+    rng = random.Random(3)
+    price = 50000.0
+    for _ in range(1000):
+        price = round(price * (1 + rng.gauss(0, 1e-4)), 2)
+        expected = calc.update(Decimal(str(price)))
+        assert pipeline.update_mid(price) == pytest.approx(expected, rel=1e-9)
+        ewma.update(price)
+        assert pipeline.ewma_volatility == pytest.approx(ewma.volatility, rel=1e-9)
+        reference = realized.update(price)
+        for horizon, value in pipeline.realized_volatility.items():
+            assert value == pytest.approx(reference[horizon], rel=1e-9, abs=1e-15)
+    assert pipeline.updates == 1000
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_book_features_from_market_depth(engine_cls):
+    """test mid, microprice and imbalance read from the engine's depth"""
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    for side, levels in ((Side.BUY, BIDS), (Side.SELL, ASKS)):
+        for price, qty in levels:
+            engine.apply_l2_delta(side, float(price), float(qty))
+
+    pipeline = FeaturePipeline()
+    engine.update_features(pipeline)
+    assert pipeline.mid == pytest.approx(50000.01)
+    assert pipeline.spread == pytest.approx(0.02)
+    # the heavier bid pulls the microprice towards the ask
+    assert pipeline.microprice == pytest.approx((50000.00 * 1 + 50000.02 * 2) / 3)
+    assert pipeline.imbalance_features() == pytest.approx(
+        get_imbalance_features(BIDS, ASKS)
+    )
+    assert pipeline.updates == 1
+
+
+def test_one_sided_book_is_skipped():
+    """test an update without both sides leaves the features alone"""
+    engine = MapMatchEngine(tick_size=0.01, lot_size=0.001)
+    engine.apply_l2_delta(Side.BUY, 100.0, 1.0)
+    pipeline = FeaturePipeline()
+    engine.update_features(pipeline)
+    assert pipeline.updates == 0
+    assert pipeline.volatility == 0.0
+
+
+def test_depth_replay_updates_features():
+    """test DepthReplay feeds the same pipeline as the engines"""
+    replay = DepthReplay(tick_size=0.01, lot_size=0.001)
+    pipeline = FeaturePipeline()
+    replay.update_features(pipeline)
+    assert pipeline.updates == 0
+    assert pipeline.realized_volatility == {10: 0.0, 100: 0.0, 1000: 0.0}
+
+
+def test_pipeline_errors():
+    """test invalid estimator settings are rejected"""
+    with pytest.raises(ValueError):
+        FeaturePipeline(window=0)
+    with pytest.raises(ValueError):
+        FeaturePipeline(ewma_alpha=1.5)
+    with pytest.raises(ValueError):
+        FeaturePipeline(horizons=[])
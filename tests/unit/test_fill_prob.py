@@ -4,8 +4,37 @@ unit tests for fill probability model
 
 from decimal import Decimal
 
+import numpy as np
+import pandas as pd
+import pytest
+
+import models.fill_prob as fill_prob
 from models.fill_prob import FillFeatures, FillProbabilityModel
 
+BIDS = [["100.0", "1.0"], ["99.0", "2.0"], ["98.0", "3.0"]]
+ASKS = [["101.0", "1.5"], ["102.0", "2.0"], ["103.0", "0.5"]]
+PRICES = [Decimal("100.5"), Decimal("99.25"), Decimal("98"), Decimal("101.75")]
+SIDES = ["buy", "buy", "buy", "sell"]
+
+
+@pytest.fixture
+def trained_model(tmp_path):
+    """model fitted on fills at varying distances from mid"""
+    np.random.seed(0)
+    data = [
+        {
+            "bids": [[str(100.0 - i * 0.01), "1.0"]],
+            "asks": [[str(100.0 + i * 0.01), str(1.0 + i % 3)]],
+            "price": str(100.0 + (i % 7 - 3) * 0.1),
+            "size": "1.0",
+            "side": "buy" if i % 2 == 0 else "sell",
+        }
+        for i in range(1, 60)
+    ]
+    model = FillProbabilityModel(model_path=str(tmp_path / "model.joblib"))
+    model.train(pd.DataFrame(data))
+    return model
+
 
 def test_feature_extraction():
     """test feature extraction from order book state"""
@@ -146,3 +175,60 @@ def test_model_persistence(tmp_path):
     )
 
     assert prob1 == prob2
+
+
+def test_feature_matrix_matches_extract_features():
+    """test batched rows keep the FillFeatures column order"""
+    model = FillProbabilityModel()
+    X = model.feature_matrix(BIDS, ASKS, PRICES, Decimal("0.5"), SIDES)
+
+    assert X.shape == (len(PRICES), 10)
+    for row, price, side in zip(X, PRICES, SIDES):
+        features = model.extract_features(BIDS, ASKS, price, Decimal("0.5"), side)
+        np.testing.assert_allclose(row, features.to_array(), rtol=1e-12)
+
+
+def test_predict_batch_matches_predict(trained_model):
+    """test one batch scores every order like predict() does"""
+    probs = trained_model.predict_batch(BIDS, ASKS, PRICES, Decimal("1.0"), SIDES)
+
+    expected = [
+        trained_model.predict(BIDS, ASKS, price, Decimal("1.0"), side)
+        for price, side in zip(PRICES, SIDES)
+    ]
+    np.testing.assert_allclose(probs, expected, rtol=1e-9)
+
+
+def test_predict_batch_numpy_fallback(trained_model, monkeypatch):
+    """test scoring without the extension gives the native result"""
+    native = trained_model.predict_batch(BIDS, ASKS, PRICES, Decimal("1.0"), SIDES)
+    monkeypatch.setattr(fill_prob, "logistic_proba", None)
+    fallback = trained_model.predict_batch(BIDS, ASKS, PRICES, Decimal("1.0"), SIDES)
+
+    np.testing.assert_allclose(fallback, native, rtol=1e-12)
+
+
+def test_predict_batch_follows_loaded_model(trained_model, tmp_path):
+    """test folded weights are rebuilt when the model is replaced"""
+    trained_model.predict_batch(BIDS, ASKS, PRICES, Decimal("1.0"), SIDES)
+    other = FillProbabilityModel(model_path=str(tmp_path / "other.joblib"))
+    other.model = trained_model.model.__class__().fit(
+        np.random.RandomState(1).normal(size=(40, 10)), [0, 1] * 20
+    )
+    other.scaler.fit(np.random.RandomState(2).normal(size=(40, 10)))
+    other.save()
+
+    trained_model.model_path = other.model_path
+    trained_model.load()
+    probs = trained_model.predict_batch(BIDS, ASKS, PRICES, Decimal("1.0"), SIDES)
+    expected = [
+        other.predict(BIDS, ASKS, price, Decimal("1.0"), side)
+        for price, side in zip(PRICES, SIDES)
+    ]
+    np.testing.assert_allclose(probs, expected, rtol=1e-9)
+
+
+def test_predict_batch_requires_model():
+    """test batched scoring needs a trained model"""
+    with pytest.raises(RuntimeError):
+        FillProbabilityModel().predict_batch(BIDS, ASKS, PRICES, Decimal("1"), SIDES)
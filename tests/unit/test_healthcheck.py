@@ -63,6 +63,114 @@ class TestHealthcheckMetrics:
         # verify counter incremented
         assert metrics.fills_total.labels(side="buy")._value._value == initial_count + 1
 
+    def test_stage_timers(self, metrics):
+        """test stages land in their own labelled histogram"""
+        with metrics.time_stage("quote"):
+            pass
+        metrics.record_stage("orders", 2_500_000)
+
+        def count(stage):
+            return metrics.registry.get_sample_value(
+                "engine_stage_latency_seconds_count", {"stage": stage}
+            )
+
+        assert count("quote") == 1
+        assert count("orders") == 1
+        assert metrics.registry.get_sample_value(
+            "engine_stage_latency_seconds_sum", {"stage": "orders"}
+        ) == pytest.approx(0.0025)
+        # sub-millisecond buckets
+        assert (
+            metrics.registry.get_sample_value(
+                "engine_stage_latency_seconds_bucket", {"stage": "quote", "le": "1e-05"}
+            )
+            is not None
+        )
+
+    def test_record_event_to_quote(self, metrics):
+        """test quote age is measured from the exchange event time"""
+        with patch("live.healthcheck.time.time", return_value=1700000000.25):
+            metrics.record_event_to_quote(1700000000000)
+
+        assert metrics.registry.get_sample_value(
+            "event_to_quote_latency_seconds_sum"
+        ) == pytest.approx(0.25)
+
+    def test_native_latency_collector(self, metrics):
+        """test native engine buckets are exported as a cumulative histogram"""
+
+        class FakeEngine:
+            timing = False
+
+            def latency_stats(self):
+                return {
+                    "insert": ([1e-6, 1e-5], [3, 1, 2], 0.5),
+                    "cancel": ([1e-6, 1e-5], [0, 4, 0], 0.25),
+                }
+
+        engine = FakeEngine()
+        metrics.register_native_latency(engine)
+
+        assert engine.timing is True
+
+        def sample(name, **labels):
+            return metrics.registry.get_sample_value(
+                f"native_match_latency_seconds_{name}", labels
+            )
+
+        assert sample("bucket", op="insert", le="1e-06") == 3
+        assert sample("bucket", op="insert", le="1e-05") == 4
+        assert sample("bucket", op="insert", le="+Inf") == 6
+        assert sample("count", op="insert") == 6
+        assert sample("sum", op="cancel") == 0.25
+
+    def test_shard_runtime_collector(self, metrics):
+        """test every shard's stats are exported labelled by symbol"""
+
+        class FakeRuntime:
+            symbols = ["btcusdt", "ethusdt"]
+
+            def stats(self, index):
+                return {
+                    "messages": 10 + index,
+                    "dropped": 0,
+                    "stale": 1,
+                    "gaps": index,
+                    "quotes": 4,
+                    "queue_full": 0,
+                    "errors": 0,
+                    "mid": 100.0 / (index + 1),
+                    "spread": 0.01,
+                    "volatility": 0.0,
+                    "inventory": -3 * index,
+                }
+
+            def latency_stats(self, index):
+                return ([1e-6, 1e-5], [index, 2, 1], 0.125)
+
+        metrics.register_shard_runtime(FakeRuntime())
+
+        def sample(name, symbol):
+            return metrics.registry.get_sample_value(name, {"symbol": symbol})
+
+        assert sample("shard_messages_total", "btcusdt") == 10
+        assert sample("shard_messages_total", "ethusdt") == 11
+        assert sample("shard_gaps_total", "ethusdt") == 1
+        assert sample("shard_mid", "ethusdt") == 50.0
+        assert sample("shard_inventory", "ethusdt") == -3
+        assert sample("shard_quote_latency_seconds_count", "ethusdt") == 4
+        assert sample("shard_quote_latency_seconds_sum", "btcusdt") == 0.125
+
+    def test_record_depth_batch(self, metrics):
+        """test a drained batch records conflation and queue lag"""
+        metrics.record_depth_batch(5, 0.02)
+        metrics.record_depth_batch(2, 0.001)
+
+        assert metrics.depth_updates_total._value._value == 7
+        assert metrics.depth_conflation_ratio._value._value == 2
+        assert metrics.depth_queue_lag_current._value._value == 0.001
+        assert metrics.depth_queue_lag._sum._value == pytest.approx(0.021)
+
     @pytest.mark.asyncio
     async def test_update_outstanding_orders(self, metrics):
         """test outstanding orders update"""
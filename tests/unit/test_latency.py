@@ -0,0 +1,47 @@
+"""
+unit tests for the backtest clock's latency model and event queue
+"""
+
+import pytest
+
+from backtest.latency import EventQueue, LatencyModel
+
+
+def test_arrival_adds_feed_and_order_latency():
+    """test an action lands feed + order after the event it was made on"""
+    assert LatencyModel().arrival(1000) == 1000
+    assert LatencyModel(feed=5, order=20).arrival(1000) == 1025
+    with pytest.raises(ValueError, match="negative"):
+        LatencyModel(order=-1)
+
+
+def test_event_queue_runs_in_due_order():
+    """test due order, stable ties and the exclusive bound"""
+    queue = EventQueue()
+    ran = []
+    queue.push(5, lambda now: ran.append(("first", now)))
+    queue.push(3, lambda now: ran.append(("early", now)))
+    queue.push(5, lambda now: ran.append(("second", now)))
+    queue.push(9, lambda now: ran.append(("late", now)))
+
+    assert queue.run_until(5, inclusive=False) == 1
+    assert ran == [("early", 3)]
+    assert queue.run_until(5) == 2
+    assert ran[1:] == [("first", 5), ("second", 5)]
+    assert queue.next_due() == 9 and len(queue) == 1
+
+
+def test_actions_can_schedule_more():
+    """test an action's follow-up runs in the same pass when it is due"""
+    queue = EventQueue()
+    ran = []
+
+    def action(now):
+        ran.append(now)
+        if now < 3:
+            queue.push(now + 1, action)
+
+    queue.push(1, action)
+    assert queue.run_until(10) == 3
+    assert ran == [1, 2, 3]
+    assert queue.next_due() is None
@@ -2,13 +2,17 @@
 unit tests for live trading engine
 """
 
+import asyncio
 import json
 from decimal import Decimal
 from unittest.mock import AsyncMock, patch
 
 import pytest
 
-from live.engine import LiveEngine
+from data_feed.schemas import DepthUpdate
+from data_feed.stream_codec import encode_binary
+from live.engine import LiveEngine, RestingOrder
+from strategy.ev_maker import Quote
 
 
 class TestLiveEngine:
@@ -130,6 +134,21 @@ class TestLiveEngine:
 
         await engine.stop()
 
+    @pytest.mark.asyncio
+    async def test_decode_binary_message(self, sample_message):
+        """test binary stream entries decode to the same update as json ones"""
+        engine = LiveEngine(symbol="btcusdt")
+
+        json_fields = {b"data": json.dumps(sample_message).encode()}
+        binary_fields = {b"bin": encode_binary(sample_message)}
+        assert engine._decode_message(binary_fields) == DepthUpdate(**sample_message)
+        assert engine._decode_message(binary_fields) == engine._decode_message(
+            json_fields
+        )
+        assert engine._decode_message({b"bin": b"\x02"}) is None
+
+        await engine.stop()
+
     @pytest.mark.asyncio
     async def test_engine_start_stop(self):
         """test engine start and stop lifecycle"""
@@ -285,3 +304,284 @@ class TestLiveEngine:
 
         # verify pnl key was updated (5.0 - 0.10 commission)
         mock_redis.set.assert_any_call("pnl:btcusdt", "4.90")
+
+
+def _depth_update(event_time, bids, asks):
+    return DepthUpdate(
+        e="depthUpdate",
+        E=event_time,
+        s="BTCUSDT",
+        U=event_time,
+        u=event_time,
+        b=bids,
+        a=asks,
+    )
+
+
+class TestConflation:
+    """test the engine applies every diff but quotes on the latest book"""
+
+    @pytest.mark.asyncio
+    async def test_book_applies_diffs(self):
+        """test diffs update and remove levels of the local book"""
+        engine = LiveEngine(symbol="btcusdt")
+        engine._apply_depth_update(
+            _depth_update(1, [["100.0", "1"], ["99.0", "2"]], [["101.0", "1"]])
+        )
+        engine._apply_depth_update(
+            _depth_update(2, [["100.00", "0"], ["99.0", "3"]], [["102.0", "4"]])
+        )
+
+        assert engine.book_bids == {Decimal("99.0"): ["99.0", "3"]}
+        assert sorted(engine.book_asks) == [Decimal("101.0"), Decimal("102.0")]
+
+        await engine.stop()
+
+    @pytest.mark.asyncio
+    async def test_batch_quotes_once_on_latest_state(self):
+        """test a burst of diffs costs one quote on the final book"""
+        engine = LiveEngine(symbol="btcusdt")
+        updates = [
+            _depth_update(1, [["100.0", "1"]], [["102.0", "1"]]),
+            _depth_update(2, [["101.0", "1"]], []),
+            _depth_update(3, [["100.0", "0"]], [["102.0", "0"], ["103.0", "2"]]),
+        ]
+
+        with patch.object(
+            engine.ev_maker, "quote_prices", wraps=engine.ev_maker.quote_prices
+        ) as mock_quote:
+            with patch("builtins.print"):
+                await engine._process_batch(updates)
+
+        mock_quote.assert_called_once()
+        kwargs = mock_quote.call_args.kwargs
+        assert kwargs["best_bid"] == Decimal("101.0")
+        assert kwargs["best_ask"] == Decimal("103.0")
+        assert kwargs["bids"] == [["101.0", "1"]]
+        assert kwargs["asks"] == [["103.0", "2"]]
+        assert engine.metrics.depth_updates_total._value._value == 3
+        assert engine.metrics.depth_conflation_ratio._value._value == 3
+
+        await engine.stop()
+
+    @pytest.mark.asyncio
+    async def test_batch_skips_stale_and_counts_gaps(self):
+        """test replayed diffs are skipped and a gap is applied but counted"""
+        engine = LiveEngine(symbol="btcusdt")
+        with patch("builtins.print"):
+            await engine._process_batch(
+                [
+                    _depth_update(1, [["100.0", "1"]], [["102.0", "1"]]),
+                    _depth_update(2, [["100.0", "2"]], []),
+                ]
+            )
+        assert engine.last_update_id == 2
+
+        stale = _depth_update(2, [["100.0", "9"]], [])
+        gap = _depth_update(5, [["99.0", "1"]], [])
+        with patch.object(engine, "_quote", wraps=engine._quote) as mock_quote:
+            # a replay of what the book already has quotes nothing
+            await engine._process_batch([stale])
+            mock_quote.assert_not_called()
+            with patch("builtins.print"):
+                await engine._process_batch([stale, gap])
+            mock_quote.assert_called_once()
+
+        assert engine.book_bids[Decimal("100.0")] == ["100.0", "2"]
+        assert Decimal("99.0") in engine.book_bids
+        assert engine.last_update_id == 5
+        assert engine.metrics.depth_stale_total._value._value == 2
+        assert engine.metrics.depth_gaps_total._value._value == 1
+        assert engine.metrics.depth_updates_total._value._value == 3
+
+        await engine.stop()
+
+    @pytest.mark.asyncio
+    async def test_quote_levels_are_sorted_and_capped(self):
+        """test the quoted book is the best quote_depth levels per side"""
+        engine = LiveEngine(symbol="btcusdt")
+        engine.quote_depth = 2
+        bids = [[str(100 - i), "1"] for i in (3, 0, 2, 1)]
+        asks = [[str(101 + i), "1"] for i in (2, 1, 3, 0)]
+
+        with patch.object(
+            engine.ev_maker, "quote_prices", wraps=engine.ev_maker.quote_prices
+        ) as mock_quote:
+            with patch("builtins.print"):
+                await engine._process_depth_update(_depth_update(1, bids, asks))
+
+        kwargs = mock_quote.call_args.kwargs
+        assert kwargs["bids"] == [["100", "1"], ["99", "1"]]
+        assert kwargs["asks"] == [["101", "1"], ["102", "1"]]
+
+        await engine.stop()
+
+    @pytest.mark.asyncio
+    async def test_drain_stream_reads_until_short_batch(self):
+        """test the drain keeps reading full batches from the last id seen"""
+        engine = LiveEngine(symbol="btcusdt")
+        engine.max_batch = 2
+        mock_redis = AsyncMock()
+        stream = b"depth_updates:btcusdt"
+        mock_redis.xread.side_effect = [
+            [[stream, [(b"1-0", {b"data": b"a"}), (b"2-0", {b"data": b"b"})]]],
+            [[stream, [(b"3-0", {b"data": b"c"})]]],
+        ]
+        engine.redis_client = mock_redis
+
+        entries = await engine._drain_stream()
+
+        assert entries == [{b"data": b"a"}, {b"data": b"b"}, {b"data": b"c"}]
+        assert engine.last_stream_id == b"3-0"
+        first, second = mock_redis.xread.call_args_list
+        assert first.args[0] == {"depth_updates:btcusdt": "$"}
+        assert first.kwargs["block"] == 100
+        assert second.args[0] == {"depth_updates:btcusdt": b"2-0"}
+        assert second.kwargs["block"] is None
+
+
+class TestOrderManagement:
+    """test requoting against the gateway"""
+
+    @staticmethod
+    def _quote(price, size="0.001"):
+        return Quote(Decimal(price), Decimal(size))
+
+    @pytest.mark.asyncio
+    async def test_sides_are_requoted_concurrently(self):
+        """test the bid and ask posts are in flight at the same time"""
+        engine = LiveEngine(symbol="btcusdt")
+        in_flight = []
+        both_sent = asyncio.Event()
+
+        async def post_order(**kwargs):
+            in_flight.append(kwargs["side"])
+            if len(in_flight) == 2:
+                both_sent.set()
+            await asyncio.wait_for(both_sent.wait(), timeout=1)
+            return {"orderId": 1 if kwargs["side"] == "BUY" else 2}
+
+        engine.gateway = AsyncMock()
+        engine.gateway.post_order.side_effect = post_order
+
+        await engine._manage_orders(self._quote("100.0"), self._quote("101.0"))
+
+        assert sorted(in_flight) == ["BUY", "SELL"]
+        assert engine.current_bid_order_id == "1"
+        assert engine.current_ask_order_id == "2"
+
+        await engine.stop()
+
+    @pytest.mark.asyncio
+    async def test_quote_within_tolerance_keeps_resting_order(self):
+        """test a small move leaves the resting order alone"""
+        engine = LiveEngine(symbol="btcusdt", price_tolerance=Decimal("0.05"))
+        engine.gateway = AsyncMock()
+        engine.gateway.post_order.return_value = {"orderId": 7}
+        engine.gateway.cancel_replace_order.return_value = {
+            "newOrderResponse": {"orderId": 8}
+        }
+
+        await engine._manage_orders(self._quote("100.00"), self._quote("101.00"))
+        await engine._manage_orders(self._quote("100.04"), self._quote("101.10"))
+
+        assert engine.gateway.post_order.call_count == 2
+        engine.gateway.cancel_replace_order.assert_called_once()
+        replace = engine.gateway.cancel_replace_order.call_args.kwargs
+        assert replace["side"] == "SELL"
+        assert replace["cancel_order_id"] == 7
+        assert replace["price"] == Decimal("101.10")
+        assert engine.resting_orders["BUY"].price == Decimal("100.00")
+        assert engine.current_ask_order_id == "8"
+        engine.gateway.cancel_order.assert_not_called()
+
+        await engine.stop()
+
+    @pytest.mark.asyncio
+    async def test_failed_replace_clears_resting_order(self):
+        """test a rejected replacement is posted fresh on the next tick"""
+        engine = LiveEngine(symbol="btcusdt")
+        engine.gateway = AsyncMock()
+        engine.gateway.post_order.return_value = {"orderId": 7}
+        engine.gateway.cancel_replace_order.side_effect = Exception("filled")
+
+        await engine._manage_orders(self._quote("100.0"), self._quote("101.0"))
+        await engine._manage_orders(self._quote("99.0"), self._quote("102.0"))
+
+        assert engine.current_bid_order_id is None
+        assert engine.current_ask_order_id is None
+
+        await engine.stop()
+
+    @pytest.mark.asyncio
+    async def test_cancel_then_post_without_cancel_replace(self):
+        """test each side cancels before it posts when replace is off"""
+        engine = LiveEngine(symbol="btcusdt", cancel_replace=False)
+        calls = []
+
+        async def cancel_order(symbol, order_id):
+            calls.append(("cancel", order_id))
+            return {}
+
+        async def post_order(**kwargs):
+            calls.append(("post", kwargs["side"]))
+            return {"orderId": 5}
+
+        engine.gateway = AsyncMock()
+        engine.gateway.cancel_order.side_effect = cancel_order
+        engine.gateway.post_order.side_effect = post_order
+        engine.resting_orders["BUY"] = RestingOrder(
+            "3", Decimal("100"), Decimal("0.001")
+        )
+
+        await engine._manage_orders(self._quote("99.0"), self._quote("101.0"))
+
+        assert calls.index(("cancel", 3)) < calls.index(("post", "BUY"))
+        assert engine.current_bid_order_id == "5"
+        engine.gateway.cancel_replace_order.assert_not_called()
+
+        await engine.stop()
+
+    def test_unknown_order_api_is_refused(self):
+        """test order_api only takes rest or ws"""
+        with pytest.raises(ValueError, match="unknown order api"):
+            LiveEngine(symbol="btcusdt", order_api="fix")
+
+
+class TestBookSnapshot:
+    """test the l2 book is checkpointed into redis and reloaded on start"""
+
+    @pytest.mark.asyncio
+    async def test_book_snapshot_round_trip(self):
+        """test a restarted engine resumes with the book and stream id"""
+        engine = LiveEngine(symbol="btcusdt", book_snapshot=True)
+        engine.redis_client = AsyncMock()
+        engine._apply_depth_update(
+            _depth_update(1, [["100.5", "1.25"]], [["101.0", "0.001"]])
+        )
+        engine.last_update_id = 1
+        engine.last_stream_id = b"5-0"
+        await engine._save_book_snapshot()
+        mapping = engine.redis_client.hset.call_args.kwargs["mapping"]
+
+        restarted = LiveEngine(symbol="btcusdt", book_snapshot=True)
+        restarted.redis_client = AsyncMock()
+        restarted.redis_client.hgetall.return_value = {
+            b"engine": mapping["engine"],
+            b"stream_id": mapping["stream_id"],
+        }
+        await restarted._load_book_snapshot()
+
+        restarted.redis_client.hgetall.assert_awaited_once_with("book_snapshot:btcusdt")
+        assert restarted.book_bids == {Decimal("100.5"): ["100.5", "1.25"]}
+        assert restarted.book_asks == {Decimal("101.0"): ["101.0", "0.001"]}
+        assert restarted.last_update_id == 1
+        assert restarted.last_stream_id == "5-0"
+
+    @pytest.mark.asyncio
+    async def test_nothing_read_is_not_checkpointed(self):
+        """test an engine that never read the stream keeps the old snapshot"""
+        engine = LiveEngine(symbol="btcusdt", book_snapshot=True)
+        engine.redis_client = AsyncMock()
+        await engine._save_book_snapshot()
+        engine.redis_client.hset.assert_not_called()
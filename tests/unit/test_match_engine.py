@@ -1,4 +1,22 @@
-from match_engine import MatchEngine, Side
+import threading
+
+import numpy as np
+import pytest
+
+from match_engine import (
+    FILL_DTYPE,
+    OP_DTYPE,
+    TICK_FILL_DTYPE,
+    DepthSync,
+    LadderMatchEngine,
+    MapMatchEngine,
+    MatchEngine,
+    OpType,
+    OrderType,
+    Side,
+    logistic_proba,
+)
+from storage.engine_snapshot import load_engine, save_engine
 
 
 def test_basic_matching():
@@ -70,3 +88,608 @@ def test_multiple_fills():
     fills = engine.insert("sell1", Side.SELL, 100.0, 2.5, 4)
     assert len(fills) == 3
     assert sum(fill.size for fill in fills) == 2.5
+
+
+def test_tick_grid_aggregates_equal_prices():
+    engine = MatchEngine(tick_size=0.01, lot_size=0.001)
+    assert engine.tick_size == 0.01
+    assert engine.lot_size == 0.001
+    # 0.1 + 0.2 != 0.3 as doubles, but both land on the same tick
+    engine.insert("buy1", Side.BUY, 0.3, 1.0, 1)
+    engine.insert("buy2", Side.BUY, 0.1 + 0.2, 1.0, 2)
+    fills = engine.insert("sell1", Side.SELL, 0.3, 2.0, 3)
+    assert [f.maker_order_id for f in fills] == ["buy1", "buy2"]
+    assert all(f.price_ticks == 30 for f in fills)
+    assert fills[0].price == pytest.approx(0.3)
+    assert fills[0].size_lots == 1000
+
+
+def test_tick_grid_rejects_off_grid_values():
+    engine = MatchEngine(tick_size=0.01, lot_size=0.001)
+    with pytest.raises(ValueError):
+        engine.insert("buy1", Side.BUY, 100.005, 1.0, 1)
+    with pytest.raises(ValueError):
+        engine.insert("buy1", Side.BUY, 100.0, 0.0005, 1)
+    with pytest.raises(ValueError):
+        MatchEngine(tick_size=0.0)
+
+
+@pytest.mark.parametrize("price", [50_000.0, 60_000.0, 75_000.0, 99_999.0, 100_000.0])
+@pytest.mark.parametrize("offset", [0.005, 0.0025, 0.0075])
+def test_tick_grid_rejects_off_grid_values_at_btc_prices(price, offset):
+    engine = MatchEngine(tick_size=0.01, lot_size=0.00001)
+    with pytest.raises(ValueError):
+        engine.insert("buy1", Side.BUY, price + offset, 1.0, 1)
+    # the neighbouring ticks are still on the grid
+    engine.insert("buy1", Side.BUY, price + 0.01, 1.0, 1)
+    engine.insert("buy2", Side.BUY, price - 0.01, 1.0, 1)
+    assert engine.best_bid == pytest.approx(price + 0.01)
+
+
+def test_insert_ticks():
+    engine = MatchEngine(tick_size=0.5, lot_size=0.1)
+    engine.insert_ticks("buy1", Side.BUY, 200, 10, 1)
+    fills = engine.insert("sell1", Side.SELL, 100.0, 1.0, 2)
+    assert len(fills) == 1
+    assert fills[0].price == 100.0
+    assert fills[0].size == 1.0
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_backends_price_time_priority(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.insert("ask1", Side.SELL, 101.0, 1.0, 1)
+    engine.insert("ask2", Side.SELL, 100.5, 1.0, 2)
+    engine.insert("ask3", Side.SELL, 100.5, 1.0, 3)
+    fills = engine.insert("buy1", Side.BUY, 101.0, 2.5, 4)
+    assert [f.maker_order_id for f in fills] == ["ask2", "ask3", "ask1"]
+    assert [f.price for f in fills] == [100.5, 100.5, 101.0]
+
+
+def test_ladder_recenters_and_grows():
+    # a tiny window forces both recentering and growth
+    engine = LadderMatchEngine(tick_size=0.01, lot_size=0.001, ladder_levels=64)
+    engine.insert("bid_far", Side.BUY, 50.0, 1.0, 1)
+    engine.insert("bid_near", Side.BUY, 99.0, 1.0, 2)
+    engine.insert("ask_near", Side.SELL, 101.0, 1.0, 3)
+    engine.insert("ask_far", Side.SELL, 150.0, 1.0, 4)
+    fills = engine.insert("sell1", Side.SELL, 50.0, 2.0, 5)
+    assert [f.maker_order_id for f in fills] == ["bid_near", "bid_far"]
+    fills = engine.insert("buy1", Side.BUY, 150.0, 2.0, 6)
+    assert [f.maker_order_id for f in fills] == ["ask_near", "ask_far"]
+
+
+def test_ladder_falls_back_to_map_on_fine_grid():
+    # a dollar is 1e8 ticks on the default grid, far past any ladder window
+    engine = LadderMatchEngine()
+    engine.insert("buy1", Side.BUY, 100.0, 1.0, 1)
+    engine.insert("buy2", Side.BUY, 101.0, 1.0, 2)
+    engine.insert("buy3", Side.BUY, 99.0, 1.0, 3)
+    fills = engine.insert("sell1", Side.SELL, 100.0, 1.0, 4)
+    assert [f.maker_order_id for f in fills] == ["buy2"]
+    assert engine.best_bid == 100.0
+    # once the side empties it is back on the ladder
+    engine.cancel("buy1")
+    engine.cancel("buy3")
+    engine.insert("buy4", Side.BUY, 100.00000001, 1.0, 5)
+    engine.insert("buy5", Side.BUY, 100.00000002, 1.0, 6)
+    assert engine.best_bid == pytest.approx(100.00000002)
+
+
+def test_ladder_cancel_moves_best():
+    engine = LadderMatchEngine(tick_size=0.01, lot_size=0.001)
+    engine.insert("bid1", Side.BUY, 100.0, 1.0, 1)
+    engine.insert("bid2", Side.BUY, 99.0, 1.0, 2)
+    assert engine.cancel("bid1") is True
+    fills = engine.insert("sell1", Side.SELL, 99.0, 1.0, 3)
+    assert len(fills) == 1
+    assert fills[0].maker_order_id == "bid2"
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_cancel_keeps_queue_priority(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.insert("buy1", Side.BUY, 100.0, 1.0, 1)
+    engine.insert("buy2", Side.BUY, 100.0, 1.0, 2)
+    engine.insert("buy3", Side.BUY, 100.0, 1.0, 3)
+    assert engine.cancel("buy2") is True
+    assert "buy2" not in engine
+    assert len(engine) == 2
+    fills = engine.insert("sell1", Side.SELL, 100.0, 2.0, 4)
+    assert [f.maker_order_id for f in fills] == ["buy1", "buy3"]
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_amend(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.insert("buy1", Side.BUY, 100.0, 2.0, 1)
+    engine.insert("buy2", Side.BUY, 100.0, 1.0, 2)
+    # shrinking keeps priority
+    assert engine.amend("buy1", 1.0) is True
+    fills = engine.insert("sell1", Side.SELL, 100.0, 0.5, 3)
+    assert fills[0].maker_order_id == "buy1"
+    # growing goes to the back of the level
+    assert engine.amend("buy1", 3.0) is True
+    fills = engine.insert("sell2", Side.SELL, 100.0, 0.5, 4)
+    assert fills[0].maker_order_id == "buy2"
+    assert engine.amend("missing", 1.0) is False
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_replace(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.insert("ask1", Side.SELL, 101.0, 1.0, 1)
+    engine.insert("buy1", Side.BUY, 100.0, 1.0, 2)
+    fills = engine.replace("buy1", "buy2", 100.5, 1.0, 3)
+    assert fills == []
+    assert "buy1" not in engine
+    assert "buy2" in engine
+    # replacing across the spread matches like a fresh insert
+    fills = engine.replace("buy2", "buy3", 101.0, 1.0, 4)
+    assert len(fills) == 1
+    assert fills[0].taker_order_id == "buy3"
+    assert fills[0].maker_order_id == "ask1"
+    assert len(engine) == 0
+    with pytest.raises(ValueError):
+        engine.replace("missing", "new", 100.0, 1.0, 5)
+
+
+def test_duplicate_order_id_rejected():
+    engine = MatchEngine()
+    engine.insert("buy1", Side.BUY, 100.0, 1.0, 1)
+    with pytest.raises(ValueError):
+        engine.insert("buy1", Side.BUY, 99.0, 1.0, 2)
+
+
+def test_numeric_order_ids():
+    engine = MatchEngine(tick_size=0.01, lot_size=0.001)
+    engine.reserve(1024)
+    engine.insert(1, Side.BUY, 100.0, 1.0, 1)
+    engine.insert(2, Side.BUY, 100.0, 1.0, 2)
+    assert 1 in engine
+    assert engine.cancel(1) is True
+    fills = engine.insert(3, Side.SELL, 100.0, 1.0, 3)
+    assert len(fills) == 1
+    assert fills[0].maker_id == 2
+    assert fills[0].taker_id == 3
+    assert fills[0].maker_order_id == "2"
+    assert len(engine) == 0
+    with pytest.raises(ValueError):
+        engine.insert(2**63, Side.BUY, 100.0, 1.0, 4)
+
+
+def test_string_ids_are_released_after_fill():
+    engine = MatchEngine()
+    engine.insert("buy1", Side.BUY, 100.0, 1.0, 1)
+    engine.insert("sell1", Side.SELL, 100.0, 1.0, 2)
+    assert "buy1" not in engine
+    # a filled id can be reused for a new order
+    engine.insert("buy1", Side.BUY, 100.0, 1.0, 3)
+    assert "buy1" in engine
+
+
+def _ops(rows):
+    ops = np.zeros(len(rows), dtype=OP_DTYPE)
+    for i, (op, side, price, size, ts, order_id) in enumerate(rows):
+        ops[i] = (int(op), int(side), price, size, ts, order_id)
+    return ops
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_apply_batch(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    ops = _ops(
+        [
+            (OpType.INSERT, Side.BUY, 100.0, 1.0, 1, 1),
+            (OpType.INSERT, Side.BUY, 100.0, 1.0, 2, 2),
+            (OpType.CANCEL, Side.BUY, 0.0, 0.0, 3, 1),
+            (OpType.AMEND, Side.BUY, 0.0, 0.5, 4, 2),
+            (OpType.INSERT, Side.SELL, 99.0, 2.0, 5, 3),
+        ]
+    )
+    fills = engine.apply_batch(ops)
+    assert fills.dtype == FILL_DTYPE
+    assert len(fills) == 1
+    assert fills["op_index"][0] == 4
+    assert fills["maker_id"][0] == 2
+    assert fills["taker_id"][0] == 3
+    assert fills["price"][0] == 100.0
+    assert fills["size"][0] == 0.5
+    # the rest of the sell order is now resting
+    assert 3 in engine
+    assert len(engine) == 1
+
+
+def test_apply_batch_matches_per_order_calls():
+    rng = np.random.default_rng(7)
+    rows = []
+    for i in range(2000):
+        side = Side.BUY if rng.random() < 0.5 else Side.SELL
+        price = 100.0 + int(rng.integers(-20, 21)) * 0.01
+        rows.append((OpType.INSERT, side, price, 1.0, i, i + 1))
+    batch = MatchEngine(tick_size=0.01, lot_size=0.001)
+    fills = batch.apply_batch(_ops(rows))
+
+    single = MatchEngine(tick_size=0.01, lot_size=0.001)
+    expected = []
+    for _, side, price, size, ts, order_id in rows:
+        for fill in single.insert(order_id, side, price, size, ts):
+            expected.append((fill.taker_id, fill.maker_id, fill.price))
+    got = list(zip(fills["taker_id"], fills["maker_id"], fills["price"]))
+    assert got == expected
+
+
+def test_apply_batch_reports_failing_row():
+    engine = MatchEngine()
+    ops = _ops(
+        [
+            (OpType.INSERT, Side.BUY, 100.0, 1.0, 1, 1),
+            (OpType.INSERT, Side.BUY, -1.0, 1.0, 2, 2),
+        ]
+    )
+    with pytest.raises(ValueError, match="op 1"):
+        engine.apply_batch(ops)
+    # rows before the failure stay applied
+    assert 1 in engine
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_failed_apply_batch_releases_filled_string_ids(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.insert("maker", Side.SELL, 100.0, 1.0, 0)
+    ops = _ops(
+        [
+            (OpType.INSERT, Side.BUY, 100.0, 1.0, 1, 1),
+            (OpType.INSERT, Side.BUY, -1.0, 1.0, 2, 2),
+        ]
+    )
+    with pytest.raises(ValueError, match="op 1"):
+        engine.apply_batch(ops)
+    # the crossing row filled the maker before the batch failed
+    assert "maker" not in engine
+    engine.insert("maker", Side.SELL, 101.0, 1.0, 3)
+    assert "maker" in engine
+
+
+def test_apply_batch_shares_engine_across_threads():
+    engine = MatchEngine(tick_size=0.01, lot_size=0.001)
+    batches = [
+        _ops(
+            [
+                (OpType.INSERT, Side.BUY, 99.0 - (i % 50) * 0.01, 1.0, i, base + i)
+                for i in range(5_000)
+            ]
+        )
+        for base in (1, 10_001)
+    ]
+
+    def insert_asks():
+        for i in range(5_000):
+            engine.submit(20_001 + i, Side.SELL, 10_100 + i % 50, 1_000, i)
+
+    threads = [
+        threading.Thread(target=engine.apply_batch, args=(ops,)) for ops in batches
+    ]
+    threads.append(threading.Thread(target=insert_asks))
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    # nothing crossed, so every order from every thread rests
+    assert len(engine) == 15_000
+    assert (engine.best_bid, engine.best_ask) == (99.0, 101.0)
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_submit_fills_view(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.insert("maker", Side.SELL, 100.0, 1.0, 0)
+    for order_id in (1, 2):
+        engine.insert(order_id, Side.SELL, 100.01, 1.0, order_id)
+
+    assert engine.submit(10, Side.BUY, 9_000, 500, 3) == 0
+    assert engine.last_fills.dtype == TICK_FILL_DTYPE
+    assert len(engine.last_fills) == 0
+
+    # sweeps the string-id maker and both numeric makers, then rests
+    assert engine.submit(11, Side.BUY, 10_001, 3_500, 4) == 3
+    fills = engine.last_fills
+    assert fills["taker_id"].tolist() == [11, 11, 11]
+    assert fills["maker_id"][1:].tolist() == [1, 2]
+    assert fills["price_ticks"].tolist() == [10_000, 10_001, 10_001]
+    assert fills["size_lots"].tolist() == [1_000, 1_000, 1_000]
+    assert (fills["timestamp"] == 4).all()
+    assert "maker" not in engine
+    assert engine.queue_position(11) == (0, 0.0)
+
+    # the list api fills the same buffer; the copy and the view taken
+    # before it both keep the fills they were taken with
+    view = engine.last_fills_view()
+    assert not view.flags.writeable and len(view) == 3
+    engine.insert("taker", Side.SELL, 100.01, 0.25, 5)
+    assert engine.last_fills["maker_id"].tolist() == [11]
+    assert engine.last_fills_view()["maker_id"].tolist() == [11]
+    assert fills["maker_id"][1:].tolist() == [1, 2]
+    assert view["maker_id"][1:].tolist() == [1, 2]
+    assert fills.flags.writeable
+
+    assert engine.submit_replace(11, 12, 10_002, 100, 6) == 0
+    assert 12 in engine and 11 not in engine
+    with pytest.raises(ValueError):
+        engine.submit(2**63, Side.BUY, 1, 1, 0)
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_fills_view_outlives_buffer_growth(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    for order_id in range(1, 301):
+        engine.submit(order_id, Side.SELL, 10_000 + order_id, 1, 0)
+    assert engine.submit(1000, Side.BUY, 10_001, 1, 1) == 1
+    view = engine.last_fills_view()
+
+    # more makers than the default 256-fill buffer holds
+    assert engine.submit(1001, Side.BUY, 20_000, 1_000, 2) == 299
+    assert view["maker_id"].tolist() == [1]
+    assert view["timestamp"].tolist() == [1]
+    assert len(engine.last_fills_view()) == 299
+
+    # a view keeps its fills after the engine is gone too
+    del engine
+    assert view["maker_id"].tolist() == [1]
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_submit_order_types(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.submit(1, Side.SELL, 10_100, 3, 0)
+    engine.submit(2, Side.SELL, 10_200, 5, 0)
+    engine.submit(3, Side.BUY, 9_900, 4, 0)
+
+    # post-only is dropped whole if it would match, otherwise it rests
+    assert engine.submit(10, Side.BUY, 10_100, 1, 1, OrderType.POST_ONLY) == 0
+    assert 10 not in engine and 1 in engine
+    assert engine.submit(11, Side.BUY, 10_000, 1, 1, OrderType.POST_ONLY) == 0
+    assert 11 in engine
+
+    # ioc takes up to its price and drops the remainder
+    assert engine.submit(12, Side.BUY, 10_100, 5, 2, OrderType.IOC) == 1
+    assert engine.last_fills["size_lots"].tolist() == [3]
+    assert 12 not in engine and 2 in engine
+    engine.submit(1, Side.SELL, 10_100, 3, 0)
+
+    # fok fills in full inside its price or not at all
+    assert engine.submit(13, Side.BUY, 10_100, 4, 3, OrderType.FOK) == 0
+    assert engine.submit(14, Side.BUY, 10_200, 9, 3, OrderType.FOK) == 0
+    assert 1 in engine and 2 in engine
+    assert engine.submit(15, Side.BUY, 10_200, 8, 3, OrderType.FOK) == 2
+    assert 1 not in engine and 2 not in engine and 15 not in engine
+
+    # market ignores its price, sweeps every level and never rests
+    assert engine.submit(16, Side.SELL, 0, 10, 4, OrderType.MARKET) == 2
+    assert engine.last_fills["price_ticks"].tolist() == [10_000, 9_900]
+    assert len(engine) == 0
+    with pytest.raises(ValueError):
+        engine.submit(17, Side.SELL, 0, 1, 4)
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_submit_replace_post_only(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.submit(1, Side.SELL, 10_100, 1, 0)
+    engine.submit(2, Side.BUY, 10_000, 1, 0)
+
+    assert engine.submit_replace(2, 3, 10_050, 1, 1, OrderType.POST_ONLY) == 0
+    assert 3 in engine and 2 not in engine
+    # a replace that would cross drops the new order and the old one is gone
+    assert engine.submit_replace(3, 4, 10_100, 1, 2, OrderType.POST_ONLY) == 0
+    assert 3 not in engine and 4 not in engine and 1 in engine
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_market_depth_kept_apart_from_orders(engine_cls):
+    engine = engine_cls()
+    engine.apply_l2_delta(Side.BUY, 100.0, 5.0)
+    engine.apply_l2_delta(Side.SELL, 101.0, 3.0)
+    # market levels never match our orders
+    assert engine.insert("sell1", Side.SELL, 100.0, 1.0, 1) == []
+    assert engine.market_best_bid == 100.0
+    assert engine.market_qty(Side.BUY, 100.0) == 5.0
+    engine.apply_l2_delta(Side.BUY, 100.0, 0.0)
+    assert engine.market_snapshot() == ([], [(101.0, 3.0)])
+    assert "sell1" in engine
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_depth_into_buffers(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.insert("b1", Side.BUY, 100.0, 0.5, 0)
+    engine.insert("b2", Side.BUY, 100.0, 0.25, 1)
+    engine.insert("b3", Side.BUY, 99.5, 1.0, 2)
+    engine.insert("a1", Side.SELL, 101.0, 2.0, 3)
+    assert (engine.best_bid, engine.best_ask) == (100.0, 101.0)
+
+    out = np.full((3, 2), -1.0)
+    assert engine.depth(Side.BUY, out) == 2
+    np.testing.assert_allclose(out, [[100.0, 0.75], [99.5, 1.0], [0.0, 0.0]])
+    engine.depth(Side.BUY, out, cumulative=True)
+    np.testing.assert_allclose(out[:2], [[100.0, 0.75], [99.5, 1.75]])
+
+    ticks = np.empty((1, 2), dtype=np.int64)
+    assert engine.depth(Side.SELL, ticks) == 1
+    assert ticks.tolist() == [[10100, 2000]]
+    assert engine.cumulative_volume(Side.BUY) == pytest.approx(1.75)
+    assert engine.cumulative_volume(Side.BUY, levels=1) == pytest.approx(0.75)
+
+
+def test_market_depth_into_buffers():
+    engine = MatchEngine(tick_size=0.01, lot_size=0.001)
+    engine.apply_depth_update(
+        1, 1, [("100.0", "1.5"), ("99.9", "2")], [("100.1", "3")]
+    )
+    out = np.zeros((4, 2))
+    assert engine.market_depth(Side.BUY, out, cumulative=True) == 2
+    np.testing.assert_allclose(out[:2], [[100.0, 1.5], [99.9, 3.5]])
+    assert engine.market_cumulative_volume(Side.SELL) == pytest.approx(3.0)
+    # our own book is untouched by market depth
+    assert engine.depth(Side.BUY, out) == 0
+    assert not out.any()
+
+
+def test_depth_buffer_is_checked():
+    engine = MatchEngine()
+    # a converted copy would hide the writes, so the wrong dtype is refused
+    with pytest.raises(TypeError):
+        engine.depth(Side.BUY, np.zeros((2, 2), dtype=np.float32))
+    with pytest.raises(TypeError):
+        engine.depth(Side.BUY, np.zeros((2, 2))[:, ::-1])
+    with pytest.raises(ValueError):
+        engine.depth(Side.BUY, np.zeros((2, 3)))
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_queue_position(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.insert("first", Side.BUY, 100.0, 0.5, 0)
+    engine.insert(7, Side.BUY, 100.0, 0.25, 1)
+    engine.insert("third", Side.BUY, 100.0, 1.0, 2)
+    assert engine.queue_position("first") == (0, 0.0)
+    assert engine.queue_position(7) == (1, pytest.approx(0.5))
+    assert engine.queue_position("third") == (2, pytest.approx(0.75))
+
+    # shrinking keeps the place, orders ahead leaving move it up
+    engine.amend("first", 0.125)
+    assert engine.queue_position("third") == (2, pytest.approx(0.375))
+    engine.cancel(7)
+    assert engine.queue_position("third") == (1, pytest.approx(0.125))
+    assert engine.queue_position("gone") is None
+    assert engine.queue_position(7) is None
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_native_latency_timers(engine_cls):
+    engine = engine_cls()
+    engine.insert("a", Side.BUY, 100.0, 1.0, 0)
+    assert not engine.timing
+    assert sum(engine.latency_stats()["insert"][1]) == 0
+
+    engine.timing = True
+    engine.insert("b", Side.BUY, 99.0, 1.0, 1)
+    engine.insert(5, Side.SELL, 99.0, 1.0, 2)
+    engine.cancel("a")
+    stats = engine.latency_stats()
+    bounds, counts, total = stats["insert"]
+    assert len(counts) == len(bounds) + 1
+    assert bounds == sorted(bounds) and bounds[0] == pytest.approx(32e-9)
+    assert sum(counts) == 2 and total > 0
+    assert sum(stats["cancel"][1]) == 1
+
+    engine.reset_latency()
+    assert sum(engine.latency_stats()["insert"][1]) == 0
+    assert engine.timing
+
+
+def test_apply_depth_update_sequence():
+    engine = MatchEngine()
+    sync = engine.apply_depth_update(10, 12, [("100.0", "1.5")], [["101.0", "2"]])
+    assert sync == DepthSync.APPLIED
+    assert engine.last_update_id == 12
+
+    # already covered by the book
+    assert engine.apply_depth_update(11, 12, [("100.0", "0")], []) == DepthSync.STALE
+    assert engine.market_qty(Side.BUY, 100.0) == 1.5
+
+    # overlapping update applies, qty 0 deletes
+    assert engine.apply_depth_update(12, 14, [(100.0, 0.0)], []) == DepthSync.APPLIED
+    assert engine.market_snapshot() == ([], [(101.0, 2.0)])
+
+    # missed ids are reported and leave the book alone
+    assert engine.apply_depth_update(16, 17, [(99.0, 1.0)], []) == DepthSync.GAP
+    assert engine.market_snapshot() == ([], [(101.0, 2.0)])
+    assert engine.last_update_id == 14
+
+    # resync from a snapshot
+    engine.reset_market(20)
+    assert engine.market_snapshot() == ([], [])
+    assert engine.apply_depth_update(21, 21, [(99.0, 1.0)], []) == DepthSync.APPLIED
+
+
+def test_apply_depth_update_bad_level_leaves_book():
+    engine = MatchEngine()
+    engine.apply_depth_update(1, 1, [(100.0, 1.0)], [])
+    with pytest.raises(ValueError):
+        engine.apply_depth_update(2, 2, [(99.0, 1.0)], [("abc", "1")])
+    with pytest.raises(ValueError):
+        engine.apply_depth_update(2, 2, [(99.0, -1.0)], [])
+    assert engine.last_update_id == 1
+    assert engine.market_snapshot() == ([(100.0, 1.0)], [])
+
+
+@pytest.mark.parametrize("engine_cls", [MapMatchEngine, LadderMatchEngine])
+def test_snapshot_round_trip(engine_cls):
+    engine = engine_cls(tick_size=0.01, lot_size=0.001)
+    engine.insert("first", Side.BUY, 100.0, 0.5, 1)
+    engine.insert(7, Side.BUY, 100.0, 0.25, 2)
+    engine.insert("third", Side.BUY, 99.5, 1.0, 3)
+    engine.insert("ask", Side.SELL, 101.0, 2.0, 4)
+    engine.apply_depth_update(10, 12, [("100.5", "3")], [("101.5", "4")])
+    data = engine.snapshot()
+
+    restored = engine_cls(tick_size=0.01, lot_size=0.001)
+    restored.insert("stale", Side.SELL, 105.0, 1.0, 0)
+    restored.restore(data)
+    assert len(restored) == 4 and "stale" not in restored
+    assert restored.snapshot() == data
+    assert restored.last_update_id == 12
+    assert restored.market_snapshot() == engine.market_snapshot()
+    assert restored.queue_position(7) == (1, pytest.approx(0.5))
+
+    # queue order and string ids survive, so the queue fills as it would have
+    fills = restored.insert("sell", Side.SELL, 100.0, 1.0, 5)
+    assert [f.maker_order_id for f in fills] == ["first", "7"]
+    assert "ask" in restored and "first" not in restored
+
+
+def test_restore_rejects_bad_snapshot():
+    engine = MatchEngine(tick_size=0.01, lot_size=0.001)
+    engine.insert("buy", Side.BUY, 100.0, 1.0, 1)
+    data = engine.snapshot()
+
+    target = MatchEngine(tick_size=0.01, lot_size=0.001)
+    target.insert("keep", Side.SELL, 101.0, 1.0, 1)
+    for bad in (data[:-1], data[:40], b"not a snapshot" * 8):
+        with pytest.raises(ValueError):
+            target.restore(bad)
+    with pytest.raises(ValueError, match="grid"):
+        MatchEngine(tick_size=0.1, lot_size=0.001).restore(data)
+    assert target.market_snapshot() == ([], [])
+    assert len(target) == 1 and "keep" in target
+
+
+def test_engine_snapshot_file(tmp_path):
+    engine = MatchEngine(tick_size=0.01, lot_size=0.001)
+    engine.insert("buy", Side.BUY, 100.0, 1.0, 1)
+    path = tmp_path / "engine.snap"
+    assert save_engine(engine, path) == path.stat().st_size
+
+    restored = MatchEngine(tick_size=0.01, lot_size=0.001)
+    assert not load_engine(restored, tmp_path / "missing.snap")
+    assert load_engine(restored, path)
+    assert "buy" in restored and restored.best_bid == 100.0
+
+
+@pytest.mark.parametrize("rows", [0, 1, 4, 7])
+def test_logistic_proba_matches_numpy(rows):
+    features = np.random.RandomState(rows).normal(size=(rows, 10)) * 5
+    weights = np.linspace(-1.0, 1.0, 10)
+    expected = 1.0 / (1.0 + np.exp(-(features @ weights + 0.3)))
+    np.testing.assert_allclose(
+        logistic_proba(features, weights, 0.3), expected, rtol=1e-12
+    )
+
+
+def test_logistic_proba_shape_errors():
+    with pytest.raises(ValueError):
+        logistic_proba(np.zeros(10), np.zeros(10))
+    with pytest.raises(ValueError):
+        logistic_proba(np.zeros((2, 10)), np.zeros(9))
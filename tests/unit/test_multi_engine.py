@@ -0,0 +1,223 @@
+"""
+unit tests for the multi-symbol engine and the native shard runtime
+"""
+
+import asyncio
+import json
+import time
+import uuid
+from decimal import Decimal
+from unittest.mock import AsyncMock
+
+import numpy as np
+import pytest
+
+from data_feed.shm_ring import DepthRingWriter
+from live.multi_engine import MultiSymbolEngine
+from match_engine import QUOTE_DTYPE, QuoteEngine, ShardRuntime
+from models.size_calculator import SizeConfig
+from strategy.ev_maker import EVConfig
+
+GRID = ("0.01", "0.001")
+
+
+def _message(update_id, bids, asks, event_time=1):
+    return {
+        "e": "depthUpdate",
+        "E": event_time,
+        "s": "BTCUSDT",
+        "U": update_id,
+        "u": update_id,
+        "b": bids,
+        "a": asks,
+    }
+
+
+def _drain(runtime, count, timeout=2.0):
+    """wait for count quotes from the workers"""
+    out = np.zeros(64, dtype=QUOTE_DTYPE)
+    rows = []
+    deadline = time.monotonic() + timeout
+    while len(rows) < count and time.monotonic() < deadline:
+        n = runtime.drain(out)
+        rows.extend(out[:n].tolist())
+        if n == 0:
+            time.sleep(0.001)
+    return rows
+
+
+def _ring():
+    return DepthRingWriter(
+        f"mm_test_{uuid.uuid4().hex[:12]}",
+        capacity=16,
+        tick_size=GRID[0],
+        lot_size=GRID[1],
+    )
+
+
+def test_runtime_quotes_each_symbol_on_its_grid():
+    """test every shard quotes from its own ring and keeps its own stats"""
+    rings = [_ring(), _ring()]
+    runtime = ShardRuntime(workers=2, queue_capacity=64)
+    try:
+        for symbol, ring in zip(("btcusdt", "ethusdt"), rings):
+            runtime.add_symbol(symbol, ring.ring, EVConfig(), SizeConfig())
+        assert runtime.symbols == ["btcusdt", "ethusdt"]
+        runtime.start()
+
+        rings[0].write(_message(1, [["100.00", "1.000"]], [["100.02", "2.000"]], 7))
+        rings[1].write(_message(1, [["20.00", "5.000"]], [["20.04", "5.000"]], 8))
+        rows = sorted(_drain(runtime, 2))
+
+        assert [row[0] for row in rows] == [0, 1]
+        for row, (best_bid, best_ask) in zip(rows, ((10000, 10002), (2000, 2004))):
+            # a fresh QuoteEngine on the same grid quotes the same ticks
+            reference = QuoteEngine(EVConfig(), SizeConfig(), 0.01, 0.001)
+            (bid, bid_size), (ask, ask_size) = reference.quote_ticks(best_bid, best_ask)
+            assert row[1:5] == (bid, bid_size, ask, ask_size)
+        assert [row[5] for row in rows] == [7, 8]
+
+        with pytest.raises(RuntimeError, match="while running"):
+            runtime.add_symbol("solusdt", rings[0].ring, EVConfig(), SizeConfig())
+
+        stats = runtime.stats(1)
+        assert stats["messages"] == 1 and stats["quotes"] == 1
+        assert stats["mid"] == pytest.approx(20.02)
+        bounds, counts, total = runtime.latency_stats(0)
+        assert sum(counts) == 1 and len(counts) == len(bounds) + 1
+    finally:
+        runtime.close()
+        for ring in rings:
+            ring.close()
+
+
+def test_runtime_counts_stale_and_gapped_updates():
+    """test sequencing follows DepthBook and a settled book is not requoted"""
+    ring = _ring()
+    runtime = ShardRuntime(queue_capacity=64)
+    try:
+        runtime.add_symbol("btcusdt", ring.ring, EVConfig(), SizeConfig())
+        runtime.set_inventory(0, 5)
+        runtime.start()
+
+        ring.write(_message(10, [["100.00", "1.000"]], [["100.02", "1.000"]]))
+        assert len(_drain(runtime, 1)) == 1
+        ring.write(_message(9, [["99.00", "1.000"]], []))
+        ring.write(_message(20, [["99.99", "0.500"]], []))
+        # a no-op update leaves the quote where it was
+        ring.write(_message(21, [["99.99", "0.500"]], []))
+        time.sleep(0.05)
+        assert _drain(runtime, 1, timeout=0.05) == []
+
+        stats = runtime.stats(0)
+        assert stats["messages"] == 4 and stats["quotes"] == 1
+        assert (stats["stale"], stats["gaps"], stats["errors"]) == (1, 1, 0)
+        assert stats["inventory"] == 5
+    finally:
+        runtime.close()
+        ring.close()
+    assert runtime.symbols == []
+
+
+@pytest.mark.asyncio
+async def test_engine_feeds_rings_from_redis_streams():
+    """test one xread result fans out to each symbol's shard"""
+    grids = {"btcusdt": GRID, "ethusdt": GRID}
+    engine = MultiSymbolEngine(["BTCUSDT", "ethusdt"], workers=2, grids=grids)
+    try:
+        engine._open_rings()
+        engine.runtime.start()
+        last_ids = {key: "$" for key in engine.stream_keys}
+
+        message = _message(1, [["20.00", "1.0"]], [["20.04", "1.0"]])
+        entry = (b"1-0", {b"data": json.dumps(message).encode()})
+        engine._publish(
+            [(b"depth_updates:ethusdt", [entry]), (b"depth_updates:btcusdt", [])],
+            last_ids,
+        )
+
+        rows = _drain(engine.runtime, 1)
+        assert [row[0] for row in rows] == [1]
+        assert last_ids == {
+            "depth_updates:btcusdt": "$",
+            "depth_updates:ethusdt": b"1-0",
+        }
+        assert engine.units["ethusdt"] == (Decimal("0.01"), Decimal("0.001"))
+    finally:
+        await engine.stop()
+    assert engine.rings == {}
+
+
+@pytest.mark.asyncio
+async def test_busy_symbol_only_works_its_latest_quote():
+    """test quotes conflate per symbol while its requests are in flight"""
+    engine = MultiSymbolEngine(["btcusdt", "ethusdt"], workers=1)
+    units = (Decimal("0.01"), Decimal("0.001"))
+    engine.units = {"btcusdt": units, "ethusdt": units}
+    release = asyncio.Event()
+
+    async def post_order(**kwargs):
+        if kwargs["symbol"] == "BTCUSDT":
+            await asyncio.wait_for(release.wait(), timeout=1)
+        return {"orderId": 1}
+
+    engine.gateway = AsyncMock()
+    engine.gateway.post_order.side_effect = post_order
+    engine.gateway.cancel_replace_order.return_value = {
+        "newOrderResponse": {"orderId": 2}
+    }
+
+    engine._on_quotes([(0, 10000, 1, 10010, 1, 1)])
+    await asyncio.sleep(0)
+    engine._on_quotes(
+        [
+            (0, 10001, 1, 10011, 1, 2),
+            (1, 2000, 5, 2004, 5, 2),
+            (0, 10002, 1, 10012, 1, 3),
+        ]
+    )
+    # the other symbol isn't held up by the busy one
+    await engine._working[1]
+    assert not release.is_set()
+    eth = [call.kwargs for call in engine.gateway.post_order.call_args_list][-2:]
+    assert {(order["symbol"], order["price"]) for order in eth} == {
+        ("ETHUSDT", Decimal("20.00")),
+        ("ETHUSDT", Decimal("20.04")),
+    }
+
+    release.set()
+    await engine._working[0]
+    replaced = engine.gateway.cancel_replace_order.call_args_list
+    replaced = [call.kwargs["price"] for call in replaced]
+    assert sorted(replaced) == [Decimal("100.02"), Decimal("100.12")]
+    assert engine._working == {} and engine._latest == {}
+
+    await engine.stop()
+
+
+@pytest.mark.asyncio
+async def test_fills_move_the_shard_inventory():
+    """test account trades reach the shard in lots, once each"""
+    engine = MultiSymbolEngine(["btcusdt"], grids={"btcusdt": GRID})
+    engine.redis_client = AsyncMock()
+    engine.gateway = AsyncMock()
+    engine.gateway.get_account_trades.return_value = [
+        {"id": 1, "isBuyer": True, "qty": "0.250"},
+        {"id": 2, "isBuyer": False, "qty": "0.050"},
+    ]
+    try:
+        engine._open_rings()
+        await engine._check_for_fills(0, "btcusdt")
+        await engine._check_for_fills(0, "btcusdt")
+
+        assert engine.inventory["btcusdt"] == Decimal("0.200")
+        assert engine.runtime.stats(0)["inventory"] == 200
+        engine.redis_client.set.assert_called_once_with("position:btcusdt", "0.200")
+    finally:
+        await engine.stop()
+
+
+def test_needs_symbols():
+    """test the engine refuses an empty symbol list"""
+    with pytest.raises(ValueError, match="at least one symbol"):
+        MultiSymbolEngine([])
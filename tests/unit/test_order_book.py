@@ -79,6 +79,8 @@ def test_match_buy_order(order_book):
     assert fills[0].maker_order_id == "1"
     assert fills[0].price == Decimal("50000.00")
     assert fills[0].size == Decimal("1.0")
+    # the taker's time, not the wall clock
+    assert fills[0].timestamp == 1234567891
     assert sell_order.price not in order_book.asks  # sell order should be removed
 
 
@@ -107,6 +109,7 @@ def test_match_sell_order(order_book):
     assert fills[0].maker_order_id == "1"
     assert fills[0].price == Decimal("50000.00")
     assert fills[0].size == Decimal("1.0")
+    assert fills[0].timestamp == 1234567891
     assert buy_order.price not in order_book.bids  # buy order should be removed
 
 
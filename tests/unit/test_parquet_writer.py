@@ -3,11 +3,19 @@ unit tests for parquet writer
 """
 
 import datetime
+import threading
+import time
+from decimal import Decimal
+from types import SimpleNamespace
+from unittest.mock import patch
 
+import numpy as np
 import pandas as pd
+import pyarrow.parquet as pq
 import pytest
 
-from data_feed.parquet_writer import ParquetWriter
+from data_feed.parquet_writer import ParquetWriter, decode_levels, schema_units
+from storage.tick_store import LEVEL_DTYPE
 
 
 def _convert_array_to_list(arr):
@@ -66,6 +74,22 @@ def test_message_persistence(test_data_dir, sample_depth_update):
     assert stored_asks == sample_depth_update["a"]
 
 
+def test_default_compression_is_zstd(test_data_dir, sample_depth_update):
+    """test files are zstd compressed unless another codec is asked for"""
+    for schema_version in (1, 2):
+        writer = ParquetWriter(base_path=test_data_dir, schema_version=schema_version)
+        assert writer.compression == "zstd"
+        writer.write(sample_depth_update)
+        writer.close()
+
+        (file_path,) = test_data_dir.glob("*.parquet")
+        metadata = pq.ParquetFile(file_path).metadata
+        row_group = metadata.row_group(0)
+        codecs = {row_group.column(i).compression for i in range(row_group.num_columns)}
+        assert codecs == {"ZSTD"}
+        file_path.unlink()
+
+
 def test_invalid_message_handling(test_data_dir):
     """test handling of invalid messages"""
     writer = ParquetWriter(base_path=test_data_dir)
@@ -105,3 +129,174 @@ def test_close(test_data_dir, sample_depth_update):
     assert writer.writer is None
     assert writer.current_file is None
     assert writer.current_date is None
+
+
+def _read_file(test_data_dir):
+    files = list(test_data_dir.glob("*.parquet"))
+    assert len(files) == 1
+    return pq.read_table(files[0])
+
+
+def test_schema_v2_integer_levels(test_data_dir, sample_depth_update):
+    """test version 2 stores ticks/lots and records the grid"""
+    writer = ParquetWriter(
+        base_path=test_data_dir, schema_version=2, tick_size="0.01", lot_size="0.001"
+    )
+    writer.write(sample_depth_update)
+    writer.close()
+
+    table = _read_file(test_data_dir)
+    assert schema_units(table.schema) == (Decimal("0.01"), Decimal("0.001"))
+    row = table.to_pylist()[0]
+    assert row["bids"] == [{"price": 5000000, "qty": 1000}]
+    assert row["asks"] == [{"price": 5000100, "qty": 1000}]
+
+    units = schema_units(table.schema)
+    assert decode_levels(row["bids"], units) == [["50000.00", "1.000"]]
+
+
+def test_write_levels(test_data_dir, sample_depth_update):
+    """test decoded integer levels are stored as write() would store them"""
+    writer = ParquetWriter(
+        base_path=test_data_dir, schema_version=2, tick_size="0.01", lot_size="0.001"
+    )
+    levels = {
+        "b": np.array([(5000000, 1000)], dtype=LEVEL_DTYPE),
+        "a": np.array([(5000100, 1000)], dtype=LEVEL_DTYPE),
+    }
+    writer.write_levels(SimpleNamespace(**dict(sample_depth_update, **levels)))
+    writer.write(sample_depth_update)
+    writer.close()
+
+    first, second = _read_file(test_data_dir).to_pylist()
+    assert first == second
+
+    with pytest.raises(ValueError, match="Version 1"):
+        ParquetWriter(base_path=test_data_dir).write_levels(None)
+
+
+def test_schema_v1_has_no_units(test_data_dir, sample_depth_update):
+    """test version 1 files read back through decode_levels unchanged"""
+    writer = ParquetWriter(base_path=test_data_dir)
+    writer.write(sample_depth_update)
+    writer.close()
+
+    table = _read_file(test_data_dir)
+    assert schema_units(table.schema) is None
+    row = table.to_pylist()[0]
+    assert decode_levels(row["bids"], None) == sample_depth_update["b"]
+
+
+def test_schema_v2_rejects_off_grid(test_data_dir, sample_depth_update):
+    """test version 2 refuses levels that are not on the grid"""
+    writer = ParquetWriter(base_path=test_data_dir, schema_version=2, tick_size="1")
+    message = dict(sample_depth_update, b=[["50000.50", "1.000"]])
+    with pytest.raises(ValueError):
+        writer.write(message)
+    writer.close()
+
+
+def test_row_group_size(test_data_dir, sample_depth_update):
+    """test messages are buffered into row groups and flushed on close"""
+    writer = ParquetWriter(base_path=test_data_dir, schema_version=2, row_group_size=3)
+    for i in range(7):
+        writer.write(dict(sample_depth_update, U=i, u=i))
+    writer.close()
+
+    files = list(test_data_dir.glob("*.parquet"))
+    metadata = pq.ParquetFile(files[0]).metadata
+    assert metadata.num_rows == 7
+    assert [
+        metadata.row_group(i).num_rows for i in range(metadata.num_row_groups)
+    ] == [3, 3, 1]
+
+
+def test_rotation_flushes_buffer(test_data_dir, sample_depth_update):
+    """test buffered rows land in their own day's file on rotation"""
+    writer = ParquetWriter(base_path=test_data_dir, schema_version=2)
+    writer.write(sample_depth_update)
+    next_day = dict(sample_depth_update, E=sample_depth_update["E"] + 86400 * 1000)
+    writer.write(next_day)
+    writer.close()
+
+    files = sorted(test_data_dir.glob("*.parquet"))
+    assert [pq.read_metadata(f).num_rows for f in files] == [1, 1]
+
+
+def test_invalid_schema_version(test_data_dir):
+    """test unknown schema versions are rejected"""
+    with pytest.raises(ValueError):
+        ParquetWriter(base_path=test_data_dir, schema_version=3)
+
+
+def test_background_writer_rotates_and_compresses(test_data_dir, sample_depth_update):
+    """test a background writer keeps daily files and the chosen codec"""
+    writer = ParquetWriter(
+        base_path=test_data_dir,
+        schema_version=2,
+        row_group_size=2,
+        compression="zstd",
+        background=True,
+    )
+    for i in range(3):
+        writer.write(dict(sample_depth_update, U=i, u=i))
+    next_day = dict(sample_depth_update, E=sample_depth_update["E"] + 86400 * 1000)
+    writer.write(next_day)
+    writer.close()
+    assert writer.current_file is None
+
+    files = sorted(test_data_dir.glob("*.parquet"))
+    metadata = [pq.read_metadata(f) for f in files]
+    assert [m.num_rows for m in metadata] == [3, 1]
+    assert [m.num_row_groups for m in metadata] == [2, 1]
+    assert metadata[0].row_group(0).column(0).compression == "ZSTD"
+    assert pq.read_table(files[0]).column("final_update_id").to_pylist() == [0, 1, 2]
+
+    stats = writer.stats()
+    assert stats["batches_written"] == 3 and stats["rows_written"] == 4
+    assert stats["max_flush_seconds"] > 0
+    assert stats["pending_batches"] == 0
+
+
+def test_background_writer_backpressure(test_data_dir, sample_depth_update):
+    """test write() waits on a full queue and counts the wait"""
+    gate = threading.Event()
+    write_batch = pq.ParquetWriter.write_batch
+
+    def slow_write_batch(self, *args, **kwargs):
+        gate.wait(5)
+        return write_batch(self, *args, **kwargs)
+
+    writer = ParquetWriter(base_path=test_data_dir, background=True, max_pending=1)
+    with patch.object(pq.ParquetWriter, "write_batch", slow_write_batch):
+        # the first batch holds the thread, the second fills the queue and
+        # the third has to wait for room
+        producer = threading.Thread(
+            target=lambda: [
+                writer.write(dict(sample_depth_update, U=i, u=i)) for i in range(3)
+            ]
+        )
+        producer.start()
+        deadline = time.monotonic() + 5
+        while writer.stats()["backpressure_waits"] == 0:
+            assert time.monotonic() < deadline
+            time.sleep(0.001)
+        assert producer.is_alive()
+        gate.set()
+        producer.join(5)
+        writer.close()
+
+    assert writer.stats()["backpressure_waits"] >= 1
+    assert writer.stats()["backpressure_seconds"] > 0
+    files = list(test_data_dir.glob("*.parquet"))
+    assert pq.read_metadata(files[0]).num_rows == 3
+
+
+def test_flush_interval(test_data_dir, sample_depth_update):
+    """test a partial batch is flushed once it has waited long enough"""
+    writer = ParquetWriter(
+        base_path=test_data_dir, schema_version=2, flush_interval=0.0
+    )
+    writer.write(sample_depth_update)
+    assert writer.stats()["rows_written"] == 1
+    writer.close()
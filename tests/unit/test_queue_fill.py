@@ -0,0 +1,100 @@
+"""
+tests for the native queue position fill model
+"""
+
+import pyarrow as pa
+import pytest
+
+from match_engine import DepthReplay, QueueFillModel, Side
+
+
+def test_drops_move_the_queue_before_filling():
+    """test size leaving a level reaches our order only once none is ahead"""
+    queue = QueueFillModel(0.01, 0.001)
+    order_id = queue.place(Side.BUY, 100.0, 1.0, shown=2.0)
+    assert queue.queue(order_id) == (2.0, 1.0)
+
+    # new size joins behind us
+    queue.on_level(Side.BUY, 100.0, 5.0, 1)
+    queue.on_level(Side.BUY, 99.99, 0.0, 1)
+    assert queue.take_fills() == []
+    assert queue.queue(order_id) == (2.0, 1.0)
+
+    queue.on_level(Side.BUY, 100.0, 2.6, 2)
+    fills = queue.take_fills()
+    assert [fill[:2] for fill in fills] == [(order_id, Side.BUY)]
+    assert fills[0][2:] == pytest.approx((100.0, 0.4, 2))
+    assert queue.queue(order_id) == pytest.approx((0.0, 0.6))
+
+    assert queue.cancel(order_id)
+    assert not queue.cancel(order_id)
+    assert order_id not in queue and len(queue) == 0
+
+
+def test_later_orders_wait_behind_earlier_ones():
+    """test two orders at one price fill in the order they joined"""
+    queue = QueueFillModel(0.01, 0.001)
+    first = queue.place(Side.SELL, 101.0, 1.0, shown=0.5)
+    second = queue.place(Side.SELL, 101.0, 1.0, shown=0.5)
+    queue.on_level(Side.SELL, 101.0, 0.0, 1)
+    queue.on_level(Side.SELL, 101.0, 2.0, 2)
+    queue.on_level(Side.SELL, 101.0, 0.5, 3)
+    fills = queue.take_fills()
+    assert [fill[0] for fill in fills] == [first, second]
+    assert [fill[3] for fill in fills] == pytest.approx([1.0, 0.5])
+
+    # bids at our price trade through what is left
+    queue.on_best(101.0, 0.0, 4)
+    assert [fill[0] for fill in queue.take_fills()] == [second]
+    assert len(queue) == 0
+
+
+def test_replay_moves_the_queue_on_every_message():
+    """test an attached model sees unsampled messages too"""
+    replay = DepthReplay(0.01, 0.001, incremental=True)
+    queue = QueueFillModel(0.01, 0.001)
+    order_id = queue.place(Side.BUY, 100.0, 1.0, shown=1.0)
+    replay.set_queue_model(queue)
+    batch = pa.RecordBatch.from_pydict(
+        {
+            "event_time": [1, 2, 3],
+            "first_update_id": [1, 2, 3],
+            "final_update_id": [1, 2, 3],
+            "bids": [["100.00,1.000"], ["100.00,0.200"], []],
+            "asks": [["100.02,1.000"], [], ["100.00,0.500"]],
+        }
+    )
+    replay.replay(batch, lambda *args: None, sample_every=10)
+
+    fills = queue.take_fills()
+    assert [(fill[0], fill[4]) for fill in fills] == [(order_id, 3)]
+    assert fills[0][3] == pytest.approx(1.0)
+
+    with pytest.raises(ValueError, match="grid"):
+        replay.set_queue_model(QueueFillModel(0.1, 0.001))
+    replay.set_queue_model(None)
+
+
+def test_full_replay_drops_levels_it_leaves_out():
+    """test a full message that omits our level takes the size ahead of us"""
+    replay = DepthReplay(0.01, 0.001)
+    queue = QueueFillModel(0.01, 0.001)
+    near = queue.place(Side.BUY, 100.0, 1.0, shown=1.0)
+    deep = queue.place(Side.BUY, 99.0, 1.0, shown=2.0)
+    replay.set_queue_model(queue)
+    batch = pa.RecordBatch.from_pydict(
+        {
+            "event_time": [1, 2],
+            "first_update_id": [1, 2],
+            "final_update_id": [1, 2],
+            "bids": [["100.00,1.000", "99.50,1.000"], ["99.50,1.000"]],
+            "asks": [["100.02,1.000"], ["100.02,1.000"]],
+        }
+    )
+    replay.replay(batch, lambda *args: None, sample_every=10)
+
+    assert queue.take_fills() == []
+    # 100.00 is inside the book the second message left and got dropped,
+    # 99.00 is past its worst bid and keeps the size it had
+    assert queue.queue(near) == (0.0, 1.0)
+    assert queue.queue(deep) == (2.0, 1.0)
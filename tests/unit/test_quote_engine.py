@@ -0,0 +1,113 @@
+"""
+parity tests for the native quote engine against EVMaker
+"""
+
+import math
+from decimal import Decimal
+
+import numpy as np
+import pytest
+
+from match_engine import QuoteEngine
+from models.size_calculator import ScalingType, SizeConfig
+from strategy.ev_maker import EVConfig, EVMaker, NativeEVMaker
+
+MIDS = [Decimal("50000"), Decimal("50000.5"), Decimal("50003"), Decimal("49990.25")]
+
+
+class DistanceFillModel:
+    """fill probability falling off with distance from a fixed mid"""
+
+    def predict_batch(self, bids, asks, order_prices, order_size, order_sides):
+        distances = [abs(float(price) - 50000.0) for price in order_prices]
+        return np.exp(-np.array(distances) / 2.0)
+
+
+def _quote(maker, mid, inventory, fill_model=None):
+    return maker.quote_prices(
+        mid_price=mid,
+        volatility=Decimal("0.01"),
+        bid_probability=Decimal("0.5"),
+        ask_probability=Decimal("0.3"),
+        inventory=inventory,
+        fill_model=fill_model,
+    )
+
+
+def _assert_close(native, reference):
+    for got, expected in zip(native, reference):
+        assert float(got.price) == pytest.approx(float(expected.price), rel=1e-12)
+        assert float(got.size) == pytest.approx(float(expected.size), rel=1e-12)
+
+
+@pytest.mark.parametrize("scaling_type", [ScalingType.LINEAR, ScalingType.SIGMOID])
+@pytest.mark.parametrize("inventory", ["-1.5", "-0.4", "0", "0.3", "1.0"])
+@pytest.mark.parametrize("with_model", [False, True])
+def test_quotes_match_ev_maker(scaling_type, inventory, with_model):
+    """test a sequence of quotes matches the python reference, clip included"""
+    ev_config = EVConfig(num_points=7)
+    size_config = SizeConfig(scaling_type=scaling_type)
+    reference = EVMaker(ev_config, size_config)
+    native = NativeEVMaker(ev_config, size_config)
+    fill_model = DistanceFillModel() if with_model else None
+
+    for mid in MIDS:
+        _assert_close(
+            _quote(native, mid, Decimal(inventory), fill_model),
+            _quote(reference, mid, Decimal(inventory), fill_model),
+        )
+
+
+def test_sizes_match_size_calculator():
+    """test native sizing against SizeCalculator.get_sizes"""
+    for scaling_type in ScalingType:
+        size_config = SizeConfig(scaling_type=scaling_type)
+        reference = EVMaker(EVConfig(), size_config).size_calculator
+        engine = QuoteEngine(EVConfig(), size_config)
+        for inventory in ["-2", "-1", "-0.25", "0", "0.6", "1", "3"]:
+            expected = reference.get_sizes(Decimal(inventory))
+            got = engine.sizes(float(inventory))
+            assert got == pytest.approx([float(size) for size in expected], rel=1e-12)
+
+
+def test_quote_ticks_round_away_from_the_book():
+    """test fixed-point quotes never sit inside the computed prices"""
+    engine = QuoteEngine(EVConfig(), SizeConfig(), tick_size=0.01, lot_size=0.0001)
+    reference = QuoteEngine(EVConfig(), SizeConfig(), tick_size=0.01, lot_size=0.0001)
+
+    (bid_ticks, bid_lots), (ask_ticks, ask_lots) = engine.quote_ticks(
+        5000000, 5000001, inventory=2500
+    )
+    (bid_price, bid_size), (ask_price, ask_size) = reference.quote(50000.005, 0.25)
+    assert bid_ticks == math.floor(bid_price / 0.01 + 1e-9)
+    assert ask_ticks == math.ceil(ask_price / 0.01 - 1e-9)
+    assert bid_ticks * 0.01 <= bid_price and ask_ticks * 0.01 >= ask_price
+    assert (bid_lots, ask_lots) == (
+        math.floor(bid_size / 0.0001 + 1e-9),
+        math.floor(ask_size / 0.0001 + 1e-9),
+    )
+
+
+def test_candidates_do_not_advance_the_clip():
+    """test candidate prices are a peek at the next quote's search space"""
+    engine = QuoteEngine(EVConfig(num_points=3), SizeConfig())
+    engine.quote(50000.0)
+    bids, asks = engine.candidates(50100.0)
+    assert list(bids) == pytest.approx([49997.6, 49997.6 - 0.0025, 49997.595])
+    assert list(asks) == pytest.approx([50002.6, 50002.6 + 0.0025, 50002.605])
+
+    # the peek didn't move the clip reference; reset does
+    bids_again, _ = engine.candidates(50100.0)
+    assert list(bids_again) == list(bids)
+    engine.reset()
+    bids, _ = engine.candidates(50100.0)
+    assert bids[0] == pytest.approx(50097.5)
+
+
+def test_quote_engine_errors():
+    """test invalid configs and probability arrays are rejected"""
+    with pytest.raises(ValueError):
+        QuoteEngine(EVConfig(num_points=1), SizeConfig())
+    engine = QuoteEngine(EVConfig(num_points=3), SizeConfig())
+    with pytest.raises(ValueError):
+        engine.quote(50000.0, bid_probs=np.ones(4))
@@ -3,14 +3,20 @@ unit tests for message recorder
 """
 
 import asyncio
+import datetime
 import json
-from unittest.mock import AsyncMock, patch
+import uuid
+from decimal import Decimal
+from unittest.mock import AsyncMock, MagicMock, patch
 
 import pytest
 from redis.exceptions import ConnectionError as RedisConnectionError
 from websockets.exceptions import ConnectionClosedOK
 
 from data_feed.recorder import MessageRecorder
+from data_feed.shm_ring import DepthRingReader
+from data_feed.stream_codec import decode_fields
+from storage.tick_store import TickStoreReader
 
 
 class MockWebSocket:
@@ -57,11 +63,43 @@ class MockWebSocket:
 
         return message
 
+    async def receive_depth(self, decoder):
+        """mock receive of raw frames through a decoder"""
+        message = await self.receive()
+        if message is None:
+            return None
+        raw = json.dumps(message)
+        return raw, decoder.decode(raw)
+
     def is_connected(self):
         """mock connection status"""
         return not self.closed
 
 
+class MockPipeline:
+    """mock redis pipeline, appends what it executed to a shared list"""
+
+    def __init__(self, executed):
+        self.executed = executed
+        self.commands = []
+
+    async def __aenter__(self):
+        return self
+
+    async def __aexit__(self, *exc_info):
+        return False
+
+    def xadd(self, stream_key, fields, **kwargs):
+        """mock queued xadd"""
+        self.commands.append((stream_key, fields, kwargs))
+        return self
+
+    async def execute(self):
+        """mock execute"""
+        self.executed.append(self.commands)
+        return ["message_id"] * len(self.commands)
+
+
 @pytest.fixture
 def mock_redis():
     """fixture for mocked redis client"""
@@ -277,3 +315,158 @@ async def test_recorder_concurrent_writes(mock_redis, sample_depth_update):
             for i, call in enumerate(calls):
                 stored_data = json.loads(call[1]["fields"]["data"])
                 assert stored_data == sample_depth_update
+
+
+@pytest.mark.asyncio
+async def test_recorder_writes_tick_store(mock_redis, sample_depth_update, tmp_path):
+    """test the recorder also writes tick store files when asked"""
+    with patch("redis.asyncio.from_url", return_value=mock_redis):
+        with patch("data_feed.recorder.BinanceWebSocket") as mock_ws_class:
+            mock_ws_class.return_value = MockWebSocket(messages=[sample_depth_update])
+
+            recorder = MessageRecorder(
+                output_path=str(tmp_path / "raw"),
+                tick_store_path=str(tmp_path / "ticks"),
+            )
+            try:
+                await asyncio.wait_for(recorder.start(), timeout=1.0)
+            except asyncio.TimeoutError:
+                pass
+            finally:
+                await recorder.stop()
+
+    date = datetime.date(2021, 6, 12)
+    reader = TickStoreReader.open(tmp_path / "ticks", "btcusdt", date)
+    assert len(reader) == 1
+    assert reader.message(0)[3].tolist() == [(5000000000000, 100000000)]
+
+
+@pytest.mark.asyncio
+async def test_recorder_publishes_to_shm_ring(
+    mock_redis, sample_depth_update, tmp_path
+):
+    """test the recorder also publishes to a shared memory ring when asked"""
+    name = f"mm_test_{uuid.uuid4().hex[:12]}"
+    with patch("redis.asyncio.from_url", return_value=mock_redis):
+        with patch("data_feed.recorder.BinanceWebSocket") as mock_ws_class:
+            mock_ws_class.return_value = MockWebSocket(messages=[sample_depth_update])
+
+            recorder = MessageRecorder(output_path=str(tmp_path), shm_ring=name)
+            reader = DepthRingReader(name)
+            try:
+                await asyncio.wait_for(recorder.start(), timeout=1.0)
+            except asyncio.TimeoutError:
+                pass
+            finally:
+                update = reader.read_update("btcusdt")
+                reader.close()
+                await recorder.stop()
+
+    assert update.u == sample_depth_update["u"]
+    # levels come back on the ring's 1e-8 grid, equal as decimals
+    assert [[Decimal(v) for v in level] for level in update.b] == [
+        [Decimal("50000.00"), Decimal("1.000")]
+    ]
+
+
+@pytest.mark.asyncio
+async def test_recorder_pipelines_redis_writes(
+    mock_redis, sample_depth_update, tmp_path
+):
+    """test batched writes go out as pipelines with approximate trimming"""
+    executed = []
+    mock_redis.pipeline = MagicMock(side_effect=lambda **kw: MockPipeline(executed))
+    with patch("redis.asyncio.from_url", return_value=mock_redis):
+        with patch("data_feed.recorder.BinanceWebSocket") as mock_ws_class:
+            mock_ws_class.return_value = MockWebSocket(
+                messages=[sample_depth_update] * 3
+            )
+
+            recorder = MessageRecorder(
+                output_path=str(tmp_path),
+                payload_format="binary",
+                redis_batch_size=2,
+                redis_batch_interval=10.0,
+            )
+            try:
+                await asyncio.wait_for(recorder.start(), timeout=1.0)
+            except asyncio.TimeoutError:
+                pass
+            finally:
+                await recorder.stop()
+
+    mock_redis.xadd.assert_not_called()
+    mock_redis.pipeline.assert_called_with(transaction=False)
+    # one full pipeline, and the rest sent on stop
+    assert [len(commands) for commands in executed] == [2, 1]
+    for stream_key, fields, kwargs in executed[0] + executed[1]:
+        assert stream_key == "stream:lob:btcusdt"
+        assert kwargs == {"maxlen": 100000, "approximate": True}
+        assert decode_fields(fields).u == sample_depth_update["u"]
+
+
+@pytest.mark.asyncio
+async def test_recorder_pipeline_flushes_on_interval(
+    mock_redis, sample_depth_update, tmp_path
+):
+    """test a part-full pipeline is sent once the batch interval passes"""
+    executed = []
+    mock_redis.pipeline = MagicMock(side_effect=lambda **kw: MockPipeline(executed))
+    with patch("redis.asyncio.from_url", return_value=mock_redis):
+        with patch("data_feed.recorder.BinanceWebSocket") as mock_ws_class:
+            mock_ws_class.return_value = MockWebSocket()
+
+            recorder = MessageRecorder(
+                output_path=str(tmp_path),
+                redis_batch_size=100,
+                redis_batch_interval=0.01,
+            )
+            await recorder._record_message(sample_depth_update)
+            await recorder._record_message(sample_depth_update)
+            assert executed == []
+
+            await asyncio.sleep(0.1)
+            assert [len(commands) for commands in executed] == [2]
+            assert json.loads(executed[0][0][1]["data"]) == sample_depth_update
+            await recorder.stop()
+    assert len(executed) == 1
+
+
+@pytest.mark.asyncio
+async def test_recorder_fast_decode(mock_redis, sample_depth_update, tmp_path):
+    """test natively decoded frames reach redis, parquet and the tick store"""
+    with patch("redis.asyncio.from_url", return_value=mock_redis):
+        with patch("data_feed.recorder.BinanceWebSocket") as mock_ws_class:
+            mock_ws_class.return_value = MockWebSocket(messages=[sample_depth_update])
+
+            recorder = MessageRecorder(
+                output_path=str(tmp_path / "raw"),
+                tick_store_path=str(tmp_path / "ticks"),
+                fast_decode=True,
+            )
+            try:
+                await asyncio.wait_for(recorder.start(), timeout=1.0)
+            except asyncio.TimeoutError:
+                pass
+            finally:
+                await recorder.stop()
+
+    # the frame itself is the json entry
+    fields = mock_redis.xadd.call_args[1]["fields"]
+    assert json.loads(fields["data"]) == sample_depth_update
+
+    date = datetime.date(2021, 6, 12)
+    reader = TickStoreReader.open(tmp_path / "ticks", "btcusdt", date)
+    assert reader.message(0)[3].tolist() == [(5000000000000, 100000000)]
+
+    (path,) = (tmp_path / "raw").glob("*.parquet")
+    assert recorder.parquet_writer.schema_version == 2
+    assert path.stat().st_size > 0
+
+
+def test_recorder_rejects_bad_redis_settings():
+    """test unknown payload formats and batch sizes are refused"""
+    with pytest.raises(ValueError, match="format"):
+        MessageRecorder(redis_url="redis://dummy", payload_format="msgpack")
+    with pytest.raises(ValueError, match="batch"):
+        MessageRecorder(redis_url="redis://dummy", redis_batch_size=0)
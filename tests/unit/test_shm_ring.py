@@ -0,0 +1,152 @@
+"""
+tests for the shared memory depth ring
+"""
+
+import multiprocessing
+import uuid
+
+import numpy as np
+import pytest
+
+from data_feed.shm_ring import DepthRingReader, DepthRingWriter
+from storage.tick_store import LEVEL_DTYPE
+
+
+@pytest.fixture
+def segment_name():
+    return f"mm_test_{uuid.uuid4().hex[:12]}"
+
+
+def _message(event_time, bids, asks):
+    return {
+        "e": "depthUpdate",
+        "E": event_time,
+        "s": "BTCUSDT",
+        "U": event_time * 10,
+        "u": event_time * 10 + 1,
+        "b": bids,
+        "a": asks,
+    }
+
+
+def test_round_trip(segment_name):
+    """test a published update reads back as the same DepthUpdate"""
+    writer = DepthRingWriter(
+        segment_name, capacity=8, tick_size="0.01", lot_size="0.001"
+    )
+    reader = DepthRingReader(segment_name)
+    try:
+        assert reader.read() is None
+        writer.write(_message(1, [["50000.01", "1.500"]], [["50000.02", "0.003"]]))
+
+        update = reader.read_update("btcusdt")
+        assert (update.E, update.U, update.u, update.s) == (1, 10, 11, "BTCUSDT")
+        assert update.b == [["50000.01", "1.500"]]
+        assert update.a == [["50000.02", "0.003"]]
+        assert reader.read() is None
+    finally:
+        reader.close()
+        writer.close()
+
+
+def test_levels_are_tick_store_records(segment_name):
+    """test read() gives LEVEL_DTYPE arrays and publish_levels takes them"""
+    writer = DepthRingWriter(
+        segment_name, capacity=8, tick_size="0.01", lot_size="0.001"
+    )
+    reader = DepthRingReader(segment_name)
+    try:
+        bids = np.array([(5000001, 1500), (5000000, 20)], dtype=LEVEL_DTYPE)
+        asks = np.array([], dtype=LEVEL_DTYPE)
+        writer.ring.publish_levels(5, 50, 51, bids, asks)
+        event_time, first, final, got_bids, got_asks = reader.read()
+        assert (event_time, first, final) == (5, 50, 51)
+        assert got_bids.dtype == LEVEL_DTYPE
+        assert got_bids.tolist() == bids.tolist()
+        assert len(got_asks) == 0
+    finally:
+        reader.close()
+        writer.close()
+
+
+def test_readers_follow_independently(segment_name):
+    """test every reader sees every message at its own pace"""
+    writer = DepthRingWriter(segment_name, capacity=8)
+    early = DepthRingReader(segment_name)
+    try:
+        writer.write(_message(1, [["1", "1"]], []))
+        late = DepthRingReader(segment_name)
+        oldest = DepthRingReader(segment_name, from_oldest=True)
+        writer.write(_message(2, [["1", "1"]], []))
+
+        assert [early.read()[0], early.read()[0]] == [1, 2]
+        assert late.read()[0] == 2
+        assert [oldest.read()[0], oldest.read()[0]] == [1, 2]
+        late.close()
+        oldest.close()
+    finally:
+        early.close()
+        writer.close()
+
+
+def test_lapped_reader_skips_ahead(segment_name):
+    """test a reader a whole ring behind counts what it missed"""
+    writer = DepthRingWriter(segment_name, capacity=4)
+    reader = DepthRingReader(segment_name)
+    try:
+        for event_time in range(1, 11):
+            writer.write(_message(event_time, [["1", "1"]], []))
+        assert [reader.read()[0] for _ in range(4)] == [7, 8, 9, 10]
+        assert reader.read() is None
+        assert reader.dropped == 6
+    finally:
+        reader.close()
+        writer.close()
+
+
+def test_oversized_and_off_grid_updates_are_refused(segment_name):
+    """test updates the ring can't represent raise without publishing"""
+    writer = DepthRingWriter(segment_name, capacity=4, max_levels=2, tick_size="0.01")
+    reader = DepthRingReader(segment_name)
+    try:
+        with pytest.raises(ValueError):
+            writer.write(_message(1, [["1", "1"], ["2", "1"]], [["3", "1"]]))
+        with pytest.raises(ValueError):
+            writer.write(_message(2, [["1.001", "1"]], []))
+        assert reader.read() is None
+    finally:
+        reader.close()
+        writer.close()
+
+
+def test_reader_needs_a_ring(segment_name):
+    """test attaching to a missing segment fails"""
+    with pytest.raises(FileNotFoundError):
+        DepthRingReader(segment_name)
+    with pytest.raises(ValueError):
+        DepthRingWriter(segment_name, capacity=6)
+
+
+def _publish(name, count):
+    # the child attaches and becomes the ring's only producer
+    attached = DepthRingReader(name)
+    for event_time in range(1, count + 1):
+        attached.ring.publish(event_time, event_time, event_time, [["1", "1"]], [])
+    attached.close()
+
+
+def test_messages_cross_processes(segment_name):
+    """test a reader sees messages published by another process"""
+    writer = DepthRingWriter(segment_name, capacity=64)
+    reader = DepthRingReader(segment_name)
+    try:
+        process = multiprocessing.get_context("fork").Process(
+            target=_publish, args=(segment_name, 20)
+        )
+        process.start()
+        process.join(timeout=30)
+        assert process.exitcode == 0
+        assert [reader.read()[0] for _ in range(20)] == list(range(1, 21))
+    finally:
+        reader.close()
+        writer.close()
@@ -16,9 +16,11 @@ import pyarrow.parquet as pq
 import pytest
 from pyarrow import Table, schema
 
+from backtest.latency import LatencyModel
 from backtest.simulator import Simulator
+from data_feed.parquet_writer import ParquetWriter
 from lob.order_book import OrderBook
-from strategy.naive_maker import NaiveMaker, NaiveMakerConfig
+from strategy.naive_maker import NaiveMaker, NaiveMakerConfig, Quote
 
 
 @pytest.fixture
@@ -293,3 +295,333 @@ def test_backtest_produces_pnl_csv(tmp_path):
     expected_columns = ["num_fills", "final_position", "total_pnl"]
     for col in expected_columns:
         assert col in pnl_df.columns
+
+
+def test_native_replay_matches_python(sample_parquet_file):
+    """test that native replay leaves the same book and fills as pandas replay"""
+    naive_maker = NaiveMaker(NaiveMakerConfig())
+    date = datetime.date(2024, 1, 1)
+    python_sim = Simulator(
+        symbol="btcusdt",
+        data_path=str(sample_parquet_file.parent),
+        strategy=naive_maker.quote_prices,
+    )
+    native_sim = Simulator(
+        symbol="btcusdt",
+        data_path=str(sample_parquet_file.parent),
+        strategy=naive_maker.quote_prices,
+        native=True,
+    )
+    python_sim.replay_date(date)
+    native_sim.replay_date(date)
+
+    assert native_sim.get_order_book_state() == python_sim.get_order_book_state()
+    assert native_sim.get_pnl_summary() == python_sim.get_pnl_summary()
+
+
+def test_native_replay_sampling(sample_parquet_file):
+    """test that native replay only runs the strategy on sampled messages"""
+    calls = []
+
+    def strategy(**kwargs):
+        calls.append(kwargs["best_bid"])
+        return NaiveMaker(NaiveMakerConfig()).quote_prices(**kwargs)
+
+    simulator = Simulator(
+        symbol="btcusdt",
+        data_path=str(sample_parquet_file.parent),
+        strategy=strategy,
+        native=True,
+        sample_every=2,
+    )
+    simulator.replay_date(datetime.date(2024, 1, 1))
+    assert len(calls) == 1
+
+    # the sampled book is the second message
+    bids, asks = simulator.get_order_book_state()
+    assert ["100.0", "2.0"] in bids
+    assert ["101.0", "2.0"] in asks
+
+
+def test_native_replay_missing_file(test_data_dir):
+    """test that native replay skips missing files like pandas replay"""
+    naive_maker = NaiveMaker(NaiveMakerConfig())
+    simulator = Simulator(
+        symbol="btcusdt",
+        data_path=str(test_data_dir),
+        strategy=naive_maker.quote_prices,
+        native=True,
+    )
+    date = datetime.date(2024, 1, 1)
+    with pytest.raises(FileNotFoundError):
+        simulator.replay_date(date)
+    simulator.replay_date_range(date, date)
+    assert simulator.get_order_book_state() == ([], [])
+
+
+def _write_diffs(data_dir, updates):
+    """write depth diffs as (first_update_id, final_update_id, bids, asks)"""
+    test_data = {
+        "event_type": ["depthUpdate"] * len(updates),
+        "event_time": [1000 * (i + 1) for i in range(len(updates))],
+        "symbol": ["btcusdt"] * len(updates),
+        "first_update_id": [u[0] for u in updates],
+        "final_update_id": [u[1] for u in updates],
+        "bids": [u[2] for u in updates],
+        "asks": [u[3] for u in updates],
+    }
+    pd.DataFrame(test_data).to_parquet(data_dir / "btcusdt_20240101.parquet")
+
+
+def _market_levels(simulator):
+    """market-only (bids, asks) from the simulator book"""
+
+    def market(levels):
+        return {
+            price: orders[0].size
+            for price, orders in levels.items()
+            if orders[0].order_id.startswith("mkt_")
+        }
+
+    return market(simulator.order_book.bids), market(simulator.order_book.asks)
+
+
+def test_incremental_replay_applies_diffs(test_data_dir):
+    """test that incremental mode keeps untouched levels and deletes qty 0"""
+    _write_diffs(
+        test_data_dir,
+        [
+            (1, 1, ["100.0,1.0", "99.0,2.0"], ["101.0,1.0", "102.0,2.0"]),
+            (2, 3, ["99.0,0.0"], ["101.0,3.0"]),
+        ],
+    )
+    naive_maker = NaiveMaker(NaiveMakerConfig())
+    simulator = Simulator(
+        symbol="btcusdt",
+        data_path=str(test_data_dir),
+        strategy=naive_maker.quote_prices,
+        incremental=True,
+    )
+    simulator.replay_date(datetime.date(2024, 1, 1))
+
+    bids, asks = _market_levels(simulator)
+    assert bids == {Decimal("100.0"): Decimal("1.0")}
+    assert asks == {Decimal("101.0"): Decimal("3.0"), Decimal("102.0"): Decimal("2.0")}
+    assert simulator.last_update_id == 3
+    assert simulator.sequence_gaps == 0
+
+
+def test_incremental_replay_sequence_checks(test_data_dir):
+    """test that stale diffs are skipped and gaps are counted"""
+    _write_diffs(
+        test_data_dir,
+        [
+            (10, 12, ["100.0,1.0"], ["101.0,1.0"]),
+            (11, 12, ["100.0,0.0"], []),
+            (20, 21, ["99.0,1.0"], []),
+        ],
+    )
+    for native in (False, True):
+        naive_maker = NaiveMaker(NaiveMakerConfig())
+        simulator = Simulator(
+            symbol="btcusdt",
+            data_path=str(test_data_dir),
+            strategy=naive_maker.quote_prices,
+            incremental=True,
+            native=native,
+        )
+        simulator.replay_date(datetime.date(2024, 1, 1))
+
+        bids, _ = _market_levels(simulator)
+        assert bids == {Decimal("100.0"): Decimal("1"), Decimal("99.0"): Decimal("1")}
+        assert simulator.stale_updates == 1
+        assert simulator.sequence_gaps == 1
+        assert simulator.last_update_id == 21
+
+
+def test_replay_schema_v2(test_data_dir, sample_parquet_file):
+    """test integer-level files replay like string-level ones on both paths"""
+    v2_dir = test_data_dir / "v2"
+    writer = ParquetWriter(
+        base_path=str(v2_dir), schema_version=2, tick_size="0.5", lot_size="0.5"
+    )
+    for message in pq.read_table(sample_parquet_file).to_pylist():
+        writer.write(
+            {
+                "e": message["event_type"],
+                # land in the 2024-01-01 file the simulator looks for
+                "E": 1704067200000 + message["event_time"] % 1000,
+                "s": message["symbol"],
+                "U": message["first_update_id"],
+                "u": message["final_update_id"],
+                "b": [level.split(",") for level in message["bids"]],
+                "a": [level.split(",") for level in message["asks"]],
+            }
+        )
+    writer.close()
+
+    date = datetime.date(2024, 1, 1)
+    states = []
+    for data_path, native in [
+        (sample_parquet_file.parent, False),
+        (v2_dir, False),
+        (v2_dir, True),
+    ]:
+        simulator = Simulator(
+            symbol="btcusdt",
+            data_path=str(data_path),
+            strategy=NaiveMaker(NaiveMakerConfig()).quote_prices,
+            native=native,
+        )
+        simulator.replay_date(date)
+        market = {
+            side: {
+                price: orders[0].size
+                for price, orders in levels.items()
+                if orders[0].order_id.startswith("mkt_")
+            }
+            for side, levels in [
+                ("bids", simulator.order_book.bids),
+                ("asks", simulator.order_book.asks),
+            ]
+        }
+        states.append((market, simulator.get_pnl_summary()))
+
+    assert states[0] == states[1] == states[2]
+
+
+def test_queue_fills_wait_for_size_ahead(test_data_dir):
+    """test joined quotes fill only once the size ahead of them has traded"""
+    _write_diffs(
+        test_data_dir,
+        [
+            (1, 1, ["100.0,2.0"], ["101.0,3.0"]),
+            (2, 2, ["100.0,0.5"], []),
+            # joins behind our bid
+            (3, 3, ["100.0,2.5"], []),
+            # 0.5 ahead of us, then 0.3 of ours
+            (4, 4, ["100.0,1.7"], []),
+            # bids through our ask
+            (5, 5, ["101.0,1.0"], ["101.0,0.0", "101.5,2.0"]),
+        ],
+    )
+
+    def join_touch(**kwargs):
+        size = Decimal("1.0")
+        return Quote(kwargs["best_bid"], size), Quote(kwargs["best_ask"], size)
+
+    for native in (False, True):
+        simulator = Simulator(
+            symbol="btcusdt",
+            data_path=str(test_data_dir),
+            strategy=join_touch,
+            incremental=True,
+            native=native,
+            queue_fills=True,
+        )
+        simulator.replay_date(datetime.date(2024, 1, 1))
+
+        fills = [(f.timestamp, f.side, f.price, f.size) for f in simulator.fills]
+        assert fills == [
+            (4000, "buy", Decimal("100.0"), Decimal("0.3")),
+            (5000, "sell", Decimal("101.0"), Decimal("1.0")),
+        ]
+        assert simulator.position == Decimal("-0.7")
+        # the strategy's quotes never enter the market book
+        assert simulator.get_order_book_state() == (
+            [["101.0", "1.0"], ["100.0", "1.7"]],
+            [["101.5", "2.0"]],
+        )
+        # the bid moved up to the new touch and joined behind its 1.0
+        assert simulator._queue.queue(simulator._resting["buy"][0]) == (1.0, 1.0)
+
+
+def test_queue_fills_see_levels_a_full_book_drops(test_data_dir):
+    """test a level a full message leaves out empties the queue ahead of us"""
+    _write_diffs(
+        test_data_dir,
+        [
+            (1, 1, ["100.0,2.0", "99.0,1.0"], ["101.0,3.0"]),
+            # our level is gone, taking the 2.0 ahead of us with it
+            (2, 2, ["99.5,1.0", "99.0,1.0"], ["101.0,3.0"]),
+            # size back at our price joins behind us
+            (3, 3, ["100.0,0.5", "99.0,1.0"], ["101.0,3.0"]),
+            (4, 4, ["100.0,0.2", "99.0,1.0"], ["101.0,3.0"]),
+        ],
+    )
+
+    def fixed(**kwargs):
+        size = Decimal("1.0")
+        return Quote(Decimal("100.0"), size), Quote(Decimal("101.0"), size)
+
+    for native in (False, True):
+        simulator = Simulator(
+            symbol="btcusdt",
+            data_path=str(test_data_dir),
+            strategy=fixed,
+            native=native,
+            queue_fills=True,
+        )
+        simulator.replay_date(datetime.date(2024, 1, 1))
+
+        fills = [(f.timestamp, f.side, f.price, f.size) for f in simulator.fills]
+        assert fills == [(4000, "buy", Decimal("100.0"), Decimal("0.3"))]
+        assert simulator._queue.queue(simulator._resting["sell"][0]) == (3.0, 1.0)
+
+
+def test_latency_delays_quotes_on_the_event_clock(test_data_dir):
+    """test a quote meets the book it arrives at, stamped with its arrival"""
+    _write_diffs(
+        test_data_dir,
+        [
+            (1, 1, ["100.0,1.0"], ["101.0,1.0"]),
+            (2, 2, ["100.0,1.0"], ["100.5,1.0"]),
+            (3, 3, ["100.0,1.0"], ["100.5,1.0"]),
+        ],
+    )
+
+    def lift_once(**kwargs):
+        # cross on the first book only, then stay out of the way
+        bid = Decimal("101.0") if not calls else Decimal("90.0")
+        calls.append(kwargs["best_ask"])
+        return Quote(bid, Decimal("1.0")), Quote(Decimal("110.0"), Decimal("1.0"))
+
+    for latency, expected in [
+        (None, (1000, Decimal("101.0"))),
+        # decided at 1000, seen at 1500, on the book at 2500
+        (LatencyModel(feed=500, order=1000), (2500, Decimal("100.5"))),
+    ]:
+        for native in (False, True):
+            calls = []
+            simulator = Simulator(
+                symbol="btcusdt",
+                data_path=str(test_data_dir),
+                strategy=lift_once,
+                native=native,
+                latency=latency,
+            )
+            simulator.replay_date(datetime.date(2024, 1, 1))
+
+            fills = [(f.timestamp, f.price) for f in simulator.fills]
+            assert fills == [expected]
+            assert simulator.clock == 3000
+            # quotes made on the last books are still in flight
+            assert len(simulator.events) == (0 if latency is None else 2)
+
+
+def test_quotes_arriving_together_get_distinct_ids(test_data_dir):
+    """test two placements at one event time rest as two orders"""
+    simulator = Simulator(
+        symbol="btcusdt",
+        data_path=str(test_data_dir),
+        strategy=lambda **kwargs: None,
+        latency=LatencyModel(feed=500, order=1000),
+    )
+    size = Decimal("1.0")
+    bid, ask = Quote(Decimal("99.0"), size), Quote(Decimal("101.0"), size)
+    for _ in range(2):
+        simulator._place_quotes(2500, bid, ask)
+
+    for levels in (simulator.order_book.bids, simulator.order_book.asks):
+        (orders,) = levels.values()
+        assert len({order.order_id for order in orders}) == 2
@@ -0,0 +1,68 @@
+"""
+tests for redis stream payload encodings
+"""
+
+import json
+
+import pytest
+
+from data_feed.schemas import DepthUpdate
+from data_feed.stream_codec import (
+    decode_binary,
+    decode_fields,
+    encode_binary,
+    encode_fields,
+)
+
+
+@pytest.fixture
+def message():
+    """depth update as the recorder hands it over"""
+    return {
+        "e": "depthUpdate",
+        "E": 1623456789000,
+        "s": "BTCUSDT",
+        "U": 1234567,
+        "u": 1234568,
+        "b": [["50000.00", "1.000"], ["49999.99", "0.00000000"]],
+        "a": [["50001.00", "1.000"]],
+    }
+
+
+def test_binary_round_trip(message):
+    """test a binary payload decodes to exactly the encoded update"""
+    payload = encode_binary(message)
+    assert decode_binary(payload) == DepthUpdate(**message)
+    assert len(payload) < len(json.dumps(message))
+
+    message["b"] = message["a"] = []
+    assert decode_binary(encode_binary(message)) == DepthUpdate(**message)
+
+
+def test_fields_pick_the_format(message):
+    """test the reader follows whichever field the entry was written with"""
+    update = DepthUpdate(**message)
+    for payload_format in ("json", "binary"):
+        fields = encode_fields(message, payload_format)
+        as_read = {
+            key.encode(): value.encode() if isinstance(value, str) else value
+            for key, value in fields.items()
+        }
+        assert decode_fields(fields) == update
+        assert decode_fields(as_read) == update
+
+    with pytest.raises(ValueError, match="format"):
+        encode_fields(message, "msgpack")
+    with pytest.raises(KeyError):
+        decode_fields({b"other": b""})
+
+
+def test_binary_rejects_bad_payloads(message):
+    """test truncated and unknown payloads raise instead of misreading"""
+    payload = encode_binary(message)
+    with pytest.raises(ValueError, match="truncated"):
+        decode_binary(payload[:10])
+    with pytest.raises(ValueError, match="truncated"):
+        decode_binary(payload[:-1])
+    with pytest.raises(ValueError, match="version"):
+        decode_binary(b"\x02" + payload[1:])
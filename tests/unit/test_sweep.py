@@ -0,0 +1,157 @@
+"""
+unit tests for the parameter sweep runner
+"""
+
+import datetime
+from decimal import Decimal
+
+import pyarrow as pa
+import pyarrow.parquet as pq
+import pytest
+
+from backtest.simulator import Simulator
+from backtest.sweep import SweepRunner, ev_maker_strategy
+from storage.tick_store import convert_parquet
+from strategy.ev_maker import Quote
+
+DATES = [datetime.date(2024, 1, 1), datetime.date(2024, 1, 2)]
+DAY_MS = 1704067200000  # 2024-01-01 00:00 UTC
+
+
+def _edge_strategy(params):
+    """quotes a bid `edge` above mid, so a large edge crosses the ask"""
+    edge = Decimal(str(params["edge"]))
+
+    def quote_prices(mid_price, **kwargs):
+        return (
+            Quote(mid_price + edge, Decimal("0.1")),
+            Quote(mid_price + Decimal("10"), Decimal("0.1")),
+        )
+
+    return quote_prices
+
+
+@pytest.fixture
+def data_dir(tmp_path):
+    """two days of string-level parquet files"""
+    sch = pa.schema(
+        [
+            ("event_type", pa.string()),
+            ("event_time", pa.int64()),
+            ("symbol", pa.string()),
+            ("first_update_id", pa.int64()),
+            ("final_update_id", pa.int64()),
+            ("bids", pa.list_(pa.string())),
+            ("asks", pa.list_(pa.string())),
+        ]
+    )
+    for day, date in enumerate(DATES):
+        rows = [
+            {
+                "event_type": "depthUpdate",
+                "event_time": DAY_MS + day * 86400000 + i,
+                "symbol": "btcusdt",
+                "first_update_id": i + 1,
+                "final_update_id": i + 1,
+                "bids": [f"{100 + i}.0,1.0", f"{99 + i}.0,2.0"],
+                "asks": [f"{101 + i}.0,1.0", f"{102 + i}.0,2.0"],
+            }
+            for i in range(5)
+        ]
+        path = tmp_path / f"btcusdt_{date.strftime('%Y%m%d')}.parquet"
+        pq.write_table(pa.Table.from_pylist(rows, schema=sch), path)
+    return tmp_path
+
+
+def _serial_summary(data_dir, params):
+    simulator = Simulator(
+        symbol="btcusdt", data_path=str(data_dir), strategy=_edge_strategy(params)
+    )
+    for date in DATES:
+        simulator.replay_date(date)
+    return simulator.get_pnl_summary()
+
+
+@pytest.mark.parametrize("workers", [1, 3])
+def test_sweep_matches_serial_runs(data_dir, workers):
+    """test every config reports what a serial Simulator run would"""
+    configs = [{"edge": edge} for edge in ("0", "0.8", "2")]
+    runner = SweepRunner(
+        "BTCUSDT", str(data_dir), strategy_factory=_edge_strategy, workers=workers
+    )
+    assert runner.load(DATES) == 10
+
+    results = runner.run(configs)
+    assert list(results["edge"]) == ["0", "0.8", "2"]
+    for row, params in zip(results.to_dict("records"), configs):
+        expected = _serial_summary(data_dir, params)
+        assert {key: row[key] for key in expected} == expected
+    assert results["num_fills"].iloc[0] == 0
+    assert results["num_fills"].iloc[2] > 0
+
+
+def test_sweep_reuses_loaded_days(data_dir):
+    """test repeated runs replay the decoded days without reloading"""
+    runner = SweepRunner(
+        "btcusdt", str(data_dir), strategy_factory=_edge_strategy, workers=1
+    )
+    runner.load(DATES)
+    for path in data_dir.glob("*.parquet"):
+        path.unlink()
+
+    first = runner.run([{"edge": "2"}])
+    second = runner.run([{"edge": "2"}])
+    assert first.to_dict("records") == second.to_dict("records")
+
+
+def test_sweep_from_tick_store(data_dir, tmp_path):
+    """test days mapped from tick store files give the parquet results"""
+    store_dir = tmp_path / "ticks"
+    for path in sorted(data_dir.glob("*.parquet")):
+        convert_parquet(path, store_dir, "btcusdt", tick_size="0.1", lot_size="0.1")
+    configs = [{"edge": "0"}, {"edge": "2"}]
+
+    from_parquet = SweepRunner(
+        "btcusdt", str(data_dir), strategy_factory=_edge_strategy, workers=2
+    )
+    from_parquet.load(DATES)
+    from_store = SweepRunner(
+        "btcusdt",
+        str(data_dir),
+        strategy_factory=_edge_strategy,
+        tick_store_path=str(store_dir),
+        workers=2,
+    )
+    from_store.load(DATES)
+    expected = from_parquet.run(configs).to_dict("records")
+    assert from_store.run(configs).to_dict("records") == expected
+
+
+def test_sweep_missing_day(data_dir):
+    """test loading a day without data raises"""
+    runner = SweepRunner("btcusdt", str(data_dir), strategy_factory=_edge_strategy)
+    with pytest.raises(FileNotFoundError):
+        runner.load([datetime.date(2024, 2, 1)])
+
+
+def test_sweep_invalid_workers(data_dir):
+    """test a pool needs at least one worker"""
+    with pytest.raises(ValueError):
+        SweepRunner("btcusdt", str(data_dir), workers=0)
+
+
+def test_ev_maker_strategy_params():
+    """test flat params land in EVConfig and InventorySkewConfig"""
+    quote_prices = ev_maker_strategy(
+        {"max_spread": "0.002", "num_points": 5, "skew_factor": 0.25}
+    )
+    config = quote_prices.__self__.config
+    assert config.max_spread == Decimal("0.002")
+    assert config.num_points == 5
+    assert config.inventory_config.skew_factor == 0.25
+    assert config.min_spread == Decimal("0.0005")
+
+    with pytest.raises(ValueError):
+        ev_maker_strategy({"spread": "0.01"})
+    with pytest.raises(ValueError):
+        ev_maker_strategy({"skew_factor": 0})
@@ -0,0 +1,273 @@
+"""
+unit tests for the memory-mapped tick store
+"""
+
+import datetime
+from decimal import Decimal
+
+import pandas as pd
+import pytest
+
+from backtest.simulator import Simulator
+from data_feed.parquet_writer import ParquetWriter
+from storage.tick_store import (
+    HEADER_SIZE,
+    INDEX_DTYPE,
+    LEVEL_DTYPE,
+    TickStoreReader,
+    TickStoreWriter,
+    checkpoint_paths,
+    convert_parquet,
+    tick_store_paths,
+    write_checkpoints,
+)
+from strategy.naive_maker import NaiveMaker, NaiveMakerConfig
+
+DAY_MS = 1704067200000  # 2024-01-01 00:00 UTC
+
+
+def _message(event_time, update_id, bids, asks):
+    return {
+        "e": "depthUpdate",
+        "E": event_time,
+        "s": "BTCUSDT",
+        "U": update_id,
+        "u": update_id,
+        "b": bids,
+        "a": asks,
+    }
+
+
+@pytest.fixture
+def store_dir(tmp_path):
+    """directory with three messages on 2024-01-01"""
+    writer = TickStoreWriter(base_path=tmp_path, tick_size="0.01", lot_size="0.001")
+    writer.write(_message(DAY_MS + 100, 1, [["100.00", "1.000"]], [["100.01", "2"]]))
+    writer.write(_message(DAY_MS + 200, 2, [], [["100.02", "0.5"]]))
+    writer.write(
+        _message(DAY_MS + 300, 3, [["99.99", "3"], ["99.98", "4"]], [["100.01", "1"]])
+    )
+    writer.close()
+    return tmp_path
+
+
+def test_round_trip(store_dir):
+    """test levels come back in ticks/lots with the stored grid"""
+    reader = TickStoreReader.open(store_dir, "btcusdt", datetime.date(2024, 1, 1))
+    assert len(reader) == 3
+    assert reader.tick_size == Decimal("0.01")
+    assert reader.lot_size == Decimal("0.001")
+
+    event_time, first_id, final_id, bids, asks = reader.message(0)
+    assert (event_time, first_id, final_id) == (DAY_MS + 100, 1, 1)
+    assert bids.tolist() == [(10000, 1000)]
+    assert asks.tolist() == [(10001, 2000)]
+
+    _, _, _, bids, asks = reader.message(1)
+    assert len(bids) == 0
+    assert asks.tolist() == [(10002, 500)]
+
+
+def test_fixed_size_records(store_dir):
+    """test files are a header plus whole fixed-size records"""
+    ticks_path, index_path = tick_store_paths(
+        store_dir, "btcusdt", datetime.date(2024, 1, 1)
+    )
+    assert index_path.stat().st_size == HEADER_SIZE + 3 * INDEX_DTYPE.itemsize
+    assert ticks_path.stat().st_size == HEADER_SIZE + 6 * LEVEL_DTYPE.itemsize
+
+
+def test_seek(store_dir):
+    """test seeking by timestamp without scanning earlier messages"""
+    reader = TickStoreReader.open(store_dir, "btcusdt", datetime.date(2024, 1, 1))
+    assert reader.seek(0) == 0
+    assert reader.seek(DAY_MS + 200) == 1
+    assert reader.seek(DAY_MS + 201) == 2
+    assert reader.seek(DAY_MS + 10_000) == 3
+
+    times = [m[0] for m in reader.iter_messages(DAY_MS + 150, DAY_MS + 300)]
+    assert times == [DAY_MS + 200]
+
+
+def test_append_reopens_day(store_dir):
+    """test a restarted writer appends to the same day's files"""
+    writer = TickStoreWriter(base_path=store_dir, tick_size="0.01", lot_size="0.001")
+    writer.write(_message(DAY_MS + 400, 4, [["99.00", "1"]], []))
+    writer.close()
+
+    reader = TickStoreReader.open(store_dir, "btcusdt", datetime.date(2024, 1, 1))
+    assert len(reader) == 4
+    _, _, _, bids, _ = reader.message(3)
+    assert bids.tolist() == [(9900, 1000)]
+
+
+def test_grid_mismatch_on_append(store_dir):
+    """test appending with a different grid is refused"""
+    writer = TickStoreWriter(base_path=store_dir, tick_size="0.1", lot_size="0.001")
+    with pytest.raises(ValueError):
+        writer.write(_message(DAY_MS + 400, 4, [], []))
+    writer.close()
+
+
+def test_torn_write_is_dropped(store_dir):
+    """test index entries past the level file are ignored and overwritten"""
+    ticks_path, _ = tick_store_paths(store_dir, "btcusdt", datetime.date(2024, 1, 1))
+    # lose the last message's levels and half a record
+    size = ticks_path.stat().st_size
+    with open(ticks_path, "r+b") as f:
+        f.truncate(size - 2 * LEVEL_DTYPE.itemsize - 8)
+
+    reader = TickStoreReader.open(store_dir, "btcusdt", datetime.date(2024, 1, 1))
+    assert len(reader) == 2
+
+    writer = TickStoreWriter(base_path=store_dir, tick_size="0.01", lot_size="0.001")
+    writer.write(_message(DAY_MS + 400, 4, [["99.00", "1"]], []))
+    writer.close()
+    reader = TickStoreReader.open(store_dir, "btcusdt", datetime.date(2024, 1, 1))
+    assert [m[2] for m in reader.iter_messages()] == [1, 2, 4]
+    assert reader.message(2)[3].tolist() == [(9900, 1000)]
+
+
+def test_missing_day(tmp_path):
+    """test opening a day without files"""
+    with pytest.raises(FileNotFoundError):
+        TickStoreReader.open(tmp_path, "btcusdt", datetime.date(2024, 1, 1))
+
+
+@pytest.mark.parametrize("schema_version", [1, 2])
+def test_convert_parquet(tmp_path, schema_version):
+    """test converting recorded parquet files of both schema versions"""
+    raw_dir = tmp_path / "raw"
+    writer = ParquetWriter(
+        base_path=raw_dir, schema_version=schema_version, tick_size="0.01"
+    )
+    writer.write(_message(DAY_MS + 100, 1, [["100.00", "1.5"]], [["100.01", "2"]]))
+    writer.write(_message(DAY_MS + 200, 2, [["100.01", "1"]], []))
+    writer.close()
+
+    ticks_dir = tmp_path / "ticks"
+    count = convert_parquet(
+        raw_dir / "btcusdt_20240101.parquet",
+        ticks_dir,
+        "btcusdt",
+        tick_size="0.01",
+        lot_size="0.1",
+    )
+    assert count == 2
+
+    reader = TickStoreReader.open(ticks_dir, "btcusdt", datetime.date(2024, 1, 1))
+    assert reader.message(0)[3].tolist() == [(10000, 15)]
+    assert reader.message(1)[3].tolist() == [(10001, 10)]
+
+
+def test_simulator_replays_tick_store(tmp_path):
+    """test the simulator gives the same result from parquet and tick store"""
+    raw_dir = tmp_path / "raw"
+    test_data = {
+        "event_type": ["depthUpdate"] * 3,
+        "event_time": [DAY_MS + 1000, DAY_MS + 2000, DAY_MS + 3000],
+        "symbol": ["btcusdt"] * 3,
+        "first_update_id": [1, 2, 3],
+        "final_update_id": [1, 2, 3],
+        "bids": [
+            ["10000.0,1.0", "9999.0,1.0"],
+            ["10001.0,1.0", "10000.0,1.0"],
+            ["10002.0,1.0", "10001.0,1.0"],
+        ],
+        "asks": [
+            ["10001.0,1.0", "10002.0,1.0"],
+            ["10002.0,1.0", "10003.0,1.0"],
+            ["10003.0,1.0", "10004.0,1.0"],
+        ],
+    }
+    raw_dir.mkdir()
+    parquet_path = raw_dir / "btcusdt_20240101.parquet"
+    pd.DataFrame(test_data).to_parquet(parquet_path)
+    ticks_dir = tmp_path / "ticks"
+    convert_parquet(parquet_path, ticks_dir, "btcusdt")
+
+    def run(**kwargs):
+        calls = []
+
+        def strategy(**quote_kwargs):
+            calls.append(quote_kwargs["best_bid"])
+            return NaiveMaker(NaiveMakerConfig()).quote_prices(**quote_kwargs)
+
+        simulator = Simulator(
+            symbol="btcusdt", data_path=str(raw_dir), strategy=strategy, **kwargs
+        )
+        simulator.replay_date(datetime.date(2024, 1, 1), start_time=DAY_MS + 2000)
+        return simulator.get_pnl_summary(), calls
+
+    from_parquet = run()
+    from_ticks = run(tick_store_path=str(ticks_dir))
+    assert from_ticks == from_parquet
+    # the first message is before start_time
+    assert len(from_ticks[1]) == 2
+
+
+def test_checkpoints(store_dir):
+    """test checkpoints hold the diff book at every n-th message"""
+    date = datetime.date(2024, 1, 1)
+    writer = TickStoreWriter(base_path=store_dir, tick_size="0.01", lot_size="0.001")
+    # stale, then a deletion
+    writer.write(_message(DAY_MS + 400, 2, [["99.00", "1"]], []))
+    writer.write(_message(DAY_MS + 500, 4, [["99.99", "0"]], []))
+    writer.close()
+    assert write_checkpoints(store_dir, "btcusdt", date, every=2) == 2
+    assert all(path.exists() for path in checkpoint_paths(store_dir, "btcusdt", date))
+
+    reader = TickStoreReader.open(store_dir, "btcusdt", date)
+    assert reader.checkpoint(1) is None
+    position, last_update_id, bids, asks = reader.checkpoint(3)
+    assert (position, last_update_id) == (2, 2)
+    assert bids.tolist() == [(10000, 1000)]
+    assert asks.tolist() == [(10001, 2000), (10002, 500)]
+
+    position, last_update_id, bids, asks = reader.checkpoint(10)
+    assert (position, last_update_id) == (4, 3)
+    assert bids.tolist() == [(10000, 1000), (9999, 3000), (9998, 4000)]
+    assert asks.tolist() == [(10001, 1000), (10002, 500)]
+
+
+def test_simulator_warm_starts_from_checkpoint(tmp_path):
+    """test a mid-day diff replay sees the book a full replay would"""
+    writer = TickStoreWriter(base_path=tmp_path, tick_size="0.01", lot_size="0.001")
+    for i in range(9):
+        bid = f"{100 - i * 0.01:.2f}"
+        ask = f"{101 + i * 0.01:.2f}"
+        writer.write(_message(DAY_MS + i * 100, i + 1, [[bid, "1"]], [[ask, "1"]]))
+    writer.close()
+    write_checkpoints(tmp_path, "btcusdt", datetime.date(2024, 1, 1), every=4)
+
+    def run(start_time=None):
+        books = []
+
+        def market(levels):
+            return sorted(
+                price
+                for price, orders in levels.items()
+                if any(order.order_id.startswith("mkt_") for order in orders)
+            )
+
+        def strategy(**quote_kwargs):
+            book = simulator.order_book
+            books.append((market(book.bids), market(book.asks)))
+            return NaiveMaker(NaiveMakerConfig()).quote_prices(**quote_kwargs)
+
+        simulator = Simulator(
+            symbol="btcusdt",
+            data_path=str(tmp_path),
+            strategy=strategy,
+            incremental=True,
+            tick_store_path=str(tmp_path),
+        )
+        simulator.replay_date(datetime.date(2024, 1, 1), start_time=start_time)
+        return books, simulator.last_update_id
+
+    full_books, full_last = run()
+    # starts from the checkpoint at message 4 and applies 4 and 5 silently
+    warm_books, warm_last = run(start_time=DAY_MS + 600)
+    assert warm_books == full_books[6:]
+    assert len(warm_books[0][0]) == 7
+    assert warm_last == full_last == 9
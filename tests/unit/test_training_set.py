@@ -0,0 +1,146 @@
+"""
+unit tests for columnar fill probability training sets
+"""
+
+from decimal import Decimal
+
+import numpy as np
+import pandas as pd
+import pyarrow as pa
+import pytest
+
+from data_feed.parquet_writer import LEVEL_TYPE
+from models.fill_prob import FillProbabilityModel
+from models.training_set import (
+    FEATURE_COLUMNS,
+    NEGATIVE_OFFSET,
+    build_training_set,
+    level_arrays,
+)
+
+
+def _records(n: int):
+    return [
+        {
+            "bids": [[f"{100 - i * 0.01:.2f}", "1.0"], ["99.0", str(i % 4)]],
+            "asks": [[f"{100 + i * 0.01:.2f}", str(1.0 + i % 3)]]
+            + [[f"{101 + k}", "0.5"] for k in range(i % 6)],
+            "price": f"{100 + (i % 7 - 3) * 0.1:.1f}",
+            "size": "0.5",
+            "side": "buy" if i % 2 == 0 else "sell",
+        }
+        for i in range(n)
+    ]
+
+
+def _fills(n: int = 40) -> pd.DataFrame:
+    return pd.DataFrame(_records(n))
+
+
+def _expected(fills: pd.DataFrame, negatives: int, seed: int) -> np.ndarray:
+    """rows the per-fill extract_features loop gives for the same offsets"""
+    np.random.seed(seed)
+    offsets = np.random.uniform(0.5, 1.5, size=(len(fills), negatives))
+    model = FillProbabilityModel()
+    rows = []
+    for (_, row), row_offsets in zip(fills.iterrows(), offsets):
+        price = Decimal(row["price"])
+        sign = 1 if row["side"] == "buy" else -1
+        prices = [price] + [
+            price - sign * Decimal(str(NEGATIVE_OFFSET * u)) for u in row_offsets
+        ]
+        for order_price in prices:
+            features = model.extract_features(
+                row["bids"],
+                row["asks"],
+                order_price,
+                Decimal(row["size"]),
+                row["side"],
+            )
+            rows.append(features.to_array())
+    return np.array(rows)
+
+
+def test_matches_extract_features():
+    fills = _fills()
+    np.random.seed(3)
+    X, y = build_training_set(fills, negatives=5)
+
+    assert X.shape == (len(fills) * 6, len(FEATURE_COLUMNS))
+    assert y.tolist() == ([1] + [0] * 5) * len(fills)
+    np.testing.assert_allclose(X, _expected(fills, 5, 3), rtol=1e-9, atol=1e-12)
+
+
+def test_chunks_and_workers_give_the_same_rows():
+    fills = _fills(50)
+    np.random.seed(11)
+    whole, labels = build_training_set(fills)
+
+    chunks = [fills.iloc[i : i + 16] for i in range(0, len(fills), 16)]
+    np.random.seed(11)
+    chunked, chunked_labels = build_training_set(iter(chunks))
+    np.random.seed(11)
+    parallel, parallel_labels = build_training_set(chunks, workers=2)
+
+    np.testing.assert_array_equal(chunked, whole)
+    np.testing.assert_array_equal(parallel, whole)
+    np.testing.assert_array_equal(parallel_labels, labels)
+    np.testing.assert_array_equal(chunked_labels, labels)
+
+
+def test_arrow_tick_levels():
+    fills = _fills(12)
+    units = (Decimal("0.01"), Decimal("0.1"))
+
+    def to_levels(column):
+        return pa.array(
+            [
+                [
+                    {"price": round(float(p) * 100), "qty": round(float(q) * 10)}
+                    for p, q in levels
+                ]
+                for levels in column
+            ],
+            type=LEVEL_TYPE,
+        )
+
+    batch = pa.RecordBatch.from_pydict(
+        {
+            "bids": to_levels(fills["bids"]),
+            "asks": to_levels(fills["asks"]),
+            "price": pa.array(fills["price"].astype(float)),
+            "size": pa.array(fills["size"]),
+            "side": pa.array(fills["side"]),
+        }
+    )
+    np.random.seed(5)
+    from_arrow, _ = build_training_set(batch, units=units)
+    np.random.seed(5)
+    from_lists, _ = build_training_set(fills)
+    np.testing.assert_allclose(from_arrow, from_lists, rtol=1e-12)
+
+    with pytest.raises(ValueError):
+        level_arrays(batch.column("bids"))
+
+
+def test_level_arrays_pad_short_books():
+    prices, qtys = level_arrays([[["10", "1"], ["9", "2"]], [], [["8.5", "3"]]])
+    np.testing.assert_array_equal(prices, [[10, 9], [0, 0], [8.5, 0]])
+    np.testing.assert_array_equal(qtys, [[1, 2], [0, 0], [3, 0]])
+
+
+def test_empty_book_rejected():
+    records = _records(3)
+    records[1]["bids"] = records[1]["asks"] = []
+    with pytest.raises(ValueError, match="snapshot 1"):
+        build_training_set(pd.DataFrame(records))
+    with pytest.raises(ValueError):
+        build_training_set(_fills(3), workers=0)
+
+
+def test_train_on_chunks(tmp_path):
+    fills = _fills(60)
+    model = FillProbabilityModel(model_path=str(tmp_path / "model.joblib"))
+    auc = model.train((fills.iloc[i : i + 20] for i in range(0, 60, 20)))
+    assert 0 <= auc <= 1
+    assert model.model.coef_.shape == (1, len(FEATURE_COLUMNS))
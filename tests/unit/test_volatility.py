@@ -2,11 +2,30 @@
 unit tests for short-term volatility feature calculation
 """
 
+import math
+import random
+import statistics
 from decimal import Decimal
 
 import pytest
 
-from features.volatility import VolatilityCalculator
+from features.volatility import (
+    ANNUALIZATION,
+    EwmaVolatility,
+    RealizedVolatility,
+    RollingStats,
+    VolatilityCalculator,
+)
+
+
+def _random_walk(count, seed=7):
+    rng = random.Random(seed)
+    price = 50000.0
+    prices = []
+    for _ in range(count):
+        price *= 1 + rng.gauss(0, 1e-4)
+        prices.append(price)
+    return prices
 
 
 def test_volatility_calculator_initialization():
@@ -73,3 +92,71 @@ def test_volatility_calculator_window_size():
 
     # volatility should be lower now due to window size
     assert calc.volatility < high_vol
+
+
+@pytest.mark.parametrize("window", [1, 2, 3, 20])
+def test_rolling_stats_matches_statistics(window):
+    """test the welford window against a full recompute after every push"""
+    stats = RollingStats(window)
+    values = _random_walk(500)
+    for i, value in enumerate(values):
+        stats.push(value)
+        kept = values[max(0, i + 1 - window) : i + 1]
+        assert len(stats) == len(kept)
+        assert stats.mean == pytest.approx(statistics.fmean(kept), rel=1e-12)
+        if len(kept) > 1:
+            expected = statistics.variance(kept)
+            assert stats.variance == pytest.approx(expected, rel=1e-6, abs=1e-12)
+        else:
+            assert stats.variance == 0.0
+
+
+def test_rolling_stats_rejects_empty_window():
+    """test a window must hold at least one value"""
+    with pytest.raises(ValueError):
+        RollingStats(0)
+
+
+def test_volatility_calculator_matches_full_recompute():
+    """test the O(1) update against the std of the window's returns"""
+    calc = VolatilityCalculator(window_size=20)
+    prices = _random_walk(300)
+    for i, price in enumerate(prices):
+        calc.update(Decimal(str(price)))
+        window = [float(str(p)) for p in prices[max(0, i - 19) : i + 1]]
+        returns = [(b - a) / a for a, b in zip(window, window[1:])]
+        expected = (
+            statistics.stdev(returns) * ANNUALIZATION if len(returns) > 1 else 0.0
+        )
+        assert calc.volatility == pytest.approx(expected, rel=1e-9, abs=1e-15)
+
+
+def test_ewma_volatility():
+    """test the ewma seeds on the first return then decays"""
+    ewma = EwmaVolatility(alpha=0.5)
+    assert ewma.update(Decimal("100")) == 0.0
+    first = ewma.update(Decimal("101"))
+    assert first == pytest.approx(0.01 * ANNUALIZATION)
+    # a flat price halves the variance
+    assert ewma.update(Decimal("101")) == pytest.approx(first / math.sqrt(2))
+
+    with pytest.raises(ValueError):
+        EwmaVolatility(alpha=0.0)
+    with pytest.raises(ValueError):
+        EwmaVolatility(alpha=1.5)
+
+
+def test_realized_volatility_per_horizon():
+    """test each horizon sums only its own most recent squared returns"""
+    realized = RealizedVolatility(horizons=(5, 2, 50, 5))
+    assert realized.horizons == (2, 5, 50)
+    prices = _random_walk(400)
+    for i, price in enumerate(prices):
+        result = realized.update(price)
+        returns = [(b - a) / a for a, b in zip(prices[: i + 1], prices[1 : i + 1])]
+        for horizon in realized.horizons:
+            expected = math.sqrt(math.fsum(r * r for r in returns[-horizon:]))
+            assert result[horizon] == pytest.approx(expected, rel=1e-9, abs=1e-15)
+
+    with pytest.raises(ValueError):
+        RealizedVolatility(horizons=(0, 10))